@@ -0,0 +1,73 @@
+#ifndef BENCH_UTILS_H
+#define BENCH_UTILS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "esp_log.h"
+
+#include "globalComponents.h"
+
+/**
+ * Generate an irrigation configuration with all zones and the given number of events.
+ *
+ * The events are spread evenly over the day, so they never overlap. Every fourth event is
+ * a weekly recurrence, the others are daily events.
+ */
+static inline std::string benchMakeIrrigationConfig(unsigned int numEvents)
+{
+    std::string json = "{\n  \"zones\": [\n";
+    char buf[256];
+
+    for(unsigned int i = 0; i < irrigationPlannerNumZones; i++) {
+        snprintf(buf, sizeof(buf),
+            "    {\"name\": \"Z%u\", \"chEnabled\": [true, false, false, false], \"chNum\": [%u, -1, -1, -1], "
+            "\"chStateStart\": [true, false, false, false], \"chStateStop\": [false, false, false, false]}%s\n",
+            i, i % 3, (i + 1 < irrigationPlannerNumZones) ? "," : "");
+        json += buf;
+    }
+
+    json += "  ],\n  \"events\": [\n";
+
+    unsigned int spacing = 86400 / ((numEvents > 0) ? numEvents : 1);
+    unsigned int duration = (spacing > 120) ? 60 : (spacing / 2);
+    for(unsigned int i = 0; i < numEvents; i++) {
+        unsigned int secOfDay = i * spacing;
+        if(3 == (i % 4)) {
+            snprintf(buf, sizeof(buf),
+                "    {\"zoneNum\": %u, \"durationSecs\": %u, \"isRecurring\": true, \"hour\": %u, \"minute\": %u, "
+                "\"weekdays\": [1, 3, 5]}",
+                i % irrigationPlannerNumZones, duration, secOfDay / 3600, (secOfDay / 60) % 60);
+        } else {
+            snprintf(buf, sizeof(buf),
+                "    {\"zoneNum\": %u, \"durationSecs\": %u, \"isDaily\": true, \"hour\": %u, \"minute\": %u, \"second\": %u}",
+                i % irrigationPlannerNumZones, duration, secOfDay / 3600, (secOfDay / 60) % 60, secOfDay % 60);
+        }
+        json += buf;
+        json += (i + 1 < numEvents) ? ",\n" : "\n";
+    }
+
+    json += "  ]\n}\n";
+
+    return json;
+}
+
+/** Publish the configuration and let the planner switch to it. Aborts on errors. */
+static inline void benchLoadIrrigationConfig(const std::string& json)
+{
+    SettingsManager::err_t err = settingsMgr.updateIrrigationConfig(json.c_str(), json.length(), true);
+    if(SettingsManager::ERR_OK != err) {
+        fprintf(stderr, "Loading irrigation config failed with %d.\n", err);
+        abort();
+    }
+    irrigPlanner.irrigConfigUpdated();
+}
+
+/** Common setup of all benchmarks: quiet logging. */
+static inline void benchSetup(void)
+{
+    esp_log_level_set("*", ESP_LOG_ERROR);
+}
+
+#endif /* BENCH_UTILS_H */
@@ -0,0 +1,83 @@
+/*
+ * Benchmarks of the CivilTime conversions compared to the ones of the C library, which
+ * the firmware used before.
+ */
+
+#include <stdlib.h>
+#include <ctime>
+#include <benchmark/benchmark.h>
+
+#include "benchUtils.h"
+
+static const char* benchTz = "CET-1CEST,M3.5.0,M10.5.0/3";
+/** 2020-06-01 00:00:00 UTC */
+static const time_t benchStartTime = 1590969600;
+
+static void BM_CivilTimeUtcToCivil(benchmark::State& state)
+{
+    benchSetup();
+    CivilTime ct;
+    civil_time_t civil;
+    time_t t = benchStartTime;
+
+    ct.setTimezone(benchTz);
+    for(auto _ : state) {
+        ct.utcToCivil(t, &civil);
+        benchmark::DoNotOptimize(civil);
+        t += 3607;
+    }
+}
+
+static void BM_CivilTimeCivilToUtc(benchmark::State& state)
+{
+    benchSetup();
+    CivilTime ct;
+    int hour = 0;
+
+    ct.setTimezone(benchTz);
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(ct.civilToUtc(2020, 6, 1 + (hour / 24) % 28, hour % 24, 30, 0));
+        hour++;
+    }
+}
+
+static void BM_LibcLocaltime(benchmark::State& state)
+{
+    benchSetup();
+    struct tm tm;
+    time_t t = benchStartTime;
+
+    setenv("TZ", benchTz, 1);
+    tzset();
+    for(auto _ : state) {
+        localtime_r(&t, &tm);
+        benchmark::DoNotOptimize(tm);
+        t += 3607;
+    }
+}
+
+static void BM_LibcMktime(benchmark::State& state)
+{
+    benchSetup();
+    struct tm tm;
+    int hour = 0;
+
+    setenv("TZ", benchTz, 1);
+    tzset();
+    for(auto _ : state) {
+        tm = {};
+        tm.tm_year = 2020 - 1900;
+        tm.tm_mon = 5;
+        tm.tm_mday = 1 + (hour / 24) % 28;
+        tm.tm_hour = hour % 24;
+        tm.tm_min = 30;
+        tm.tm_isdst = -1;
+        benchmark::DoNotOptimize(mktime(&tm));
+        hour++;
+    }
+}
+
+BENCHMARK(BM_CivilTimeUtcToCivil);
+BENCHMARK(BM_CivilTimeCivilToUtc);
+BENCHMARK(BM_LibcLocaltime);
+BENCHMARK(BM_LibcMktime);
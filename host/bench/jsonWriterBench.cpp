@@ -0,0 +1,74 @@
+/*
+ * Benchmark of the JsonWriter against the previous approach of appending each value
+ * with snprintf, on the telemetry batch shape (array of small integer arrays).
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <benchmark/benchmark.h>
+
+#include "jsonWriter.h"
+
+static const uint32_t sampleTime = 1590994800;
+
+static void appendFormatted(char* buf, size_t bufLen, size_t* len, const char* fmt, ...)
+{
+    va_list args;
+    int ret;
+
+    va_start(args, fmt);
+    ret = vsnprintf((*len < bufLen) ? &buf[*len] : nullptr, (*len < bufLen) ? (bufLen - *len) : 0, fmt, args);
+    va_end(args);
+
+    if(ret > 0) *len += (size_t) ret;
+}
+
+static void BM_SamplesSnprintf(benchmark::State& state)
+{
+    static char buf[4096];
+    unsigned int count = (unsigned int) state.range(0);
+
+    size_t len = 0;
+    for(auto _ : state) {
+        len = 0;
+        appendFormatted(buf, sizeof(buf), &len, "{\"samples\":[");
+        for(unsigned int i = 0; i < count; i++) {
+            appendFormatted(buf, sizeof(buf), &len, "%s[%u,%u,%d,%u,%u]", (i == 0) ? "" : ",",
+                sampleTime + i * 600, 12710 - i, -2, 1, 3);
+        }
+        appendFormatted(buf, sizeof(buf), &len, "]}");
+        benchmark::DoNotOptimize(buf);
+    }
+    state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) len);
+}
+
+static void BM_SamplesJsonWriter(benchmark::State& state)
+{
+    static char buf[4096];
+    unsigned int count = (unsigned int) state.range(0);
+
+    size_t len = 0;
+    for(auto _ : state) {
+        JsonWriter writer(buf, sizeof(buf));
+
+        writer.startObject(nullptr);
+        writer.startArray("samples");
+        for(unsigned int i = 0; i < count; i++) {
+            writer.startArray(nullptr);
+            writer.addUint(nullptr, sampleTime + i * 600);
+            writer.addUint(nullptr, 12710 - i);
+            writer.addInt(nullptr, -2);
+            writer.addUint(nullptr, 1);
+            writer.addUint(nullptr, 3);
+            writer.endArray();
+        }
+        writer.endArray();
+        writer.endObject();
+        len = writer.getLength();
+        benchmark::DoNotOptimize(buf);
+    }
+    state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) len);
+}
+
+BENCHMARK(BM_SamplesSnprintf)->Arg(1)->Arg(8)->Arg(32);
+BENCHMARK(BM_SamplesJsonWriter)->Arg(1)->Arg(8)->Arg(32);
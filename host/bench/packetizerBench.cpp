@@ -0,0 +1,43 @@
+/*
+ * Benchmark of the SerialPacketizer receive path: framed packets are injected into the
+ * UART driver shim and taken from the receive packet queue, i.e. the measured time
+ * includes the hand-over to and from the packetizer task.
+ */
+
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "hostShim.h"
+#include "benchUtils.h"
+
+static void BM_PacketizerRx(benchmark::State& state)
+{
+    benchSetup();
+
+    unsigned int payloadLen = (unsigned int) state.range(0);
+    std::vector<uint8_t> frame;
+    FillSensorPacketizer::BUFFER_T packet;
+    QueueHandle_t rxQueue = fillSensorPacketizer.getRxPacketQueue();
+
+    frame.push_back(0xfe);
+    frame.push_back(0xaa);
+    frame.push_back((uint8_t) payloadLen);
+    frame.push_back((uint8_t) (payloadLen ^ 0xff));
+    for(unsigned int i = 0; i < payloadLen; i++) {
+        frame.push_back((uint8_t) (0x30 + i));
+    }
+    frame.push_back(0x55);
+    frame.push_back(0x01);
+
+    for(auto _ : state) {
+        hostUartInject(fillSensorPortNum, frame.data(), frame.size());
+        if(pdPASS != xQueueReceive(rxQueue, &packet, pdMS_TO_TICKS(1000))) {
+            state.SkipWithError("Packet wasn't received");
+            break;
+        }
+        benchmark::DoNotOptimize(packet);
+    }
+    state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) frame.size());
+}
+
+BENCHMARK(BM_PacketizerRx)->Arg(1)->Arg(4)->Arg(16)->UseRealTime();
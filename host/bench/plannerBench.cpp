@@ -0,0 +1,72 @@
+/*
+ * Benchmarks of the IrrigationPlanner: next event lookup, timeline rebuilds and the
+ * dispatch cycle of the IrrigationController. Built for the default and the large
+ * capacity policy.
+ */
+
+#include <ctime>
+#include <benchmark/benchmark.h>
+
+#include "benchUtils.h"
+
+/** Monday, 2020-06-01 00:00:00 UTC */
+static const time_t benchStartTime = 1590969600;
+
+static void plannerSetup(const benchmark::State& state)
+{
+    benchSetup();
+    benchLoadIrrigationConfig(benchMakeIrrigationConfig((unsigned int) state.range(0)));
+}
+
+/** Steady state: ask for the next event a bit later each time, i.e. mostly no timeline changes. */
+static void BM_PlannerNextEventSteady(benchmark::State& state)
+{
+    plannerSetup(state);
+    time_t t = benchStartTime;
+
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(irrigPlanner.getNextEventTime(t, true));
+        t += 10;
+    }
+    state.counters["events"] = (double) state.range(0);
+}
+
+/** Going back in time, which rebuilds the entire timeline each time. */
+static void BM_PlannerTimelineRebuild(benchmark::State& state)
+{
+    plannerSetup(state);
+    time_t t = benchStartTime + 365 * 86400;
+
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(irrigPlanner.getNextEventTime(t, true));
+        t -= 10;
+    }
+    state.counters["events"] = (double) state.range(0);
+}
+
+/** Event loop of the IrrigationController: look up the next event and dispatch it. */
+static void BM_PlannerDispatchCycle(benchmark::State& state)
+{
+    plannerSetup(state);
+    time_t t = benchStartTime;
+    const IrrigationPlanner::due_event_t* events;
+    unsigned int numEvents;
+
+    // Start from a valid timeline
+    irrigPlanner.getNextEventTime(t, false);
+
+    for(auto _ : state) {
+        time_t next = irrigPlanner.getNextEventTime(t, true);
+        if(0 == next) {
+            state.SkipWithError("No upcoming event found");
+            break;
+        }
+        benchmark::DoNotOptimize(irrigPlanner.dispatchDueEvents(next, &events, &numEvents));
+        t = next;
+    }
+    state.counters["events"] = (double) state.range(0);
+}
+
+BENCHMARK(BM_PlannerNextEventSteady)->RangeMultiplier(4)->Range(8, irrigationPlannerNumNormalEvents);
+BENCHMARK(BM_PlannerTimelineRebuild)->RangeMultiplier(4)->Range(8, irrigationPlannerNumNormalEvents);
+BENCHMARK(BM_PlannerDispatchCycle)->RangeMultiplier(4)->Range(8, irrigationPlannerNumNormalEvents);
@@ -0,0 +1,108 @@
+/*
+ * Benchmarks of the SettingsManager: parsing and publishing irrigation configurations,
+ * and loading them from the config image or RTC memory instead. Parsing hardware
+ * configurations, whose JSON tree is allocated in the JSON arena.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "benchUtils.h"
+
+static void BM_SettingsIrrigationConfigUpdate(benchmark::State& state)
+{
+    benchSetup();
+    std::string json = benchMakeIrrigationConfig((unsigned int) state.range(0));
+
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(settingsMgr.updateIrrigationConfig(json.c_str(), json.length(), true));
+
+        // The planner has to release the previous snapshot, otherwise the next update waits for it
+        state.PauseTiming();
+        irrigPlanner.irrigConfigUpdated();
+        state.ResumeTiming();
+    }
+    state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) json.length());
+    state.counters["events"] = (double) state.range(0);
+}
+
+BENCHMARK(BM_SettingsIrrigationConfigUpdate)->RangeMultiplier(4)->Range(8, irrigationPlannerNumNormalEvents);
+
+static void BM_SettingsConfigImageLoad(benchmark::State& state)
+{
+    benchSetup();
+    std::string json = benchMakeIrrigationConfig((unsigned int) state.range(0));
+
+    settingsMgr.updateIrrigationConfig(json.c_str(), json.length(), true);
+    irrigPlanner.irrigConfigUpdated();
+    settingsMgr.storeConfigImage();
+
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(settingsMgr.loadConfigImage());
+
+        state.PauseTiming();
+        irrigPlanner.irrigConfigUpdated();
+        state.ResumeTiming();
+    }
+    state.counters["events"] = (double) state.range(0);
+}
+
+BENCHMARK(BM_SettingsConfigImageLoad)->RangeMultiplier(4)->Range(8, irrigationPlannerNumNormalEvents);
+
+static void BM_SettingsConfigRtcLoad(benchmark::State& state)
+{
+    benchSetup();
+    std::string json = benchMakeIrrigationConfig((unsigned int) state.range(0));
+
+    // Accepted updates are copied to RTC memory
+    settingsMgr.updateIrrigationConfig(json.c_str(), json.length(), true);
+    irrigPlanner.irrigConfigUpdated();
+
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(settingsMgr.loadConfigRtcCopy());
+
+        state.PauseTiming();
+        irrigPlanner.irrigConfigUpdated();
+        state.ResumeTiming();
+    }
+    state.counters["events"] = (double) state.range(0);
+}
+
+BENCHMARK(BM_SettingsConfigRtcLoad)->RangeMultiplier(4)->Range(8, irrigationPlannerNumNormalEvents);
+
+static void BM_SettingsDefaultInit(benchmark::State& state)
+{
+    benchSetup();
+
+    for(auto _ : state) {
+        settingsMgr.init();
+
+        state.PauseTiming();
+        irrigPlanner.irrigConfigUpdated();
+        state.ResumeTiming();
+    }
+}
+
+BENCHMARK(BM_SettingsDefaultInit);
+
+static void BM_SettingsHardwareConfigUpdate(benchmark::State& state)
+{
+    benchSetup();
+    std::string json =
+        "{\"disableBatteryCheck\": true, \"battCriticalThresholdMilli\": 11900, \"battLowThresholdMilli\": 12100, "
+        "\"battOkThresholdMilli\": 13800, \"battVoltageDeadbandMilli\": 100, \"disableReservoirCheck\": true, "
+        "\"fillLevelMaxVal\": 545, \"fillLevelMinVal\": 0, \"fillLevelCriticalThresholdPercent10\": 75, "
+        "\"fillLevelLowThresholdPercent10\": 250, \"fillLevelHysteresisPercent10\": 50, \"fillLevelDeadbandPercent10\": 10, "
+        "\"stateEncoding\": \"json\", \"telemetryEncoding\": \"json\", \"timezone\": \"CET-1CEST,M3.5.0,M10.5.0/3\", "
+        "\"latitude\": 48.137, \"longitude\": 11.575}";
+    JsonArena::json_arena_stats_t stats;
+
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(settingsMgr.updateHardwareConfig(json.c_str(), json.length(), true));
+    }
+    state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) json.length());
+
+    jsonArena.getStats(&stats);
+    state.counters["arenaBytes"] = (double) stats.highWater;
+}
+
+BENCHMARK(BM_SettingsHardwareConfigUpdate);
@@ -0,0 +1,106 @@
+/*
+ * Benchmark of formatting the MQTT state update of the IrrigationController.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+
+#include "benchUtils.h"
+#include "irrigationController.h"
+
+extern IrrigationController irrigCtrl;
+
+static void BM_StateFormat(benchmark::State& state)
+{
+    benchSetup();
+
+    static char buf[1024];
+    IrrigationController::state_t stateData;
+
+    stateData.fillLevel = 734;
+    stateData.reservoirState = IrrigationController::RESERVOIR_OK;
+    stateData.battVoltage = 12710;
+    stateData.battState = PowerManager::BATT_OK;
+    stateData.numActiveOutputs = 0;
+    for(int64_t i = 0; i < state.range(0); i++) {
+        stateData.activeOutputs[stateData.numActiveOutputs++] = OutputController::CH_MAIN + (uint32_t) i;
+    }
+    stateData.nextIrrigEvent = 1590994800;
+    stateData.sntpLastSync = 1590969600;
+    stateData.sntpNextSync = 1590984000;
+
+    size_t len = 0;
+    for(auto _ : state) {
+        len = irrigCtrl.formatStateData(stateData, IrrigationController::STATE_FIELDS_ALL, buf, sizeof(buf));
+        benchmark::DoNotOptimize(buf);
+    }
+    state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) len);
+}
+
+BENCHMARK(BM_StateFormat)->DenseRange(0, OutputController::intChannels);
+
+static void BM_StateEncodeCbor(benchmark::State& state)
+{
+    benchSetup();
+
+    static uint8_t buf[1024];
+    IrrigationController::state_t stateData;
+
+    stateData.fillLevel = 734;
+    stateData.reservoirState = IrrigationController::RESERVOIR_OK;
+    stateData.battVoltage = 12710;
+    stateData.battState = PowerManager::BATT_OK;
+    stateData.numActiveOutputs = 0;
+    for(int64_t i = 0; i < state.range(0); i++) {
+        stateData.activeOutputs[stateData.numActiveOutputs++] = OutputController::CH_MAIN + (uint32_t) i;
+    }
+    stateData.nextIrrigEvent = 1590994800;
+    stateData.sntpLastSync = 1590969600;
+    stateData.sntpNextSync = 1590984000;
+
+    size_t len = 0;
+    for(auto _ : state) {
+        len = irrigCtrl.encodeStateData(stateData, IrrigationController::STATE_FIELDS_ALL, buf, sizeof(buf));
+        benchmark::DoNotOptimize(buf);
+    }
+    state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) len);
+    state.counters["payloadBytes"] = (double) len;
+}
+
+BENCHMARK(BM_StateEncodeCbor)->DenseRange(0, OutputController::intChannels);
+
+static void BM_StateFormatDelta(benchmark::State& state)
+{
+    benchSetup();
+
+    static char buf[1024];
+    IrrigationController::state_t stateData;
+    IrrigationController::state_t publishedData;
+
+    memset(&stateData, 0, sizeof(stateData));
+    stateData.fillLevel = 734;
+    stateData.reservoirState = IrrigationController::RESERVOIR_OK;
+    stateData.battVoltage = 12710;
+    stateData.battState = PowerManager::BATT_OK;
+    stateData.activeOutputs[0] = OutputController::CH_MAIN;
+    stateData.numActiveOutputs = 1;
+    stateData.nextIrrigEvent = 1590994800;
+    stateData.sntpLastSync = 1590969600;
+    stateData.sntpNextSync = 1590984000;
+
+    // Typical update: an output got switched on, the battery voltage moved within its deadband
+    publishedData = stateData;
+    publishedData.battVoltage = 12730;
+    publishedData.numActiveOutputs = 0;
+    publishedData.nextIrrigEvent = 1590991200;
+
+    size_t len = 0;
+    for(auto _ : state) {
+        uint32_t changes = irrigCtrl.getStateChanges(stateData, publishedData);
+        len = irrigCtrl.formatStateData(stateData, changes, buf, sizeof(buf));
+        benchmark::DoNotOptimize(buf);
+    }
+    state.SetBytesProcessed((int64_t) state.iterations() * (int64_t) len);
+}
+
+BENCHMARK(BM_StateFormatDelta);
@@ -0,0 +1,22 @@
+/*
+ * Empty default configuration for the build of the default config generator
+ * (tools/defaultConfigGen.cpp), which can't use the defaults it generates. The generator
+ * doesn't call SettingsManager::init().
+ */
+
+#ifndef DEFAULT_CONFIG_H
+#define DEFAULT_CONFIG_H
+
+#include "settingsManager.h"
+
+static constexpr unsigned int defaultConfigNumZones = 0;
+static constexpr unsigned int defaultConfigNumEvents = 0;
+
+typedef struct default_config_t {
+    SettingsManager::config_image_data_t data;
+    SettingsManager::config_image_event_t events[1];
+} default_config_t;
+
+static constexpr default_config_t defaultConfig = {};
+
+#endif /* DEFAULT_CONFIG_H */
@@ -0,0 +1,66 @@
+/*
+ * Global components of the firmware for host builds.
+ *
+ * The firmware defines them in main.cpp, which also contains the ESP-IDF bring-up
+ * (WiFi, SPIFFS, OTA, console) and therefore isn't part of host builds. The objects are
+ * defined here in the same order, so they are constructed like on the target.
+ */
+
+#include <new>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+#include "wifiEvents.h"
+#include "globalComponents.h"
+#include "irrigationController.h"
+#include "irrigationPlanner.h"
+#include "hostComponents.h"
+
+EventGroupHandle_t wifiEvents = xEventGroupCreate();
+const int wifiEventConnected = (1<<0);
+const int wifiEventDisconnected = (1<<1);
+
+CivilTime civilTime;
+SolarTable solarTable;
+JsonArena jsonArena;
+SettingsManager settingsMgr;
+FillSensorPacketizer fillSensorPacketizer;
+FillSensorProtoHandler<FillSensorPacketizer> fillSensor(&fillSensorPacketizer);
+PowerManager pwrMgr;
+OutputController outputCtrl;
+MqttManager mqttMgr;
+IrrigationController irrigCtrl;
+IrrigationPlanner irrigPlanner;
+
+/**
+ * Simulate a reboot of the components in RAM: they are destroyed and constructed again
+ * in place, like the target does after a restart or deep sleep wakeup. RTC data
+ * persists, as it does on the target.
+ *
+ * The fill sensor components are kept, because their task is running and the UART
+ * driver is installed already. The MQTT manager stand-in has no state of interest.
+ * No task must use the components during the reboot.
+ */
+void hostComponentsReboot(void)
+{
+    // The planner holds a configuration snapshot of the settings manager, so destroy
+    // in reverse order of construction
+    irrigPlanner.~IrrigationPlanner();
+    irrigCtrl.~IrrigationController();
+    outputCtrl.~OutputController();
+    pwrMgr.~PowerManager();
+    settingsMgr.~SettingsManager();
+    jsonArena.~JsonArena();
+    solarTable.~SolarTable();
+    civilTime.~CivilTime();
+
+    new (&civilTime) CivilTime();
+    new (&solarTable) SolarTable();
+    new (&jsonArena) JsonArena();
+    new (&settingsMgr) SettingsManager();
+    new (&pwrMgr) PowerManager();
+    new (&outputCtrl) OutputController();
+    new (&irrigCtrl) IrrigationController();
+    new (&irrigPlanner) IrrigationPlanner();
+}
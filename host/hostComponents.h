@@ -0,0 +1,10 @@
+#ifndef HOST_COMPONENTS_H
+#define HOST_COMPONENTS_H
+
+/*
+ * Host only helpers for the global components defined by hostComponents.cpp.
+ */
+
+void hostComponentsReboot(void);
+
+#endif /* HOST_COMPONENTS_H */
@@ -0,0 +1,290 @@
+/*
+ * Host shim of the GPIO, ADC and UART drivers. The environment, e.g. a benchmark,
+ * drives the inputs and observes the outputs by the functions of hostShim.h.
+ */
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+#include "driver/gpio.h"
+#include "driver/rtc_io.h"
+#include "driver/adc.h"
+#include "driver/uart.h"
+#include "hostShim.h"
+
+// ********************************************************************
+// GPIO
+// ********************************************************************
+static std::atomic<uint32_t>* getGpioLevels(void)
+{
+    // Function local, because the drivers are used by constructors of global objects
+    static std::atomic<uint32_t> levels[GPIO_NUM_MAX];
+    return levels;
+}
+
+static std::atomic<HostGpioHookFncPtr> gpioHook(nullptr);
+
+static bool isValidGpio(gpio_num_t gpioNum)
+{
+    return (gpioNum >= GPIO_NUM_0) && (gpioNum < GPIO_NUM_MAX);
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t /* mode */)
+{
+    return isValidGpio(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t /* pull */)
+{
+    return isValidGpio(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if(!isValidGpio(gpio_num)) return ESP_ERR_INVALID_ARG;
+
+    uint32_t newLevel = level ? 1 : 0;
+    if(newLevel != getGpioLevels()[gpio_num].exchange(newLevel)) {
+        HostGpioHookFncPtr hook = gpioHook.load();
+        if(nullptr != hook) {
+            hook(gpio_num, newLevel);
+        }
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if(!isValidGpio(gpio_num)) return 0;
+
+    return (int) getGpioLevels()[gpio_num].load();
+}
+
+esp_err_t rtc_gpio_deinit(gpio_num_t gpio_num)
+{
+    return isValidGpio(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+void hostGpioSetLevel(gpio_num_t gpioNum, uint32_t level)
+{
+    gpio_set_level(gpioNum, level);
+}
+
+uint32_t hostGpioGetLevel(gpio_num_t gpioNum)
+{
+    return (uint32_t) gpio_get_level(gpioNum);
+}
+
+void hostSetGpioHook(HostGpioHookFncPtr hook)
+{
+    gpioHook.store(hook);
+}
+
+// ********************************************************************
+// ADC
+// ********************************************************************
+static std::atomic<int>* getAdcRaw(void)
+{
+    static std::atomic<int> raw[ADC1_CHANNEL_MAX];
+    return raw;
+}
+
+esp_err_t adc1_config_width(adc_bits_width_t /* width_bit */)
+{
+    return ESP_OK;
+}
+
+esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t /* atten */)
+{
+    return ((channel >= ADC1_CHANNEL_0) && (channel < ADC1_CHANNEL_MAX)) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+int adc1_get_raw(adc1_channel_t channel)
+{
+    if((channel < ADC1_CHANNEL_0) || (channel >= ADC1_CHANNEL_MAX)) return -1;
+
+    return getAdcRaw()[channel].load();
+}
+
+void hostAdcSetRaw(adc1_channel_t channel, int raw)
+{
+    if((channel < ADC1_CHANNEL_0) || (channel >= ADC1_CHANNEL_MAX)) return;
+
+    getAdcRaw()[channel].store(raw);
+}
+
+// ********************************************************************
+// UART
+// ********************************************************************
+typedef struct uart_state_t {
+    std::mutex mutex;
+    bool installed;
+    size_t rxBufferSize;
+    std::deque<uint8_t> rx;
+    std::deque<uint8_t> tx;
+    QueueHandle_t eventQueue;
+} uart_state_t;
+
+static uart_state_t* getUartStates(void)
+{
+    // Never freed, the packetizer task may still use its UART while the process exits
+    static uart_state_t* states = new uart_state_t[UART_NUM_MAX]();
+    return states;
+}
+
+static uart_state_t* getUart(uart_port_t port)
+{
+    if((port < UART_NUM_0) || (port >= UART_NUM_MAX)) return nullptr;
+
+    return &getUartStates()[port];
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t* /* uart_config */)
+{
+    return (nullptr != getUart(uart_num)) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int /* tx_io_num */, int /* rx_io_num */, int /* rts_io_num */, int /* cts_io_num */)
+{
+    return (nullptr != getUart(uart_num)) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int /* tx_buffer_size */, int queue_size,
+    QueueHandle_t* uart_queue, int /* intr_alloc_flags */)
+{
+    uart_state_t* uart = getUart(uart_num);
+
+    if((nullptr == uart) || (rx_buffer_size <= UART_FIFO_LEN)) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lock(uart->mutex);
+    if(uart->installed) return ESP_FAIL;
+
+    uart->installed = true;
+    uart->rxBufferSize = (size_t) rx_buffer_size;
+    uart->eventQueue = nullptr;
+    if((queue_size > 0) && (nullptr != uart_queue)) {
+        uart->eventQueue = xQueueCreate(queue_size, sizeof(uart_event_t));
+        *uart_queue = uart->eventQueue;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num)
+{
+    uart_state_t* uart = getUart(uart_num);
+
+    if(nullptr == uart) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lock(uart->mutex);
+    if(!uart->installed) return ESP_FAIL;
+
+    if(nullptr != uart->eventQueue) vQueueDelete(uart->eventQueue);
+    uart->eventQueue = nullptr;
+    uart->rx.clear();
+    uart->tx.clear();
+    uart->installed = false;
+
+    return ESP_OK;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t* size)
+{
+    uart_state_t* uart = getUart(uart_num);
+
+    if((nullptr == uart) || (nullptr == size)) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lock(uart->mutex);
+    if(!uart->installed) return ESP_FAIL;
+
+    *size = uart->rx.size();
+    return ESP_OK;
+}
+
+int uart_read_bytes(uart_port_t uart_num, uint8_t* buf, uint32_t length, TickType_t /* ticks_to_wait */)
+{
+    uart_state_t* uart = getUart(uart_num);
+    uint32_t cnt = 0;
+
+    if((nullptr == uart) || (nullptr == buf)) return -1;
+
+    // Data is injected as a whole, so there is nothing to wait for
+    std::lock_guard<std::mutex> lock(uart->mutex);
+    if(!uart->installed) return -1;
+
+    while((cnt < length) && !uart->rx.empty()) {
+        buf[cnt++] = uart->rx.front();
+        uart->rx.pop_front();
+    }
+
+    return (int) cnt;
+}
+
+int uart_write_bytes(uart_port_t uart_num, const char* src, size_t size)
+{
+    uart_state_t* uart = getUart(uart_num);
+
+    if((nullptr == uart) || (nullptr == src)) return -1;
+
+    std::lock_guard<std::mutex> lock(uart->mutex);
+    if(!uart->installed) return -1;
+
+    uart->tx.insert(uart->tx.end(), src, src + size);
+    return (int) size;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+    uart_state_t* uart = getUart(uart_num);
+
+    if(nullptr == uart) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lock(uart->mutex);
+    uart->rx.clear();
+    return ESP_OK;
+}
+
+size_t hostUartInject(uart_port_t port, const uint8_t* data, size_t len)
+{
+    uart_state_t* uart = getUart(port);
+    QueueHandle_t eventQueue;
+    uart_event_t event;
+
+    if((nullptr == uart) || (nullptr == data)) return 0;
+
+    {
+        std::lock_guard<std::mutex> lock(uart->mutex);
+        if(!uart->installed) return 0;
+
+        size_t space = uart->rxBufferSize - uart->rx.size();
+        if(len > space) len = space;
+        uart->rx.insert(uart->rx.end(), data, data + len);
+        eventQueue = uart->eventQueue;
+    }
+
+    // Like the driver, drop the event if the queue is full; the data stays buffered
+    if((len > 0) && (nullptr != eventQueue)) {
+        event.type = UART_DATA;
+        event.size = len;
+        xQueueSendToBack(eventQueue, &event, 0);
+    }
+
+    return len;
+}
+
+size_t hostUartFetch(uart_port_t port, uint8_t* data, size_t maxLen)
+{
+    uart_state_t* uart = getUart(port);
+    size_t cnt = 0;
+
+    if((nullptr == uart) || (nullptr == data)) return 0;
+
+    std::lock_guard<std::mutex> lock(uart->mutex);
+    while((cnt < maxLen) && !uart->tx.empty()) {
+        data[cnt++] = uart->tx.front();
+        uart->tx.pop_front();
+    }
+
+    return cnt;
+}
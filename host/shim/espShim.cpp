@@ -0,0 +1,274 @@
+/*
+ * Host shim of the ESP-IDF system services used by the firmware.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <mutex>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp_wifi.h"
+#include "esp_sntp.h"
+#include "esp_adc_cal.h"
+#include "hostShim.h"
+
+#ifndef HOST_LOG_DEFAULT_LEVEL
+#define HOST_LOG_DEFAULT_LEVEL ESP_LOG_INFO
+#endif
+
+static std::atomic<int> logLevel(HOST_LOG_DEFAULT_LEVEL);
+static std::atomic<HostResetHandlerFncPtr> resetHandler(nullptr);
+
+// ********************************************************************
+// Errors and logging
+// ********************************************************************
+const char* esp_err_to_name(esp_err_t code)
+{
+    switch(code) {
+        case ESP_OK:                    return "ESP_OK";
+        case ESP_FAIL:                  return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:            return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:       return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:     return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:      return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:         return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:     return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:           return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE:  return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC:       return "ESP_ERR_INVALID_CRC";
+        default:                        return "UNKNOWN ERROR";
+    }
+}
+
+void esp_log_level_set(const char* tag, esp_log_level_t level)
+{
+    // Only the wildcard is supported, the firmware sets other tags for IDF internals only
+    if(('*' == tag[0]) && ('\0' == tag[1])) {
+        logLevel.store(level);
+    }
+}
+
+uint32_t esp_log_timestamp(void)
+{
+    return (uint32_t) (hostClockGetUptimeUs() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char* /* tag */, const char* format, ...)
+{
+    va_list args;
+
+    if(level > logLevel.load()) return;
+
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+// ********************************************************************
+// System, timer and sleep
+// ********************************************************************
+void hostSetResetHandler(HostResetHandlerFncPtr handler)
+{
+    resetHandler.store(handler);
+}
+
+/** Call the reset handler, which must not return. The process exits if it does anyway. */
+void hostReset(const char* reason)
+{
+    HostResetHandlerFncPtr handler = resetHandler.load();
+
+    if(nullptr != handler) {
+        handler(reason);
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    exit(0);
+}
+
+void esp_restart(void)
+{
+    hostReset("restart");
+}
+
+extern "C" void esp_restart_noos(void) __attribute__ ((noreturn));
+extern "C" void esp_restart_noos(void)
+{
+    hostReset("restart");
+}
+
+uint32_t esp_random(void)
+{
+    static std::mutex mutex;
+    static uint32_t state = 0x12345678;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // xorshift32, deterministic on purpose so host runs are reproducible
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 200 * 1024;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return hostClockGetUptimeUs();
+}
+
+static std::atomic<esp_sleep_wakeup_cause_t> wakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+static std::atomic<uint64_t> timerWakeupUs(0);
+
+uint64_t hostSleepGetTimerWakeupUs(void)
+{
+    return timerWakeupUs.load();
+}
+
+void hostSleepSetWakeupCause(esp_sleep_wakeup_cause_t cause)
+{
+    wakeupCause.store(cause);
+}
+
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t /* gpio_num */, int /* level */)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us)
+{
+    timerWakeupUs.store(time_in_us);
+    return ESP_OK;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void)
+{
+    return wakeupCause.load();
+}
+
+void esp_deep_sleep_start(void)
+{
+    hostReset("deep sleep");
+}
+
+// ********************************************************************
+// WiFi and SNTP
+// ********************************************************************
+esp_err_t esp_wifi_get_mac(esp_interface_t /* ifx */, uint8_t mac[6])
+{
+    static const uint8_t hostMac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+
+    for(int i = 0; i < 6; i++) {
+        mac[i] = hostMac[i];
+    }
+    return ESP_OK;
+}
+
+static std::atomic<HostWifiStartHandlerFncPtr> wifiStartHandler(nullptr);
+
+void hostSetWifiStartHandler(HostWifiStartHandlerFncPtr handler)
+{
+    wifiStartHandler.store(handler);
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    HostWifiStartHandlerFncPtr handler = wifiStartHandler.load();
+
+    if(nullptr != handler) {
+        handler();
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void)
+{
+    return ESP_OK;
+}
+
+static std::atomic<bool> sntpRunning(false);
+static std::atomic<sntp_sync_time_cb_t> sntpSyncCb(nullptr);
+static std::atomic<HostSntpRequestHandlerFncPtr> sntpRequestHandler(nullptr);
+
+void hostSetSntpRequestHandler(HostSntpRequestHandlerFncPtr handler)
+{
+    sntpRequestHandler.store(handler);
+}
+
+void hostSntpSync(int64_t epochUs)
+{
+    struct timeval tv;
+    sntp_sync_time_cb_t cb = sntpSyncCb.load();
+
+    tv.tv_sec = (time_t) (epochUs / 1000000);
+    tv.tv_usec = (suseconds_t) (epochUs % 1000000);
+    settimeofday(&tv, nullptr);
+
+    if(sntpRunning.load() && (nullptr != cb)) {
+        cb(&tv);
+    }
+}
+
+void sntp_setoperatingmode(uint8_t /* operating_mode */)
+{
+}
+
+void sntp_setservername(uint8_t /* idx */, const char* /* server */)
+{
+}
+
+void sntp_init(void)
+{
+    HostSntpRequestHandlerFncPtr handler = sntpRequestHandler.load();
+
+    sntpRunning.store(true);
+    if(nullptr != handler) {
+        handler();
+    }
+}
+
+void sntp_stop(void)
+{
+    sntpRunning.store(false);
+}
+
+bool sntp_enabled(void)
+{
+    return sntpRunning.load();
+}
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback)
+{
+    sntpSyncCb.store(callback);
+}
+
+// ********************************************************************
+// ADC calibration
+// ********************************************************************
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adc_num, adc_atten_t atten, adc_bits_width_t bit_width,
+    uint32_t default_vref, esp_adc_cal_characteristics_t* chars)
+{
+    chars->adc_num = adc_num;
+    chars->atten = atten;
+    chars->bit_width = bit_width;
+    chars->vref = default_vref;
+    return ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adc_reading, const esp_adc_cal_characteristics_t* chars)
+{
+    // Ideal linear characteristic, the full scale voltages roughly match the ones of the ESP32
+    static const uint32_t fullScaleMillis[] = {1100, 1500, 2200, 3900};
+    uint32_t maxRaw = (1u << (9 + (unsigned int) chars->bit_width)) - 1;
+
+    return (adc_reading * fullScaleMillis[chars->atten]) / maxRaw;
+}
@@ -0,0 +1,158 @@
+/*
+ * Host shim of the flash partition API, SPIFFS and the ROM CRC functions.
+ *
+ * The data partitions accessed by the firmware directly are backed by RAM, which persists
+ * across simulated reboots like flash does. Writes can only clear bits, like on NOR flash,
+ * so missing erases show up as corrupted data.
+ */
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+#include "esp_spiffs.h"
+#include "rom/crc.h"
+#include "hostShim.h"
+
+typedef struct host_partition_t {
+    esp_partition_t partition;
+    uint8_t* data;
+} host_partition_t;
+
+static uint8_t cfgImageData[16 * 1024];
+
+// Entries of partitions.csv, which are accessed via the partition API
+static host_partition_t partitions[] = {
+    {{ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t) 0x40, 0x1fc000, sizeof(cfgImageData), "cfg_image", false}, cfgImageData},
+};
+static const unsigned int numPartitions = sizeof(partitions) / sizeof(partitions[0]);
+
+static std::once_flag eraseOnce;
+static std::mutex flashMutex;
+static std::atomic<unsigned int> spiffsMountCount(0);
+
+static host_partition_t* findPartition(const esp_partition_t* partition)
+{
+    std::call_once(eraseOnce, []{
+        for(unsigned int i = 0; i < numPartitions; i++) {
+            memset(partitions[i].data, 0xFF, partitions[i].partition.size);
+        }
+    });
+
+    for(unsigned int i = 0; i < numPartitions; i++) {
+        if(&partitions[i].partition == partition) return &partitions[i];
+    }
+    return nullptr;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label)
+{
+    for(unsigned int i = 0; i < numPartitions; i++) {
+        const esp_partition_t* p = &partitions[i].partition;
+
+        if(p->type != type) continue;
+        if((ESP_PARTITION_SUBTYPE_ANY != subtype) && (p->subtype != subtype)) continue;
+        if((nullptr != label) && (0 != strcmp(p->label, label))) continue;
+        return p;
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size)
+{
+    host_partition_t* p = findPartition(partition);
+
+    if((nullptr == p) || (nullptr == dst)) return ESP_ERR_INVALID_ARG;
+    if((src_offset > partition->size) || (size > (partition->size - src_offset))) return ESP_ERR_INVALID_SIZE;
+
+    std::lock_guard<std::mutex> lock(flashMutex);
+    memcpy(dst, &p->data[src_offset], size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size)
+{
+    host_partition_t* p = findPartition(partition);
+    const uint8_t* srcBytes = (const uint8_t*) src;
+
+    if((nullptr == p) || (nullptr == src)) return ESP_ERR_INVALID_ARG;
+    if((dst_offset > partition->size) || (size > (partition->size - dst_offset))) return ESP_ERR_INVALID_SIZE;
+
+    std::lock_guard<std::mutex> lock(flashMutex);
+    for(size_t i = 0; i < size; i++) {
+        p->data[dst_offset + i] &= srcBytes[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t start_addr, size_t size)
+{
+    host_partition_t* p = findPartition(partition);
+
+    if(nullptr == p) return ESP_ERR_INVALID_ARG;
+    if((start_addr > partition->size) || (size > (partition->size - start_addr))) return ESP_ERR_INVALID_SIZE;
+    if((0 != (start_addr % SPI_FLASH_SEC_SIZE)) || (0 != (size % SPI_FLASH_SEC_SIZE))) return ESP_ERR_INVALID_SIZE;
+
+    std::lock_guard<std::mutex> lock(flashMutex);
+    memset(&p->data[start_addr], 0xFF, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t* partition, size_t offset, size_t size,
+    spi_flash_mmap_memory_t /* memory */, const void** out_ptr, spi_flash_mmap_handle_t* out_handle)
+{
+    host_partition_t* p = findPartition(partition);
+
+    if((nullptr == p) || (nullptr == out_ptr) || (nullptr == out_handle)) return ESP_ERR_INVALID_ARG;
+    if((offset > partition->size) || (size > (partition->size - offset))) return ESP_ERR_INVALID_SIZE;
+
+    *out_ptr = &p->data[offset];
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t /* handle */)
+{
+}
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t* /* conf */)
+{
+    spiffsMountCount++;
+    return ESP_OK;
+}
+
+unsigned int hostSpiffsGetMountCount(void)
+{
+    return spiffsMountCount;
+}
+
+esp_err_t esp_spiffs_info(const char* /* partition_label */, size_t* total_bytes, size_t* used_bytes)
+{
+    *total_bytes = 0;
+    *used_bytes = 0;
+    return ESP_OK;
+}
+
+uint32_t crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len)
+{
+    static uint32_t table[256];
+    static std::once_flag tableOnce;
+
+    std::call_once(tableOnce, []{
+        for(uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for(int k = 0; k < 8; k++) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+    });
+
+    crc = ~crc;
+    for(uint32_t i = 0; i < len; i++) {
+        crc = table[(crc ^ buf[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
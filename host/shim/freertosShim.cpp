@@ -0,0 +1,647 @@
+/*
+ * Host shim of the FreeRTOS kernel objects, based on the C++11 thread support.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstring>
+
+#include <pthread.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "freertos/timers.h"
+#include "hostShim.h"
+
+
+// ********************************************************************
+// Ticks, virtual time and critical sections
+// ********************************************************************
+/** Set for the thread of the task running on the virtual clock (see hostSetVirtualTimeTask()). */
+static thread_local bool isVirtualTimeTask = false;
+
+static std::chrono::milliseconds ticksToDuration(TickType_t ticks)
+{
+    return std::chrono::milliseconds((uint64_t) ticks * portTICK_PERIOD_MS);
+}
+
+static int64_t ticksToMicros(TickType_t ticks)
+{
+    return (int64_t) ticks * portTICK_PERIOD_MS * 1000;
+}
+
+static void virtualTimeAdvance(int64_t us);
+
+/**
+ * Wait on a condition variable until the predicate holds or the ticks passed.
+ *
+ * The virtual time task doesn't block on timeouts. The time passes instead and the
+ * predicate is checked once more, e.g. for changes made by software timers.
+ */
+template <typename Predicate>
+static bool waitTicks(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, TickType_t ticks, Predicate pred)
+{
+    if(portMAX_DELAY == ticks) {
+        cv.wait(lock, pred);
+        return true;
+    }
+    if(isVirtualTimeTask) {
+        if(pred()) return true;
+        lock.unlock();
+        virtualTimeAdvance(ticksToMicros(ticks));
+        lock.lock();
+        return pred();
+    }
+    return cv.wait_for(lock, ticksToDuration(ticks), pred);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t) (hostClockGetUptimeUs() / 1000 / portTICK_PERIOD_MS);
+}
+
+static std::recursive_mutex& getCriticalMutex(void)
+{
+    static std::recursive_mutex* mutex = new std::recursive_mutex();
+    return *mutex;
+}
+
+void vPortCPUInitializeMutex(portMUX_TYPE* mux)
+{
+    mux->owner = 0;
+    mux->count = 0;
+}
+
+void vPortEnterCritical(portMUX_TYPE* mux)
+{
+    getCriticalMutex().lock();
+    mux->count++;
+}
+
+void vPortExitCritical(portMUX_TYPE* mux)
+{
+    mux->count--;
+    getCriticalMutex().unlock();
+}
+
+// ********************************************************************
+// Tasks
+// ********************************************************************
+struct tskTaskControlBlock {
+    TaskFunction_t func;
+    void* param;
+    char name[16];
+};
+
+static std::mutex virtualTimeTaskNameMutex;
+static char virtualTimeTaskName[16];
+
+/** Task of the calling thread, nullptr for threads not created by xTaskCreate() */
+static thread_local tskTaskControlBlock* currentTask = nullptr;
+
+void hostSetVirtualTimeTask(const char* name)
+{
+    std::lock_guard<std::mutex> lock(virtualTimeTaskNameMutex);
+    strncpy(virtualTimeTaskName, name, sizeof(virtualTimeTaskName) - 1);
+}
+
+static void taskEntry(tskTaskControlBlock* tcb)
+{
+    currentTask = tcb;
+    {
+        std::lock_guard<std::mutex> lock(virtualTimeTaskNameMutex);
+        isVirtualTimeTask = ('\0' != tcb->name[0]) && (0 == strcmp(tcb->name, virtualTimeTaskName));
+    }
+    tcb->func(tcb->param);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char* const pcName, const uint32_t /* usStackDepth */,
+    void* const pvParameters, UBaseType_t /* uxPriority */, TaskHandle_t* const pvCreatedTask)
+{
+    // Threads are detached and never freed, as tasks of the firmware don't terminate
+    tskTaskControlBlock* tcb = new tskTaskControlBlock();
+    tcb->func = pvTaskCode;
+    tcb->param = pvParameters;
+    strncpy(tcb->name, (nullptr != pcName) ? pcName : "", sizeof(tcb->name) - 1);
+
+    std::thread(taskEntry, tcb).detach();
+
+    if(nullptr != pvCreatedTask) *pvCreatedTask = tcb;
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t pvTaskCode, const char* const pcName, const uint32_t ulStackDepth,
+    void* const pvParameters, UBaseType_t uxPriority, StackType_t* const /* puxStackBuffer */, StaticTask_t* const /* pxTaskBuffer */)
+{
+    TaskHandle_t handle = nullptr;
+    xTaskCreate(pvTaskCode, pcName, ulStackDepth, pvParameters, uxPriority, &handle);
+    return handle;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+    // Only deleting the calling task is supported, which is the only use in the firmware
+    if(nullptr == xTaskToDelete) {
+        pthread_exit(nullptr);
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    // Other threads, e.g. the main thread, get a handle of their own
+    static thread_local tskTaskControlBlock threadTcb = {};
+
+    return (nullptr != currentTask) ? currentTask : &threadTcb;
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    if(0 == xTicksToDelay) {
+        std::this_thread::yield();
+    } else if(isVirtualTimeTask) {
+        virtualTimeAdvance(ticksToMicros(xTicksToDelay));
+    } else {
+        std::this_thread::sleep_for(ticksToDuration(xTicksToDelay));
+    }
+}
+
+// ********************************************************************
+// Queues, semaphores and queue sets
+// ********************************************************************
+struct QueueDefinition {
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    UBaseType_t length;
+    UBaseType_t itemSize;                   /**< Zero for semaphores, i.e. only the count matters */
+    UBaseType_t count;
+    UBaseType_t head;
+    std::vector<uint8_t> storage;
+    QueueDefinition* set;                   /**< Queue set the queue is a member of */
+};
+
+static QueueDefinition* queueCreate(UBaseType_t length, UBaseType_t itemSize, UBaseType_t initialCount)
+{
+    QueueDefinition* queue = new QueueDefinition();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->count = initialCount;
+    queue->head = 0;
+    queue->storage.resize((size_t) length * itemSize);
+    queue->set = nullptr;
+    return queue;
+}
+
+static BaseType_t queueSend(QueueDefinition* queue, const void* item, TickType_t ticks, bool toFront)
+{
+    QueueDefinition* set;
+
+    if(nullptr == queue) return pdFAIL;
+
+    {
+        std::unique_lock<std::mutex> lock(queue->mutex);
+        if(!waitTicks(queue->notFull, lock, ticks, [queue]{ return queue->count < queue->length; })) {
+            return errQUEUE_FULL;
+        }
+
+        // Semaphores have no item data and are given without an item
+        if((queue->itemSize > 0) && (nullptr != item)) {
+            UBaseType_t pos;
+            if(toFront) {
+                queue->head = (queue->head + queue->length - 1) % queue->length;
+                pos = queue->head;
+            } else {
+                pos = (queue->head + queue->count) % queue->length;
+            }
+            memcpy(&queue->storage[(size_t) pos * queue->itemSize], item, queue->itemSize);
+        }
+        queue->count++;
+        set = queue->set;
+    }
+    queue->notEmpty.notify_one();
+
+    // Like FreeRTOS, notify the set about every item, so the number of set entries
+    // equals the number of items available in its members
+    if(nullptr != set) {
+        queueSend(set, &queue, 0, false);
+    }
+
+    return pdPASS;
+}
+
+static BaseType_t queueReceive(QueueDefinition* queue, void* buffer, TickType_t ticks, bool peek)
+{
+    if(nullptr == queue) return pdFAIL;
+
+    {
+        std::unique_lock<std::mutex> lock(queue->mutex);
+        if(!waitTicks(queue->notEmpty, lock, ticks, [queue]{ return queue->count > 0; })) {
+            return errQUEUE_EMPTY;
+        }
+
+        if((queue->itemSize > 0) && (nullptr != buffer)) {
+            memcpy(buffer, &queue->storage[(size_t) queue->head * queue->itemSize], queue->itemSize);
+        }
+        if(peek) {
+            return pdPASS;
+        }
+        if(queue->itemSize > 0) {
+            queue->head = (queue->head + 1) % queue->length;
+        }
+        queue->count--;
+    }
+    queue->notFull.notify_one();
+
+    return pdPASS;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    return queueCreate(uxQueueLength, uxItemSize, 0);
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t uxQueueLength, UBaseType_t uxItemSize, uint8_t* /* pucQueueStorageBuffer */,
+    StaticQueue_t* /* pxQueueBuffer */)
+{
+    return queueCreate(uxQueueLength, uxItemSize, 0);
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    delete xQueue;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait)
+{
+    return queueSend(xQueue, pvItemToQueue, xTicksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait)
+{
+    return queueSend(xQueue, pvItemToQueue, xTicksToWait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait)
+{
+    return queueReceive(xQueue, pvBuffer, xTicksToWait, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait)
+{
+    return queueReceive(xQueue, pvBuffer, xTicksToWait, true);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+    std::lock_guard<std::mutex> lock(xQueue->mutex);
+    return xQueue->count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+    {
+        std::lock_guard<std::mutex> lock(xQueue->mutex);
+        xQueue->count = 0;
+        xQueue->head = 0;
+    }
+    xQueue->notFull.notify_all();
+    return pdPASS;
+}
+
+QueueSetHandle_t xQueueCreateSet(const UBaseType_t uxEventQueueLength)
+{
+    return queueCreate(uxEventQueueLength, sizeof(QueueDefinition*), 0);
+}
+
+BaseType_t xQueueAddToSet(QueueSetMemberHandle_t xQueueOrSemaphore, QueueSetHandle_t xQueueSet)
+{
+    std::lock_guard<std::mutex> lock(xQueueOrSemaphore->mutex);
+
+    // FreeRTOS requires members to be empty and not to be part of another set
+    if((nullptr != xQueueOrSemaphore->set) || (0 != xQueueOrSemaphore->count)) return pdFAIL;
+
+    xQueueOrSemaphore->set = xQueueSet;
+    return pdPASS;
+}
+
+BaseType_t xQueueRemoveFromSet(QueueSetMemberHandle_t xQueueOrSemaphore, QueueSetHandle_t xQueueSet)
+{
+    std::lock_guard<std::mutex> lock(xQueueOrSemaphore->mutex);
+
+    if((xQueueSet != xQueueOrSemaphore->set) || (0 != xQueueOrSemaphore->count)) return pdFAIL;
+
+    xQueueOrSemaphore->set = nullptr;
+    return pdPASS;
+}
+
+QueueSetMemberHandle_t xQueueSelectFromSet(QueueSetHandle_t xQueueSet, const TickType_t xTicksToWait)
+{
+    QueueSetMemberHandle_t member = nullptr;
+
+    if(pdPASS != queueReceive(xQueueSet, &member, xTicksToWait, false)) {
+        member = nullptr;
+    }
+
+    return member;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return queueCreate(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* /* pxMutexBuffer */)
+{
+    return queueCreate(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return queueCreate(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* /* pxSemaphoreBuffer */)
+{
+    return queueCreate(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount)
+{
+    return queueCreate(uxMaxCount, 0, uxInitialCount);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount,
+    StaticSemaphore_t* /* pxSemaphoreBuffer */)
+{
+    return queueCreate(uxMaxCount, 0, uxInitialCount);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    return queueReceive(xSemaphore, nullptr, xBlockTime, false);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore)
+{
+    return queueSend(xSemaphore, nullptr, 0, false);
+}
+
+// ********************************************************************
+// Event groups
+// ********************************************************************
+struct EventGroupDef_t {
+    std::mutex mutex;
+    std::condition_variable changed;
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    EventGroupHandle_t group = new EventGroupDef_t();
+    group->bits = 0;
+    return group;
+}
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t* /* pxEventGroupBuffer */)
+{
+    return xEventGroupCreate();
+}
+
+void vEventGroupDelete(EventGroupHandle_t xEventGroup)
+{
+    delete xEventGroup;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+    const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits, TickType_t xTicksToWait)
+{
+    std::unique_lock<std::mutex> lock(xEventGroup->mutex);
+
+    auto satisfied = [xEventGroup, uxBitsToWaitFor, xWaitForAllBits] {
+        EventBits_t matching = xEventGroup->bits & uxBitsToWaitFor;
+        return (pdFALSE != xWaitForAllBits) ? (matching == uxBitsToWaitFor) : (0 != matching);
+    };
+
+    bool ok = waitTicks(xEventGroup->changed, lock, xTicksToWait, satisfied);
+    EventBits_t bits = xEventGroup->bits;
+    if(ok && (pdFALSE != xClearOnExit)) {
+        xEventGroup->bits &= ~uxBitsToWaitFor;
+    }
+
+    return bits;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet)
+{
+    EventBits_t bits;
+    {
+        std::lock_guard<std::mutex> lock(xEventGroup->mutex);
+        xEventGroup->bits |= uxBitsToSet;
+        bits = xEventGroup->bits;
+    }
+    xEventGroup->changed.notify_all();
+    return bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear)
+{
+    std::lock_guard<std::mutex> lock(xEventGroup->mutex);
+    EventBits_t bits = xEventGroup->bits;
+    xEventGroup->bits &= ~uxBitsToClear;
+    return bits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup)
+{
+    std::lock_guard<std::mutex> lock(xEventGroup->mutex);
+    return xEventGroup->bits;
+}
+
+// ********************************************************************
+// Software timers, processed by one service thread like the FreeRTOS timer task.
+// On the virtual clock, the virtual time task processes them instead.
+// ********************************************************************
+struct tmrTimerControl {
+    TickType_t period;
+    bool autoReload;
+    void* id;
+    TimerCallbackFunction_t callback;
+    bool active;
+    int64_t expiry;                         /**< Uptime in us */
+};
+
+typedef struct timer_service_t {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<tmrTimerControl*> timers;
+    bool running;
+} timer_service_t;
+
+static timer_service_t& getTimerService(void)
+{
+    static timer_service_t* service = new timer_service_t();
+    return *service;
+}
+
+/** Get the active timer expiring next. The service mutex must be held. */
+static tmrTimerControl* timerGetNext(timer_service_t& service)
+{
+    tmrTimerControl* next = nullptr;
+
+    for(tmrTimerControl* timer : service.timers) {
+        if(timer->active && ((nullptr == next) || (timer->expiry < next->expiry))) {
+            next = timer;
+        }
+    }
+
+    return next;
+}
+
+/** Reload or stop an expired timer. The service mutex must be held. */
+static void timerExpired(tmrTimerControl* timer)
+{
+    if(timer->autoReload) {
+        timer->expiry += ticksToMicros(timer->period);
+    } else {
+        timer->active = false;
+    }
+}
+
+static void timerServiceFunc(void)
+{
+    timer_service_t& service = getTimerService();
+    std::unique_lock<std::mutex> lock(service.mutex);
+
+    while(true) {
+        tmrTimerControl* next = timerGetNext(service);
+        int64_t now = hostClockGetUptimeUs();
+
+        if((nullptr == next) || hostClockIsVirtual()) {
+            service.changed.wait(lock);
+        } else if(now < next->expiry) {
+            service.changed.wait_for(lock, std::chrono::microseconds(next->expiry - now));
+        } else {
+            timerExpired(next);
+            lock.unlock();
+            next->callback(next);
+            lock.lock();
+        }
+    }
+}
+
+/** Let virtual time pass for the virtual time task and process the timers expiring meanwhile. */
+static void virtualTimeAdvance(int64_t us)
+{
+    timer_service_t& service = getTimerService();
+    int64_t target = hostClockGetUptimeUs() + us;
+
+    while(true) {
+        std::unique_lock<std::mutex> lock(service.mutex);
+        tmrTimerControl* next = timerGetNext(service);
+        if((nullptr == next) || (next->expiry > target)) break;
+
+        hostClockAdvance(next->expiry - hostClockGetUptimeUs());
+        timerExpired(next);
+        lock.unlock();
+        next->callback(next);
+    }
+    hostClockAdvance(target - hostClockGetUptimeUs());
+
+    if(hostClockVirtualEnded()) {
+        hostReset("virtual time ended");
+    }
+}
+
+void hostTimersDeleteAll(void)
+{
+    timer_service_t& service = getTimerService();
+    std::lock_guard<std::mutex> lock(service.mutex);
+
+    for(tmrTimerControl* timer : service.timers) {
+        delete timer;
+    }
+    service.timers.clear();
+}
+
+static TimerHandle_t timerCreate(const TickType_t period, const UBaseType_t autoReload, void* const id,
+    TimerCallbackFunction_t callback)
+{
+    timer_service_t& service = getTimerService();
+    tmrTimerControl* timer = new tmrTimerControl();
+
+    timer->period = period;
+    timer->autoReload = (pdFALSE != autoReload);
+    timer->id = id;
+    timer->callback = callback;
+    timer->active = false;
+
+    std::lock_guard<std::mutex> lock(service.mutex);
+    service.timers.push_back(timer);
+    if(!service.running) {
+        std::thread(timerServiceFunc).detach();
+        service.running = true;
+    }
+
+    return timer;
+}
+
+static BaseType_t timerSetActive(TimerHandle_t xTimer, bool active)
+{
+    timer_service_t& service = getTimerService();
+
+    if(nullptr == xTimer) return pdFAIL;
+
+    {
+        std::lock_guard<std::mutex> lock(service.mutex);
+        xTimer->active = active;
+        xTimer->expiry = hostClockGetUptimeUs() + ticksToMicros(xTimer->period);
+    }
+    service.changed.notify_all();
+
+    return pdPASS;
+}
+
+TimerHandle_t xTimerCreate(const char* const /* pcTimerName */, const TickType_t xTimerPeriodInTicks,
+    const UBaseType_t uxAutoReload, void* const pvTimerID, TimerCallbackFunction_t pxCallbackFunction)
+{
+    return timerCreate(xTimerPeriodInTicks, uxAutoReload, pvTimerID, pxCallbackFunction);
+}
+
+TimerHandle_t xTimerCreateStatic(const char* const /* pcTimerName */, const TickType_t xTimerPeriodInTicks,
+    const UBaseType_t uxAutoReload, void* const pvTimerID, TimerCallbackFunction_t pxCallbackFunction,
+    StaticTimer_t* /* pxTimerBuffer */)
+{
+    return timerCreate(xTimerPeriodInTicks, uxAutoReload, pvTimerID, pxCallbackFunction);
+}
+
+BaseType_t xTimerStart(TimerHandle_t xTimer, TickType_t /* xTicksToWait */)
+{
+    return timerSetActive(xTimer, true);
+}
+
+BaseType_t xTimerStop(TimerHandle_t xTimer, TickType_t /* xTicksToWait */)
+{
+    return timerSetActive(xTimer, false);
+}
+
+BaseType_t xTimerReset(TimerHandle_t xTimer, TickType_t /* xTicksToWait */)
+{
+    return timerSetActive(xTimer, true);
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t xTimer)
+{
+    std::lock_guard<std::mutex> lock(getTimerService().mutex);
+    return xTimer->active ? pdTRUE : pdFALSE;
+}
+
+void* pvTimerGetTimerID(const TimerHandle_t xTimer)
+{
+    return xTimer->id;
+}
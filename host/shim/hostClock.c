@@ -0,0 +1,128 @@
+/*
+ * Host shim of the system time. The firmware sets the time on SNTP sync and by the
+ * console, which must not touch the clock of the host. The definitions below take
+ * precedence over the ones of the C library and keep the set time as an offset to
+ * the host clock instead.
+ *
+ * For simulations, the host clock can be replaced by a virtual one, which only moves
+ * when it is advanced explicitly (see hostClockSetVirtual()). The uptime, i.e. the
+ * base of ticks and esp_timer, is derived from the same clock and restarts on each
+ * simulated boot.
+ *
+ * This is a C file on purpose: the C library declarations carry exception
+ * specifications, which a C++ definition would have to repeat.
+ */
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/time.h>
+
+#include "hostShim.h"
+
+static _Atomic int64_t clockOffsetUs = 0;
+static _Atomic int64_t monotonicStartUs = 0;
+static _Atomic int64_t bootUs = 0;
+
+static atomic_int virtualMode = 0;
+static _Atomic int64_t virtualUs = 0;
+static _Atomic int64_t virtualEndUs = INT64_MAX;
+
+static int64_t getHostMicros(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ((int64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+__attribute__((constructor)) static void hostClockInit(void)
+{
+    atomic_store(&monotonicStartUs, getHostMicros(CLOCK_MONOTONIC));
+}
+
+/** Monotonic time since start, the base of the uptime. */
+static int64_t getMonotonicMicros(void)
+{
+    if(atomic_load(&virtualMode)) {
+        return atomic_load(&virtualUs);
+    }
+    return getHostMicros(CLOCK_MONOTONIC) - atomic_load(&monotonicStartUs);
+}
+
+/** Base of the wall clock, which the offset is applied to. */
+static int64_t getWallBaseMicros(void)
+{
+    if(atomic_load(&virtualMode)) {
+        return atomic_load(&virtualUs);
+    }
+    return getHostMicros(CLOCK_REALTIME);
+}
+
+void hostClockSetVirtual(int64_t epochUs, int64_t durationUs)
+{
+    atomic_store(&virtualUs, 0);
+    atomic_store(&virtualEndUs, durationUs);
+    atomic_store(&bootUs, 0);
+    atomic_store(&clockOffsetUs, epochUs);
+    atomic_store(&virtualMode, 1);
+}
+
+int hostClockIsVirtual(void)
+{
+    return atomic_load(&virtualMode);
+}
+
+void hostClockAdvance(int64_t us)
+{
+    if(us > 0) {
+        atomic_fetch_add(&virtualUs, us);
+    }
+}
+
+int64_t hostClockGetVirtualUs(void)
+{
+    return atomic_load(&virtualUs);
+}
+
+int hostClockVirtualEnded(void)
+{
+    return atomic_load(&virtualMode) && (atomic_load(&virtualUs) >= atomic_load(&virtualEndUs));
+}
+
+void hostClockBoot(void)
+{
+    atomic_store(&bootUs, getMonotonicMicros());
+}
+
+int64_t hostClockGetUptimeUs(void)
+{
+    return getMonotonicMicros() - atomic_load(&bootUs);
+}
+
+int gettimeofday(struct timeval* tv, void* tz __attribute__((unused)))
+{
+    int64_t us = getWallBaseMicros() + atomic_load(&clockOffsetUs);
+
+    tv->tv_sec = (time_t) (us / 1000000);
+    tv->tv_usec = (suseconds_t) (us % 1000000);
+    return 0;
+}
+
+int settimeofday(const struct timeval* tv, const struct timezone* tz __attribute__((unused)))
+{
+    if(0 != tv) {
+        int64_t us = ((int64_t) tv->tv_sec * 1000000) + tv->tv_usec;
+        atomic_store(&clockOffsetUs, us - getWallBaseMicros());
+    }
+    return 0;
+}
+
+time_t time(time_t* t)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, 0);
+    if(0 != t) *t = tv.tv_sec;
+    return tv.tv_sec;
+}
@@ -0,0 +1,17 @@
+#ifndef DRIVER_RTC_IO_H_
+#define DRIVER_RTC_IO_H_
+
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t rtc_gpio_deinit(gpio_num_t gpio_num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DRIVER_RTC_IO_H_ */
@@ -0,0 +1,12 @@
+#ifndef ESP_ATTR_H_
+#define ESP_ATTR_H_
+
+/* Host shim: there are no dedicated memory regions, all data lives in regular RAM. */
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_RODATA_ATTR
+#define RTC_NOINIT_ATTR
+
+#endif /* ESP_ATTR_H_ */
@@ -0,0 +1,27 @@
+#ifndef ESP_SNTP_H_
+#define ESP_SNTP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SNTP_OPMODE_POLL 0
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval* tv);
+
+void sntp_setoperatingmode(uint8_t operating_mode);
+void sntp_setservername(uint8_t idx, const char* server);
+void sntp_init(void);
+void sntp_stop(void);
+bool sntp_enabled(void);
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESP_SNTP_H_ */
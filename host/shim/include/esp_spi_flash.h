@@ -0,0 +1,28 @@
+#ifndef ESP_SPI_FLASH_H
+#define ESP_SPI_FLASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPI_FLASH_SEC_SIZE  4096    /**< Size of an erasable flash sector */
+
+typedef enum {
+    SPI_FLASH_MMAP_DATA,
+    SPI_FLASH_MMAP_INST,
+} spi_flash_mmap_memory_t;
+
+typedef uint32_t spi_flash_mmap_handle_t;
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESP_SPI_FLASH_H */
@@ -0,0 +1,29 @@
+#ifndef ESP_SPIFFS_H
+#define ESP_SPIFFS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Host shim: mounting always succeeds, the files are accessed in the host file system. */
+
+typedef struct {
+    const char* base_path;
+    const char* partition_label;
+    size_t max_files;
+    bool format_if_mount_failed;
+} esp_vfs_spiffs_conf_t;
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t* conf);
+esp_err_t esp_spiffs_info(const char* partition_label, size_t* total_bytes, size_t* used_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESP_SPIFFS_H */
@@ -0,0 +1,22 @@
+#ifndef ESP_SYSTEM_H_
+#define ESP_SYSTEM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "esp_attr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void esp_restart(void) __attribute__ ((noreturn));
+uint32_t esp_random(void);
+uint32_t esp_get_free_heap_size(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESP_SYSTEM_H_ */
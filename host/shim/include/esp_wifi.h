@@ -0,0 +1,27 @@
+#ifndef ESP_WIFI_H_
+#define ESP_WIFI_H_
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    ESP_IF_WIFI_STA = 0,
+    ESP_IF_WIFI_AP,
+    ESP_IF_ETH,
+    ESP_IF_MAX
+} esp_interface_t;
+
+esp_err_t esp_wifi_get_mac(esp_interface_t ifx, uint8_t mac[6]);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ESP_WIFI_H_ */
@@ -0,0 +1,65 @@
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+/*
+ * Host shim of the FreeRTOS API subset used by the firmware. Tasks are mapped to
+ * detached threads, queues, semaphores and event groups to mutex/condition variable
+ * pairs and the tick count to a monotonic clock. Static creation functions ignore
+ * the provided buffers and allocate from the heap instead.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_attr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define configTICK_RATE_HZ          100
+#define configMINIMAL_STACK_SIZE    768
+#define configMAX_PRIORITIES        25
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t;
+
+#define portMAX_DELAY               ((TickType_t) 0xffffffffUL)
+#define portTICK_PERIOD_MS          ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS            portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(xTimeInMs)    ((TickType_t) (((TickType_t) (xTimeInMs) * (TickType_t) configTICK_RATE_HZ) / (TickType_t) 1000))
+
+#define pdFALSE                     ((BaseType_t) 0)
+#define pdTRUE                      ((BaseType_t) 1)
+#define pdPASS                      (pdTRUE)
+#define pdFAIL                      (pdFALSE)
+#define errQUEUE_EMPTY              ((BaseType_t) 0)
+#define errQUEUE_FULL               ((BaseType_t) 0)
+
+#define tskIDLE_PRIORITY            ((UBaseType_t) 0U)
+
+/* Buffers of the static creation functions. Unused by the shim. */
+typedef struct StaticQueue_t { void* dummy; } StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+typedef struct StaticTask_t { void* dummy; } StaticTask_t;
+typedef struct StaticEventGroup_t { void* dummy; } StaticEventGroup_t;
+typedef struct StaticTimer_t { void* dummy; } StaticTimer_t;
+
+/* Critical sections are emulated by one global recursive lock */
+typedef struct portMUX_TYPE { uint32_t owner; uint32_t count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+
+void vPortCPUInitializeMutex(portMUX_TYPE* mux);
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+
+#define portENTER_CRITICAL(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)      vPortExitCritical(mux)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_FREERTOS_H */
@@ -0,0 +1,28 @@
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tskTaskControlBlock* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t pvTaskCode, const char* const pcName, const uint32_t ulStackDepth,
+    void* const pvParameters, UBaseType_t uxPriority, StackType_t* const puxStackBuffer, StaticTask_t* const pxTaskBuffer);
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char* const pcName, const uint32_t usStackDepth,
+    void* const pvParameters, UBaseType_t uxPriority, TaskHandle_t* const pvCreatedTask);
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vTaskDelay(const TickType_t xTicksToDelay);
+TickType_t xTaskGetTickCount(void);
+
+#define taskYIELD() vTaskDelay(0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_TASK_H */
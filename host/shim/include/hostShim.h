@@ -0,0 +1,109 @@
+#ifndef HOST_SHIM_H
+#define HOST_SHIM_H
+
+/*
+ * Host only interface of the ESP-IDF/FreeRTOS shims. It allows the host programs
+ * (benchmarks, simulators) to act as the environment of the firmware, e.g. by
+ * driving inputs or injecting received UART data.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_log.h"
+#include "driver/gpio.h"
+#include "driver/adc.h"
+#include "driver/uart.h"
+#include "esp_sleep.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Set the level of a GPIO, i.e. the value read back by gpio_get_level(). */
+void hostGpioSetLevel(gpio_num_t gpioNum, uint32_t level);
+/** Get the level of a GPIO as driven by the firmware. */
+uint32_t hostGpioGetLevel(gpio_num_t gpioNum);
+
+/** Hook called whenever the level of a GPIO changes. */
+typedef void (*HostGpioHookFncPtr)(gpio_num_t gpioNum, uint32_t level);
+void hostSetGpioHook(HostGpioHookFncPtr hook);
+
+/** Set the raw value adc1_get_raw() returns for the channel. */
+void hostAdcSetRaw(adc1_channel_t channel, int raw);
+
+/**
+ * Append data to the receive buffer of an installed UART driver. A UART_DATA event is
+ * posted to its event queue.
+ *
+ * @return Number of bytes accepted, i.e. less than len if the receive buffer is full.
+ */
+size_t hostUartInject(uart_port_t port, const uint8_t* data, size_t len);
+/** Fetch and remove data written by the firmware. @return Number of bytes copied. */
+size_t hostUartFetch(uart_port_t port, uint8_t* data, size_t maxLen);
+
+/** Handler called instead of restarting or entering deep sleep. Exits the process by default. */
+typedef void (*HostResetHandlerFncPtr)(const char* reason);
+void hostSetResetHandler(HostResetHandlerFncPtr handler);
+/** Reset like esp_restart(), but with a custom reason passed to the reset handler. */
+void hostReset(const char* reason) __attribute__ ((noreturn));
+
+/** Timer wakeup time of the last esp_sleep_enable_timer_wakeup() call in us. */
+uint64_t hostSleepGetTimerWakeupUs(void);
+/** Set the cause esp_sleep_get_wakeup_cause() reports after the next (simulated) boot. */
+void hostSleepSetWakeupCause(esp_sleep_wakeup_cause_t cause);
+
+/** Number of SPIFFS mounts, i.e. esp_vfs_spiffs_register() calls, since the start of the program. */
+unsigned int hostSpiffsGetMountCount(void);
+
+/**
+ * Handler called when the firmware starts WiFi. It may signal the connection via the
+ * wifiEvents group. Without a handler, WiFi never connects.
+ */
+typedef void (*HostWifiStartHandlerFncPtr)(void);
+void hostSetWifiStartHandler(HostWifiStartHandlerFncPtr handler);
+
+/**
+ * Handler called when the firmware starts SNTP. It may answer the request right away
+ * by hostSntpSync(). Without a handler, SNTP never syncs.
+ */
+typedef void (*HostSntpRequestHandlerFncPtr)(void);
+void hostSetSntpRequestHandler(HostSntpRequestHandlerFncPtr handler);
+/** Set the time like a SNTP sync does and notify the firmware, if SNTP is running. */
+void hostSntpSync(int64_t epochUs);
+
+/**
+ * Virtual clock for simulations (see hostClock.c). After switching to it, time only
+ * passes if it is advanced, i.e. by the delays and timeouts of the virtual time task
+ * (see hostSetVirtualTimeTask()) or by the simulation itself.
+ *
+ * @param epochUs Wall clock time to start at in us since the epoch.
+ * @param durationUs Virtual time after which hostClockVirtualEnded() returns true.
+ */
+void hostClockSetVirtual(int64_t epochUs, int64_t durationUs);
+int hostClockIsVirtual(void);
+/** Advance the virtual clock. Software timers aren't processed, unlike task delays. */
+void hostClockAdvance(int64_t us);
+/** Virtual time passed since hostClockSetVirtual(), independent of the set wall clock. */
+int64_t hostClockGetVirtualUs(void);
+int hostClockVirtualEnded(void);
+/** Restart the uptime, i.e. ticks and esp_timer, like a (simulated) boot does. */
+void hostClockBoot(void);
+int64_t hostClockGetUptimeUs(void);
+
+/**
+ * Let the task with the given name run on the virtual clock: its delays and timeouts
+ * advance the clock instead of blocking, and software timers expiring meanwhile are
+ * processed in its context. Waits without a timeout still block. Once the virtual
+ * time has ended, the next delay or timeout performs a hostReset().
+ * Only one task, which must be created after the call, is supported.
+ */
+void hostSetVirtualTimeTask(const char* name);
+/** Delete all software timers, e.g. to simulate a reboot. The timers must not be used anymore. */
+void hostTimersDeleteAll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_SHIM_H */
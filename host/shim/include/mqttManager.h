@@ -0,0 +1,56 @@
+#ifndef MQTT_MANAGER_H
+#define MQTT_MANAGER_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <mutex>
+
+/**
+ * @brief Host stand-in for the MqttManager component. Nothing is sent; the last
+ * message of each topic is kept so it can be inspected, e.g. by benchmarks.
+ */
+class MqttManager
+{
+public:
+    typedef enum {
+        ERR_OK = 0,
+        ERR_INVALID_ARG = -1,
+        ERR_NOT_CONNECTED = -2
+    } err_t;
+
+    typedef enum {
+        QOS_AT_MOST_ONCE = 0,
+        QOS_AT_LEAST_ONCE = 1,
+        QOS_EXACTLY_ONCE = 2
+    } qos_t;
+
+    MqttManager();
+
+    void start(void);
+    void stop(void);
+
+    bool waitConnected(int timeoutMs);
+    bool waitAllPublished(int timeoutMs);
+
+    err_t publish(const char* topic, const char* data, int len, qos_t qos, bool retain);
+
+    /** Host only: Wether or not the simulated broker connection is available. */
+    void setConnected(bool connected);
+    /** Host only: Get the last message published to the topic. */
+    bool getLastMessage(const char* topic, std::string* data);
+    /** Host only: Number of messages published since the start. */
+    unsigned int getPublishCount(void);
+    /** Host only: Number of payload bytes published since the start. */
+    uint64_t getPublishedBytes(void);
+
+private:
+    std::mutex mutex;
+    bool started;
+    bool connected;
+    unsigned int publishCount;
+    uint64_t publishedBytes;
+    std::map<std::string, std::string> lastMessages;
+};
+
+#endif /* MQTT_MANAGER_H */
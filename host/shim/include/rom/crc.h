@@ -0,0 +1,20 @@
+#ifndef ROM_CRC_H
+#define ROM_CRC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * CRC-32 (IEEE 802.3) like the ROM function: the CRC is inverted on entry and exit, so
+ * calculations can be chained by passing the previous result, starting with 0.
+ */
+uint32_t crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ROM_CRC_H */
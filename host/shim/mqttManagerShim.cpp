@@ -0,0 +1,76 @@
+/*
+ * Host stand-in of the MQTT manager component.
+ */
+
+#include "mqttManager.h"
+
+MqttManager::MqttManager() : started(false), connected(true), publishCount(0), publishedBytes(0)
+{
+}
+
+void MqttManager::start(void)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    started = true;
+}
+
+void MqttManager::stop(void)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    started = false;
+}
+
+bool MqttManager::waitConnected(int /* timeoutMs */)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return connected;
+}
+
+bool MqttManager::waitAllPublished(int /* timeoutMs */)
+{
+    // Publishing completes immediately
+    return true;
+}
+
+MqttManager::err_t MqttManager::publish(const char* topic, const char* data, int len, qos_t /* qos */, bool /* retain */)
+{
+    if((nullptr == topic) || (nullptr == data) || (len < 0)) return ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!connected) return ERR_NOT_CONNECTED;
+
+    lastMessages[topic].assign(data, (size_t) len);
+    publishCount++;
+    publishedBytes += (uint64_t) len;
+
+    return ERR_OK;
+}
+
+void MqttManager::setConnected(bool connected)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->connected = connected;
+}
+
+bool MqttManager::getLastMessage(const char* topic, std::string* data)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = lastMessages.find(topic);
+
+    if(lastMessages.end() == it) return false;
+
+    if(nullptr != data) *data = it->second;
+    return true;
+}
+
+unsigned int MqttManager::getPublishCount(void)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return publishCount;
+}
+
+uint64_t MqttManager::getPublishedBytes(void)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return publishedBytes;
+}
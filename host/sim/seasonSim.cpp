@@ -0,0 +1,661 @@
+/*
+ * Season simulator of the irrigation control logic.
+ *
+ * The real IrrigationController task runs on a virtual clock (see hostShim.h), i.e. its
+ * delays and timeouts take no real time. Deep sleep and restarts reboot the components
+ * like on the target, while RTC data persists. The simulation supplies SNTP syncs, an
+ * optional drift of the RTC during deep sleep and the timezone rules of the hardware
+ * config, so DST transitions are covered as well. A year replays within seconds.
+ *
+ * The output switching is recorded by the GPIOs of the outputs and compared to the
+ * occurrences of the configured events in true time. Missed, duplicated and late
+ * switching is reported. The recorded timeline can be written to a trace file and
+ * compared to a reference trace, e.g. to check changes of the wake up margins of the
+ * controller (preEventMillisDeepSleep, noDeepSleepRangeMillis, ...).
+ *
+ * Limitations: the fill sensor and the battery voltage aren't simulated, so the
+ * hardware config should disable the related checks (as the default one does). Events
+ * overlapping on the same output channel switch it only once and are reported as missed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+
+#include "hostShim.h"
+#include "hostComponents.h"
+#include "wifiEvents.h"
+#include "globalComponents.h"
+#include "hardwareConfig.h"
+#include "timeSystem.h"
+#include "irrigationController.h"
+#include "irrigationPlanner.h"
+
+extern IrrigationController irrigCtrl;
+
+typedef struct sim_options_t {
+    const char* irrigConfigFile;
+    const char* hardwareConfigFile;
+    const char* traceFile;
+    const char* referenceFile;
+    int64_t startEpochSecs;
+    int days;
+    double driftPpm;                /**< Drift of the RTC during deep sleep, positive if it runs fast */
+    double sntpFailRate;            /**< Probability of a failing SNTP request */
+    bool offline;                   /**< No WiFi, i.e. no SNTP and MQTT */
+    bool keepAwake;                 /**< Keep awake input active, i.e. no deep sleep */
+    int bootMillis;                 /**< Time from reset to starting the controller */
+    int wifiMillis;                 /**< Time from starting WiFi to being connected */
+    int toleranceMillis;            /**< Deviation from the event time still considered in time */
+    int windowSecs;                 /**< Maximum deviation for matching switching to events */
+    unsigned int seed;
+    int logLevel;
+} sim_options_t;
+
+typedef struct switch_record_t {
+    int64_t trueUs;                 /**< True time of the switching in us since the epoch */
+    int channel;
+    bool on;
+} switch_record_t;
+
+typedef struct expected_switch_t {
+    int64_t trueUs;
+    int channel;
+    bool on;
+    int eventIdx;                   /**< Index of the event in the configuration */
+} expected_switch_t;
+
+typedef struct sim_stats_t {
+    unsigned int boots;
+    unsigned int deepSleeps;
+    unsigned int restarts;
+    unsigned int configRtcLoads;    /**< Boots which restored the config from RTC memory */
+    unsigned int configRtcMounts;   /**< Of them, boots which mounted the config store nevertheless */
+    unsigned int configImageLoads;  /**< Boots which loaded the config image instead of parsing the configs */
+    unsigned int sntpRequests;
+    unsigned int sntpSyncs;
+    unsigned int wifiStarts;
+    int64_t awakeUs;
+    int64_t sleepUs;
+} sim_stats_t;
+
+static const gpio_num_t outputGpios[OutputController::intChannels] = {
+    irrigationMainGpioNum,
+    irrigationAux0GpioNum,
+    irrigationAux1GpioNum
+};
+static const char* const outputNames[OutputController::intChannels] = {"MAIN", "AUX0", "AUX1"};
+
+static sim_options_t opts;
+static sim_stats_t stats;
+static std::string irrigConfigJson;
+static std::string hardwareConfigJson;
+static std::mt19937 rng;
+
+static std::mutex simMutex;
+static std::condition_variable simResetCond;
+static bool simResetPending = false;
+static std::string simResetReason;
+static std::vector<switch_record_t> switches;
+
+// ********************************************************************
+// Time helpers
+// ********************************************************************
+static int64_t getTrueUs(void)
+{
+    return opts.startEpochSecs * 1000000 + hostClockGetVirtualUs();
+}
+
+static void formatTime(int64_t us, char* buf, size_t bufLen)
+{
+    int64_t secs = CivilTime::floorDiv(us, 1000000);
+    int64_t days = CivilTime::floorDiv(secs, CivilTime::secsPerDay);
+    int32_t daySecs = (int32_t) (secs - days * CivilTime::secsPerDay);
+    int year, month, day;
+
+    CivilTime::civilFromDays(days, &year, &month, &day);
+    snprintf(buf, bufLen, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", year, month, day,
+        daySecs / 3600, (daySecs / 60) % 60, daySecs % 60, (int) ((us - secs * 1000000) / 1000));
+}
+
+// ********************************************************************
+// Environment hooks, called by the shims
+// ********************************************************************
+static void simGpioHook(gpio_num_t gpioNum, uint32_t level)
+{
+    for(unsigned int i = 0; i < OutputController::intChannels; i++) {
+        if(outputGpios[i] == gpioNum) {
+            switch_record_t rec = {getTrueUs(), (int) i, (0 != level)};
+            std::lock_guard<std::mutex> lock(simMutex);
+            switches.push_back(rec);
+        }
+    }
+}
+
+/** Called when the firmware starts WiFi. Connecting takes --wifi-ms, unless offline. */
+static void simWifiStartHandler(void)
+{
+    stats.wifiStarts++;
+    if(!opts.offline) {
+        hostClockAdvance((int64_t) opts.wifiMillis * 1000);
+        xEventGroupSetBits(wifiEvents, wifiEventConnected);
+    }
+}
+
+static void simSntpRequestHandler(void)
+{
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+
+    stats.sntpRequests++;
+    if(dist(rng) >= opts.sntpFailRate) {
+        stats.sntpSyncs++;
+        hostSntpSync(getTrueUs());
+    }
+}
+
+/** Called by the controller task instead of a restart or deep sleep. Ends the task. */
+static void simResetHandler(const char* reason)
+{
+    {
+        std::lock_guard<std::mutex> lock(simMutex);
+        simResetReason = reason;
+        simResetPending = true;
+    }
+    simResetCond.notify_one();
+
+    vTaskDelete(nullptr);
+    abort();
+}
+
+// ********************************************************************
+// Boot sequence, like app_main() without the network and console parts
+// ********************************************************************
+static void simBootSystem(void)
+{
+    stats.boots++;
+
+    hostTimersDeleteAll();
+    xEventGroupClearBits(wifiEvents, wifiEventConnected);
+    hostGpioSetLevel(keepAwakeGpioNum, opts.keepAwake ? 0 : 1);
+    hostComponentsReboot();
+    hostClockBoot();
+    hostClockAdvance((int64_t) opts.bootMillis * 1000);
+
+    // The configs given take the place of the config files
+    if( (ESP_SLEEP_WAKEUP_TIMER == esp_sleep_get_wakeup_cause()) &&
+        (SettingsManager::ERR_OK == settingsMgr.loadConfigRtcCopy()) )
+    {
+        stats.configRtcLoads++;
+    } else if(SettingsManager::ERR_OK == settingsMgr.loadConfigImage()) {
+        stats.configImageLoads++;
+    } else {
+        settingsMgr.init();
+        if(SettingsManager::ERR_OK != settingsMgr.updateIrrigationConfig(irrigConfigJson.c_str(), irrigConfigJson.length(), true)) {
+            fprintf(stderr, "Irrigation config %s is invalid.\n", opts.irrigConfigFile);
+            exit(2);
+        }
+        if(!hardwareConfigJson.empty() &&
+            (SettingsManager::ERR_OK != settingsMgr.updateHardwareConfig(hardwareConfigJson.c_str(), hardwareConfigJson.length(), true)))
+        {
+            fprintf(stderr, "Hardware config %s is invalid.\n", opts.hardwareConfigFile);
+            exit(2);
+        }
+        settingsMgr.storeConfigImage();
+    }
+
+    TimeSystem_Init();
+
+    settingsMgr.registerHardwareConfigUpdatedHook(TimeSystem_HardwareConfigUpdated, nullptr);
+    settingsMgr.registerHardwareConfigUpdatedHook(settingsMgr.solarTableUpdateHookDispatch, &settingsMgr);
+    settingsMgr.registerHardwareConfigUpdatedHook(pwrMgr.hardwareConfigUpdatedHookDispatch, &pwrMgr);
+    settingsMgr.registerIrrigConfigUpdatedHook(irrigPlanner.irrigConfigUpdatedHookDispatch, &irrigPlanner);
+
+    TimeSystem_HardwareConfigUpdated(nullptr);
+    settingsMgr.updateSolarTable();
+    pwrMgr.hardwareConfigUpdated();
+    irrigPlanner.irrigConfigUpdated();
+
+    if(irrigCtrl.isNetworkWakeRequired()) {
+        irrigCtrl.startNetwork();
+    }
+}
+
+/** Wait for the controller task to reset the system. @return Reset reason. */
+static std::string simWaitReset(void)
+{
+    std::unique_lock<std::mutex> lock(simMutex);
+
+    simResetCond.wait(lock, []{ return simResetPending; });
+    simResetPending = false;
+    return simResetReason;
+}
+
+// ********************************************************************
+// Expected switching, based on the configured events in true time
+// ********************************************************************
+static std::vector<expected_switch_t> calcExpectedSwitches(void)
+{
+    std::vector<expected_switch_t> expected;
+    const irrigation_config_t* config = settingsMgr.acquireIrrigationConfig();
+    time_t endSecs = (time_t) (opts.startEpochSecs + (int64_t) opts.days * CivilTime::secsPerDay);
+
+    if(nullptr == config) {
+        fprintf(stderr, "No irrigation config available.\n");
+        exit(2);
+    }
+
+    for(int idx = config->events.nextUsed(0); idx >= 0; idx = config->events.nextUsed(idx + 1)) {
+        IrrigationEvent::irrigation_event_data_t data;
+        if(IrrigationEvent::ERR_OK != config->events[idx].getEventData(&data)) continue;
+        if((data.zoneIdx < 0) || (data.zoneIdx >= (int) irrigationPlannerNumZones)) continue;
+        const irrigation_zone_cfg_t& zone = config->zones[data.zoneIdx];
+
+        time_t ref = (time_t) opts.startEpochSecs;
+        time_t next;
+        while((0 != (next = config->events[idx].calcNextOccurance(ref))) && (next < endSecs)) {
+            for(unsigned int i = 0; i < irrigationZoneCfgElements; i++) {
+                int ch = (int) zone.chNum[i] - (int) OutputController::CH_MAIN;
+                if(!zone.chEnabled[i] || (ch < 0) || (ch >= (int) OutputController::intChannels)) continue;
+
+                if(zone.chStateStart[i]) {
+                    expected.push_back({(int64_t) next * 1000000, ch, true, idx});
+                }
+                if(zone.chStateStart[i] != zone.chStateStop[i]) {
+                    expected.push_back({((int64_t) next + data.durationSecs) * 1000000, ch, zone.chStateStop[i], idx});
+                }
+            }
+            ref = next + 1;
+        }
+    }
+
+    settingsMgr.releaseIrrigationConfig(config);
+
+    std::sort(expected.begin(), expected.end(), [](const expected_switch_t& a, const expected_switch_t& b) {
+        return (a.trueUs < b.trueUs) || ((a.trueUs == b.trueUs) && (a.channel < b.channel));
+    });
+    return expected;
+}
+
+// ********************************************************************
+// Evaluation
+// ********************************************************************
+typedef struct eval_result_t {
+    unsigned int matched;
+    unsigned int missed;
+    unsigned int duplicated;
+    unsigned int late;
+    int64_t maxDeviationUs;
+} eval_result_t;
+
+/**
+ * Match the observed switching of one channel and direction to the expected one. Each
+ * expected switching may be matched by one observed switching within the window, which
+ * ends half way to the neighbouring expected switching.
+ */
+static void evalSeries(const std::vector<int64_t>& expected, const std::vector<int>& eventIdx,
+    const std::vector<int64_t>& observed, const char* what, eval_result_t* res)
+{
+    const int64_t windowUs = (int64_t) opts.windowSecs * 1000000;
+    const int64_t toleranceUs = (int64_t) opts.toleranceMillis * 1000;
+    char timeStr[32];
+    size_t o = 0;
+
+    for(size_t e = 0; e < expected.size(); e++) {
+        int64_t lo = expected[e] - windowUs;
+        int64_t hi = expected[e] + windowUs;
+        if(e > 0) lo = std::max(lo, expected[e] - (expected[e] - expected[e-1]) / 2);
+        if(e + 1 < expected.size()) hi = std::min(hi, expected[e] + (expected[e+1] - expected[e]) / 2);
+
+        for(; (o < observed.size()) && (observed[o] < lo); o++) {
+            formatTime(observed[o], timeStr, sizeof(timeStr));
+            printf("DUPLICATED %s  %s\n", timeStr, what);
+            res->duplicated++;
+        }
+
+        formatTime(expected[e], timeStr, sizeof(timeStr));
+        if((o < observed.size()) && (observed[o] < hi)) {
+            int64_t deviation = observed[o] - expected[e];
+            res->matched++;
+            res->maxDeviationUs = std::max(res->maxDeviationUs, (deviation < 0) ? -deviation : deviation);
+            if((deviation > toleranceUs) || (deviation < -toleranceUs)) {
+                printf("LATE       %s  %s  %+lld ms (event %d)\n", timeStr, what, (long long) (deviation / 1000), eventIdx[e]);
+                res->late++;
+            }
+            o++;
+        } else {
+            printf("MISSED     %s  %s  (event %d)\n", timeStr, what, eventIdx[e]);
+            res->missed++;
+        }
+    }
+
+    for(; o < observed.size(); o++) {
+        formatTime(observed[o], timeStr, sizeof(timeStr));
+        printf("DUPLICATED %s  %s\n", timeStr, what);
+        res->duplicated++;
+    }
+}
+
+static eval_result_t evaluate(const std::vector<expected_switch_t>& expected)
+{
+    eval_result_t res = {0, 0, 0, 0, 0};
+    char what[16];
+
+    for(int ch = 0; ch < (int) OutputController::intChannels; ch++) {
+        for(int on = 1; on >= 0; on--) {
+            std::vector<int64_t> expTimes, obsTimes;
+            std::vector<int> expIdx;
+
+            for(const expected_switch_t& exp : expected) {
+                if((exp.channel == ch) && (exp.on == (1 == on))) {
+                    expTimes.push_back(exp.trueUs);
+                    expIdx.push_back(exp.eventIdx);
+                }
+            }
+            for(const switch_record_t& rec : switches) {
+                if((rec.channel == ch) && (rec.on == (1 == on))) {
+                    obsTimes.push_back(rec.trueUs);
+                }
+            }
+
+            snprintf(what, sizeof(what), "%s %s", outputNames[ch], on ? "ON" : "OFF");
+            evalSeries(expTimes, expIdx, obsTimes, what, &res);
+        }
+    }
+
+    return res;
+}
+
+/** Write the trace and compare it to the reference. @return Number of differing lines. */
+static unsigned int writeTrace(void)
+{
+    std::vector<std::string> lines;
+    char timeStr[32];
+    char line[64];
+    unsigned int diffs = 0;
+
+    for(const switch_record_t& rec : switches) {
+        formatTime(rec.trueUs, timeStr, sizeof(timeStr));
+        snprintf(line, sizeof(line), "%s %s %s", timeStr, outputNames[rec.channel], rec.on ? "ON" : "OFF");
+        lines.push_back(line);
+    }
+
+    if(nullptr != opts.traceFile) {
+        FILE* f = fopen(opts.traceFile, "w");
+        if(nullptr == f) {
+            fprintf(stderr, "Couldn't write trace file %s.\n", opts.traceFile);
+            exit(2);
+        }
+        for(const std::string& l : lines) {
+            fprintf(f, "%s\n", l.c_str());
+        }
+        fclose(f);
+    }
+
+    if(nullptr != opts.referenceFile) {
+        FILE* f = fopen(opts.referenceFile, "r");
+        if(nullptr == f) {
+            fprintf(stderr, "Couldn't read reference trace %s.\n", opts.referenceFile);
+            exit(2);
+        }
+
+        size_t i = 0;
+        while(nullptr != fgets(line, sizeof(line), f)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if((i >= lines.size()) || (lines[i] != line)) {
+                if(0 == diffs) {
+                    printf("Trace differs from reference at line %u: '%s' instead of '%s'\n", (unsigned int) (i + 1),
+                        (i < lines.size()) ? lines[i].c_str() : "<end>", line);
+                }
+                diffs++;
+            }
+            i++;
+        }
+        if(i < lines.size()) diffs += (unsigned int) (lines.size() - i);
+        fclose(f);
+    }
+
+    return diffs;
+}
+
+// ********************************************************************
+// Command line
+// ********************************************************************
+static bool readFile(const char* filename, std::string* content)
+{
+    FILE* f = fopen(filename, "r");
+    char buf[1024];
+    size_t len;
+
+    if(nullptr == f) return false;
+    content->clear();
+    while((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+        content->append(buf, len);
+    }
+    fclose(f);
+    return true;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+        "Usage: %s [options] <irrigation config>\n"
+        "  --hardware FILE       hardware config (default: built-in default config)\n"
+        "  --start YYYY-MM-DD    start date, midnight UTC (default: 2020-01-01)\n"
+        "  --days N              simulated days (default: 365)\n"
+        "  --drift PPM           RTC drift during deep sleep, positive if fast (default: 0)\n"
+        "  --sntp-fail-rate P    probability of a failing SNTP request (default: 0)\n"
+        "  --offline             no WiFi, i.e. no SNTP syncs\n"
+        "  --keep-awake          keep awake input active, i.e. no deep sleep\n"
+        "  --boot-ms N           time from reset to starting the controller (default: 600)\n"
+        "  --wifi-ms N           time for connecting to WiFi (default: 2000)\n"
+        "  --tolerance-ms N      deviation still considered in time (default: 1000)\n"
+        "  --window-secs N       maximum deviation for matching switching to events (default: 3600)\n"
+        "  --seed N              seed for random SNTP failures (default: 0)\n"
+        "  --trace FILE          write the output switching timeline\n"
+        "  --reference FILE      compare the timeline to a reference trace\n"
+        "  --log-level N         firmware log level, 0 (none) to 5 (verbose) (default: 0)\n"
+        "Exits with 1 if switching was missed, duplicated, late or differs from the reference,\n"
+        "or if the config store was mounted on a boot which restored the config from RTC memory.\n",
+        prog);
+}
+
+static bool parseDate(const char* str, int64_t* epochSecs)
+{
+    int year, month, day;
+
+    if((3 != sscanf(str, "%d-%d-%d", &year, &month, &day)) || (month < 1) || (month > 12) ||
+        (day < 1) || (day > CivilTime::daysInMonth(year, month)))
+    {
+        return false;
+    }
+    *epochSecs = CivilTime::daysFromCivil(year, month, day) * CivilTime::secsPerDay;
+    return true;
+}
+
+static void parseOptions(int argc, char** argv)
+{
+    static const struct option longOpts[] = {
+        {"hardware", required_argument, nullptr, 'H'},
+        {"start", required_argument, nullptr, 's'},
+        {"days", required_argument, nullptr, 'd'},
+        {"drift", required_argument, nullptr, 'D'},
+        {"sntp-fail-rate", required_argument, nullptr, 'f'},
+        {"offline", no_argument, nullptr, 'o'},
+        {"keep-awake", no_argument, nullptr, 'k'},
+        {"boot-ms", required_argument, nullptr, 'b'},
+        {"wifi-ms", required_argument, nullptr, 'w'},
+        {"tolerance-ms", required_argument, nullptr, 't'},
+        {"window-secs", required_argument, nullptr, 'W'},
+        {"seed", required_argument, nullptr, 'S'},
+        {"trace", required_argument, nullptr, 'T'},
+        {"reference", required_argument, nullptr, 'r'},
+        {"log-level", required_argument, nullptr, 'l'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+
+    opts.hardwareConfigFile = nullptr;
+    opts.traceFile = nullptr;
+    opts.referenceFile = nullptr;
+    opts.startEpochSecs = 1577836800; // 2020-01-01
+    opts.days = 365;
+    opts.driftPpm = 0.0;
+    opts.sntpFailRate = 0.0;
+    opts.offline = false;
+    opts.keepAwake = false;
+    opts.bootMillis = 600;
+    opts.wifiMillis = 2000;
+    opts.toleranceMillis = 1000;
+    opts.windowSecs = 3600;
+    opts.seed = 1;
+    opts.logLevel = ESP_LOG_NONE;
+
+    while(-1 != (c = getopt_long(argc, argv, "h", longOpts, nullptr))) {
+        switch(c) {
+            case 'H': opts.hardwareConfigFile = optarg; break;
+            case 's':
+                if(!parseDate(optarg, &opts.startEpochSecs)) {
+                    fprintf(stderr, "Invalid start date %s.\n", optarg);
+                    exit(2);
+                }
+                break;
+            case 'd': opts.days = atoi(optarg); break;
+            case 'D': opts.driftPpm = atof(optarg); break;
+            case 'f': opts.sntpFailRate = atof(optarg); break;
+            case 'o': opts.offline = true; break;
+            case 'k': opts.keepAwake = true; break;
+            case 'b': opts.bootMillis = atoi(optarg); break;
+            case 'w': opts.wifiMillis = atoi(optarg); break;
+            case 't': opts.toleranceMillis = atoi(optarg); break;
+            case 'W': opts.windowSecs = atoi(optarg); break;
+            case 'S': opts.seed = (unsigned int) strtoul(optarg, nullptr, 0); break;
+            case 'T': opts.traceFile = optarg; break;
+            case 'r': opts.referenceFile = optarg; break;
+            case 'l': opts.logLevel = atoi(optarg); break;
+            default:
+                usage(argv[0]);
+                exit(2);
+        }
+    }
+
+    if((optind + 1 != argc) || (opts.days <= 0)) {
+        usage(argv[0]);
+        exit(2);
+    }
+    opts.irrigConfigFile = argv[optind];
+
+    if(!readFile(opts.irrigConfigFile, &irrigConfigJson)) {
+        fprintf(stderr, "Couldn't read irrigation config %s.\n", opts.irrigConfigFile);
+        exit(2);
+    }
+    if((nullptr != opts.hardwareConfigFile) && !readFile(opts.hardwareConfigFile, &hardwareConfigJson)) {
+        fprintf(stderr, "Couldn't read hardware config %s.\n", opts.hardwareConfigFile);
+        exit(2);
+    }
+}
+
+// ********************************************************************
+// Main
+// ********************************************************************
+int main(int argc, char** argv)
+{
+    char startStr[32];
+    std::vector<expected_switch_t> expected;
+    int64_t bootStartUs;
+    unsigned int bootRtcLoads;
+    unsigned int bootMounts;
+
+    parseOptions(argc, argv);
+
+    esp_log_level_set("*", (esp_log_level_t) opts.logLevel);
+    rng.seed(opts.seed);
+
+    hostClockSetVirtual(opts.startEpochSecs * 1000000, (int64_t) opts.days * CivilTime::secsPerDay * 1000000);
+    hostSetVirtualTimeTask("irrig_ctrl_task");
+    hostSetResetHandler(simResetHandler);
+    hostSetSntpRequestHandler(simSntpRequestHandler);
+    hostSetGpioHook(simGpioHook);
+    hostSetWifiStartHandler(simWifiStartHandler);
+
+    while(true) {
+        bootStartUs = hostClockGetVirtualUs();
+        bootRtcLoads = stats.configRtcLoads;
+        bootMounts = hostSpiffsGetMountCount();
+        simBootSystem();
+        if(1 == stats.boots) {
+            expected = calcExpectedSwitches();
+        }
+        irrigCtrl.start();
+
+        std::string reason = simWaitReset();
+        stats.awakeUs += hostClockGetVirtualUs() - bootStartUs;
+        // A wake restored from RTC memory must not touch the config store
+        if((stats.configRtcLoads != bootRtcLoads) && (hostSpiffsGetMountCount() != bootMounts)) {
+            stats.configRtcMounts++;
+        }
+        if(hostClockVirtualEnded()) break;
+
+        if("deep sleep" == reason) {
+            int64_t sleepUs = (int64_t) hostSleepGetTimerWakeupUs();
+            struct timeval tv;
+
+            stats.deepSleeps++;
+            stats.sleepUs += sleepUs;
+            hostClockAdvance(sleepUs);
+
+            // The RTC runs from its own, less accurate oscillator in deep sleep
+            gettimeofday(&tv, nullptr);
+            int64_t deviceUs = (int64_t) tv.tv_sec * 1000000 + tv.tv_usec + (int64_t) (sleepUs * opts.driftPpm / 1e6);
+            tv.tv_sec = (time_t) (deviceUs / 1000000);
+            tv.tv_usec = (suseconds_t) (deviceUs % 1000000);
+            settimeofday(&tv, nullptr);
+
+            hostSleepSetWakeupCause(ESP_SLEEP_WAKEUP_TIMER);
+            if(hostClockVirtualEnded()) break;
+        } else {
+            stats.restarts++;
+            hostSleepSetWakeupCause(ESP_SLEEP_WAKEUP_UNDEFINED);
+        }
+    }
+
+    formatTime(opts.startEpochSecs * 1000000, startStr, sizeof(startStr));
+    eval_result_t res = evaluate(expected);
+    unsigned int traceDiffs = writeTrace();
+    int64_t simUs = hostClockGetVirtualUs();
+
+    printf("\nSimulated %d days starting at %s\n", opts.days, startStr);
+    printf("Boots: %u (deep sleep wakeups: %u, restarts: %u)\n", stats.boots, stats.deepSleeps, stats.restarts);
+    printf("Config: restored from RTC memory on %u boots (config store mounted on %u of them), loaded from image on %u boots\n",
+        stats.configRtcLoads, stats.configRtcMounts, stats.configImageLoads);
+    printf("Awake: %.1f h (%.2f %%)\n", stats.awakeUs / 3.6e9, (simUs > 0) ? (100.0 * stats.awakeUs / simUs) : 0.0);
+    printf("WiFi: %u starts\n", stats.wifiStarts);
+    printf("SNTP: %u requests, %u syncs\n", stats.sntpRequests, stats.sntpSyncs);
+    printf("MQTT: %u messages, %llu bytes\n", mqttMgr.getPublishCount(), (unsigned long long) mqttMgr.getPublishedBytes());
+    printf("Switching: %u expected, %u observed, %u matched (max. deviation %lld ms)\n",
+        (unsigned int) expected.size(), (unsigned int) switches.size(), res.matched, (long long) (res.maxDeviationUs / 1000));
+    printf("Missed: %u, duplicated: %u, late: %u\n", res.missed, res.duplicated, res.late);
+    if(nullptr != opts.referenceFile) {
+        printf("Reference trace: %u differing lines\n", traceDiffs);
+    }
+
+    // Exit without destroying the global components, their tasks are still running
+    fflush(stdout);
+    _exit(((0 == res.missed) && (0 == res.duplicated) && (0 == res.late) && (0 == traceDiffs) &&
+        (0 == stats.configRtcMounts)) ? 0 : 1);
+}
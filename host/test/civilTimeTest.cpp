@@ -0,0 +1,161 @@
+/*
+ * Tests of the CivilTime conversions against the ones of the C library (glibc), which
+ * the firmware used before. The years 2018 to 2040 are compared hour by hour in several
+ * timezones, which includes all DST gap and overlap hours.
+ */
+
+#include <stdlib.h>
+#include <ctime>
+
+#include "testUtils.h"
+#include "civilTime.h"
+
+/** 2018-01-01 00:00:00 UTC */
+static const time_t testStartTime = 1514764800;
+/** 2041-01-01 00:00:00 UTC */
+static const time_t testEndTime = 2240611200;
+static const int testLastYear = 2040;
+
+static const char* const testTimezones[] = {
+    "UTC0",
+    "CET-1CEST,M3.5.0,M10.5.0/3",
+    "EST5EDT,M3.2.0,M11.1.0",
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",
+    "NZST-12NZDT,M9.5.0,M4.1.0/3",
+    "IST-5:30"
+};
+
+static const char* const testTzCet = "CET-1CEST,M3.5.0,M10.5.0/3";
+
+/** Set the timezone of both the CivilTime and the C library. */
+static bool setTimezones(CivilTime& civilTime, const char* posixTz)
+{
+    setenv("TZ", posixTz, 1);
+    tzset();
+
+    return TEST_CHECK_EQ(CivilTime::ERR_OK, civilTime.setTimezone(posixTz));
+}
+
+static time_t libcMktime(int year, int month, int day, int hour, int minute)
+{
+    struct tm tm = {};
+
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_isdst = -1;
+
+    return mktime(&tm);
+}
+
+static void testUtcToCivilMatchesLocaltime(void)
+{
+    for(const char* posixTz : testTimezones) {
+        CivilTime civilTime;
+        civil_time_t civil;
+        struct tm tm;
+
+        if(!setTimezones(civilTime, posixTz)) return;
+
+        // Hourly plus some seconds, so all minutes and seconds of the hour are covered
+        for(time_t t = testStartTime; t < testEndTime; t += 3600 + 7) {
+            civilTime.utcToCivil(t, &civil);
+            localtime_r(&t, &tm);
+
+            bool passed = TEST_CHECK_EQ(tm.tm_year + 1900, civil.year) &&
+                TEST_CHECK_EQ(tm.tm_mon + 1, civil.month) &&
+                TEST_CHECK_EQ(tm.tm_mday, civil.day) &&
+                TEST_CHECK_EQ(tm.tm_hour, civil.hour) &&
+                TEST_CHECK_EQ(tm.tm_min, civil.minute) &&
+                TEST_CHECK_EQ(tm.tm_sec, civil.second) &&
+                TEST_CHECK_EQ(tm.tm_wday, civil.weekday) &&
+                TEST_CHECK_EQ(tm.tm_yday, civil.yearday) &&
+                TEST_CHECK_EQ(tm.tm_isdst > 0, civil.isDst) &&
+                TEST_CHECK_EQ(tm.tm_gmtoff, (long) civilTime.getUtcOffset(t));
+            if(!passed) {
+                std::cerr << "  at " << t << " in " << posixTz << std::endl;
+                return;
+            }
+        }
+    }
+}
+
+static void testCivilToUtcMatchesMktime(void)
+{
+    for(const char* posixTz : testTimezones) {
+        CivilTime civilTime;
+
+        if(!setTimezones(civilTime, posixTz)) return;
+
+        for(int year = civilTimeTableFirstYear; year <= testLastYear; year++) {
+            for(int month = 1; month <= 12; month++) {
+                for(int day = 1; day <= CivilTime::daysInMonth(year, month); day++) {
+                    for(int hour = 0; hour < 24; hour++) {
+                        if(!TEST_CHECK_EQ(libcMktime(year, month, day, hour, 30), civilTime.civilToUtc(year, month, day, hour, 30, 0))) {
+                            std::cerr << "  at " << year << "-" << month << "-" << day << " " << hour << ":30 in " << posixTz << std::endl;
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/** Local times within the gap are interpreted as standard time. */
+static void testGapHour(void)
+{
+    CivilTime civilTime;
+    civil_time_t civil;
+
+    if(!setTimezones(civilTime, testTzCet)) return;
+
+    // 2020-03-29 02:30 doesn't exist, it is 01:30 UTC, i.e. 03:30 CEST
+    time_t t = civilTime.civilToUtc(2020, 3, 29, 2, 30, 0);
+    TEST_CHECK_EQ(1585445400, t);
+    civilTime.utcToCivil(t, &civil);
+    TEST_CHECK_EQ(3, civil.hour);
+    TEST_CHECK_EQ(30, civil.minute);
+    TEST_CHECK(civil.isDst);
+
+    // The hours around the gap are unambiguous
+    TEST_CHECK_EQ(1585445400 - 3600, civilTime.civilToUtc(2020, 3, 29, 1, 30, 0));
+    TEST_CHECK_EQ(1585445400, civilTime.civilToUtc(2020, 3, 29, 3, 30, 0));
+}
+
+/** Ambiguous local times within the overlap resolve to the first occurance, i.e. DST. */
+static void testOverlapHour(void)
+{
+    CivilTime civilTime;
+    civil_time_t civil;
+
+    if(!setTimezones(civilTime, testTzCet)) return;
+
+    // 2020-10-25 02:30 occurs at 00:30 UTC (CEST) and at 01:30 UTC (CET)
+    time_t t = civilTime.civilToUtc(2020, 10, 25, 2, 30, 0);
+    TEST_CHECK_EQ(1603585800, t);
+    civilTime.utcToCivil(t, &civil);
+    TEST_CHECK_EQ(2, civil.hour);
+    TEST_CHECK(civil.isDst);
+
+    civilTime.utcToCivil(t + 3600, &civil);
+    TEST_CHECK_EQ(2, civil.hour);
+    TEST_CHECK_EQ(30, civil.minute);
+    TEST_CHECK(!civil.isDst);
+
+    TEST_CHECK_EQ(1603585800 + 7200, civilTime.civilToUtc(2020, 10, 25, 3, 30, 0));
+}
+
+static const test_case_t tests[] = {
+    TEST_CASE(testUtcToCivilMatchesLocaltime),
+    TEST_CASE(testCivilToUtcMatchesMktime),
+    TEST_CASE(testGapHour),
+    TEST_CASE(testOverlapHour)
+};
+
+int main(void)
+{
+    return TEST_RUN(tests);
+}
@@ -0,0 +1,98 @@
+/*
+ * Tests of the config files in the config store, which is the directory /cfg_store on
+ * the host. The tests are skipped if it can't be created.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+
+#include "testUtils.h"
+#include "globalComponents.h"
+#include "fileConfig.h"
+
+static void writeFile(const std::string& filename, const std::string& content)
+{
+    std::ofstream(filename, std::ios::binary) << content;
+}
+
+static bool fileExists(const std::string& filename)
+{
+    struct stat st;
+    return (0 == stat(filename.c_str(), &st));
+}
+
+static std::string readFile(const std::string& filename)
+{
+    std::ifstream f(filename, std::ios::binary);
+    std::stringstream content;
+
+    content << f.rdbuf();
+    return content.str();
+}
+
+static void removeFiles(const char* filename)
+{
+    unlink(filename);
+    unlink((std::string(filename) + ".tmp").c_str());
+    unlink((std::string(filename) + ".new").c_str());
+}
+
+/** Writes interrupted by a power failure are completed or discarded when mounting. */
+static void testRecoverInterruptedWrites(void)
+{
+    // First write, interrupted before the file was complete
+    writeFile(std::string(filenameIrrigationConfig) + ".tmp", "{\"zones\": [");
+    // Interrupted before the previous file was removed
+    writeFile(filenameHardwareConfig, "old");
+    writeFile(std::string(filenameHardwareConfig) + ".new", "new");
+    // Interrupted after the previous file was removed
+    writeFile(std::string(filenameSolarTable) + ".new", "new");
+
+    TEST_CHECK_EQ(SettingsManager::ERR_OK, settingsMgr.mountConfigStore());
+
+    TEST_CHECK(!fileExists(filenameIrrigationConfig));
+    TEST_CHECK(!fileExists(std::string(filenameIrrigationConfig) + ".tmp"));
+    TEST_CHECK_EQ(std::string("new"), readFile(filenameHardwareConfig));
+    TEST_CHECK(!fileExists(std::string(filenameHardwareConfig) + ".new"));
+    TEST_CHECK_EQ(std::string("new"), readFile(filenameSolarTable));
+    TEST_CHECK(!fileExists(std::string(filenameSolarTable) + ".new"));
+}
+
+static void testWriteConfigFile(void)
+{
+    std::string config = testMakeIrrigationConfig({});
+    std::string json = "{\"storePersistent\": true, " + config.substr(1);
+
+    TEST_CHECK_EQ(SettingsManager::ERR_OK, settingsMgr.updateIrrigationConfig(json.c_str(), json.length(), true));
+
+    // Stored without the storePersistent member
+    TEST_CHECK_EQ(config, readFile(filenameIrrigationConfig));
+    TEST_CHECK(!fileExists(std::string(filenameIrrigationConfig) + ".tmp"));
+    TEST_CHECK(!fileExists(std::string(filenameIrrigationConfig) + ".new"));
+}
+
+static const test_case_t tests[] = {
+    TEST_CASE(testRecoverInterruptedWrites),
+    TEST_CASE(testWriteConfigFile)
+};
+
+int main(void)
+{
+    bool created = (0 == mkdir(filepathConfigStore, 0755));
+
+    if(!created && !fileExists(filepathConfigStore)) {
+        printf("Config store %s can't be created, skipping tests.\n", filepathConfigStore);
+        return 0;
+    }
+
+    int ret = TEST_RUN(tests);
+
+    removeFiles(filenameIrrigationConfig);
+    removeFiles(filenameHardwareConfig);
+    removeFiles(filenameSolarTable);
+    if(created) rmdir(filepathConfigStore);
+
+    return ret;
+}
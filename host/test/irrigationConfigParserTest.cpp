@@ -0,0 +1,560 @@
+/*
+ * Tests of the IrrigationConfigParser against the former parsing via a cJSON tree, which
+ * is kept here as reference. Both have to accept and reject the same configurations and
+ * set up the same zones and events, also when the input is fed in small chunks.
+ *
+ * The reference includes the later range check of "offsetMinutes". Known differences,
+ * which aren't compared: the parser only supports integers fitting into an int32_t
+ * (cJSON truncated fractions and saturated big numbers) and rejects leading zeros, as
+ * JSON requires. It also rejects events with "isSingle" or "isDaily", but without a
+ * time (cJSON dereferenced the missing items).
+ */
+
+#include <string.h>
+#include <fstream>
+#include <sstream>
+
+#include "cJSON.h"
+
+#include "testUtils.h"
+#include "irrigationConfigParser.h"
+
+/********************************************************************
+ * Reference: parsing via cJSON
+ ********************************************************************/
+
+static bool refParseBitset(cJSON* evtJson, const char* arrayName, const char* singleName,
+    int minVal, int maxVal, uint64_t defaultMask, uint64_t* mask)
+{
+    cJSON* arrayPtr = cJSON_GetObjectItem(evtJson, arrayName);
+    cJSON* singlePtr = (nullptr != singleName) ? cJSON_GetObjectItem(evtJson, singleName) : nullptr;
+    cJSON* elem;
+
+    *mask = 0;
+
+    if(nullptr != arrayPtr) {
+        if(!cJSON_IsArray(arrayPtr)) return false;
+
+        cJSON_ArrayForEach(elem, arrayPtr) {
+            if(!cJSON_IsNumber(elem) || (elem->valueint < minVal) || (elem->valueint > maxVal)) {
+                return false;
+            }
+            *mask |= (1ull << elem->valueint);
+        }
+    } else if(nullptr != singlePtr) {
+        if(!cJSON_IsNumber(singlePtr) || (singlePtr->valueint < minVal) || (singlePtr->valueint > maxVal)) {
+            return false;
+        }
+        *mask = (1ull << singlePtr->valueint);
+    } else {
+        *mask = defaultMask;
+    }
+
+    return (0 != *mask);
+}
+
+static bool refParseRecurrence(cJSON* evtJson, IrrigationEvent& evt)
+{
+    IrrigationEvent::recurrence_t rec;
+    uint64_t mask;
+
+    cJSON* secondPtr = cJSON_GetObjectItem(evtJson, "second");
+
+    if(!refParseBitset(evtJson, "minutes", "minute", 0, 59, 0, &mask)) return false;
+    rec.minutes = mask;
+    if(!refParseBitset(evtJson, "hours", "hour", 0, 23, 0, &mask)) return false;
+    rec.hours = (uint32_t) mask;
+    if(!refParseBitset(evtJson, "weekdays", nullptr, 0, 6, IrrigationEvent::recurrenceAllWeekdays, &mask)) return false;
+    rec.weekdays = (uint8_t) mask;
+    if(!refParseBitset(evtJson, "daysOfMonth", nullptr, 1, 31, IrrigationEvent::recurrenceAllDaysOfMonth, &mask)) return false;
+    rec.daysOfMonth = (uint32_t) mask;
+    if(!refParseBitset(evtJson, "months", nullptr, 1, 12, IrrigationEvent::recurrenceAllMonths, &mask)) return false;
+    rec.months = (uint16_t) mask;
+
+    rec.second = 0;
+    if(nullptr != secondPtr) {
+        if(!cJSON_IsNumber(secondPtr) || (secondPtr->valueint < 0) || (secondPtr->valueint > 59)) return false;
+        rec.second = (uint8_t) secondPtr->valueint;
+    }
+
+    return (IrrigationEvent::ERR_OK == evt.setRecurrence(rec));
+}
+
+static bool refParseSolarEvent(cJSON* evtJson, IrrigationEvent& evt)
+{
+    SolarTable::solar_event_t solarEvent;
+    int offsetMinutes = 0;
+
+    cJSON* solarEventPtr = cJSON_GetObjectItem(evtJson, "solarEvent");
+    cJSON* offsetMinutesPtr = cJSON_GetObjectItem(evtJson, "offsetMinutes");
+
+    if((nullptr == solarEventPtr) || !cJSON_IsString(solarEventPtr)) return false;
+
+    if(0 == strcmp(cJSON_GetStringValue(solarEventPtr), "sunrise")) {
+        solarEvent = SolarTable::SUNRISE;
+    } else if(0 == strcmp(cJSON_GetStringValue(solarEventPtr), "sunset")) {
+        solarEvent = SolarTable::SUNSET;
+    } else {
+        return false;
+    }
+
+    if(nullptr != offsetMinutesPtr) {
+        if(!cJSON_IsNumber(offsetMinutesPtr)) return false;
+        offsetMinutes = offsetMinutesPtr->valueint;
+        if((offsetMinutes < -(IrrigationEvent::solarMaxOffsetSecs / 60)) ||
+            (offsetMinutes > (IrrigationEvent::solarMaxOffsetSecs / 60))) return false;
+    }
+
+    return (IrrigationEvent::ERR_OK == evt.setSolarRepetition(solarEvent, offsetMinutes * 60));
+}
+
+static bool refParseZone(cJSON* zoneJson, irrigation_zone_cfg_t& zoneCfg)
+{
+    cJSON* namePtr = cJSON_GetObjectItem(zoneJson, "name");
+    cJSON* chEnPtr = cJSON_GetObjectItem(zoneJson, "chEnabled");
+    cJSON* chNumPtr = cJSON_GetObjectItem(zoneJson, "chNum");
+    cJSON* chStateStartPtr = cJSON_GetObjectItem(zoneJson, "chStateStart");
+    cJSON* chStateStopPtr = cJSON_GetObjectItem(zoneJson, "chStateStop");
+    cJSON* elem;
+    int numElems;
+    int i;
+
+    if( (nullptr == namePtr) || (nullptr == chEnPtr) || (nullptr == chNumPtr) ||
+        (nullptr == chStateStartPtr) || (nullptr == chStateStopPtr) ) return false;
+
+    if( !cJSON_IsString(namePtr) || !cJSON_IsArray(chEnPtr) || !cJSON_IsArray(chNumPtr) ||
+        !cJSON_IsArray(chStateStartPtr) || !cJSON_IsArray(chStateStopPtr) ||
+        ((numElems = cJSON_GetArraySize(chEnPtr)) > (int) irrigationZoneCfgElements) ||
+        (numElems != cJSON_GetArraySize(chNumPtr)) || (numElems != cJSON_GetArraySize(chStateStartPtr)) ||
+        (numElems != cJSON_GetArraySize(chStateStopPtr)) ) return false;
+
+    strncpy(zoneCfg.name, cJSON_GetStringValue(namePtr), irrigationZoneCfgNameLen);
+    zoneCfg.name[irrigationZoneCfgNameLen] = '\0';
+
+    i = 0;
+    cJSON_ArrayForEach(elem, chEnPtr) {
+        if(!cJSON_IsBool(elem)) return false;
+        zoneCfg.chEnabled[i++] = cJSON_IsTrue(elem);
+    }
+    i = 0;
+    cJSON_ArrayForEach(elem, chNumPtr) {
+        if(!cJSON_IsNumber(elem)) return false;
+        zoneCfg.chNum[i++] = (OutputController::ch_map_t) elem->valueint;
+    }
+    i = 0;
+    cJSON_ArrayForEach(elem, chStateStartPtr) {
+        if(!cJSON_IsBool(elem)) return false;
+        zoneCfg.chStateStart[i++] = cJSON_IsTrue(elem);
+    }
+    i = 0;
+    cJSON_ArrayForEach(elem, chStateStopPtr) {
+        if(!cJSON_IsBool(elem)) return false;
+        zoneCfg.chStateStop[i++] = cJSON_IsTrue(elem);
+    }
+
+    return true;
+}
+
+static bool refParseEvent(cJSON* evtJson, IrrigationEvent& evt, bool& used)
+{
+    bool ok = true;
+
+    cJSON* zoneNumPtr = cJSON_GetObjectItem(evtJson, "zoneNum");
+    cJSON* durationSecsPtr = cJSON_GetObjectItem(evtJson, "durationSecs");
+    cJSON* isSinglePtr = cJSON_GetObjectItem(evtJson, "isSingle");
+    cJSON* isDailyPtr = cJSON_GetObjectItem(evtJson, "isDaily");
+    cJSON* hourPtr = cJSON_GetObjectItem(evtJson, "hour");
+    cJSON* minutePtr = cJSON_GetObjectItem(evtJson, "minute");
+    cJSON* secondPtr = cJSON_GetObjectItem(evtJson, "second");
+    cJSON* dayPtr = cJSON_GetObjectItem(evtJson, "day");
+    cJSON* monthPtr = cJSON_GetObjectItem(evtJson, "month");
+    cJSON* yearPtr = cJSON_GetObjectItem(evtJson, "year");
+    cJSON* isRecurringPtr = cJSON_GetObjectItem(evtJson, "isRecurring");
+    cJSON* isSolarPtr = cJSON_GetObjectItem(evtJson, "isSolar");
+
+    bool isRecurring = (nullptr != isRecurringPtr) && cJSON_IsBool(isRecurringPtr) && cJSON_IsTrue(isRecurringPtr);
+    bool isSolar = (nullptr != isSolarPtr) && cJSON_IsBool(isSolarPtr) && cJSON_IsTrue(isSolarPtr);
+
+    if( (nullptr == zoneNumPtr) || (nullptr == durationSecsPtr) ||
+        !cJSON_IsNumber(zoneNumPtr) || !cJSON_IsNumber(durationSecsPtr) ||
+        !(isRecurring || isSolar || ((nullptr != hourPtr) && (nullptr != minutePtr) && (nullptr != secondPtr) &&
+        cJSON_IsNumber(hourPtr) && cJSON_IsNumber(minutePtr) && cJSON_IsNumber(secondPtr))) ) return true;
+
+    if( (nullptr != isSinglePtr) && cJSON_IsBool(isSinglePtr) && cJSON_IsTrue(isSinglePtr) &&
+        (nullptr != dayPtr) && (nullptr != monthPtr) && (nullptr != yearPtr) &&
+        cJSON_IsNumber(dayPtr) && cJSON_IsNumber(monthPtr) && cJSON_IsNumber(yearPtr) )
+    {
+        ok = (IrrigationEvent::ERR_OK == evt.setSingleEvent(hourPtr->valueint, minutePtr->valueint, secondPtr->valueint,
+            dayPtr->valueint, monthPtr->valueint, yearPtr->valueint));
+    } else if((nullptr != isDailyPtr) && cJSON_IsBool(isDailyPtr) && cJSON_IsTrue(isDailyPtr)) {
+        ok = (IrrigationEvent::ERR_OK == evt.setDailyRepetition(hourPtr->valueint, minutePtr->valueint, secondPtr->valueint));
+    } else if(isRecurring) {
+        ok = refParseRecurrence(evtJson, evt);
+    } else if(isSolar) {
+        ok = refParseSolarEvent(evtJson, evt);
+    } else {
+        return false;
+    }
+
+    if(IrrigationEvent::ERR_OK != evt.setZoneIndex(zoneNumPtr->valueint)) {
+        ok = false;
+    }
+    evt.setDuration(durationSecsPtr->valueint);
+    evt.setStartFlag(true);
+    used = true;
+
+    return ok;
+}
+
+typedef enum ref_result_t {
+    REF_OK = 0,
+    REF_INVALID_JSON,
+    REF_INVALID
+} ref_result_t;
+
+static ref_result_t refParseConfig(const std::string& json, irrigation_config_t& config)
+{
+    ref_result_t ret = REF_OK;
+    cJSON* root = cJSON_ParseWithOpts(json.c_str(), nullptr, true);
+
+    if(nullptr == root) return REF_INVALID_JSON;
+
+    cJSON* zones = cJSON_GetObjectItem(root, "zones");
+    cJSON* events = cJSON_GetObjectItem(root, "events");
+
+    if( (nullptr != zones) && (nullptr != events) &&
+        cJSON_IsArray(zones) && (cJSON_GetArraySize(zones) <= (int) irrigationPlannerNumZones) &&
+        cJSON_IsArray(events) && (cJSON_GetArraySize(events) <= (int) irrigationPlannerNumNormalEvents) )
+    {
+        int i = 0;
+        cJSON* elem;
+        cJSON_ArrayForEach(elem, zones) {
+            if(!refParseZone(elem, config.zones[i])) {
+                ret = REF_INVALID;
+                break;
+            }
+            i++;
+        }
+
+        i = 0;
+        cJSON_ArrayForEach(elem, events) {
+            if(REF_OK != ret) break;
+
+            bool used = false;
+            if(!refParseEvent(elem, config.events[i], used)) {
+                ret = REF_INVALID;
+                break;
+            }
+            if(used) {
+                config.events.claim(i);
+            }
+            i++;
+        }
+    } else {
+        ret = REF_INVALID;
+    }
+
+    cJSON_Delete(root);
+
+    return ret;
+}
+
+/********************************************************************
+ * Comparison
+ ********************************************************************/
+
+static ref_result_t parseConfig(const std::string& json, irrigation_config_t& config, size_t chunkLen)
+{
+    IrrigationConfigParser parser(config);
+
+    if(0 == chunkLen) chunkLen = json.length();
+
+    for(size_t pos = 0; pos < json.length(); pos += chunkLen) {
+        parser.feed(&json[pos], std::min(chunkLen, json.length() - pos));
+    }
+
+    switch(parser.finish()) {
+        case IrrigationConfigParser::ERR_OK:
+            return REF_OK;
+        case IrrigationConfigParser::ERR_INVALID_JSON:
+            return REF_INVALID_JSON;
+        default:
+            return REF_INVALID;
+    }
+}
+
+static bool checkZonesEqual(const irrigation_zone_cfg_t& expected, const irrigation_zone_cfg_t& actual)
+{
+    bool equal = TEST_CHECK_EQ(std::string(expected.name), std::string(actual.name));
+
+    for(unsigned int i = 0; i < irrigationZoneCfgElements; i++) {
+        equal = TEST_CHECK_EQ(expected.chEnabled[i], actual.chEnabled[i]) && equal;
+        equal = TEST_CHECK_EQ((int) expected.chNum[i], (int) actual.chNum[i]) && equal;
+        equal = TEST_CHECK_EQ(expected.chStateStart[i], actual.chStateStart[i]) && equal;
+        equal = TEST_CHECK_EQ(expected.chStateStop[i], actual.chStateStop[i]) && equal;
+    }
+
+    return equal;
+}
+
+static bool checkEventsEqual(const IrrigationEvent& expected, const IrrigationEvent& actual)
+{
+    IrrigationEvent::event_definition_t exp;
+    IrrigationEvent::event_definition_t act;
+    bool equal = true;
+
+    expected.getDefinition(&exp);
+    actual.getDefinition(&act);
+
+    equal = TEST_CHECK_EQ(exp.recurrence.minutes, act.recurrence.minutes) && equal;
+    equal = TEST_CHECK_EQ(exp.recurrence.hours, act.recurrence.hours) && equal;
+    equal = TEST_CHECK_EQ(exp.recurrence.daysOfMonth, act.recurrence.daysOfMonth) && equal;
+    equal = TEST_CHECK_EQ(exp.recurrence.months, act.recurrence.months) && equal;
+    equal = TEST_CHECK_EQ((int) exp.recurrence.weekdays, (int) act.recurrence.weekdays) && equal;
+    equal = TEST_CHECK_EQ((int) exp.recurrence.second, (int) act.recurrence.second) && equal;
+    equal = TEST_CHECK_EQ(exp.durationSecs, act.durationSecs) && equal;
+    equal = TEST_CHECK_EQ(exp.solarOffsetSecs, act.solarOffsetSecs) && equal;
+    equal = TEST_CHECK_EQ(exp.zoneIdx, act.zoneIdx) && equal;
+    equal = TEST_CHECK_EQ(exp.year, act.year) && equal;
+    equal = TEST_CHECK_EQ((int) exp.month, (int) act.month) && equal;
+    equal = TEST_CHECK_EQ((int) exp.day, (int) act.day) && equal;
+    equal = TEST_CHECK_EQ((int) exp.hour, (int) act.hour) && equal;
+    equal = TEST_CHECK_EQ((int) exp.minute, (int) act.minute) && equal;
+    equal = TEST_CHECK_EQ((int) exp.second, (int) act.second) && equal;
+    equal = TEST_CHECK_EQ((int) exp.repetitionType, (int) act.repetitionType) && equal;
+    equal = TEST_CHECK_EQ((int) exp.solarEvent, (int) act.solarEvent) && equal;
+    equal = TEST_CHECK_EQ(exp.isStart, act.isStart) && equal;
+
+    return equal;
+}
+
+/**
+ * Parse the configuration with both the reference and the parser, as a whole and in
+ * chunks, and check that the results are the same.
+ *
+ * @return Result of the reference.
+ */
+static ref_result_t checkSameAsReference(const std::string& json)
+{
+    static const size_t chunkLens[] = {0, 1, 2, 3, 7, 64};
+    irrigation_config_t* refConfig = new irrigation_config_t();
+    ref_result_t refResult = refParseConfig(json, *refConfig);
+
+    for(size_t c = 0; c < sizeof(chunkLens) / sizeof(chunkLens[0]); c++) {
+        irrigation_config_t* config = new irrigation_config_t();
+        ref_result_t result = parseConfig(json, *config, chunkLens[c]);
+        bool equal = TEST_CHECK_EQ(refResult, result);
+
+        for(unsigned int i = 0; equal && (REF_OK == result) && (i < irrigationPlannerNumZones); i++) {
+            equal = checkZonesEqual(refConfig->zones[i], config->zones[i]);
+        }
+        for(unsigned int i = 0; equal && (REF_OK == result) && (i < irrigationPlannerNumNormalEvents); i++) {
+            equal = TEST_CHECK_EQ(refConfig->events.isUsed(i), config->events.isUsed(i)) &&
+                (!refConfig->events.isUsed(i) || checkEventsEqual(refConfig->events[i], config->events[i]));
+        }
+
+        delete config;
+        if(!equal) {
+            std::cerr << "  input: " << json << ", chunk length " << chunkLens[c] << std::endl;
+            break;
+        }
+    }
+
+    delete refConfig;
+
+    return refResult;
+}
+
+static std::string makeZone(const char* members)
+{
+    return std::string("{\"zones\": [") + members + "], \"events\": []}";
+}
+
+static std::string readFile(const char* path)
+{
+    std::ifstream file(path);
+    std::stringstream content;
+
+    content << file.rdbuf();
+
+    return content.str();
+}
+
+/********************************************************************
+ * Tests
+ ********************************************************************/
+
+static void testDefaultConfigs(void)
+{
+    std::string defaultConfig = readFile(FW_DIR "/irrigationConfig.default.json");
+    std::string seasonConfig = readFile(HOST_DIR "/sim/seasonConfig.json");
+
+    TEST_CHECK(!defaultConfig.empty() && !seasonConfig.empty());
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference(defaultConfig));
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference(seasonConfig));
+}
+
+static void testZones(void)
+{
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference(testMakeIrrigationConfig({})));
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference(makeZone(
+        "{\"name\": \"A long zone name, which is truncated\", \"chEnabled\": [true, true, false, true], "
+        "\"chNum\": [3, 0, -1, 2], \"chStateStart\": [true, false, true, false], \"chStateStop\": [false, true, false, true], "
+        "\"comment\": {\"nested\": [1, {\"name\": 5}]}}")));
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference(makeZone(
+        "{\"name\": \"Empty\", \"chEnabled\": [], \"chNum\": [], \"chStateStart\": [], \"chStateStop\": []}")));
+
+    // Missing members, wrong types and lengths
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(makeZone(
+        "{\"chEnabled\": [true], \"chNum\": [1], \"chStateStart\": [true], \"chStateStop\": [false]}")));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(makeZone(
+        "{\"name\": 1, \"chEnabled\": [true], \"chNum\": [1], \"chStateStart\": [true], \"chStateStop\": [false]}")));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(makeZone(
+        "{\"name\": \"Z\", \"chEnabled\": [1], \"chNum\": [1], \"chStateStart\": [true], \"chStateStop\": [false]}")));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(makeZone(
+        "{\"name\": \"Z\", \"chEnabled\": [true], \"chNum\": [true], \"chStateStart\": [true], \"chStateStop\": [false]}")));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(makeZone(
+        "{\"name\": \"Z\", \"chEnabled\": [true], \"chNum\": [1, 2], \"chStateStart\": [true], \"chStateStop\": [false]}")));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(makeZone(
+        "{\"name\": \"Z\", \"chEnabled\": [true, true, true, true, true], \"chNum\": [1, 1, 1, 1, 1], "
+        "\"chStateStart\": [true, true, true, true, true], \"chStateStop\": [true, true, true, true, true]}")));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(makeZone("[]")));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(makeZone("1")));
+}
+
+static void testEvents(void)
+{
+    std::vector<std::string> events = {
+        // Single and daily events
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isSingle\": true, \"hour\": 6, \"minute\": 30, \"second\": 15, "
+            "\"day\": 24, \"month\": 12, \"year\": 2030}",
+        "{\"zoneNum\": 1, \"durationSecs\": 600, \"isDaily\": true, \"hour\": 21, \"minute\": 0, \"second\": 0}",
+        // Recurrences given by arrays, single numbers and defaults
+        "{\"zoneNum\": 2, \"durationSecs\": 120, \"isRecurring\": true, \"hours\": [5, 19], \"minutes\": [0, 30], "
+            "\"weekdays\": [1, 3, 5], \"daysOfMonth\": [1, 15, 31], \"months\": [4, 5, 6, 7, 8, 9], \"second\": 30}",
+        "{\"zoneNum\": 3, \"durationSecs\": 90, \"isRecurring\": true, \"hour\": 7, \"minute\": 45}",
+        "{\"zoneNum\": 4, \"durationSecs\": 90, \"isRecurring\": true, \"hours\": [0, 23], \"minute\": 59, \"hour\": 3}",
+        // Solar events
+        "{\"zoneNum\": 5, \"durationSecs\": 300, \"isSolar\": true, \"solarEvent\": \"sunrise\", \"offsetMinutes\": -30}",
+        "{\"zoneNum\": 6, \"durationSecs\": 300, \"isSolar\": true, \"solarEvent\": \"sunset\"}",
+        // Skipped: no zone, duration or time, not an object
+        "{\"durationSecs\": 60, \"isDaily\": true, \"hour\": 6, \"minute\": 0, \"second\": 0}",
+        "{\"zoneNum\": 0, \"durationSecs\": \"60\", \"isDaily\": true, \"hour\": 6, \"minute\": 0, \"second\": 0}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isDaily\": true, \"hour\": 6, \"minute\": 0}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": false, \"isSolar\": 1}",
+        "42",
+        "[{\"zoneNum\": 0}]",
+        // Unknown and nested members are ignored
+        "{\"zoneNum\": 7, \"durationSecs\": 60, \"comment\": {\"hour\": [1, 2]}, \"isDaily\": true, \"hour\": 6, \"minute\": 0, \"second\": 0}"
+    };
+
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference(testMakeIrrigationConfig(events)));
+}
+
+static void testInvalidEvents(void)
+{
+    const char* const events[] = {
+        // No repetition, invalid times and dates
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"hour\": 6, \"minute\": 0, \"second\": 0}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isDaily\": true, \"hour\": 24, \"minute\": 0, \"second\": 0}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isSingle\": true, \"hour\": 6, \"minute\": 0, \"second\": 0, "
+            "\"day\": 1, \"month\": 13, \"year\": 2030}",
+        // Invalid zones
+        "{\"zoneNum\": -1, \"durationSecs\": 60, \"isDaily\": true, \"hour\": 6, \"minute\": 0, \"second\": 0}",
+        "{\"zoneNum\": 8, \"durationSecs\": 60, \"isDaily\": true, \"hour\": 6, \"minute\": 0, \"second\": 0}",
+        // Invalid recurrences
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": true, \"hour\": 6}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": true, \"hours\": [], \"minute\": 0}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": true, \"hours\": [24], \"minute\": 0}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": true, \"hours\": [\"6\"], \"minute\": 0}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": true, \"hours\": 6, \"minute\": 0}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": true, \"hour\": 6, \"minute\": 0, \"weekdays\": [7]}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": true, \"hour\": 6, \"minute\": 0, \"daysOfMonth\": [0]}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": true, \"hour\": 6, \"minute\": 0, \"months\": [13]}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": true, \"hour\": 6, \"minute\": 0, \"second\": 60}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": true, \"hour\": 6, \"minute\": 0, \"second\": null}",
+        // Invalid solar events
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isSolar\": true}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isSolar\": true, \"solarEvent\": \"noon\"}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isSolar\": true, \"solarEvent\": \"Sunrise\"}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isSolar\": true, \"solarEvent\": \"sunset\", \"offsetMinutes\": \"5\"}",
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isSolar\": true, \"solarEvent\": \"sunset\", \"offsetMinutes\": 721}"
+    };
+
+    for(size_t i = 0; i < sizeof(events) / sizeof(events[0]); i++) {
+        if(!TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(testMakeIrrigationConfig({events[i]})))) {
+            std::cerr << "  event: " << events[i] << std::endl;
+        }
+    }
+}
+
+/** Keys are case-insensitive and the first of duplicate members counts, as with cJSON_GetObjectItem(). */
+static void testKeys(void)
+{
+    const char* const daily = "{\"zoneNum\": 0, \"durationSecs\": 60, \"isDaily\": true, \"hour\": 6, \"minute\": 0, \"second\": 0}";
+
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference(testMakeIrrigationConfig({
+        "{\"ZONENUM\": 1, \"durationsecs\": 60, \"IsDaily\": true, \"Hour\": 6, \"minute\": 0, \"SECOND\": 0}",
+        "{\"zoneNum\": 2, \"zoneNum\": 3, \"durationSecs\": 60, \"isDaily\": true, \"hour\": 6, \"hour\": 7, \"minute\": 0, \"second\": 0}",
+        "{\"zoneNum\": 4, \"durationSecs\": 60, \"isRecurring\": true, \"hours\": [1], \"HOURS\": [2], \"minute\": 5, \"Minute\": 6}",
+        "{\"zoneNum\": 5, \"durationSecs\": 60, \"isSolar\": true, \"solarEvent\": \"sunrise\", \"solarevent\": \"sunset\"}",
+        "{\"zoneNum\": 7, \"durationSecs\": \"60\", \"durationSecs\": 60, \"isDaily\": true, \"hour\": 6, \"minute\": 0, \"second\": 0}"
+    })));
+
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference(makeZone(
+        "{\"NAME\": \"First\", \"name\": \"Second\", \"chenabled\": [true], \"chNum\": [1], \"chNum\": [2, 3], "
+        "\"chStateStart\": [true], \"CHSTATESTOP\": [false]}")));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(testMakeIrrigationConfig({
+        "{\"zoneNum\": 6, \"durationSecs\": 60, \"isDaily\": false, \"isDaily\": true, \"hour\": 6, \"minute\": 0, \"second\": 0}"
+    })));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(makeZone(
+        "{\"name\": 1, \"name\": \"Z\", \"chEnabled\": [true], \"chNum\": [1], \"chStateStart\": [true], \"chStateStop\": [false]}")));
+
+    // Duplicate top level members
+    std::string config = testMakeIrrigationConfig({daily});
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference(config.substr(0, config.length() - 1) + ", \"events\": 5, \"Zones\": []}"));
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference("{\"Events\": [], \"ZONES\": [], \"events\": [" + std::string(daily) + "]}"));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference("{\"events\": 5, \"zones\": [], \"events\": []}"));
+}
+
+static void testStructure(void)
+{
+    std::string tooManyZones = "{\"events\": [], \"zones\": [";
+    for(unsigned int i = 0; i <= irrigationPlannerNumZones; i++) {
+        tooManyZones += (i > 0) ? ", " : "";
+        tooManyZones += "{\"name\": \"Z\", \"chEnabled\": [], \"chNum\": [], \"chStateStart\": [], \"chStateStop\": []}";
+    }
+    tooManyZones += "]}";
+
+    std::vector<std::string> events(irrigationPlannerNumNormalEvents + 1, "{}");
+
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference("{\"zones\": [], \"events\": [], \"storePersistent\": true}"));
+    TEST_CHECK_EQ(REF_OK, checkSameAsReference(testMakeIrrigationConfig(std::vector<std::string>(irrigationPlannerNumNormalEvents, "{}"))));
+
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(tooManyZones));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference(testMakeIrrigationConfig(events)));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference("{\"zones\": []}"));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference("{\"events\": []}"));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference("{\"zones\": {}, \"events\": []}"));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference("{\"zones\": [], \"events\": null}"));
+    TEST_CHECK_EQ(REF_INVALID, checkSameAsReference("[]"));
+
+    TEST_CHECK_EQ(REF_INVALID_JSON, checkSameAsReference(""));
+    TEST_CHECK_EQ(REF_INVALID_JSON, checkSameAsReference("{\"zones\": [], \"events\": []"));
+    TEST_CHECK_EQ(REF_INVALID_JSON, checkSameAsReference("{\"zones\": [], \"events\": [],}"));
+    TEST_CHECK_EQ(REF_INVALID_JSON, checkSameAsReference("{\"zones\": [], \"events\": []} {}"));
+}
+
+static const test_case_t tests[] = {
+    TEST_CASE(testDefaultConfigs),
+    TEST_CASE(testZones),
+    TEST_CASE(testEvents),
+    TEST_CASE(testInvalidEvents),
+    TEST_CASE(testKeys),
+    TEST_CASE(testStructure)
+};
+
+int main(void)
+{
+    return TEST_RUN(tests);
+}
@@ -0,0 +1,114 @@
+/*
+ * Tests of the next occurances of irrigation events around DST transitions.
+ */
+
+#include "testUtils.h"
+#include "globalComponents.h"
+
+static const char* const testTzCet = "CET-1CEST,M3.5.0,M10.5.0/3";
+
+static const time_t testGapStartUtc = 1585443600;      /**< 2020-03-29 02:00 CET, i.e. 03:00 CEST */
+static const time_t testOverlapStartUtc = 1603584000;  /**< 2020-10-25 02:00 CEST */
+
+static void testDailyRegularDay(void)
+{
+    IrrigationEvent evt;
+
+    civilTime.setTimezone(testTzCet);
+    evt.setDailyRepetition(6, 0, 0);
+
+    // 2020-06-01 06:00 CEST
+    TEST_CHECK_EQ((time_t) 1590984000, evt.calcNextOccurance(1590984000));
+    TEST_CHECK_EQ((time_t) 1590984000, evt.calcNextOccurance(1590984000 - 3600));
+    TEST_CHECK_EQ((time_t) (1590984000 + 86400), evt.calcNextOccurance(1590984000 + 1));
+}
+
+/** Event times within the DST gap are shifted behind it, even if the wall clock is past them already. */
+static void testDailyWithinDstGap(void)
+{
+    IrrigationEvent evt;
+
+    civilTime.setTimezone(testTzCet);
+    evt.setDailyRepetition(2, 30, 0);
+
+    // 02:30 CET doesn't exist, it becomes 03:30 CEST
+    TEST_CHECK_EQ(testGapStartUtc + 1800, evt.calcNextOccurance(testGapStartUtc - 1800));
+    TEST_CHECK_EQ(testGapStartUtc + 1800, evt.calcNextOccurance(testGapStartUtc + 600));
+    // 2020-03-30 02:30 CEST
+    TEST_CHECK_EQ(testGapStartUtc + 86400 - 1800, evt.calcNextOccurance(testGapStartUtc + 1800 + 1));
+}
+
+/** Ambiguous event times occur once, at their first instance. */
+static void testDailyWithinDstOverlap(void)
+{
+    IrrigationEvent evt;
+
+    civilTime.setTimezone(testTzCet);
+    evt.setDailyRepetition(2, 30, 0);
+
+    TEST_CHECK_EQ(testOverlapStartUtc + 1800, evt.calcNextOccurance(testOverlapStartUtc));
+    // 2020-10-26 02:30 CET
+    TEST_CHECK_EQ(testOverlapStartUtc + 86400 + 1800 + 3600, evt.calcNextOccurance(testOverlapStartUtc + 1800 + 1));
+}
+
+/** Recurrence matching the given minutes of the given hour every day. */
+static IrrigationEvent::recurrence_t makeDailyRecurrence(int hour, uint64_t minutes)
+{
+    IrrigationEvent::recurrence_t rec = {};
+
+    rec.minutes = minutes;
+    rec.hours = 1u << hour;
+    rec.daysOfMonth = IrrigationEvent::recurrenceAllDaysOfMonth;
+    rec.months = IrrigationEvent::recurrenceAllMonths;
+    rec.weekdays = IrrigationEvent::recurrenceAllWeekdays;
+    rec.second = 0;
+
+    return rec;
+}
+
+/** Like DAILY events, recurrence matches within the DST gap are shifted behind it. */
+static void testRecurrenceWithinDstGap(void)
+{
+    IrrigationEvent evt;
+
+    civilTime.setTimezone(testTzCet);
+    TEST_CHECK_EQ(IrrigationEvent::ERR_OK, evt.setRecurrence(makeDailyRecurrence(2, 1ull << 30)));
+
+    TEST_CHECK_EQ(testGapStartUtc + 1800, evt.calcNextOccurance(testGapStartUtc - 1800));
+    TEST_CHECK_EQ(testGapStartUtc + 1800, evt.calcNextOccurance(testGapStartUtc + 600));
+    TEST_CHECK_EQ(testGapStartUtc + 86400 - 1800, evt.calcNextOccurance(testGapStartUtc + 1800 + 1));
+
+    // 2020-03-29 is a sunday
+    TEST_CHECK_EQ(IrrigationEvent::ERR_OK, evt.setWeeklyRepetition(2, 30, 0, 0x01));
+    TEST_CHECK_EQ(testGapStartUtc + 1800, evt.calcNextOccurance(testGapStartUtc + 600));
+}
+
+/** Ambiguous recurrence matches occur at their first instance, passed ones are skipped. */
+static void testRecurrenceWithinDstOverlap(void)
+{
+    IrrigationEvent evt;
+
+    civilTime.setTimezone(testTzCet);
+    TEST_CHECK_EQ(IrrigationEvent::ERR_OK, evt.setRecurrence(makeDailyRecurrence(2, 1ull << 50)));
+
+    TEST_CHECK_EQ(testOverlapStartUtc + 3000, evt.calcNextOccurance(testOverlapStartUtc));
+    // 02:45 CET, i.e. the second pass, continues with 2020-10-26 02:50 CET
+    TEST_CHECK_EQ(testOverlapStartUtc + 86400 + 3600 + 3000, evt.calcNextOccurance(testOverlapStartUtc + 3600 + 2700));
+
+    // The passed 02:50 is skipped in favour of the following slot, here the next day's 02:30
+    TEST_CHECK_EQ(IrrigationEvent::ERR_OK, evt.setRecurrence(makeDailyRecurrence(2, (1ull << 30) | (1ull << 50))));
+    TEST_CHECK_EQ(testOverlapStartUtc + 86400 + 3600 + 1800, evt.calcNextOccurance(testOverlapStartUtc + 3600 + 2100));
+}
+
+static const test_case_t tests[] = {
+    TEST_CASE(testDailyRegularDay),
+    TEST_CASE(testDailyWithinDstGap),
+    TEST_CASE(testDailyWithinDstOverlap),
+    TEST_CASE(testRecurrenceWithinDstGap),
+    TEST_CASE(testRecurrenceWithinDstOverlap)
+};
+
+int main(void)
+{
+    return TEST_RUN(tests);
+}
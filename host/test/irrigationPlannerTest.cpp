@@ -0,0 +1,202 @@
+/*
+ * Tests of the worst-case number of concurrent irrigations of a configuration, which
+ * decides if a configuration can be applied (see IrrigationPlanner::calcMaxStopEvents()),
+ * and of the timeline of upcoming events.
+ */
+
+#include "testUtils.h"
+#include "globalComponents.h"
+
+static const char* const testTzCet = "CET-1CEST,M3.5.0,M10.5.0/3";
+static const uint8_t testMonday = 1u << 1;
+static const uint8_t testTuesday = 1u << 2;
+
+static IrrigationConfigEventPool events;
+
+static IrrigationEvent& addEvent(unsigned int durationSecs)
+{
+    IrrigationEvent& evt = events[events.alloc()];
+
+    evt.setZoneIndex(0);
+    evt.setStartFlag(true);
+    evt.setDuration(durationSecs);
+
+    return evt;
+}
+
+static void addDailyEvent(int hour, int minute, unsigned int durationSecs)
+{
+    addEvent(durationSecs).setDailyRepetition(hour, minute, 0);
+}
+
+static void addWeeklyEvent(int hour, int minute, uint8_t weekdays, unsigned int durationSecs)
+{
+    addEvent(durationSecs).setWeeklyRepetition(hour, minute, 0, weekdays);
+}
+
+static unsigned int calcMaxStopEvents(const char* posixTz)
+{
+    CivilTime timezone;
+
+    timezone.setTimezone(posixTz);
+    return IrrigationPlanner::calcMaxStopEvents(events, timezone);
+}
+
+/** Update the irrigation config of the settings manager and let the planner switch to it. */
+static SettingsManager::err_t updateIrrigationConfig(const std::vector<std::string>& eventObjects)
+{
+    std::string json = testMakeIrrigationConfig(eventObjects);
+    SettingsManager::err_t err = settingsMgr.updateIrrigationConfig(json.c_str(), json.length(), true);
+
+    irrigPlanner.irrigConfigUpdated();
+
+    return err;
+}
+
+/** One more short daily irrigation than supported, which never overlap, must be accepted. */
+static void testSequentialDailyEventsAccepted(void)
+{
+    std::vector<std::string> eventObjects;
+    char buf[128];
+
+    for(unsigned int i = 0; i <= irrigationPlannerNumConfigStopEvents; i++) {
+        snprintf(buf, sizeof(buf), "{\"zoneNum\": %u, \"durationSecs\": 60, \"isDaily\": true, \"hour\": 6, \"minute\": %u, \"second\": 0}",
+            i % irrigationPlannerNumZones, i * 6);
+        eventObjects.push_back(buf);
+    }
+
+    TEST_CHECK_EQ(SettingsManager::ERR_OK, updateIrrigationConfig(eventObjects));
+}
+
+static void testConcurrentDailyEventsRejected(void)
+{
+    std::vector<std::string> eventObjects;
+    char buf[128];
+
+    for(unsigned int i = 0; i <= irrigationPlannerNumConfigStopEvents; i++) {
+        snprintf(buf, sizeof(buf), "{\"zoneNum\": %u, \"durationSecs\": 600, \"isDaily\": true, \"hour\": 6, \"minute\": %u, \"second\": 0}",
+            i % irrigationPlannerNumZones, i);
+        eventObjects.push_back(buf);
+    }
+
+    TEST_CHECK_EQ(SettingsManager::ERR_SETTINGS_INVALID, updateIrrigationConfig(eventObjects));
+}
+
+/** A recurrence every 5 minutes of 1 minute irrigations never overlaps itself. */
+static void testBusyRecurrence(void)
+{
+    IrrigationEvent::recurrence_t rec = {};
+
+    events.clear();
+    for(int minute = 0; minute < 60; minute += 5) {
+        rec.minutes |= 1ull << minute;
+    }
+    rec.hours = IrrigationEvent::recurrenceAllHours;
+    rec.daysOfMonth = IrrigationEvent::recurrenceAllDaysOfMonth;
+    rec.months = IrrigationEvent::recurrenceAllMonths;
+    rec.weekdays = IrrigationEvent::recurrenceAllWeekdays;
+    TEST_CHECK_EQ(IrrigationEvent::ERR_OK, addEvent(60).setRecurrence(rec));
+
+    TEST_CHECK_EQ(1u, calcMaxStopEvents("UTC0"));
+    // Occurances within the DST gap are shifted onto the ones behind it
+    TEST_CHECK_EQ(2u, calcMaxStopEvents(testTzCet));
+
+    // Irrigations of 5 minutes touch the next one
+    events[0].setDuration(300);
+    TEST_CHECK_EQ(2u, calcMaxStopEvents("UTC0"));
+}
+
+static void testWeekdays(void)
+{
+    events.clear();
+    for(unsigned int i = 0; i < 4; i++) {
+        addWeeklyEvent(1, 0, testMonday, 3600);
+        addWeeklyEvent(1, 0, testTuesday, 3600);
+    }
+    TEST_CHECK_EQ(4u, calcMaxStopEvents("UTC0"));
+
+    // Irrigations continue on the next day
+    addWeeklyEvent(23, 30, testMonday, 2 * 3600);
+    TEST_CHECK_EQ(5u, calcMaxStopEvents("UTC0"));
+
+    // ... and on the days after
+    addWeeklyEvent(12, 0, testMonday, 3 * 86400);
+    TEST_CHECK_EQ(6u, calcMaxStopEvents("UTC0"));
+}
+
+static void testLongIrrigations(void)
+{
+    events.clear();
+    addDailyEvent(12, 0, 36 * 3600);
+    TEST_CHECK_EQ(2u, calcMaxStopEvents("UTC0"));
+
+    events.clear();
+    addWeeklyEvent(12, 0, testMonday, 36 * 3600);
+    TEST_CHECK_EQ(1u, calcMaxStopEvents("UTC0"));
+
+    // Events starting once never overlap themselves
+    events.clear();
+    addEvent(30 * 86400).setSingleEvent(12, 0, 0, 1, 6, 2030);
+    TEST_CHECK_EQ(1u, calcMaxStopEvents("UTC0"));
+}
+
+/** Irrigations are extended by the DST gap only if they span it or start within it. */
+static void testDstGap(void)
+{
+    events.clear();
+    for(unsigned int i = 0; i < 4; i++) {
+        addDailyEvent(3, 0, 600);
+    }
+
+    // Ends at 02:30, or at 03:30 local time on the day DST starts
+    addDailyEvent(1, 30, 3600);
+    TEST_CHECK_EQ(4u, calcMaxStopEvents("UTC0"));
+    TEST_CHECK_EQ(5u, calcMaxStopEvents(testTzCet));
+
+    // Starts at 03:30 local time on the day DST starts
+    events.clear();
+    addDailyEvent(3, 35, 600);
+    addDailyEvent(2, 30, 600);
+    TEST_CHECK_EQ(1u, calcMaxStopEvents("UTC0"));
+    TEST_CHECK_EQ(2u, calcMaxStopEvents(testTzCet));
+
+    // Far from the gap
+    events.clear();
+    addDailyEvent(13, 1, 600);
+    addDailyEvent(12, 0, 3600);
+    TEST_CHECK_EQ(1u, calcMaxStopEvents(testTzCet));
+}
+
+/** Repeating events stay in the timeline while it is walked through the DST overlap. */
+static void testTimelineDstOverlap(void)
+{
+    const time_t overlapStartUtc = 1603584000;     // 2020-10-25 02:00 CEST
+    const time_t nextDayUtc = 1603677000;          // 2020-10-26 02:50 CET
+
+    TEST_CHECK_EQ(SettingsManager::ERR_OK, updateIrrigationConfig({
+        "{\"zoneNum\": 0, \"durationSecs\": 60, \"isRecurring\": true, \"hour\": 2, \"minute\": 50, \"second\": 0, \"weekdays\": [0, 1, 2, 3, 4, 5, 6]}"
+    }));
+    civilTime.setTimezone(testTzCet);
+
+    TEST_CHECK_EQ(overlapStartUtc + 3000, irrigPlanner.getNextEventTime(overlapStartUtc, false));
+    // 02:45 CET, i.e. the second pass, after the first 02:50 has passed
+    TEST_CHECK_EQ(nextDayUtc, irrigPlanner.getNextEventTime(overlapStartUtc + 3600 + 2700, false));
+    TEST_CHECK_EQ(nextDayUtc, irrigPlanner.getNextEventTime(overlapStartUtc + 86400, false));
+    TEST_CHECK_EQ(nextDayUtc, irrigPlanner.getNextEventTime(nextDayUtc, false));
+    TEST_CHECK_EQ(nextDayUtc + 86400, irrigPlanner.getNextEventTime(nextDayUtc, true));
+}
+
+static const test_case_t tests[] = {
+    TEST_CASE(testSequentialDailyEventsAccepted),
+    TEST_CASE(testConcurrentDailyEventsRejected),
+    TEST_CASE(testBusyRecurrence),
+    TEST_CASE(testWeekdays),
+    TEST_CASE(testLongIrrigations),
+    TEST_CASE(testDstGap),
+    TEST_CASE(testTimelineDstOverlap)
+};
+
+int main(void)
+{
+    return TEST_RUN(tests);
+}
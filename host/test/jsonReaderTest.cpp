@@ -0,0 +1,279 @@
+/*
+ * Tests of the JsonReader tokenizer. Each input is fed as a whole and in chunks of every
+ * size, which splits every token at every position, and all feeds have to report the
+ * same tokens and result.
+ */
+
+#include <string.h>
+
+#include "testUtils.h"
+#include "jsonReader.h"
+
+typedef struct read_result_t {
+    JsonReader::err_t err;
+    std::vector<std::string> tokens;
+} read_result_t;
+
+static const char* const tokenTypeNames[] = {
+    "{", "}", "[", "]", "key", "str", "num", "bool", "null"
+};
+
+static void collectToken(void* param, const JsonReader::token_t* token)
+{
+    std::vector<std::string>* tokens = (std::vector<std::string>*) param;
+    char buf[128];
+
+    int len = snprintf(buf, sizeof(buf), "%s %u %u-%u", tokenTypeNames[token->type], token->depth,
+        (unsigned int) token->offset, (unsigned int) token->endOffset);
+
+    if(nullptr != token->str) {
+        snprintf(&buf[len], sizeof(buf) - len, " '%s'%s", token->str, token->truncated ? " truncated" : "");
+    } else if(JsonReader::TOKEN_NUMBER == token->type) {
+        snprintf(&buf[len], sizeof(buf) - len, " %d", (int) token->intVal);
+    } else if(JsonReader::TOKEN_BOOL == token->type) {
+        snprintf(&buf[len], sizeof(buf) - len, " %s", token->boolVal ? "true" : "false");
+    }
+
+    tokens->push_back(buf);
+}
+
+/** Read the input in chunks of chunkLen chars, 0 feeds it as a whole. */
+static read_result_t readJson(const std::string& json, size_t chunkLen)
+{
+    read_result_t result;
+    JsonReader reader(collectToken, &result.tokens);
+
+    if(0 == chunkLen) chunkLen = json.length();
+
+    for(size_t pos = 0; pos < json.length(); pos += chunkLen) {
+        reader.feed(&json[pos], std::min(chunkLen, json.length() - pos));
+    }
+    result.err = reader.finish();
+
+    return result;
+}
+
+/** Read the input as a whole and check that all chunk sizes give the same result. */
+static read_result_t readJsonChunked(const std::string& json)
+{
+    read_result_t whole = readJson(json, 0);
+
+    for(size_t chunkLen = 1; chunkLen < json.length(); chunkLen++) {
+        read_result_t chunked = readJson(json, chunkLen);
+        if(!TEST_CHECK_EQ(whole.err, chunked.err) || !TEST_CHECK(whole.tokens == chunked.tokens)) {
+            std::cerr << "  input: " << json << ", chunk length " << chunkLen << std::endl;
+            break;
+        }
+    }
+
+    return whole;
+}
+
+static JsonReader::err_t readJsonErr(const std::string& json)
+{
+    return readJsonChunked(json).err;
+}
+
+/** Read a single string and return its value, or an empty string on errors. */
+static std::string readString(const std::string& json)
+{
+    read_result_t result = readJsonChunked(json);
+
+    if((JsonReader::ERR_OK != result.err) || (1 != result.tokens.size())) return "";
+
+    // "str 0 <offset>-<endOffset> '<value>'"
+    const std::string& token = result.tokens[0];
+    size_t start = token.find('\'');
+    return token.substr(start + 1, token.rfind('\'') - start - 1);
+}
+
+/** Read a single number and return its value. */
+static bool readNumber(const std::string& json, int32_t* val)
+{
+    read_result_t result = readJsonChunked(json);
+
+    if((JsonReader::ERR_OK != result.err) || (1 != result.tokens.size())) return false;
+
+    *val = (int32_t) strtol(result.tokens[0].substr(result.tokens[0].rfind(' ') + 1).c_str(), nullptr, 10);
+    return true;
+}
+
+static void testTokens(void)
+{
+    read_result_t result = readJsonChunked(
+        "{\"zones\": [{\"name\": \"Z0\", \"chNum\": [1, -12]}], \"on\": true, \"off\": false, \"none\": null, \"e\": {}}");
+
+    std::vector<std::string> expected = {
+        "{ 0 0-1",
+        "key 1 1-8 'zones'",
+        "[ 1 10-11",
+        "{ 2 11-12",
+        "key 3 12-18 'name'",
+        "str 3 20-24 'Z0'",
+        "key 3 26-33 'chNum'",
+        "[ 3 35-36",
+        "num 4 36-37 1",
+        "num 4 39-42 -12",
+        "] 3 42-43",
+        "} 2 43-44",
+        "] 1 44-45",
+        "key 1 47-51 'on'",
+        "bool 1 53-57 true",
+        "key 1 59-64 'off'",
+        "bool 1 66-71 false",
+        "key 1 73-79 'none'",
+        "null 1 81-85",
+        "key 1 87-90 'e'",
+        "{ 1 92-93",
+        "} 1 93-94",
+        "} 0 94-95"
+    };
+
+    TEST_CHECK_EQ(JsonReader::ERR_OK, result.err);
+    TEST_CHECK_EQ(expected.size(), result.tokens.size());
+    for(size_t i = 0; (i < expected.size()) && (i < result.tokens.size()); i++) {
+        if(!TEST_CHECK_EQ(expected[i], result.tokens[i])) break;
+    }
+}
+
+static void testEscapes(void)
+{
+    TEST_CHECK_EQ(std::string("a\"b\\c/d\be\ff\ng\rh\ti"), readString("\"a\\\"b\\\\c\\/d\\be\\ff\\ng\\rh\\ti\""));
+    TEST_CHECK_EQ(std::string("A"), readString("\"\\u0041\""));
+    TEST_CHECK_EQ(std::string("\xC3\xA9"), readString("\"\\u00e9\""));
+    TEST_CHECK_EQ(std::string("\xC3\xA9"), readString("\"\\u00E9\""));
+    TEST_CHECK_EQ(std::string("\xE2\x82\xAC"), readString("\"\\u20ac\""));
+    TEST_CHECK_EQ(std::string("x\xC3\xA9y"), readString("\"x\xC3\xA9y\""));
+
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("\"\\x\""));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("\"\\u00g0\""));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("\"a\nb\""));
+}
+
+static void testSurrogates(void)
+{
+    TEST_CHECK_EQ(std::string("\xF0\x9F\x98\x80"), readString("\"\\ud83d\\ude00\""));
+    TEST_CHECK_EQ(std::string("a\xF0\x9F\x98\x80z"), readString("\"a\\uD83D\\uDE00z\""));
+
+    // Lone or reversed surrogates
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("\"\\ud83d\""));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("\"\\ud83dx\""));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("\"\\ud83d\\u0041\""));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("\"\\ude00\""));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("\"\\ude00\\ud83d\""));
+}
+
+static void testTruncatedStrings(void)
+{
+    std::string longStr(JsonReader::maxStringLen + 10, 'x');
+    read_result_t result = readJsonChunked("[\"" + longStr + "\", \"" + longStr.substr(0, JsonReader::maxStringLen) + "\"]");
+
+    TEST_CHECK_EQ(JsonReader::ERR_OK, result.err);
+    if(TEST_CHECK_EQ(4u, result.tokens.size())) {
+        TEST_CHECK(std::string::npos != result.tokens[1].find("'" + longStr.substr(0, JsonReader::maxStringLen) + "' truncated"));
+        TEST_CHECK(std::string::npos == result.tokens[2].find("truncated"));
+    }
+
+    // Truncation is bytewise, like the copy into the zone name
+    result = readJsonChunked("\"" + longStr.substr(0, JsonReader::maxStringLen - 1) + "\\u20ac\"");
+    TEST_CHECK_EQ(JsonReader::ERR_OK, result.err);
+    if(TEST_CHECK_EQ(1u, result.tokens.size())) {
+        TEST_CHECK(std::string::npos != result.tokens[0].find("'" + longStr.substr(0, JsonReader::maxStringLen - 1) + "\xE2' truncated"));
+    }
+}
+
+static void testNumbers(void)
+{
+    int32_t val = 1;
+
+    TEST_CHECK(readNumber("0", &val) && (0 == val));
+    TEST_CHECK(readNumber("-0", &val) && (0 == val));
+    TEST_CHECK(readNumber("10", &val) && (10 == val));
+    TEST_CHECK(readNumber("-1050", &val) && (-1050 == val));
+    TEST_CHECK(readNumber("2147483647", &val) && (INT32_MAX == val));
+    TEST_CHECK(readNumber("-2147483648", &val) && (INT32_MIN == val));
+
+    // int32 overflow
+    TEST_CHECK_EQ(JsonReader::ERR_NUMBER, readJsonErr("2147483648"));
+    TEST_CHECK_EQ(JsonReader::ERR_NUMBER, readJsonErr("-2147483649"));
+    TEST_CHECK_EQ(JsonReader::ERR_NUMBER, readJsonErr("[4294967296]"));
+    TEST_CHECK_EQ(JsonReader::ERR_NUMBER, readJsonErr("[99999999999999999999]"));
+
+    // Fractions and exponents aren't supported
+    TEST_CHECK_EQ(JsonReader::ERR_NUMBER, readJsonErr("1.5"));
+    TEST_CHECK_EQ(JsonReader::ERR_NUMBER, readJsonErr("[1e3]"));
+    TEST_CHECK_EQ(JsonReader::ERR_NUMBER, readJsonErr("[1E3]"));
+
+    // Leading zeros and incomplete numbers are invalid
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("01"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("-01"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("[00]"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("{\"a\": 007}"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("[-]"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("[+1]"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("[1-]"));
+}
+
+static void testDepth(void)
+{
+    std::string maxNested = std::string(JsonReader::maxDepth, '[') + std::string(JsonReader::maxDepth, ']');
+    std::string tooNested = std::string(JsonReader::maxDepth + 1, '[') + std::string(JsonReader::maxDepth + 1, ']');
+
+    TEST_CHECK_EQ(JsonReader::ERR_OK, readJsonErr(maxNested));
+    TEST_CHECK_EQ(JsonReader::ERR_DEPTH, readJsonErr(tooNested));
+}
+
+static void testSyntax(void)
+{
+    TEST_CHECK_EQ(JsonReader::ERR_OK, readJsonErr(" \t\r\n{ \"a\" : [ 1 , 2 ] }\n"));
+    TEST_CHECK_EQ(JsonReader::ERR_OK, readJsonErr("[]"));
+
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("[1,]"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("[1 2]"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("{\"a\" 1}"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("{\"a\": 1,}"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("{1: 2}"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("[1}"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("{\"a\": 1]"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("[tru]"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("[nul1]"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("{} {}"));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr("[1] x"));
+}
+
+static void testIncomplete(void)
+{
+    TEST_CHECK_EQ(JsonReader::ERR_INCOMPLETE, readJsonErr(""));
+    TEST_CHECK_EQ(JsonReader::ERR_INCOMPLETE, readJsonErr("  "));
+    TEST_CHECK_EQ(JsonReader::ERR_INCOMPLETE, readJsonErr("{\"a\": [1, 2"));
+    TEST_CHECK_EQ(JsonReader::ERR_INCOMPLETE, readJsonErr("\"abc"));
+    TEST_CHECK_EQ(JsonReader::ERR_INCOMPLETE, readJsonErr("[\"\\u00"));
+    TEST_CHECK_EQ(JsonReader::ERR_INCOMPLETE, readJsonErr("tru"));
+}
+
+/** Trailing zero bytes, e.g. of a zero terminated buffer, are ignored. */
+static void testTrailingZeros(void)
+{
+    TEST_CHECK_EQ(JsonReader::ERR_OK, readJsonErr(std::string("{}\0\0", 4)));
+    TEST_CHECK_EQ(JsonReader::ERR_OK, readJsonErr(std::string("[1] \0", 5)));
+    TEST_CHECK_EQ(JsonReader::ERR_OK, readJsonErr(std::string("{}\0 \0", 5)));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr(std::string("{}\0x", 4)));
+    TEST_CHECK_EQ(JsonReader::ERR_SYNTAX, readJsonErr(std::string("[\0]", 3)));
+}
+
+static const test_case_t tests[] = {
+    TEST_CASE(testTokens),
+    TEST_CASE(testEscapes),
+    TEST_CASE(testSurrogates),
+    TEST_CASE(testTruncatedStrings),
+    TEST_CASE(testNumbers),
+    TEST_CASE(testDepth),
+    TEST_CASE(testSyntax),
+    TEST_CASE(testIncomplete),
+    TEST_CASE(testTrailingZeros)
+};
+
+int main(void)
+{
+    return TEST_RUN(tests);
+}
@@ -0,0 +1,115 @@
+/*
+ * Tests of the JsonWriter, in particular the separators of nested containers and the
+ * handling of too small buffers and too deep nesting.
+ */
+
+#include <stdint.h>
+
+#include "testUtils.h"
+#include "jsonWriter.h"
+
+/** Write depth nested arrays, each with a number before and after the nested one. */
+static size_t writeNested(JsonWriter& writer, unsigned int depth)
+{
+    for(unsigned int i = 0; i < depth; i++) {
+        writer.startArray(nullptr);
+        writer.addUint(nullptr, i);
+    }
+    for(unsigned int i = 0; i < depth; i++) {
+        writer.addUint(nullptr, depth - 1 - i);
+        writer.endArray();
+    }
+
+    return writer.getLength();
+}
+
+static std::string expectedNested(unsigned int depth)
+{
+    std::string expected;
+
+    for(unsigned int i = 0; i < depth; i++) {
+        expected += "[" + std::to_string(i) + ",";
+    }
+    for(unsigned int i = 0; i < depth; i++) {
+        expected += std::to_string(depth - 1 - i) + "]";
+        expected += (i + 1 < depth) ? "," : "";
+    }
+
+    return expected;
+}
+
+static void testValues(void)
+{
+    char buf[128];
+    JsonWriter writer(buf, sizeof(buf));
+
+    writer.startObject(nullptr);
+    writer.addUint("u", UINT64_MAX);
+    writer.addInt("i", INT64_MIN);
+    writer.addString("s", "a\"b\\c\n");
+    writer.startArray("a");
+    writer.endArray();
+    writer.startObject("o");
+    writer.addInt("x", -1);
+    writer.endObject();
+    writer.endObject();
+
+    std::string expected = "{\"u\":18446744073709551615,\"i\":-9223372036854775808,\"s\":\"a\\\"b\\\\c\\u000a\",\"a\":[],\"o\":{\"x\":-1}}";
+    TEST_CHECK_EQ(expected, std::string(buf));
+    TEST_CHECK_EQ(expected.length(), writer.getLength());
+}
+
+/** All levels up to maxDepth get their separators. */
+static void testMaxDepth(void)
+{
+    char buf[256];
+    JsonWriter writer(buf, sizeof(buf));
+
+    size_t len = writeNested(writer, JsonWriter::maxDepth);
+
+    TEST_CHECK_EQ(expectedNested(JsonWriter::maxDepth), std::string(buf));
+    TEST_CHECK_EQ(expectedNested(JsonWriter::maxDepth).length(), len);
+}
+
+/** Deeper nesting is rejected like a truncated output. */
+static void testDepthExceeded(void)
+{
+    char buf[256];
+    JsonWriter writer(buf, sizeof(buf));
+    JsonWriter sizer(nullptr, 0);
+
+    TEST_CHECK_EQ(SIZE_MAX, writeNested(writer, JsonWriter::maxDepth + 1));
+    TEST_CHECK_EQ(std::string(""), std::string(buf));
+    TEST_CHECK_EQ(SIZE_MAX, writeNested(sizer, JsonWriter::maxDepth + 1));
+}
+
+/** Like snprintf, the output is truncated and the complete length is counted. */
+static void testTruncation(void)
+{
+    char buf[8];
+    JsonWriter writer(buf, sizeof(buf));
+    JsonWriter sizer(nullptr, 0);
+
+    writer.startArray(nullptr);
+    writer.addString(nullptr, "abcdefgh");
+    writer.endArray();
+    sizer.startArray(nullptr);
+    sizer.addString(nullptr, "abcdefgh");
+    sizer.endArray();
+
+    TEST_CHECK_EQ(std::string("[\"abcde"), std::string(buf));
+    TEST_CHECK_EQ((size_t) 12, writer.getLength());
+    TEST_CHECK_EQ((size_t) 12, sizer.getLength());
+}
+
+static const test_case_t tests[] = {
+    TEST_CASE(testValues),
+    TEST_CASE(testMaxDepth),
+    TEST_CASE(testDepthExceeded),
+    TEST_CASE(testTruncation)
+};
+
+int main(void)
+{
+    return TEST_RUN(tests);
+}
@@ -0,0 +1,101 @@
+/*
+ * Tests of the irrigation config handling of the SettingsManager.
+ */
+
+#include "testUtils.h"
+#include "globalComponents.h"
+
+static SettingsManager::err_t updateIrrigationConfig(int minute)
+{
+    char buf[128];
+
+    snprintf(buf, sizeof(buf), "{\"zoneNum\": 0, \"durationSecs\": 60, \"isDaily\": true, \"hour\": 6, \"minute\": %d, \"second\": 0}", minute);
+    std::string json = testMakeIrrigationConfig({buf});
+
+    return settingsMgr.updateIrrigationConfig(json.c_str(), json.length(), true);
+}
+
+static uint32_t getPublishedGeneration(void)
+{
+    const irrigation_config_t* config = settingsMgr.acquireIrrigationConfig();
+    uint32_t generation = (nullptr != config) ? config->generation : 0;
+
+    settingsMgr.releaseIrrigationConfig(config);
+
+    return generation;
+}
+
+/** Updates in a row succeed while a previous config is used, e.g. by the planner during an irrigation. */
+static void testUpdatesWhilePreviousConfigInUse(void)
+{
+    TEST_CHECK_EQ(SettingsManager::ERR_OK, updateIrrigationConfig(0));
+    const irrigation_config_t* pinned = settingsMgr.acquireIrrigationConfig();
+    TEST_CHECK(nullptr != pinned);
+
+    for(int i = 1; i <= 3; i++) {
+        uint32_t generation = getPublishedGeneration();
+        TEST_CHECK_EQ(SettingsManager::ERR_OK, updateIrrigationConfig(i));
+        TEST_CHECK_EQ(generation + 1, getPublishedGeneration());
+    }
+
+    settingsMgr.releaseIrrigationConfig(pinned);
+}
+
+/** Updates time out while readers use all previous configs and succeed once one is released. */
+static void testUpdateWhileAllConfigsInUse(void)
+{
+    const irrigation_config_t* pinnedFirst;
+    const irrigation_config_t* pinnedSecond;
+    const irrigation_config_t* pinnedThird;
+
+    TEST_CHECK_EQ(SettingsManager::ERR_OK, updateIrrigationConfig(0));
+    pinnedFirst = settingsMgr.acquireIrrigationConfig();
+    TEST_CHECK_EQ(SettingsManager::ERR_OK, updateIrrigationConfig(1));
+    pinnedSecond = settingsMgr.acquireIrrigationConfig();
+    TEST_CHECK_EQ(SettingsManager::ERR_OK, updateIrrigationConfig(2));
+    pinnedThird = settingsMgr.acquireIrrigationConfig();
+
+    uint32_t generation = getPublishedGeneration();
+    TEST_CHECK_EQ(SettingsManager::ERR_TIMEOUT, updateIrrigationConfig(3));
+    TEST_CHECK_EQ(generation, getPublishedGeneration());
+
+    settingsMgr.releaseIrrigationConfig(pinnedFirst);
+    TEST_CHECK_EQ(SettingsManager::ERR_OK, updateIrrigationConfig(3));
+    TEST_CHECK_EQ(generation + 1, getPublishedGeneration());
+
+    settingsMgr.releaseIrrigationConfig(pinnedSecond);
+    settingsMgr.releaseIrrigationConfig(pinnedThird);
+}
+
+/** Configs are stored up to the capacity policy and rejected before being published beyond it. */
+static void testStoredConfigLength(void)
+{
+    std::vector<std::string> eventObjects;
+    char buf[160];
+
+    for(unsigned int i = 0; i < irrigationPlannerNumNormalEvents; i++) {
+        snprintf(buf, sizeof(buf), "{\"zoneNum\": %u, \"durationSecs\": 60, \"isRecurring\": true, \"hour\": %u, \"minute\": 0, "
+            "\"weekdays\": [1, 3, 5]}", i % irrigationPlannerNumZones, i % 24);
+        eventObjects.push_back(buf);
+    }
+    std::string json = "{\"storePersistent\": true, " + testMakeIrrigationConfig(eventObjects).substr(1);
+
+    uint32_t generation = getPublishedGeneration();
+    TEST_CHECK_EQ(SettingsManager::ERR_OK, settingsMgr.updateIrrigationConfig(json.c_str(), json.length(), true));
+    TEST_CHECK_EQ(generation + 1, getPublishedGeneration());
+
+    json.insert(json.length() - 1, std::string(irrigationPlannerNumNormalEvents * 128, ' '));
+    TEST_CHECK_EQ(SettingsManager::ERR_NO_RESOURCES, settingsMgr.updateIrrigationConfig(json.c_str(), json.length(), true));
+    TEST_CHECK_EQ(generation + 1, getPublishedGeneration());
+}
+
+static const test_case_t tests[] = {
+    TEST_CASE(testUpdatesWhilePreviousConfigInUse),
+    TEST_CASE(testUpdateWhileAllConfigsInUse),
+    TEST_CASE(testStoredConfigLength)
+};
+
+int main(void)
+{
+    return TEST_RUN(tests);
+}
@@ -0,0 +1,115 @@
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+/*
+ * Minimal test harness of the host tests, so they don't need a test framework. Each test
+ * executable lists its test functions in a test_case_t table and returns testRun() from
+ * main(). ctest runs the executables, see host/CMakeLists.txt.
+ *
+ * The checks return wether or not they passed, so loops can stop at the first failure:
+ *   if(!TEST_CHECK_EQ(expected, actual)) return;
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "esp_log.h"
+
+#include "irrigationPlanner.h"
+
+typedef void (*test_func_t)(void);
+
+typedef struct test_case_t {
+    const char* name;
+    test_func_t func;
+} test_case_t;
+
+#define TEST_CASE(func) { #func, func }
+
+static unsigned int testCheckFailures = 0;
+
+static inline bool testCheck(bool passed, const char* expr, const char* file, int line)
+{
+    if(!passed) {
+        std::cerr << file << ":" << line << ": check failed: " << expr << std::endl;
+        testCheckFailures++;
+    }
+    return passed;
+}
+
+template <typename T1, typename T2>
+static inline bool testCheckEq(const T1& expected, const T2& actual, const char* expr, const char* file, int line)
+{
+    bool passed = (expected == actual);
+    if(!passed) {
+        std::cerr << file << ":" << line << ": check failed: " << expr << std::endl;
+        std::cerr << "  expected: " << expected << std::endl;
+        std::cerr << "  actual:   " << actual << std::endl;
+        testCheckFailures++;
+    }
+    return passed;
+}
+
+#define TEST_CHECK(cond) testCheck((cond), #cond, __FILE__, __LINE__)
+#define TEST_CHECK_EQ(expected, actual) testCheckEq((expected), (actual), #expected " == " #actual, __FILE__, __LINE__)
+
+/**
+ * Run the given tests.
+ *
+ * @return int Exit code: 0 if all checks passed, 1 otherwise.
+ */
+static inline int testRun(const test_case_t* tests, size_t numTests)
+{
+    unsigned int failedTests = 0;
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    for(size_t i = 0; i < numTests; i++) {
+        unsigned int failuresBefore = testCheckFailures;
+        printf("[ RUN    ] %s\n", tests[i].name);
+        fflush(stdout);
+        tests[i].func();
+        if(testCheckFailures == failuresBefore) {
+            printf("[     OK ] %s\n", tests[i].name);
+        } else {
+            printf("[ FAILED ] %s\n", tests[i].name);
+            failedTests++;
+        }
+    }
+    printf("%u of %u tests passed.\n", (unsigned int) (numTests - failedTests), (unsigned int) numTests);
+
+    return (0 == failedTests) ? 0 : 1;
+}
+
+/**
+ * Build an irrigation configuration with all zones and the given event objects.
+ */
+static inline std::string testMakeIrrigationConfig(const std::vector<std::string>& events)
+{
+    std::string json = "{\"zones\": [";
+    char buf[256];
+
+    for(unsigned int i = 0; i < irrigationPlannerNumZones; i++) {
+        snprintf(buf, sizeof(buf),
+            "{\"name\": \"Z%u\", \"chEnabled\": [true, false, false, false], \"chNum\": [%u, -1, -1, -1], "
+            "\"chStateStart\": [true, false, false, false], \"chStateStop\": [false, false, false, false]}%s",
+            i, i % 3, (i + 1 < irrigationPlannerNumZones) ? ", " : "");
+        json += buf;
+    }
+
+    json += "], \"events\": [";
+    for(size_t i = 0; i < events.size(); i++) {
+        json += (i > 0) ? ", " : "";
+        json += events[i];
+    }
+    json += "]}";
+
+    return json;
+}
+
+#define TEST_RUN(tests) testRun(tests, sizeof(tests) / sizeof(tests[0]))
+
+#endif /* TEST_UTILS_H */
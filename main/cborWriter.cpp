@@ -0,0 +1,116 @@
+#include "cborWriter.h"
+
+#include <cstring>
+
+/**
+ * @brief Create a writer, which starts at the beginning of the buffer.
+ * 
+ * @param buf Destination buffer
+ * @param bufLen Size of the destination buffer
+ */
+CborWriter::CborWriter(uint8_t* buf, size_t bufLen) : buf(buf), bufLen(bufLen), len(0)
+{
+}
+
+/**
+ * @brief Start a definite length array. It must be followed by numItems data items.
+ */
+void CborWriter::startArray(uint32_t numItems)
+{
+    addHead(majorTypeArray, numItems);
+}
+
+/**
+ * @brief Start a definite length map. It must be followed by numPairs key/value pairs.
+ */
+void CborWriter::startMap(uint32_t numPairs)
+{
+    addHead(majorTypeMap, numPairs);
+}
+
+/**
+ * @brief Add an unsigned integer.
+ */
+void CborWriter::addUint(uint64_t val)
+{
+    addHead(majorTypeUint, val);
+}
+
+/**
+ * @brief Add a signed integer, i.e. an unsigned one if it isn't negative.
+ */
+void CborWriter::addInt(int64_t val)
+{
+    if(val < 0) {
+        // Negative integers are encoded as -1 - n
+        addHead(majorTypeNegInt, (uint64_t) (-1 - val));
+    } else {
+        addHead(majorTypeUint, (uint64_t) val);
+    }
+}
+
+/**
+ * @brief Add a zero terminated UTF-8 string (without the terminating zero).
+ */
+void CborWriter::addText(const char* str)
+{
+    size_t strLen = strlen(str);
+
+    addHead(majorTypeText, strLen);
+    if(len < bufLen) {
+        memcpy(&buf[len], str, ((bufLen - len) < strLen) ? (bufLen - len) : strLen);
+    }
+    len += strLen;
+}
+
+/**
+ * @brief Get the length of the encoded data. If it is greater than the buffer size,
+ * the data has been truncated.
+ */
+size_t CborWriter::getLength(void) const
+{
+    return len;
+}
+
+/**
+ * @brief Add the initial byte of a data item and its argument in the shortest form.
+ * 
+ * @param majorType Major type (0..7)
+ * @param val Argument, i.e. the value of integers or the length of the others
+ */
+void CborWriter::addHead(uint8_t majorType, uint64_t val)
+{
+    uint8_t type = (uint8_t) (majorType << 5);
+    int numBytes;
+
+    if(val < 24) {
+        addByte(type | (uint8_t) val);
+        return;
+    } else if(val <= UINT8_MAX) {
+        addByte(type | 24);
+        numBytes = 1;
+    } else if(val <= UINT16_MAX) {
+        addByte(type | 25);
+        numBytes = 2;
+    } else if(val <= UINT32_MAX) {
+        addByte(type | 26);
+        numBytes = 4;
+    } else {
+        addByte(type | 27);
+        numBytes = 8;
+    }
+
+    // Network byte order
+    for(int i = numBytes - 1; i >= 0; i--) {
+        addByte((uint8_t) (val >> (i * 8)));
+    }
+}
+
+/**
+ * @brief Add a single byte.
+ */
+void CborWriter::addByte(uint8_t val)
+{
+    if(len < bufLen) buf[len] = val;
+    len++;
+}
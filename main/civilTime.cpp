@@ -0,0 +1,417 @@
+#include "civilTime.h"
+
+#include <cstring>
+
+/**
+ * @brief Default constructor, which sets up UTC as timezone.
+ */
+CivilTime::CivilTime(void)
+{
+    memset(rules, 0, sizeof(rules));
+    strcpy(rules[0].posixTz, "UTC0");
+    activeRule = 0;
+    ruleGeneration = 0;
+}
+
+/**
+ * @brief Convert a day number back to a civil date.
+ *
+ * @param days Days since 1970-01-01.
+ * @param year Pointer to store the full year at.
+ * @param month Pointer to store the month (1..12) at.
+ * @param day Pointer to store the day of month (1..31) at.
+ */
+void CivilTime::civilFromDays(int64_t days, int* year, int* month, int* day)
+{
+    days += 719468;
+    int64_t era = floorDiv(days, 146097);
+    int64_t doe = days - era * 146097;                                      // [0, 146096]
+    int64_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;          // [0, 399]
+    int64_t doy = doe - (365*yoe + yoe/4 - yoe/100);                        // [0, 365]
+    int64_t mp = (5*doy + 2) / 153;                                         // [0, 11]
+    int d = (int) (doy - (153*mp + 2)/5 + 1);                               // [1, 31]
+    int m = (int) ((mp < 10) ? (mp + 3) : (mp - 9));                        // [1, 12]
+
+    *year = (int) (yoe + era * 400 + ((m <= 2) ? 1 : 0));
+    *month = m;
+    *day = d;
+}
+
+/**
+ * @brief Set a new timezone and precompile its DST transition table.
+ *
+ * Supported is the POSIX TZ format 'std offset [dst [offset] [,start[/time],end[/time]]]'
+ * with start/end dates in the 'Mm.w.d', 'Jn' or 'n' format. If a DST name is given,
+ * the start/end rule is mandatory.
+ *
+ * @param posixTz POSIX TZ rule string, e.g. "CET-1CEST,M3.5.0,M10.5.0/3".
+ * @return CivilTime::err_t
+ * @retval ERR_OK Success.
+ * @retval ERR_INVALID_PARAM posixTz is invalid or too long.
+ * @retval ERR_INVALID_RULE The rule couldn't be parsed. The previous rule stays active.
+ */
+CivilTime::err_t CivilTime::setTimezone(const char* posixTz)
+{
+    if(nullptr == posixTz) return ERR_INVALID_PARAM;
+    if(strlen(posixTz) > civilTimeTzRuleMaxLen) return ERR_INVALID_PARAM;
+
+    // nothing to do if the rule didn't change
+    if(0 == strcmp(rules[activeRule].posixTz, posixTz)) return ERR_OK;
+
+    unsigned int inactiveRule = activeRule ^ 1U;
+    tz_rule_t* rule = &rules[inactiveRule];
+
+    if(!parseRule(posixTz, rule)) {
+        return ERR_INVALID_RULE;
+    }
+
+    strcpy(rule->posixTz, posixTz);
+    for(int i = 0; i < civilTimeTableNumYears; i++) {
+        calcTransitions(*rule, civilTimeTableFirstYear + i, &rule->dstStartUtc[i], &rule->dstEndUtc[i]);
+    }
+
+    activeRule = inactiveRule;
+    ruleGeneration = ruleGeneration + 1;
+
+    return ERR_OK;
+}
+
+/**
+ * @brief Get the currently active POSIX TZ rule string.
+ */
+const char* CivilTime::getTimezone(void) const
+{
+    return rules[activeRule].posixTz;
+}
+
+/**
+ * @brief Get the generation of the currently active rule. It is incremented
+ * on each rule change, so cached local time calculations can be invalidated.
+ */
+uint32_t CivilTime::getRuleGeneration(void) const
+{
+    return ruleGeneration;
+}
+
+/**
+ * @brief Get the UTC offset (east positive) in seconds valid at the specified time.
+ */
+int32_t CivilTime::getUtcOffset(time_t utc) const
+{
+    const tz_rule_t& rule = rules[activeRule];
+    return isDst(rule, utc) ? rule.dstOffsetSecs : rule.stdOffsetSecs;
+}
+
+/**
+ * @brief Get the gap of the DST transition at which the local time jumps forward,
+ * usually the start of DST.
+ *
+ * @param startSecs Local time of day the gap starts at, in seconds after midnight.
+ * @param gapSecs Length of the gap in seconds.
+ * @return true if the timezone has such a transition, false otherwise (both are set to 0).
+ */
+bool CivilTime::getDstGap(int32_t* startSecs, int32_t* gapSecs) const
+{
+    const tz_rule_t& rule = rules[activeRule];
+    int64_t transitionSecs;
+
+    *startSecs = 0;
+    *gapSecs = 0;
+    if(!rule.hasDst || (rule.dstOffsetSecs == rule.stdOffsetSecs)) return false;
+
+    // The start time is given in standard time, the end time in daylight saving time
+    if(rule.dstOffsetSecs > rule.stdOffsetSecs) {
+        transitionSecs = rule.startSecs;
+        *gapSecs = rule.dstOffsetSecs - rule.stdOffsetSecs;
+    } else {
+        transitionSecs = rule.endSecs;
+        *gapSecs = rule.stdOffsetSecs - rule.dstOffsetSecs;
+    }
+    *startSecs = (int32_t) (transitionSecs - floorDiv(transitionSecs, secsPerDay) * secsPerDay);
+
+    return true;
+}
+
+/**
+ * @brief Convert a UTC time to local seconds, i.e. the local wall clock time in
+ * seconds since 1970-01-01 00:00:00 local time.
+ */
+int64_t CivilTime::utcToLocal(time_t utc) const
+{
+    return (int64_t) utc + getUtcOffset(utc);
+}
+
+/**
+ * @brief Convert a UTC time to broken down local civil time (localtime_r replacement).
+ *
+ * @param utc UTC time to convert.
+ * @param dest Pointer to a civil_time_t, which will be populated.
+ */
+void CivilTime::utcToCivil(time_t utc, civil_time_t* dest) const
+{
+    if(nullptr == dest) return;
+
+    const tz_rule_t& rule = rules[activeRule];
+    bool dst = isDst(rule, utc);
+    int64_t local = (int64_t) utc + (dst ? rule.dstOffsetSecs : rule.stdOffsetSecs);
+    int64_t days = floorDiv(local, secsPerDay);
+    int32_t daySecs = (int32_t) (local - days * secsPerDay);
+
+    civilFromDays(days, &dest->year, &dest->month, &dest->day);
+    dest->hour = daySecs / 3600;
+    dest->minute = (daySecs / 60) % 60;
+    dest->second = daySecs % 60;
+    dest->weekday = weekdayFromDays(days);
+    dest->yearday = (int) (days - daysFromCivil(dest->year, 1, 1));
+    dest->isDst = dst;
+}
+
+/**
+ * @brief Convert local seconds to UTC (mktime replacement with tm_isdst = -1).
+ *
+ * @param localSecs Local wall clock time in seconds since 1970-01-01 00:00:00 local time.
+ * @return time_t Corresponding UTC time.
+ */
+time_t CivilTime::localToUtc(int64_t localSecs) const
+{
+    const tz_rule_t& rule = rules[activeRule];
+
+    time_t utcStd = (time_t) (localSecs - rule.stdOffsetSecs);
+    if(!rule.hasDst) return utcStd;
+
+    // Ambiguous times resolve to the first occurance, which is the DST one.
+    // Times within the gap are interpreted as standard time.
+    time_t utcDst = (time_t) (localSecs - rule.dstOffsetSecs);
+    if(isDst(rule, utcDst)) return utcDst;
+    return utcStd;
+}
+
+/**
+ * @brief Convert a local civil date and time to UTC.
+ *
+ * Note: Out of range time fields (e.g. second > 59) are handled gracefully, because
+ * the time of day is just added to the start of the day.
+ */
+time_t CivilTime::civilToUtc(int year, int month, int day, int hour, int minute, int second) const
+{
+    int64_t localSecs = daysFromCivil(year, month, day) * secsPerDay +
+        (int64_t) hour * 3600 + (int64_t) minute * 60 + second;
+    return localToUtc(localSecs);
+}
+
+/**
+ * @brief Get the DST state of a UTC time by using the precompiled transition table.
+ * Years outside of the table are calculated on the fly.
+ */
+bool CivilTime::isDst(const tz_rule_t& rule, time_t utc)
+{
+    if(!rule.hasDst) return false;
+
+    int year, month, day;
+    civilFromDays(floorDiv((int64_t) utc + rule.stdOffsetSecs, secsPerDay), &year, &month, &day);
+
+    time_t dstStart, dstEnd;
+    int idx = year - civilTimeTableFirstYear;
+    if((idx >= 0) && (idx < civilTimeTableNumYears)) {
+        dstStart = rule.dstStartUtc[idx];
+        dstEnd = rule.dstEndUtc[idx];
+    } else {
+        calcTransitions(rule, year, &dstStart, &dstEnd);
+    }
+
+    if(dstStart < dstEnd) {
+        // northern hemisphere
+        return (utc >= dstStart) && (utc < dstEnd);
+    } else {
+        // southern hemisphere: DST spans the turn of the year
+        return (utc < dstEnd) || (utc >= dstStart);
+    }
+}
+
+/**
+ * @brief Calculate the DST transitions of a rule for the specified year.
+ */
+void CivilTime::calcTransitions(const tz_rule_t& rule, int year, time_t* dstStart, time_t* dstEnd)
+{
+    int64_t startDays = ruleDateToDays(year, rule.startType, rule.startM, rule.startW, rule.startD);
+    int64_t endDays = ruleDateToDays(year, rule.endType, rule.endM, rule.endW, rule.endD);
+
+    // start is specified in local standard time, end in local daylight saving time
+    *dstStart = (time_t) (startDays * secsPerDay + rule.startSecs - rule.stdOffsetSecs);
+    *dstEnd = (time_t) (endDays * secsPerDay + rule.endSecs - rule.dstOffsetSecs);
+}
+
+/**
+ * @brief Convert a POSIX TZ rule date to a day number.
+ */
+int64_t CivilTime::ruleDateToDays(int year, char type, int m, int w, int d)
+{
+    int64_t days;
+
+    if(type == 'M') {
+        // d'th day (0 = sunday) of week w (5 = last) of month m
+        int64_t firstOfMonth = daysFromCivil(year, m, 1);
+        int mday = 1 + ((d - weekdayFromDays(firstOfMonth) + 7) % 7) + (w - 1) * 7;
+        while(mday > daysInMonth(year, m)) mday -= 7;
+        days = firstOfMonth + mday - 1;
+    } else if(type == 'J') {
+        // julian day 1..365, february 29th is never counted
+        days = daysFromCivil(year, 1, 1) + d - 1;
+        if(isLeapYear(year) && (d >= 60)) days++;
+    } else {
+        // zero-based julian day 0..365, february 29th is counted
+        days = daysFromCivil(year, 1, 1) + d;
+    }
+
+    return days;
+}
+
+bool CivilTime::parseName(const char** str)
+{
+    const char* s = *str;
+    int len = 0;
+
+    if(*s == '<') {
+        s++;
+        while((*s != '\0') && (*s != '>')) {
+            s++;
+            len++;
+        }
+        if(*s != '>') return false;
+        s++;
+    } else {
+        while(((*s >= 'A') && (*s <= 'Z')) || ((*s >= 'a') && (*s <= 'z'))) {
+            s++;
+            len++;
+        }
+    }
+
+    *str = s;
+    return (len >= 3);
+}
+
+/**
+ * @brief Parse a decimal number not bigger than maxVal.
+ */
+bool CivilTime::parseNum(const char** str, int* val, int maxVal)
+{
+    const char* s = *str;
+    int num = 0;
+
+    if((*s < '0') || (*s > '9')) return false;
+    while((*s >= '0') && (*s <= '9')) {
+        num = num * 10 + (*s - '0');
+        if(num > maxVal) return false;
+        s++;
+    }
+
+    *str = s;
+    *val = num;
+    return true;
+}
+
+/**
+ * @brief Parse a '[+-]hh[:mm[:ss]]' offset or time into seconds.
+ */
+bool CivilTime::parseOffset(const char** str, int32_t* secs)
+{
+    const char* s = *str;
+    int sign = 1;
+    int hh = 0, mm = 0, ss = 0;
+
+    if(*s == '+') {
+        s++;
+    } else if(*s == '-') {
+        sign = -1;
+        s++;
+    }
+
+    if(!parseNum(&s, &hh, 167)) return false;
+    if(*s == ':') {
+        s++;
+        if(!parseNum(&s, &mm, 59)) return false;
+        if(*s == ':') {
+            s++;
+            if(!parseNum(&s, &ss, 59)) return false;
+        }
+    }
+
+    *str = s;
+    *secs = sign * (hh * 3600 + mm * 60 + ss);
+    return true;
+}
+
+/**
+ * @brief Parse a 'Mm.w.d', 'Jn' or 'n' date.
+ */
+bool CivilTime::parseDate(const char** str, char* type, int* m, int* w, int* d)
+{
+    const char* s = *str;
+
+    if(*s == 'M') {
+        s++;
+        *type = 'M';
+        if(!parseNum(&s, m, 12) || (*m < 1) || (*s != '.')) return false;
+        s++;
+        if(!parseNum(&s, w, 5) || (*w < 1) || (*s != '.')) return false;
+        s++;
+        if(!parseNum(&s, d, 6)) return false;
+    } else if(*s == 'J') {
+        s++;
+        *type = 'J';
+        if(!parseNum(&s, d, 365) || (*d < 1)) return false;
+    } else {
+        *type = 'D';
+        if(!parseNum(&s, d, 365)) return false;
+    }
+
+    *str = s;
+    return true;
+}
+
+/**
+ * @brief Parse a POSIX TZ rule string into its compiled form (without transition table).
+ */
+bool CivilTime::parseRule(const char* posixTz, tz_rule_t* rule)
+{
+    const char* s = posixTz;
+    int32_t offset;
+
+    if(!parseName(&s)) return false;
+    if(!parseOffset(&s, &offset)) return false;
+    // POSIX offsets are west positive
+    rule->stdOffsetSecs = -offset;
+    rule->dstOffsetSecs = rule->stdOffsetSecs;
+    rule->hasDst = false;
+
+    if(*s == '\0') return true;
+
+    if(!parseName(&s)) return false;
+    rule->hasDst = true;
+    rule->dstOffsetSecs = rule->stdOffsetSecs + 3600;
+    if((*s != ',') && (*s != '\0')) {
+        if(!parseOffset(&s, &offset)) return false;
+        rule->dstOffsetSecs = -offset;
+    }
+
+    // DST rules are mandatory, there is no sensible default outside of the US
+    if(*s != ',') return false;
+    s++;
+    if(!parseDate(&s, &rule->startType, &rule->startM, &rule->startW, &rule->startD)) return false;
+    rule->startSecs = 2 * 3600;
+    if(*s == '/') {
+        s++;
+        if(!parseOffset(&s, &rule->startSecs)) return false;
+    }
+
+    if(*s != ',') return false;
+    s++;
+    if(!parseDate(&s, &rule->endType, &rule->endM, &rule->endW, &rule->endD)) return false;
+    rule->endSecs = 2 * 3600;
+    if(*s == '/') {
+        s++;
+        if(!parseOffset(&s, &rule->endSecs)) return false;
+    }
+
+    return (*s == '\0');
+}
@@ -5,10 +5,10 @@
 
 COMPONENT_ADD_INCLUDEDIRS := . include
 
-COMPONENT_EMBED_TXTFILES := ota_root_ca_cert.pem ota_host_public_key.pem irrigationConfig.default.json hardwareConfig.default.json
+COMPONENT_EMBED_TXTFILES := ota_root_ca_cert.pem ota_host_public_key.pem
 
-# override the default build target to update version.h if needed
-build: $(COMPONENT_PATH)/include/version.h $(COMPONENT_LIBRARY)
+# override the default build target to update version.h and defaultConfig.h if needed
+build: $(COMPONENT_PATH)/include/version.h $(COMPONENT_PATH)/include/defaultConfig.h $(COMPONENT_LIBRARY)
 
 GIT_SHA1 := $(shell git describe --match=NeVeRmAtCh --always --abbrev=40 --dirty --tags)
 
@@ -19,3 +19,25 @@ $(COMPONENT_PATH)/include/version.h: $(COMPONENT_PATH)/include/version.h.in
 		mv $@.tmp $@ ; \
 	fi
 	rm -f $@.tmp
+
+# The default configs are validated and converted into constexpr data by a host build of
+# the firmware logic (see tools/defaultConfigGen.cpp), so invalid defaults fail the build.
+DEFAULT_CONFIG_FILES := $(COMPONENT_PATH)/irrigationConfig.default.json $(COMPONENT_PATH)/hardwareConfig.default.json
+DEFAULT_CONFIG_GEN_DIR := $(BUILD_DIR_BASE)/defaultConfigGen
+DEFAULT_CONFIG_STAMP := $(DEFAULT_CONFIG_GEN_DIR)/defaultConfig.stamp
+DEFAULT_CONFIG_GEN_SOURCES := $(PROJECT_PATH)/tools/defaultConfigGen.cpp \
+	$(addprefix $(COMPONENT_PATH)/, settingsManager.cpp irrigationConfigParser.cpp jsonReader.cpp irrigationEvent.cpp irrigationPlanner.cpp civilTime.cpp) \
+	$(addprefix $(COMPONENT_PATH)/include/, settingsManager.h irrigationConfigParser.h jsonReader.h irrigationEvent.h irrigationPlanner.h irrigationZoneCfg.h irrigationCapacity.h civilTime.h)
+
+settingsManager.o: $(COMPONENT_PATH)/include/defaultConfig.h
+
+# The generator only rewrites the header if its content changed, so the stamp records the
+# last run. Otherwise the generator would run on every build after a source change.
+$(COMPONENT_PATH)/include/defaultConfig.h: $(DEFAULT_CONFIG_STAMP) ;
+
+$(DEFAULT_CONFIG_STAMP): $(DEFAULT_CONFIG_FILES) $(DEFAULT_CONFIG_GEN_SOURCES)
+	# configure for the host, not with the exported cross toolchain
+	env -u CC -u CXX -u CFLAGS -u CXXFLAGS -u CPPFLAGS -u LDFLAGS cmake -S $(PROJECT_PATH)/host -B $(DEFAULT_CONFIG_GEN_DIR) -DCMAKE_BUILD_TYPE=Release
+	cmake --build $(DEFAULT_CONFIG_GEN_DIR) --target default_config_gen
+	$(DEFAULT_CONFIG_GEN_DIR)/default_config_gen $(DEFAULT_CONFIG_FILES) $(COMPONENT_PATH)/include/defaultConfig.h
+	touch $@
@@ -19,7 +19,13 @@
 
 #include "version.h"
 #include "timeSystem.h"
+#include "irrigationController.h"
+#include "settingsManager.h"
+#include "jsonArena.h"
 
+extern IrrigationController irrigCtrl;
+extern SettingsManager settingsMgr;
+extern JsonArena jsonArena;
 
 #define IGNORE_UNUSED_VARIABLE(x)     if ( &x == &x ) {}
 
@@ -34,6 +40,9 @@ static eCommandResult_T ConsoleCommandTimeSet(const char buffer[]);
 static eCommandResult_T ConsoleCommandTimeSntp(const char buffer[]);
 static eCommandResult_T ConsoleCommandLog(const char buffer[]);
 static eCommandResult_T ConsoleCommandLogLevel(const char buffer[]);
+static eCommandResult_T ConsoleCommandLatStats(const char buffer[]);
+static eCommandResult_T ConsoleCommandCfgStats(const char buffer[]);
+static eCommandResult_T ConsoleCommandJsonStats(const char buffer[]);
 
 static const sConsoleCommandTable_T mConsoleCommandTable[] =
 {
@@ -52,6 +61,10 @@ static const sConsoleCommandTable_T mConsoleCommandTable[] =
     {"log", &ConsoleCommandLog, HELP("Set logging on/off. Param: 0:off,1:on")},
     {"log_level", &ConsoleCommandLogLevel, HELP("Set log level. Param: 0:NONE,1:ERR,2:WARN,3:INFO,4:DEBUG,5:DFLT")},
 
+    {"lat_stats", &ConsoleCommandLatStats, HELP("Show event latency stats. Param (optional): 1:reset afterwards")},
+    {"cfg_stats", &ConsoleCommandCfgStats, HELP("Show config store write stats since power on.")},
+    {"json_stats", &ConsoleCommandJsonStats, HELP("Show JSON arena usage since boot.")},
+
     {"exit", &ConsoleExit, HELP("Exits the command console.")},
     CONSOLE_COMMAND_TABLE_END // must be LAST
 };
@@ -296,6 +309,98 @@ static eCommandResult_T ConsoleCommandLogLevel(const char buffer[])
     return result;
 }
 
+static void ConsoleSendLatencyHistogram(const char* name, const IrrigationController::latency_histogram_t* hist)
+{
+    static char outStr[80];
+    uint32_t lowerMillis = 0;
+
+    snprintf(outStr, sizeof(outStr) / sizeof(outStr[0]), "%s: count %u, avg %u ms, max %u ms",
+        name, hist->count, (hist->count > 0) ? (uint32_t) (hist->sumMillis / hist->count) : 0, hist->maxMillis);
+    ConsoleIoSendString(outStr);
+    ConsoleIoSendString(STR_ENDLINE);
+
+    for(unsigned int i = 0; i < IrrigationController::latencyBucketCount; i++) {
+        uint32_t upperMillis = IrrigationController::getLatencyBucketUpperMillis(i);
+
+        if(UINT32_MAX == upperMillis) {
+            snprintf(outStr, sizeof(outStr) / sizeof(outStr[0]), "  > %u ms: %u", lowerMillis, hist->buckets[i]);
+        } else {
+            snprintf(outStr, sizeof(outStr) / sizeof(outStr[0]), "  <= %u ms: %u", upperMillis, hist->buckets[i]);
+        }
+        ConsoleIoSendString(outStr);
+        ConsoleIoSendString(STR_ENDLINE);
+        lowerMillis = upperMillis;
+    }
+}
+
+static eCommandResult_T ConsoleCommandLatStats(const char buffer[])
+{
+    eCommandResult_T result = COMMAND_SUCCESS;
+    int16_t reset = 0;
+    static IrrigationController::event_latency_stats_t stats;
+
+    // The reset parameter is optional
+    if(COMMAND_SUCCESS != ConsoleReceiveParamInt16(buffer, 1, &reset)) reset = 0;
+    if((reset < 0) || (reset > 1)) result = COMMAND_PARAMETER_ERROR;
+
+    if(COMMAND_SUCCESS == result) {
+        irrigCtrl.getEventLatencyStats(&stats);
+        ConsoleSendLatencyHistogram("Start events", &stats.start);
+        ConsoleSendLatencyHistogram("Stop events", &stats.stop);
+
+        if(1 == reset) {
+            irrigCtrl.resetEventLatencyStats();
+            ConsoleIoSendString("Event latency stats reset.");
+            ConsoleIoSendString(STR_ENDLINE);
+        }
+    } else {
+        ConsoleIoSendString("Error parsing parameters.");
+        ConsoleIoSendString(STR_ENDLINE);
+    }
+
+    return result;
+}
+
+static eCommandResult_T ConsoleCommandCfgStats(const char buffer[])
+{
+    static char outStr[80];
+    static SettingsManager::config_store_stats_t stats;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+    settingsMgr.getConfigStoreStats(&stats);
+    snprintf(outStr, sizeof(outStr) / sizeof(outStr[0]), "Requests: %u, skipped (unchanged): %u",
+        stats.requests, stats.skippedWrites);
+    ConsoleIoSendString(outStr);
+    ConsoleIoSendString(STR_ENDLINE);
+    snprintf(outStr, sizeof(outStr) / sizeof(outStr[0]), "Writes: %u, failed: %u, bytes written: %u",
+        stats.writes, stats.failedWrites, stats.bytesWritten);
+    ConsoleIoSendString(outStr);
+    ConsoleIoSendString(STR_ENDLINE);
+
+    return COMMAND_SUCCESS;
+}
+
+static eCommandResult_T ConsoleCommandJsonStats(const char buffer[])
+{
+    static char outStr[80];
+    static JsonArena::json_arena_stats_t stats;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+    jsonArena.getStats(&stats);
+    snprintf(outStr, sizeof(outStr) / sizeof(outStr[0]), "Requests: %u, failed allocations: %u",
+        stats.requests, stats.failedAllocs);
+    ConsoleIoSendString(outStr);
+    ConsoleIoSendString(STR_ENDLINE);
+    snprintf(outStr, sizeof(outStr) / sizeof(outStr[0]), "Last used: %u, high-water: %u of %u bytes",
+        stats.lastUsed, stats.highWater, (unsigned int) JsonArena::arenaSize);
+    ConsoleIoSendString(outStr);
+    ConsoleIoSendString(STR_ENDLINE);
+
+    return COMMAND_SUCCESS;
+}
+
 const sConsoleCommandTable_T* ConsoleCommandsGetTable(void)
 {
     return (mConsoleCommandTable);
@@ -0,0 +1,151 @@
+#ifndef FIXED_BLOCK_POOL_H
+#define FIXED_BLOCK_POOL_H
+
+#include <stdint.h>
+#include <cstdbool>
+
+
+/**
+ * @brief The FixedBlockPool class provides storage for a fixed number of equally
+ * sized blocks, e.g. irrigation events. The occupancy is tracked in a bitmap,
+ * so allocation, release and iteration over the used blocks scan 32 blocks per
+ * step instead of checking each block individually.
+ *
+ * Blocks are identified by their index, which stays valid until the block is released.
+ * alloc() always returns the lowest free index, i.e. filling a cleared pool yields
+ * ascending indices.
+ *
+ * Note: The pool doesn't lock; the owner is responsible for synchronization.
+ *
+ * @tparam T Type of the blocks.
+ * @tparam numBlocks Number of blocks.
+ */
+template <typename T, unsigned int numBlocks>
+class FixedBlockPool
+{
+public:
+    static constexpr unsigned int capacity = numBlocks;
+
+    FixedBlockPool()
+    {
+        clear();
+    }
+
+    /**
+     * @brief Release all blocks.
+     */
+    void clear()
+    {
+        for(unsigned int i = 0; i < numWords; i++) {
+            usedMask[i] = 0;
+        }
+        used = 0;
+    }
+
+    /**
+     * @brief Allocate the lowest free block.
+     *
+     * @return int Index of the allocated block, -1 if the pool is exhausted.
+     */
+    int alloc()
+    {
+        for(unsigned int i = 0; i < numWords; i++) {
+            uint32_t freeMask = ~usedMask[i] & wordMask(i);
+            if(0 != freeMask) {
+                unsigned int idx = i * 32 + __builtin_ctz(freeMask);
+                usedMask[i] |= (1UL << (idx % 32));
+                used++;
+                return idx;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Allocate a specific block, e.g. to preserve the indices of a configuration.
+     *
+     * @param idx Index of the block.
+     * @return true if the block was allocated, false if it is invalid or already in use.
+     */
+    bool claim(unsigned int idx)
+    {
+        if((idx >= numBlocks) || isUsed(idx)) return false;
+
+        usedMask[idx / 32] |= (1UL << (idx % 32));
+        used++;
+        return true;
+    }
+
+    /**
+     * @brief Return a block to the pool. Releasing a free block has no effect.
+     *
+     * @param idx Index of the block.
+     */
+    void release(unsigned int idx)
+    {
+        if(!isUsed(idx)) return;
+
+        usedMask[idx / 32] &= ~(1UL << (idx % 32));
+        used--;
+    }
+
+    bool isUsed(unsigned int idx) const
+    {
+        return (idx < numBlocks) && (0 != (usedMask[idx / 32] & (1UL << (idx % 32))));
+    }
+
+    /**
+     * @brief Get the first used block at or after the given index.
+     *
+     * Iterate all used blocks with:
+     * for(int i = pool.nextUsed(0); i >= 0; i = pool.nextUsed(i + 1)) { ... }
+     *
+     * @param idx Index to start searching at.
+     * @return int Index of the used block, -1 if there is none.
+     */
+    int nextUsed(unsigned int idx) const
+    {
+        if(idx >= numBlocks) return -1;
+
+        unsigned int i = idx / 32;
+        uint32_t mask = usedMask[i] & ~((1UL << (idx % 32)) - 1);
+        while(true) {
+            if(0 != mask) return i * 32 + __builtin_ctz(mask);
+            if(++i >= numWords) return -1;
+            mask = usedMask[i];
+        }
+    }
+
+    unsigned int numUsed() const
+    {
+        return used;
+    }
+
+    T& operator[](unsigned int idx)
+    {
+        return blocks[idx];
+    }
+
+    const T& operator[](unsigned int idx) const
+    {
+        return blocks[idx];
+    }
+
+private:
+    static constexpr unsigned int numWords = (numBlocks + 31) / 32;
+
+    T blocks[numBlocks];                    /**< Block storage */
+    uint32_t usedMask[numWords];            /**< Bit i is set if block i is in use */
+    unsigned int used;                      /**< Number of blocks in use */
+
+    /** Mask of the valid blocks of a bitmap word, i.e. excluding the padding of the last word */
+    static constexpr uint32_t wordMask(unsigned int word)
+    {
+        return ((word < numWords - 1) || (0 == numBlocks % 32)) ? 0xFFFFFFFFUL : ((1UL << (numBlocks % 32)) - 1);
+    }
+};
+
+template <typename T, unsigned int numBlocks>
+constexpr unsigned int FixedBlockPool<T, numBlocks>::capacity;
+
+#endif /* FIXED_BLOCK_POOL_H */
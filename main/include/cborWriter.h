@@ -0,0 +1,43 @@
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief The CborWriter class encodes data items in CBOR (RFC 7049) into a caller
+ * provided buffer. Only what the MQTT payloads need is supported: unsigned and
+ * negative integers, text strings and definite length arrays and maps.
+ *
+ * Like snprintf, the writer keeps counting if the buffer is too small, so the
+ * required size can be determined by comparing getLength() with the buffer size.
+ */
+class CborWriter
+{
+public:
+    CborWriter(uint8_t* buf, size_t bufLen);
+
+    void startArray(uint32_t numItems);
+    void startMap(uint32_t numPairs);
+    void addUint(uint64_t val);
+    void addInt(int64_t val);
+    void addText(const char* str);
+
+    size_t getLength(void) const;
+
+private:
+    static const uint8_t majorTypeUint = 0;
+    static const uint8_t majorTypeNegInt = 1;
+    static const uint8_t majorTypeText = 3;
+    static const uint8_t majorTypeArray = 4;
+    static const uint8_t majorTypeMap = 5;
+
+    void addHead(uint8_t majorType, uint64_t val);
+    void addByte(uint8_t val);
+
+    uint8_t* buf;
+    size_t bufLen;
+    size_t len;
+};
+
+#endif /* CBOR_WRITER_H */
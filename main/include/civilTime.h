@@ -0,0 +1,152 @@
+#ifndef CIVIL_TIME_H
+#define CIVIL_TIME_H
+
+#include <stdint.h>
+#include <ctime>
+
+/** Maximum length of a POSIX TZ rule string (excl. termination). */
+constexpr unsigned int civilTimeTzRuleMaxLen = 47;
+/** First year covered by the precompiled DST transition table. */
+constexpr int civilTimeTableFirstYear = 2018;
+/** Number of years covered by the precompiled DST transition table. */
+constexpr int civilTimeTableNumYears = 32;
+
+/** Broken down civil (i.e. local wall clock) time. */
+typedef struct civil_time_t {
+    int year;           /**< Full year, e.g. 2018 */
+    int month;          /**< Month 1..12 */
+    int day;            /**< Day of month 1..31 */
+    int hour;           /**< Hour 0..23 */
+    int minute;         /**< Minute 0..59 */
+    int second;         /**< Second 0..59 */
+    int weekday;        /**< Day of week 0..6, 0 = sunday */
+    int yearday;        /**< Day of year 0..365 */
+    bool isDst;         /**< Wether or not daylight saving time is active */
+} civil_time_t;
+
+/**
+ * @brief The CivilTime class is an allocation free replacement for newlib's
+ * mktime/localtime_r in the scheduling path.
+ *
+ * It is built around integer days-from-civil calendar math and a DST transition
+ * table, which is precompiled from a POSIX TZ rule (e.g. "CET-1CEST,M3.5.0,M10.5.0/3")
+ * whenever the rule is set. Local times are handled as 'local seconds', i.e. the
+ * wall clock time expressed as seconds since 1970-01-01 00:00:00 local time.
+ *
+ * Local times within the DST gap are interpreted as standard time (i.e. they are
+ * shifted behind the gap). Ambiguous local times after the DST end resolve to the
+ * first occurance (i.e. the DST one). That's the same as what mktime does with
+ * tm_isdst set to -1.
+ */
+class CivilTime
+{
+public:
+    typedef enum {
+        ERR_OK = 0,
+        ERR_INVALID_PARAM = -1,
+        ERR_INVALID_RULE = -2,
+    } err_t;
+
+    static constexpr int32_t secsPerDay = 86400;
+
+    /**
+     * @brief Floor division, i.e. rounding towards negative infinity.
+     */
+    static constexpr int64_t floorDiv(int64_t a, int64_t b)
+    {
+        return (a >= 0) ? (a / b) : -((-a + b - 1) / b);
+    }
+
+    /**
+     * @brief Get the number of days since 1970-01-01 of a civil date.
+     *
+     * @param year Full year, e.g. 2018.
+     * @param month Month 1..12.
+     * @param day Day of month 1..31.
+     * @return int64_t Days since 1970-01-01 (negative before).
+     */
+    static constexpr int64_t daysFromCivil(int year, int month, int day)
+    {
+        return daysFromShiftedCivil(year - ((month <= 2) ? 1 : 0), month, day);
+    }
+
+    /**
+     * @brief Get the day of week of the specified day number.
+     *
+     * @param days Days since 1970-01-01.
+     * @return int Day of week 0..6, 0 = sunday.
+     */
+    static constexpr int weekdayFromDays(int64_t days)
+    {
+        return (int) ((days >= -4) ? ((days + 4) % 7) : (((days + 5) % 7) + 6));
+    }
+
+    static constexpr bool isLeapYear(int year)
+    {
+        return ((year % 4) == 0) && (((year % 100) != 0) || ((year % 400) == 0));
+    }
+
+    static constexpr int daysInMonth(int year, int month)
+    {
+        return (month == 2) ? (isLeapYear(year) ? 29 : 28) :
+            (((month == 4) || (month == 6) || (month == 9) || (month == 11)) ? 30 : 31);
+    }
+
+    static void civilFromDays(int64_t days, int* year, int* month, int* day);
+
+    CivilTime(void);
+
+    err_t setTimezone(const char* posixTz);
+    const char* getTimezone(void) const;
+    uint32_t getRuleGeneration(void) const;
+
+    int32_t getUtcOffset(time_t utc) const;
+    bool getDstGap(int32_t* startSecs, int32_t* gapSecs) const;
+    int64_t utcToLocal(time_t utc) const;
+    void utcToCivil(time_t utc, civil_time_t* dest) const;
+
+    time_t localToUtc(int64_t localSecs) const;
+    time_t civilToUtc(int year, int month, int day, int hour, int minute, int second) const;
+
+private:
+    /** Compiled form of a POSIX TZ rule. */
+    typedef struct tz_rule_t {
+        char posixTz[civilTimeTzRuleMaxLen+1];                  /**< Source rule string */
+        int32_t stdOffsetSecs;                                  /**< UTC offset of standard time (east positive) */
+        int32_t dstOffsetSecs;                                  /**< UTC offset of daylight saving time (east positive) */
+        bool hasDst;                                            /**< Wether or not the rule has daylight saving time */
+        char startType;                                         /**< DST start date format: 'M', 'J' or 'D' (zero-based day) */
+        int startM, startW, startD;                             /**< DST start date fields */
+        int32_t startSecs;                                      /**< DST start time of day (local standard time) */
+        char endType;                                           /**< DST end date format: 'M', 'J' or 'D' (zero-based day) */
+        int endM, endW, endD;                                   /**< DST end date fields */
+        int32_t endSecs;                                        /**< DST end time of day (local daylight saving time) */
+        time_t dstStartUtc[civilTimeTableNumYears];             /**< Precompiled DST start transitions in UTC */
+        time_t dstEndUtc[civilTimeTableNumYears];               /**< Precompiled DST end transitions in UTC */
+    } tz_rule_t;
+
+    tz_rule_t rules[2];                                         /**< Double buffered rules, so readers never see a half written one */
+    volatile unsigned int activeRule;                           /**< Index of the currently active rule */
+    volatile uint32_t ruleGeneration;                           /**< Incremented each time a new rule is activated */
+
+    static constexpr int64_t daysFromShiftedCivil(int y, int month, int day)
+    {
+        return floorDiv(y, 400) * 146097 + dayOfEra(y - floorDiv(y, 400) * 400, month, day) - 719468;
+    }
+
+    static constexpr int64_t dayOfEra(int64_t yoe, int month, int day)
+    {
+        return yoe * 365 + yoe / 4 - yoe / 100 + (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 + day - 1;
+    }
+
+    static bool parseNum(const char** str, int* val, int maxVal);
+    static bool parseName(const char** str);
+    static bool parseOffset(const char** str, int32_t* secs);
+    static bool parseDate(const char** str, char* type, int* m, int* w, int* d);
+    static bool parseRule(const char* posixTz, tz_rule_t* rule);
+    static int64_t ruleDateToDays(int year, char type, int m, int w, int d);
+    static void calcTransitions(const tz_rule_t& rule, int year, time_t* dstStart, time_t* dstEnd);
+    static bool isDst(const tz_rule_t& rule, time_t utc);
+};
+
+#endif /* CIVIL_TIME_H */
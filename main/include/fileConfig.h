@@ -2,8 +2,10 @@
 #define FILE_CONFIG_H
 
 static const char partlabelConfigStore[] = "cfg_store";
+static const char partlabelConfigImage[] = "cfg_image";
 static const char filepathConfigStore[] = "/cfg_store";
 static const char filenameIrrigationConfig[] = "/cfg_store/irrigationConfig.json";
 static const char filenameHardwareConfig[] = "/cfg_store/hardwareConfig.json";
+static const char filenameSolarTable[] = "/cfg_store/solarTable.bin";
 
 #endif /* FILE_CONFIG_H */
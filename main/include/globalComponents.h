@@ -8,19 +8,26 @@
 #include "serialPacketizer.h"
 #include "fillSensorProtoHandler.h"
 #include "timeSystem.h"
+#include "civilTime.h"
+#include "solarTable.h"
 #include "powerManager.h"
 #include "outputController.h"
 #include "mqttManager.h"
+#include "jsonArena.h"
 #include "settingsManager.h"
 #include "irrigationPlanner.h"
 
 extern FillSensorPacketizer fillSensorPacketizer;
 extern FillSensorProtoHandler<FillSensorPacketizer> fillSensor;
 
+extern CivilTime civilTime;
+extern SolarTable solarTable;
+
 extern PowerManager pwrMgr;
 extern OutputController outputCtrl;
 
 extern MqttManager mqttMgr;
+extern JsonArena jsonArena;
 extern SettingsManager settingsMgr;
 
 extern IrrigationPlanner irrigPlanner;
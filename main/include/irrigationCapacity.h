@@ -0,0 +1,84 @@
+#ifndef IRRIGATION_CAPACITY_H
+#define IRRIGATION_CAPACITY_H
+
+#include <stddef.h>
+
+/**
+ * @brief Capacity policy of the irrigation scheduling, i.e. the IrrigationPlanner
+ * and the irrigation configuration of the SettingsManager.
+ *
+ * All storages are statically allocated. Their sizes are derived from the policy
+ * selected below.
+ *
+ * @tparam zones Number of configurable irrigation zones.
+ * @tparam normalEvents Number of regular irrigation events.
+ * @tparam singleShotEvents Number of temporary single shot irrigation events.
+ */
+template <unsigned int zones, unsigned int normalEvents, unsigned int singleShotEvents>
+struct IrrigationCapacityPolicy
+{
+    /** Number of configurable irrigation zones. */
+    static constexpr unsigned int numZones = zones;
+    /** Number of regular irrigation events. */
+    static constexpr unsigned int numNormalEvents = normalEvents;
+    /** Number of temporary single shot irrigation events. */
+    static constexpr unsigned int numSingleShotEvents = singleShotEvents;
+
+    /** Number of irrigation events. */
+    static constexpr unsigned int numEvents = numNormalEvents + numSingleShotEvents;
+    /**
+     * Number of stop events available to the regular events, i.e. the maximum number of
+     * overlapping irrigations. Configurations exceeding it are rejected when being parsed.
+     */
+    static constexpr unsigned int numConfigStopEvents = numZones;
+    /** Number of irrigation stop events. One is reserved for each single shot event. */
+    static constexpr unsigned int numStopEvents = numConfigStopEvents + numSingleShotEvents;
+    /** Number of entries the timeline of upcoming events can hold. */
+    static constexpr unsigned int numTimelineEntries = numEvents + numStopEvents;
+
+    static_assert(numZones > 0, "At least one irrigation zone is required");
+    static_assert(numTimelineEntries <= 0x7FFF, "Event indices have to fit into an int16_t");
+};
+
+template <unsigned int zones, unsigned int normalEvents, unsigned int singleShotEvents>
+constexpr unsigned int IrrigationCapacityPolicy<zones, normalEvents, singleShotEvents>::numZones;
+template <unsigned int zones, unsigned int normalEvents, unsigned int singleShotEvents>
+constexpr unsigned int IrrigationCapacityPolicy<zones, normalEvents, singleShotEvents>::numNormalEvents;
+template <unsigned int zones, unsigned int normalEvents, unsigned int singleShotEvents>
+constexpr unsigned int IrrigationCapacityPolicy<zones, normalEvents, singleShotEvents>::numSingleShotEvents;
+template <unsigned int zones, unsigned int normalEvents, unsigned int singleShotEvents>
+constexpr unsigned int IrrigationCapacityPolicy<zones, normalEvents, singleShotEvents>::numEvents;
+template <unsigned int zones, unsigned int normalEvents, unsigned int singleShotEvents>
+constexpr unsigned int IrrigationCapacityPolicy<zones, normalEvents, singleShotEvents>::numConfigStopEvents;
+template <unsigned int zones, unsigned int normalEvents, unsigned int singleShotEvents>
+constexpr unsigned int IrrigationCapacityPolicy<zones, normalEvents, singleShotEvents>::numStopEvents;
+template <unsigned int zones, unsigned int normalEvents, unsigned int singleShotEvents>
+constexpr unsigned int IrrigationCapacityPolicy<zones, normalEvents, singleShotEvents>::numTimelineEntries;
+
+/** Default installation: 8 zones with up to 4 events each. */
+typedef IrrigationCapacityPolicy<8, 4*8, 1> IrrigationCapacityDefault;
+/** Large installation: 32 zones with up to 3 events each. */
+typedef IrrigationCapacityPolicy<32, 3*32, 1> IrrigationCapacityLarge;
+
+/**
+ * Static DRAM the storages sized by the policy, i.e. the SettingsManager and the
+ * IrrigationPlanner, may take on the ESP32. The rest of the static DRAM is left to the
+ * IDF, the WiFi stack and the other components. Each event takes about 550 bytes (three
+ * config snapshots, the stored config file, the timeline and the due events), each zone
+ * about the same. The Default policy takes about 29 kB, the Large one about 76 kB.
+ * Checked where the components are defined (see main.cpp), policies exceeding it fail
+ * to build.
+ */
+constexpr size_t irrigationCapacityStaticRamBudget = 96 * 1024;
+
+/*
+ * Policy used by the firmware. Select another one at build time, e.g. via
+ * CXXFLAGS += -DIRRIGATION_CAPACITY_POLICY=IrrigationCapacityLarge
+ */
+#ifndef IRRIGATION_CAPACITY_POLICY
+#define IRRIGATION_CAPACITY_POLICY IrrigationCapacityDefault
+#endif
+
+typedef IRRIGATION_CAPACITY_POLICY IrrigationCapacity;
+
+#endif /* IRRIGATION_CAPACITY_H */
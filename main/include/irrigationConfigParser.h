@@ -0,0 +1,158 @@
+#ifndef IRRIGATION_CONFIG_PARSER_H
+#define IRRIGATION_CONFIG_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_log.h"
+
+#include "irrigationPlanner.h"
+#include "irrigationEvent.h"
+#include "irrigationZoneCfg.h"
+#include "solarTable.h"
+#include "jsonReader.h"
+
+/**
+ * @brief The IrrigationConfigParser class parses an irrigation configuration in JSON
+ * format directly into an irrigation_config_t, while the input is streamed through a
+ * JsonReader. Neither a JSON tree nor a copy of the input is needed, so the size of the
+ * configuration isn't limited by a buffer.
+ *
+ * Zones are written as soon as their values arrive. Events are collected per object,
+ * because their type depends on keys in arbitrary order, and are set up at the end of
+ * the object. The target config has to be cleared beforehand.
+ *
+ * Like the former parsing via cJSON_GetObjectItem(), keys are compared case-insensitively
+ * and only the first of duplicate members counts.
+ */
+class IrrigationConfigParser
+{
+public:
+    typedef enum err_t {
+        ERR_OK = 0,
+        ERR_INVALID_JSON = -1,
+        ERR_INVALID_STRUCTURE = -2,
+        ERR_INVALID_ZONE = -3,
+        ERR_INVALID_EVENT = -4
+    } err_t;
+
+    IrrigationConfigParser(irrigation_config_t& config);
+
+    void feed(const char* data, size_t len);
+    err_t finish(void);
+    bool getStorePersistent(size_t* skipStart, size_t* skipEnd) const;
+
+    static void tokenHandlerDispatch(void* param, const JsonReader::token_t* token);
+
+private:
+    const char* logTag = "irrig_cfg_parser";
+
+    typedef enum section_t {
+        SECTION_NONE = 0,
+        SECTION_ZONES,
+        SECTION_EVENTS,
+        SECTION_STORE_PERSISTENT
+    } section_t;
+
+    typedef enum zone_member_t {
+        ZONE_MEMBER_CH_ENABLED = 0,
+        ZONE_MEMBER_CH_NUM,
+        ZONE_MEMBER_CH_STATE_START,
+        ZONE_MEMBER_CH_STATE_STOP,
+        ZONE_MEMBER_NAME,
+        ZONE_MEMBER_COUNT,
+        ZONE_MEMBER_UNKNOWN = ZONE_MEMBER_COUNT
+    } zone_member_t;
+    /** Number of zone members, which are arrays */
+    static const unsigned int zoneArrayMembers = ZONE_MEMBER_NAME;
+
+    typedef enum event_member_t {
+        // numbers
+        EVENT_MEMBER_ZONE_NUM = 0,
+        EVENT_MEMBER_DURATION_SECS,
+        EVENT_MEMBER_HOUR,
+        EVENT_MEMBER_MINUTE,
+        EVENT_MEMBER_SECOND,
+        EVENT_MEMBER_DAY,
+        EVENT_MEMBER_MONTH,
+        EVENT_MEMBER_YEAR,
+        EVENT_MEMBER_OFFSET_MINUTES,
+        // arrays of numbers, parsed into bitsets
+        EVENT_MEMBER_MINUTES,
+        EVENT_MEMBER_HOURS,
+        EVENT_MEMBER_WEEKDAYS,
+        EVENT_MEMBER_DAYS_OF_MONTH,
+        EVENT_MEMBER_MONTHS,
+        // bools
+        EVENT_MEMBER_IS_SINGLE,
+        EVENT_MEMBER_IS_DAILY,
+        EVENT_MEMBER_IS_RECURRING,
+        EVENT_MEMBER_IS_SOLAR,
+        // strings
+        EVENT_MEMBER_SOLAR_EVENT,
+        EVENT_MEMBER_COUNT,
+        EVENT_MEMBER_UNKNOWN = EVENT_MEMBER_COUNT
+    } event_member_t;
+    static const unsigned int eventNumberMembers = EVENT_MEMBER_MINUTES;
+    static const unsigned int eventBitsetMembers = EVENT_MEMBER_IS_SINGLE - EVENT_MEMBER_MINUTES;
+
+    typedef struct event_fields_t {
+        uint32_t exists;                                /**< Bit per event_member_t: the member exists, regardless of its type */
+        uint32_t valid;                                 /**< Bit per event_member_t: a number, true, a valid bitset or solar event */
+        int32_t numbers[eventNumberMembers];
+        uint64_t bitsets[eventBitsetMembers];
+        SolarTable::solar_event_t solarEvent;
+    } event_fields_t;
+
+    typedef struct bitset_range_t {
+        int minVal;
+        int maxVal;
+    } bitset_range_t;
+
+    static const char* const zoneMemberNames[ZONE_MEMBER_COUNT];
+    static const char* const eventMemberNames[EVENT_MEMBER_COUNT];
+    static const bitset_range_t eventBitsetRanges[eventBitsetMembers];
+
+    irrigation_config_t& config;
+    JsonReader reader;
+    err_t err;                                          /**< First semantic error. The input is still read to detect syntax errors. */
+
+    section_t section;                                  /**< Top level member being parsed */
+    bool zonesFound;
+    bool eventsFound;
+    unsigned int numZones;
+    unsigned int numEvents;
+    bool inItem;                                        /**< Wether or not a zone or event object is being parsed */
+    unsigned int member;                                /**< Member of the zone or event being parsed */
+    bool memberIsArray;
+
+    uint32_t zonePresent;                               /**< Bit per zone_member_t: the member has the right type */
+    unsigned int zoneCounts[zoneArrayMembers];
+    event_fields_t eventFields;
+
+    uint32_t topMembersSeen;                            /**< Bit per section_t: the top level member has been read */
+    bool hasTopMembers;                                 /**< Wether or not a top level member has been read */
+    size_t topKeyOffset;                                /**< Input offset of the current top level key */
+    size_t topMemberEnd;                                /**< Input offset after the previous top level value */
+    bool storePersistent;
+    bool storeSkipPending;                              /**< Wether or not the end of the storePersistent member is the next key */
+    size_t storeSkipStart;
+    size_t storeSkipEnd;
+
+    void handleToken(const JsonReader::token_t* token);
+    void handleTopToken(const JsonReader::token_t* token);
+    void handleZoneToken(const JsonReader::token_t* token);
+    void handleEventToken(const JsonReader::token_t* token);
+    void setError(err_t error);
+
+    bool finishZone(void) const;
+    bool finishEvent(IrrigationEvent& evt, bool& used);
+    bool setupRecurrence(IrrigationEvent& evt);
+    bool setupSolarEvent(IrrigationEvent& evt);
+    bool getBitset(event_member_t arrayMember, int singleMember, uint64_t defaultMask, uint64_t* mask);
+    bool isValid(event_member_t member) const;
+    bool exists(event_member_t member) const;
+    int32_t getNumber(event_member_t member) const;
+};
+
+#endif /* IRRIGATION_CONFIG_PARSER_H */
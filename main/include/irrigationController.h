@@ -3,7 +3,6 @@
 
 #include <stdint.h>
 #include <cmath> // used for NAN
-#include <vector>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -18,6 +17,9 @@
 
 #include "globalComponents.h"
 #include "wifiEvents.h"
+#include "wakeProfiler.h"
+#include "wakeCalibrator.h"
+#include "mqttPayload.h"
 
 #define RESERVOIR_STATE_TO_STR(state) (\
     (state == IrrigationController::RESERVOIR_OK) ? "OK" : \
@@ -53,15 +55,11 @@ public:
         reservoir_state_t reservoirState;
     } peristent_data_t;
 
-    IrrigationController(void);
-    ~IrrigationController(void);
+    /** Maximum number of simultaneously active outputs */
+    static const unsigned int maxActiveOutputs = OutputController::intChannels + OutputController::extChannels;
 
-    void start(void);
-
-private:
-    const char* logTag = "irrig_ctrl";
-
-    /** Internal state structure used for MQTT updates and persistant storage. */
+    /** Internal state structure used for MQTT updates and persistant storage.
+     * Must stay trivially copyable, the last published state is kept in RTC memory. */
     typedef struct state_t_ {
         int32_t fillLevel;                                      /**< Fill level of reservoir in percent multiplied by 10.
                                                                  * Note: Will be -1 if getting the fill level failed.
@@ -69,12 +67,94 @@ private:
         reservoir_state_t reservoirState;                       /**< State of the reservoir (e.g. RESERVOIR_OK, ...) */
         uint32_t battVoltage;                                   /**< External battery supply voltage in mV. */
         PowerManager::batt_state_t battState;                   /**< State of the battery (e.g. BATT_FULL, BATT_OK, ...) */
-        std::vector<uint32_t> activeOutputs;                    /**< Currently active outputs. */
+        uint32_t activeOutputs[maxActiveOutputs];               /**< Currently active outputs (sorted ascending). */
+        uint32_t numActiveOutputs;                              /**< Number of valid entries in activeOutputs */
         time_t nextIrrigEvent;                                  /**< Next time an irrigation event occurs. */
         time_t sntpLastSync;                                    /**< Last time a time sync via SNTP happened. */
         time_t sntpNextSync;                                    /**< Next time a time sync via SNTP should happen. */
     } state_t;
 
+    /** Fields of the state, used as bit mask to select the ones to be published */
+    typedef enum {
+        STATE_FIELD_BATT_VOLTAGE = (1<<STATE_KEY_BATT_VOLTAGE),         /**< battVoltage */
+        STATE_FIELD_BATT_STATE = (1<<STATE_KEY_BATT_STATE),             /**< battState */
+        STATE_FIELD_FILL_LEVEL = (1<<STATE_KEY_FILL_LEVEL),             /**< fillLevel */
+        STATE_FIELD_RESERVOIR_STATE = (1<<STATE_KEY_RESERVOIR_STATE),   /**< reservoirState */
+        STATE_FIELD_ACTIVE_OUTPUTS = (1<<STATE_KEY_ACTIVE_OUTPUTS),     /**< activeOutputs */
+        STATE_FIELD_NEXT_EVENT = (1<<STATE_KEY_NEXT_EVENT),             /**< nextIrrigEvent */
+        STATE_FIELD_SNTP_LAST_SYNC = (1<<STATE_KEY_SNTP_LAST_SYNC),     /**< sntpLastSync */
+        STATE_FIELD_SNTP_NEXT_SYNC = (1<<STATE_KEY_SNTP_NEXT_SYNC),     /**< sntpNextSync */
+        STATE_FIELDS_ALL = (1<<STATE_KEY_COUNT) - 1
+    } state_field_t;
+
+    /** Last published state, kept in RTC memory across deep sleep. */
+    typedef struct published_state_t {
+        state_t state;                                          /**< State as known by the subscribers */
+        bool valid;                                             /**< Wether or not the state has been published since power on */
+    } published_state_t;
+
+    /** Number of buckets of the event latency histograms (see latencyBucketUpperMillis) */
+    static const unsigned int latencyBucketCount = 11;
+
+    /** Histogram of the latency between the planned and the actual time events are processed at. */
+    typedef struct latency_histogram_t {
+        uint32_t buckets[latencyBucketCount];                   /**< Number of events per latency bucket */
+        uint32_t count;                                         /**< Total number of events */
+        uint64_t sumMillis;                                     /**< Sum of all latencies in milliseconds */
+        uint32_t maxMillis;                                     /**< Maximum latency in milliseconds */
+        time_t maxEventTime;                                    /**< Planned time of the event with the maximum latency */
+    } latency_histogram_t;
+
+    /** Event latency statistics, kept in RTC memory across deep sleep. */
+    typedef struct event_latency_stats_t {
+        latency_histogram_t start;                              /**< Latencies of irrigation start events */
+        latency_histogram_t stop;                               /**< Latencies of irrigation stop events */
+        bool publishPending;                                    /**< Wether or not the stats changed since the last publish */
+    } event_latency_stats_t;
+
+    /** Compact sensor sample of a wake without network */
+    typedef struct telemetry_record_t {
+        uint32_t time;                                          /**< Time of the sample in seconds since the epoch */
+        uint16_t battVoltage;                                   /**< External battery supply voltage in mV */
+        int16_t fillLevel;                                      /**< Fill level of reservoir in percent multiplied by 10 */
+        uint8_t battState;                                      /**< State of the battery */
+        uint8_t reservoirState;                                 /**< State of the reservoir */
+    } telemetry_record_t;
+
+    /** Maximum number of samples kept until the next network wake. Older ones are dropped. */
+    static const unsigned int telemetryBatchSize = 32;
+
+    /** Samples of the wakes without network and the network wake planning, kept in RTC memory. */
+    typedef struct telemetry_batch_t {
+        telemetry_record_t records[telemetryBatchSize];         /**< Ring buffer of the samples */
+        unsigned int head;                                      /**< Index the next sample is stored at */
+        unsigned int count;                                     /**< Number of samples in the ring buffer */
+        unsigned int wakesSinceNetwork;                         /**< Wakes without network since the last network wake */
+        bool nextWakeNetwork;                                   /**< Wether or not the next timer wakeup brings up the network */
+        uint8_t knownBattState;                                 /**< Battery state at the last network wake */
+        uint8_t knownReservoirState;                            /**< Reservoir state at the last network wake */
+    } telemetry_batch_t;
+
+    IrrigationController(void);
+    ~IrrigationController(void);
+
+    void start(void);
+
+    bool isNetworkWakeRequired(void) const;
+    void startNetwork(void);
+
+    uint32_t getStateChanges(const state_t& current, const state_t& published) const;
+    size_t formatStateData(const state_t& stateData, uint32_t fields, char* buf, size_t bufLen) const;
+    size_t encodeStateData(const state_t& stateData, uint32_t fields, uint8_t* buf, size_t bufLen) const;
+
+    void getEventLatencyStats(event_latency_stats_t* dst);
+    void resetEventLatencyStats(void);
+    size_t formatEventLatencyStats(const event_latency_stats_t& stats, char* buf, size_t bufLen) const;
+    static uint32_t getLatencyBucketUpperMillis(unsigned int bucket);
+
+private:
+    const char* logTag = "irrig_ctrl";
+
     static const int taskStackSize = 4096;
     static const UBaseType_t taskPrio = tskIDLE_PRIORITY + 5; // TBD
     StackType_t taskStack[taskStackSize];
@@ -86,6 +166,11 @@ private:
 
     /** Timeout in milliseconds to wait for WiFi connection */
     const int wifiConnectedWaitMillis = 16000;
+    /** Every n-th deep sleep wakeup brings up the network. The ones in-between only record the
+     * sensor data, unless an event or SNTP resync is due or a sensor state changed. 1 disables this. */
+    const unsigned int networkWakeInterval = 6;
+    /** Wether or not WiFi has been started during this boot */
+    bool networkStarted = false;
     /** Timeout in milliseconds to wait for an SNTP time resync */
     const int timeResyncWaitMillis = 2000;
     /** Timeout in milliseconds to wait for a MQTT client connection */
@@ -123,7 +208,8 @@ private:
     const int bootToTaskTimeMillis = 600 + bootCompensationMillis;
     /** Time in milliseconds to wakeup before an event */
     const int preEventMillis = peripheralEnStartupMillis + peripheralExtSupplyMillis + sensorBatReadoutTimeMillis + 5000;
-    /** Time in milliseconds to wakeup before an event in case of deep sleep */
+    /** Time in milliseconds to wakeup before an event in case of deep sleep.
+     * Worst case, which is only used until wakeCalibrator has learned the actual margin. */
     const int preEventMillisDeepSleep = wifiConnectedWaitMillis + peripheralEnStartupMillis + peripheralExtSupplyMillis +
         sensorBatReadoutTimeMillis + bootToTaskTimeMillis + 5000;
 
@@ -144,13 +230,21 @@ private:
     int fillLevelLowThresholdPercent10 = 6;
     int fillLevelHysteresisPercent10 = 1;
 
+    /** Changes of the fill level smaller than this aren't published */
+    int fillLevelDeadbandPercent10 = 10;
+
     /** Can be set to disable the battery check when irrigating */
     bool disableBatteryCheck = true;
+    /** Changes of the battery voltage smaller than this aren't published */
+    int battVoltageDeadbandMilli = 100;
+
+    /** Encoding of the state and state delta topics */
+    payload_encoding_t stateEncoding = PAYLOAD_JSON;
+    /** Encoding of the telemetry topic */
+    payload_encoding_t telemetryEncoding = PAYLOAD_JSON;
 
     /** Internal state representation */
     state_t state;
-    /** Internal state representation (as sent via MQTT the last time) */
-    state_t lastState;
 
     // MQTT related state/data
     bool mqttPrepared = false;
@@ -159,48 +253,72 @@ private:
     /** MQTT topic postfix for state information (i.e. the part after the MAC address) */
     const char* mqttStateTopicPost = "/state";
 
-    /** MQTT state update data format.
-     * Needed format specifiers (in this order!):
-     * - \%u Battery voltage in mV,
-     * - \%u Battery state (0..4),
-     * - \%s Battery state string representation,
-     * - \%d Reservoir fill level (multiplied by 10),
-     * - \%u Reservoir state (0..3),
-     * - \%s Reservoir state string representation,
-     * - \%s Next irrigation event occurance ('YYYY-MM-DD HH:MM:SS')
-     * - \%s Active outputs array (list of unsigned integers)
-     * - \%s Active outputs array (list of names)
-     */
-    const char* mqttStateDataFmt = "{\n  \"batteryVoltage\": %u,\n  \"batteryState\": %u,\n"
-        "  \"batteryStateStr\": \"%s\",\n"
-        "  \"reservoirFillLevel\": %d,\n  \"reservoirState\": %u,\n  \"reservoirStateStr\": \"%s\",\n"
-        "  \"activeOutputs\": [%s],\n"
-        "  \"activeOutputsStr\": [%s],\n"
-        "  \"nextIrrigationEvent\": \"%s\",\n"
-        "  \"sntpLastSync\": \"%s\",\n"
-        "  \"sntpNextSync\": \"%s\"\n"
-        "}";
     /** Buffer for the state topic. Will be allocated in constructor and freed in the destructor. */
     char* mqttStateTopic;
+    /** MQTT topic postfix for the changed fields of state updates (i.e. the part after the MAC address) */
+    const char* mqttStateDeltaTopicPost = "/statedelta";
+    /** Buffer for the state delta topic. Will be allocated in constructor and freed in the destructor. */
+    char* mqttStateDeltaTopic;
     /** Buffer for the state data. Will be allocated in constructor and freed in the destructor. */
     char* mqttStateData;
-    /** Maximum allowed length of the state data.
-     * Will be determined by the constructor. Assumption: 5 digits for battery voltage (mV),
-     * 1 digit for battery state, 8 digits for battery state string,
-     * 4 digits for (fillLevel * 10), 1 digit for reservoir state,
-     * 8 digits for reservoir state string,
-     * 2 digits per active output + ', ' as seperator,
-     * 6 digits per active output string + ', ' as seperator,
-     * 19 digits for the next event datetime,
-     * 19 digits for the next SNTP sync datetime,
-     * 19 digits for the last SNTP sync datetime. */
+    /** MQTT topic postfix for statistics (i.e. the part after the MAC address) */
+    const char* mqttStatsTopicPost = "/stats";
+    /** Buffer for the statistics topic. Will be allocated in constructor and freed in the destructor. */
+    char* mqttStatsTopic;
+    /** Maximum length of the formatted statistics data (compact JSON, see formatEventLatencyStats()) */
+    static const size_t mqttStatsDataMaxLen = 640;
+
+    /** MQTT topic postfix for the wake profile (i.e. the part after the MAC address) */
+    const char* mqttProfileTopicPost = "/wakeprofile";
+    /** Buffer for the wake profile topic. Will be allocated in constructor and freed in the destructor. */
+    char* mqttProfileTopic;
+    /** Maximum length of the formatted wake profile (compact JSON, see WakeProfiler::formatAggregates()) */
+    static const size_t mqttProfileDataMaxLen = 768;
+
+    /** MQTT topic postfix for the batched telemetry (i.e. the part after the MAC address) */
+    const char* mqttTelemetryTopicPost = "/telemetry";
+    /** Buffer for the telemetry topic. Will be allocated in constructor and freed in the destructor. */
+    char* mqttTelemetryTopic;
+    /** Maximum length of the formatted telemetry batch (compact JSON, see formatTelemetryBatch()) */
+    static const size_t mqttTelemetryDataMaxLen = 40 + telemetryBatchSize * 36;
+
+    /** Profiler of the wake cycle phases */
+    WakeProfiler wakeProfiler;
+    /** Learns the deep sleep wakeup margin before events */
+    WakeCalibrator wakeCalibrator;
+
+    /** Protects the event latency stats, which the console reads concurrently */
+    portMUX_TYPE latencyStatsMux;
+    /** Inclusive upper bounds of the latency histogram buckets. The last bucket is open. */
+    static const uint32_t latencyBucketUpperMillis[latencyBucketCount - 1];
+    /** Latency above which an event is reported as processed late */
+    const uint32_t latencyWarnMillis = 1000;
+
+    /** Size of the state data buffer, i.e. the exact length of the longest possible full
+     * snapshot incl. the terminating zero. Will be determined by the constructor. */
     size_t mqttStateDataMaxLen;
 
     static void taskFuncDispatch(void* params);
     void taskFunc();
-    void setZoneOutputs(bool irrigOk, irrigation_zone_cfg_t* zoneCfg, bool start);
+    void setZoneOutputs(bool irrigOk, const irrigation_zone_cfg_t* zoneCfg, bool start);
     void updateStateActiveOutputs(uint32_t chNum, bool active);
+    size_t getStateDataMaxLen(void) const;
     void publishStateUpdate();
+    bool publishState(const char* topic, uint32_t fields, bool retain);
+    bool prepareMqttTopics(void);
+    static void buildMqttTopic(char* topic, const char* pre, const uint8_t* macAddr, const char* post);
+
+    void recordEventLatency(bool isStart, time_t plannedTime, int64_t actualMillis);
+    static void addLatencyToHistogram(latency_histogram_t* hist, uint32_t latencyMillis, time_t plannedTime);
+    void publishStatsUpdate();
+    void publishProfileUpdate();
+
+    bool waitNetwork(void);
+    void recordTelemetry(void);
+    size_t formatTelemetryBatch(char* buf, size_t bufLen) const;
+    size_t encodeTelemetryBatch(uint8_t* buf, size_t bufLen) const;
+    void publishTelemetryBatch(void);
+    void planNextWake(bool eventWake, int sleepMillis);
 
     static void timeSytemEventsHookDispatch(void* param, time_system_event_t events);
     void timeSytemEventHandler(time_system_event_t events);
@@ -7,6 +7,8 @@
 #include <vector>
 
 #include "irrigationZoneCfg.h"
+#include "irrigationCapacity.h"
+#include "solarTable.h"
 
 /**
  * @brief The IrrigationEvent class is a utility class to represent irrigation events.
@@ -29,22 +31,82 @@ public:
         IrrigationEvent*    parentPtr;      /**< Pointer to the parent object containing the event data */
     } irrigation_event_data_t;
 
+    /**
+     * Compiled cron-style recurrence. Bit n of each mask represents the value n of the
+     * corresponding field. An occurance is scheduled at every combination of the set bits.
+     * Note: In contrast to cron, day of month and day of week must both match.
+     */
+    typedef struct recurrence_t {
+        uint64_t            minutes;        /**< Minutes of the hour 0..59 */
+        uint32_t            hours;          /**< Hours of the day 0..23 */
+        uint32_t            daysOfMonth;    /**< Days of the month 1..31 */
+        uint16_t            months;         /**< Months 1..12 */
+        uint8_t             weekdays;       /**< Days of the week 0..6, 0 = sunday */
+        uint8_t             second;         /**< Second of the minute 0..59 */
+    } recurrence_t;
+
+    /**
+     * Definition of an event, i.e. its configured state without the reference time and
+     * caches. It is compact plain data, so validated events can be stored in binary form.
+     */
+    typedef struct event_definition_t {
+        recurrence_t        recurrence;     /**< Compiled recurrence of WEEKLY, MONTHLY and RECURRENCE events */
+        uint32_t            durationSecs;   /**< Duration the channel configuration shall be kept active */
+        int32_t             solarOffsetSecs;/**< Offset of SOLAR events relative to the solar event */
+        int16_t             zoneIdx;        /**< Associated zone configuration index */
+        int16_t             year;           /**< Year of SINGLE events */
+        uint8_t             month;          /**< Month 1..12 of SINGLE events */
+        uint8_t             day;            /**< Day of the month 1..31 of SINGLE events */
+        uint8_t             hour;           /**< Time of day of SINGLE and DAILY events */
+        uint8_t             minute;
+        uint8_t             second;
+        uint8_t             repetitionType; /**< Repetition type, see repetition_type_t */
+        uint8_t             solarEvent;     /**< Solar event SOLAR events are anchored to */
+        bool                isStart;        /**< Wether or not this is an irrigation start event */
+    } event_definition_t;
+
+    static constexpr uint64_t recurrenceAllMinutes = 0x0FFFFFFFFFFFFFFFull;
+    static constexpr uint32_t recurrenceAllHours = 0x00FFFFFFul;
+    static constexpr uint32_t recurrenceAllDaysOfMonth = 0xFFFFFFFEul;
+    static constexpr uint16_t recurrenceAllMonths = 0x1FFE;
+    static constexpr uint8_t recurrenceAllWeekdays = 0x7F;
+
+    /** Maximum offset of SOLAR events in seconds */
+    static const int solarMaxOffsetSecs = 12 * 60 * 60;
+
+    /** Number of slots of a day coverage (see addDayCoverage()), i.e. minutes of a day */
+    static constexpr unsigned int dayCoverageSlots = 24 * 60;
+    /**
+     * Irrigations are cut to this length in a day coverage. Repetitions occur at least weekly,
+     * so only coverages of more than 52 concurrent irrigations are lowered.
+     */
+    static constexpr int64_t dayCoverageMaxLenSecs = 366 * 24 * 60 * 60;
+
     IrrigationEvent(void);
     ~IrrigationEvent(void);
 
     void setDuration(unsigned int secs);
     err_t setZoneIndex(int idx);
     void setStartFlag(bool isStart);
-    err_t getEventData(irrigation_event_data_t* dest);
+    err_t getEventData(irrigation_event_data_t* dest) const;
 
     err_t setSingleEvent(int hour, int minute, int second, int day, int month, int year);
     err_t setDailyRepetition(int hour, int minute, int second);
-    //void setWeeklyRepetition();
-    //void setMonthlyRepetition();
+    err_t setWeeklyRepetition(int hour, int minute, int second, uint8_t weekdays);
+    err_t setMonthlyRepetition(int hour, int minute, int second, int day);
+    err_t setRecurrence(const recurrence_t& rec);
+    err_t setSolarRepetition(SolarTable::solar_event_t event, int offsetSecs);
+
+    void getDefinition(event_definition_t* dest) const;
+    err_t setDefinition(const event_definition_t& def);
 
     void updateReferenceTime(time_t ref);
     time_t getReferenceTime(void);
     time_t getNextOccurance(void) const;
+    time_t calcNextOccurance(time_t ref) const;
+    bool isRepeating(void) const;
+
+    void addDayCoverage(int32_t* coverage, int weekday, int32_t dstGapStartSecs, int32_t dstGapSecs) const;
 
     bool operator==(const IrrigationEvent& rhs) const;
     bool operator!=(const IrrigationEvent& rhs) const;
@@ -60,13 +122,38 @@ private:
         DAILY = 2,
         WEEKLY = 3,
         MONTHLY = 4,
+        RECURRENCE = 5,
+        SOLAR = 6,
     } repetition_type_t;
 
     repetition_type_t repetitionType;               /**< Stores the repetition type of this event */
     irrigation_event_data_t eventData;              /**< Stores associated event data */
     struct tm eventTime;                            /**< Stores the time info of this event. Note: Its fields are only sparsely used. */
+    recurrence_t recurrence;                        /**< Stores the compiled recurrence of WEEKLY, MONTHLY and RECURRENCE events */
+    SolarTable::solar_event_t solarEvent;           /**< Stores the solar event SOLAR events are anchored to */
+    int32_t solarOffsetSecs;                        /**< Stores the offset of SOLAR events relative to the solar event */
 
     time_t refTime;                                 /**< Stores the reference time for time comparisions and the next occurance */
+
+    mutable time_t nextOccuranceCache;              /**< Stores the last calculated next occurance for refTime */
+    mutable bool nextOccuranceCacheValid;           /**< Flag weather or not nextOccuranceCache matches refTime and the event definition */
+    mutable uint32_t nextOccuranceCacheTzGen;       /**< Timezone rule generation nextOccuranceCache was calculated with */
+    mutable uint32_t nextOccuranceCacheSolarGen;    /**< Solar table generation nextOccuranceCache was calculated with */
+
+    /** Maximum number of months searched for the next match of a recurrence (i.e. a full leap year/weekday cycle) */
+    static const int recurrenceSearchMaxMonths = 28 * 12;
+    /** Maximum number of days searched for the next solar event (i.e. longer than a polar night) */
+    static const int solarSearchMaxDays = solarTableNumDays + 2;
+
+    time_t calcNextRecurrence(time_t ref) const;
+    time_t calcNextSolarEvent(time_t ref) const;
+    bool findRecurrenceTimeOfDay(int fromHour, int fromMinute, int* hour, int* minute) const;
+    uint32_t getRecurrenceDayMask(int year, int month) const;
+
+    static int nextSetBit(uint64_t mask, int from);
+    static void addDayCoverageInterval(int32_t* coverage, int weekday, uint8_t weekdays, bool repeating,
+        int32_t startSecs, int64_t lenSecs, int32_t dstGapStartSecs, int32_t dstGapSecs);
+    static void addDayCoverageSlots(int32_t* coverage, int32_t firstSlot, int32_t lastSlot, int32_t count);
 };
 
 #endif /* IRRIGATION_EVENT_H */
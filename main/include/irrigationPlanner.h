@@ -8,19 +8,43 @@
 #include "esp_log.h"
 
 #include "irrigationEvent.h"
+#include "civilTime.h"
+#include "irrigationCapacity.h"
+#include "fixedBlockPool.h"
 #include "hardwareConfig.h"
 
 /** Number of configurable irrigation zones. */
-constexpr unsigned int irrigationPlannerNumZones = 8;
+constexpr unsigned int irrigationPlannerNumZones = IrrigationCapacity::numZones;
 /** Number of regular irrigation events. */
-constexpr unsigned int irrigationPlannerNumNormalEvents = 4*irrigationPlannerNumZones;
+constexpr unsigned int irrigationPlannerNumNormalEvents = IrrigationCapacity::numNormalEvents;
 /** Number of temporary single shot irrigation events. */
-constexpr unsigned int irrigationPlannerNumSingleShotEvents = 1;
+constexpr unsigned int irrigationPlannerNumSingleShotEvents = IrrigationCapacity::numSingleShotEvents;
 
 /** Number of irrigation events. */
-static constexpr unsigned int irrigationPlannerNumEvents = irrigationPlannerNumNormalEvents + irrigationPlannerNumSingleShotEvents;
-/** Number of irrigation stop events. */ // TBD: raise to numEvents + 1 ?
-static constexpr unsigned int irrigationPlannerNumStopEvents = irrigationPlannerNumZones + irrigationPlannerNumSingleShotEvents;
+static constexpr unsigned int irrigationPlannerNumEvents = IrrigationCapacity::numEvents;
+/** Number of irrigation stop events available to the regular events, i.e. the maximum number of overlapping irrigations. */
+static constexpr unsigned int irrigationPlannerNumConfigStopEvents = IrrigationCapacity::numConfigStopEvents;
+/** Number of irrigation stop events. */
+static constexpr unsigned int irrigationPlannerNumStopEvents = IrrigationCapacity::numStopEvents;
+/** Number of entries the timeline of upcoming events can hold. */
+static constexpr unsigned int irrigationPlannerNumTimelineEntries = IrrigationCapacity::numTimelineEntries;
+
+/** Storage of the regular events as configured, indexed by their position in the configuration. */
+typedef FixedBlockPool<IrrigationEvent, irrigationPlannerNumNormalEvents> IrrigationConfigEventPool;
+/** Storage of the single shot events. Their event handles are located above the ones of the regular events. */
+typedef FixedBlockPool<IrrigationEvent, irrigationPlannerNumSingleShotEvents> IrrigationSingleShotEventPool;
+/** Storage of the stop events, indexed by event handle. */
+typedef FixedBlockPool<IrrigationEvent, irrigationPlannerNumStopEvents> IrrigationStopEventPool;
+
+/**
+ * Snapshot of the irrigation configuration. Snapshots are published by the SettingsManager
+ * and are immutable as long as they are acquired (see SettingsManager::acquireIrrigationConfig()).
+ */
+typedef struct irrigation_config_t {
+    irrigation_zone_cfg_t zones[irrigationPlannerNumZones];         /**< Irrigation zone configurations. */
+    IrrigationConfigEventPool events;                               /**< Irrigation events, indexed by their position in the configuration. */
+    uint32_t generation;                                            /**< Incremented with each published configuration. */
+} irrigation_config_t;
 
 /**
  * @brief The IrrigationPlanner class is a manager of IrrigationEvents. It is used
@@ -45,6 +69,14 @@ public:
         bool isStart;
     } event_handle_t;
 
+    /** Record of a dispatched event, containing everything needed to perform its actions. */
+    typedef struct due_event_t {
+        IrrigationEvent::irrigation_event_data_t eventData;        /**< Data of the event */
+        irrigation_zone_cfg_t zoneCfg;                              /**< Configuration of the zone the event belongs to */
+        bool zoneCfgValid;                                          /**< Wether or not zoneCfg is valid */
+        err_t confirmErr;                                           /**< Result of confirming the event, e.g. ERR_NO_STOP_SLOT_AVAIL */
+    } due_event_t;
+
     typedef void(*IrrigConfigUpdateHookFncPtr)(void*);
 
     IrrigationPlanner();
@@ -54,8 +86,11 @@ public:
     err_t getEventHandles(time_t eventTime, event_handle_t* dest, unsigned int maxElements);
     err_t getEventData(event_handle_t handle, IrrigationEvent::irrigation_event_data_t* dest);
     err_t confirmEvent(event_handle_t handle);
+    err_t dispatchDueEvents(time_t eventTime, const due_event_t** events, unsigned int* numEvents);
     err_t getZoneConfig(int idx, irrigation_zone_cfg_t* cfg);
 
+    static unsigned int calcMaxStopEvents(const IrrigationConfigEventPool& events, const CivilTime& timezone);
+
     err_t setConfigLock(bool lockState);
     bool getConfigLock();
 
@@ -66,13 +101,10 @@ public:
 private:
     const char* logTag = "irrig_planner";
 
-    irrigation_zone_cfg_t zones[irrigationPlannerNumZones];         /**< Storage holding irrigation zone configurations. */
-
-    IrrigationEvent events[irrigationPlannerNumEvents];             /**< Storage holding irrigation events. */
-    bool eventsUsed[irrigationPlannerNumEvents];                    /**< Flag weather or not the corresponding event storage is used. */
+    const irrigation_config_t* config;                              /**< Pinned configuration snapshot, nullptr if none is available yet. */
 
-    IrrigationEvent stopEvents[irrigationPlannerNumStopEvents];     /**< Storage holding irrigation stop events. */
-    bool stopEventsUsed[irrigationPlannerNumStopEvents];            /**< Flag weather or not the corresponding stop event storage is used. */
+    IrrigationSingleShotEventPool singleShotEvents;                 /**< Storage holding single shot irrigation events. */
+    IrrigationStopEventPool stopEvents;                             /**< Storage holding irrigation stop events. */
 
     bool configLock;                                                /**< Flag weather or not the config should be locked from updates. */
     bool configUpdatedDuringLock;                                   /**< Flag weather or not a config update happend during a locked phase. */
@@ -88,11 +120,42 @@ private:
     SemaphoreHandle_t hookMutex;
     StaticSemaphore_t hookMutexBuf;
 
-    int getNextEventIdx(time_t startTime, IrrigationEvent* eventList, bool* eventUsedList, unsigned int listElements);
-    void printEventDetails(IrrigationEvent* evt);
+    /** Entry of the timeline of upcoming events. */
+    typedef struct timeline_entry_t {
+        time_t time;                                                /**< Next occurance of the event */
+        event_handle_t handle;                                      /**< Handle of the event */
+    } timeline_entry_t;
+
+    timeline_entry_t timeline[irrigationPlannerNumTimelineEntries]; /**< Min-heap of upcoming events, ordered by their next occurance. */
+    unsigned int timelineLen;                                       /**< Number of entries in the timeline. */
+    int timelinePosStart[irrigationPlannerNumEvents];               /**< Timeline position of each start event, -1 if not contained. */
+    int timelinePosStop[irrigationPlannerNumStopEvents];            /**< Timeline position of each stop event, -1 if not contained. */
+    time_t timelineRefTime;                                         /**< Reference time the timeline is valid for. */
+    bool timelineValid;                                             /**< Flag weather or not the timeline needs to be rebuilt. */
+    uint32_t timelineTzGen;                                         /**< Timezone rule generation the timeline was built with. */
+    uint32_t timelineSolarGen;                                      /**< Solar table generation the timeline was built with. */
+
+    due_event_t dueEvents[irrigationPlannerNumTimelineEntries];     /**< Storage of the events returned by dispatchDueEvents. */
+
+    unsigned int collectEventHandles(time_t eventTime, event_handle_t* dest);
+
+    void rebuildTimeline(time_t refTime);
+    time_t timelineCalcNext(event_handle_t handle, time_t refTime);
+    void timelineUpdate(event_handle_t handle, time_t refTime);
+    void timelineRemove(event_handle_t handle);
+    void timelineSiftUp(unsigned int pos);
+    void timelineSiftDown(unsigned int pos);
+    void timelineSwap(unsigned int a, unsigned int b);
+    int* getTimelinePosPtr(event_handle_t handle);
+    const IrrigationEvent* getEventPtr(event_handle_t handle);
+    bool isValidHandle(event_handle_t handle);
+
+    void switchConfig();
+
+    void printEventDetails(const IrrigationEvent* evt);
     void printAllEvents();
 
-    bool confirmNormalEvent(unsigned int idx);
+    bool confirmNormalEvent(unsigned int idx, time_t occurance);
     void confirmStopEvent(unsigned int idx);
 };
 
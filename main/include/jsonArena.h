@@ -0,0 +1,76 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+
+/**
+ * @brief The JsonArena class provides the memory for the cJSON trees of a request, e.g.
+ * a received hardware config, from a fixed size buffer. Allocations just advance an
+ * offset, frees don't do anything and all memory of a request is reclaimed at once by
+ * release(). So received JSON doesn't fragment the heap, and a missing cJSON_Delete()
+ * can't leak.
+ *
+ * The arena installs itself as cJSON allocator on construction, hence there must only be
+ * one instance. It only serves the task which acquired it; cJSON use by other tasks or
+ * outside of acquire()/release() is served by the heap as before. If a request doesn't
+ * fit into the arena, the allocation fails and cJSON reports an error.
+ */
+class JsonArena
+{
+public:
+    typedef enum err_t {
+        ERR_OK = 0,
+        ERR_TIMEOUT = -1
+    } err_t;
+
+    typedef struct json_arena_stats_t {
+        uint32_t requests;                              /**< Number of releases, i.e. completed requests */
+        uint32_t failedAllocs;                          /**< Allocations which didn't fit into the arena */
+        uint32_t lastUsed;                              /**< Bytes used by the last request */
+        uint32_t highWater;                             /**< Max. bytes used by a request since boot */
+    } json_arena_stats_t;
+
+    static const size_t arenaSize = 8192;
+
+    JsonArena();
+    ~JsonArena();
+
+    err_t acquire(TickType_t timeout);
+    void release(void);
+    bool isExhausted(void) const;
+    void getStats(json_arena_stats_t* stats);
+
+private:
+    const char* logTag = "json_arena";
+
+    /** cJSON nodes contain a double */
+    static const size_t allocAlign = 8;
+
+    static JsonArena* instance;                         /**< cJSON hooks have no parameter */
+
+    SemaphoreHandle_t mutex;
+    StaticSemaphore_t mutexBuf;
+    TaskHandle_t owner;                                 /**< Task which acquired the arena, nullptr if it is free */
+    size_t used;
+    bool exhausted;                                     /**< Wether or not an allocation of the current request failed */
+
+    json_arena_stats_t stats;
+    portMUX_TYPE statsMux;
+
+    alignas(allocAlign) uint8_t buffer[arenaSize];
+
+    void* alloc(size_t size);
+    bool contains(const void* ptr) const;
+
+    static void* mallocHook(size_t size);
+    static void freeHook(void* ptr);
+};
+
+#endif /* JSON_ARENA_H */
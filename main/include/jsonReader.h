@@ -0,0 +1,115 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief The JsonReader class tokenizes JSON in a single pass and reports each token to
+ * a handler (SAX style), without building a tree or allocating memory.
+ *
+ * The input may be fed in chunks of any size, e.g. while reading a file. Tokens split
+ * across chunks are reassembled internally, so the caller doesn't need to keep the input.
+ *
+ * Only integer numbers fitting into an int32_t are supported; fractions and exponents
+ * are reported as ERR_NUMBER. Numbers with leading zeros are invalid JSON. Strings longer
+ * than maxStringLen are truncated. Trailing zero bytes after the top level value are
+ * ignored.
+ */
+class JsonReader
+{
+public:
+    typedef enum err_t {
+        ERR_OK = 0,
+        ERR_SYNTAX = -1,
+        ERR_NUMBER = -2,
+        ERR_DEPTH = -3,
+        ERR_INCOMPLETE = -4
+    } err_t;
+
+    typedef enum token_type_t {
+        TOKEN_OBJECT_START = 0,
+        TOKEN_OBJECT_END,
+        TOKEN_ARRAY_START,
+        TOKEN_ARRAY_END,
+        TOKEN_KEY,
+        TOKEN_STRING,
+        TOKEN_NUMBER,
+        TOKEN_BOOL,
+        TOKEN_NULL
+    } token_type_t;
+
+    typedef struct token_t {
+        token_type_t type;
+        unsigned int depth;         /**< Number of enclosing objects and arrays, i.e. 1 for keys and values of the top level object */
+        size_t offset;              /**< Input offset of the first char of the token */
+        size_t endOffset;           /**< Input offset after the last char of the token */
+        const char* str;            /**< Zero terminated key or string, nullptr for other tokens */
+        bool truncated;             /**< Wether or not the key or string has been truncated */
+        int32_t intVal;             /**< Value of a number */
+        bool boolVal;               /**< Value of a bool */
+    } token_t;
+
+    typedef void(*TokenHandlerFncPtr)(void*, const token_t*);
+
+    /** Maximum nesting of objects and arrays */
+    static const unsigned int maxDepth = 16;
+    /** Maximum length of keys and strings, longer ones are truncated */
+    static const unsigned int maxStringLen = 31;
+
+    JsonReader(TokenHandlerFncPtr handler, void* handlerParam);
+
+    err_t feed(const char* data, size_t len);
+    err_t finish(void);
+
+private:
+    typedef enum state_t {
+        STATE_VALUE = 0,            /**< Expecting a value */
+        STATE_VALUE_OR_END,         /**< Expecting the first value of an array or its end */
+        STATE_KEY,                  /**< Expecting a key */
+        STATE_KEY_OR_END,           /**< Expecting the first key of an object or its end */
+        STATE_COLON,                /**< Expecting the colon after a key */
+        STATE_SEPARATOR_OR_END,     /**< Expecting a comma or the end of the enclosing object / array */
+        STATE_STRING,               /**< Inside a key or string */
+        STATE_STRING_ESCAPE,        /**< After a backslash inside a key or string */
+        STATE_STRING_UNICODE,       /**< Inside a \\u escape sequence */
+        STATE_NUMBER,               /**< Inside a number */
+        STATE_LITERAL,              /**< Inside true, false or null */
+        STATE_DONE                  /**< The top level value is complete */
+    } state_t;
+
+    err_t processChar(char c);
+    err_t startValue(char c);
+    err_t endValue(void);
+    err_t endNumber(void);
+    void appendChar(char c);
+    err_t appendCodepoint(uint32_t codepoint);
+    void emit(token_type_t type);
+
+    TokenHandlerFncPtr handler;
+    void* handlerParam;
+
+    state_t state;
+    err_t err;
+    size_t offset;                  /**< Input offset of the char being processed */
+    unsigned int depth;
+    uint32_t isObject;              /**< Bit n is set if the container at depth n is an object */
+
+    size_t tokenOffset;
+    char str[maxStringLen+1];
+    unsigned int strLen;
+    bool strTruncated;
+    bool strIsKey;
+    uint32_t codepoint;
+    uint32_t highSurrogate;         /**< Pending high surrogate of a surrogate pair, 0 if none */
+    unsigned int numHexDigits;
+
+    uint32_t numMagnitude;
+    bool numNegative;
+    bool numHasDigits;
+
+    const char* literal;
+    unsigned int literalPos;
+};
+
+#endif /* JSON_READER_H */
@@ -0,0 +1,56 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief The JsonWriter class emits compact JSON into a caller provided buffer in a
+ * single pass, without allocating memory or formatting via printf.
+ *
+ * Separators are inserted automatically. Values inside objects need a key, the ones
+ * inside arrays (or at the top level) take nullptr instead.
+ *
+ * Like snprintf, the output is always zero terminated and the writer keeps counting
+ * if the buffer is too small. getLength() is the exact length of the complete output,
+ * so a writer without buffer (nullptr, 0) can be used to size one.
+ *
+ * Objects and arrays nested deeper than maxDepth are an error, as their separators
+ * can't be tracked. The output is discarded and getLength() returns SIZE_MAX, so it is
+ * rejected like a truncated one.
+ */
+class JsonWriter
+{
+public:
+    /** Maximum nesting of objects and arrays */
+    static const unsigned int maxDepth = 16;
+    static_assert(maxDepth < 32, "hasItems needs a bit per depth");
+
+    JsonWriter(char* buf, size_t bufLen);
+
+    void startObject(const char* key);
+    void endObject(void);
+    void startArray(const char* key);
+    void endArray(void);
+    void addUint(const char* key, uint64_t val);
+    void addInt(const char* key, int64_t val);
+    void addString(const char* key, const char* str);
+
+    size_t getLength(void) const;
+
+private:
+    void startContainer(const char* key, char c);
+    void startValue(const char* key);
+    void putChar(char c);
+    void putEscaped(const char* str);
+    void putUint(uint64_t val);
+
+    char* buf;
+    size_t bufLen;
+    size_t len;
+    unsigned int depth;
+    uint32_t hasItems;          /**< Bit n is set if the container at depth n has items already */
+    bool depthExceeded;         /**< Wether or not a container exceeded maxDepth */
+};
+
+#endif /* JSON_WRITER_H */
@@ -0,0 +1,46 @@
+#ifndef MQTT_PAYLOAD_H
+#define MQTT_PAYLOAD_H
+
+/**
+ * Encodings and CBOR layouts of the MQTT payloads. This header is shared with the host
+ * side decoder (see tools/mqttPayloadDecode.cpp), so it must not depend on anything else.
+ */
+
+/** Encoding of an MQTT payload */
+typedef enum {
+    PAYLOAD_JSON = 0,           /**< Compact JSON with named fields (default) */
+    PAYLOAD_CBOR = 1            /**< CBOR (RFC 7049) with integer keys, enum codes and epoch times */
+} payload_encoding_t;
+
+#define PAYLOAD_ENCODING_TO_STR(enc) (\
+    (enc == PAYLOAD_JSON) ? "json" : \
+    (enc == PAYLOAD_CBOR) ? "cbor" : \
+    "UNKNOWN" \
+)
+
+/**
+ * Keys of the CBOR encoded state (map of key to value). The values are unsigned
+ * integers, except for the fill level (signed integer) and the active outputs
+ * (array of unsigned integers). Times are seconds since the epoch.
+ * A state delta only contains the changed keys.
+ */
+typedef enum {
+    STATE_KEY_BATT_VOLTAGE = 0,         /**< Battery voltage in mV */
+    STATE_KEY_BATT_STATE = 1,           /**< Battery state code */
+    STATE_KEY_FILL_LEVEL = 2,           /**< Fill level in percent multiplied by 10 */
+    STATE_KEY_RESERVOIR_STATE = 3,      /**< Reservoir state code */
+    STATE_KEY_ACTIVE_OUTPUTS = 4,       /**< Active output channel numbers */
+    STATE_KEY_NEXT_EVENT = 5,           /**< Next irrigation event */
+    STATE_KEY_SNTP_LAST_SYNC = 6,       /**< Last SNTP sync */
+    STATE_KEY_SNTP_NEXT_SYNC = 7,       /**< Next SNTP sync */
+    STATE_KEY_COUNT
+} state_key_t;
+
+/**
+ * Number of items of a CBOR encoded telemetry sample. The telemetry batch is an array
+ * of samples, oldest first. Each sample is an array of time, battery voltage, fill level,
+ * battery state and reservoir state, like in the JSON encoding.
+ */
+static const unsigned int telemetrySampleItems = 5;
+
+#endif /* MQTT_PAYLOAD_H */
@@ -20,6 +20,8 @@
 
 #include "user_config.h"
 
+#include "seqLock.h"
+
 #define BATT_STATE_TO_STR(state) (\
     (state == PowerManager::BATT_FULL) ? "FULL" : \
     (state == PowerManager::BATT_OK) ? "OK" : \
@@ -51,14 +53,13 @@ private:
 
     bool keepAwakeAtBootState;
 
-    const TickType_t lockAcquireTimeout = pdMS_TO_TICKS(1000);          /**< Maximum lock acquisition time in OS ticks. */
-
-    SemaphoreHandle_t configMutex;
-    StaticSemaphore_t configMutexBuf;
+    typedef struct batt_thresholds_t {
+        int battCriticalThresholdMilli;
+        int battLowThresholdMilli;
+        int battOkThresholdMilli;
+    } batt_thresholds_t;
 
-    int battCriticalThresholdMilli = 1;
-    int battLowThresholdMilli = 2;
-    int battOkThresholdMilli = 3;
+    SeqLock<batt_thresholds_t> battThresholds;
 
 public:
     typedef enum {
@@ -2,8 +2,11 @@
 #define SETTINGS_MANAGER_H
 
 #include <stdint.h>
+#include <stdio.h>
+#include <atomic>
 
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/semphr.h"
 
 #include "esp_log.h"
@@ -14,9 +17,14 @@
 #include "outputController.h" // needed for CH_MAIN, ...
 
 #include "hardwareConfig.h"
+#include "civilTime.h"
+#include "solarTable.h"
+#include "mqttPayload.h"
 
 #include "cJSON.h"
 
+#include "seqLock.h"
+
 /**
  * @brief The SettingsManager class is a manager of all changable settings of the system.
  * It manages storage, reception of new settings and notification of changes.
@@ -40,6 +48,7 @@ public:
         int battCriticalThresholdMilli;
         int battLowThresholdMilli;
         int battOkThresholdMilli;
+        int battVoltageDeadbandMilli;               /**< Battery voltage changes smaller than this aren't published */
     } battery_config_t;
 
     typedef struct reservoir_config_t {
@@ -49,14 +58,57 @@ public:
         int fillLevelCriticalThresholdPercent10;
         int fillLevelLowThresholdPercent10;
         int fillLevelHysteresisPercent10;
+        int fillLevelDeadbandPercent10;             /**< Fill level changes smaller than this aren't published */
     } reservoir_config_t;
 
+    typedef struct time_config_t {
+        char timezone[civilTimeTzRuleMaxLen+1];     /**< POSIX TZ rule of the local timezone */
+    } time_config_t;
+
+    typedef struct location_config_t {
+        bool enabled;                               /**< Wether or not a location is configured */
+        int32_t latitudeMicroDeg;                   /**< Latitude in micro degrees (north positive) */
+        int32_t longitudeMicroDeg;                  /**< Longitude in micro degrees (east positive) */
+    } location_config_t;
+
+    typedef struct mqtt_config_t {
+        payload_encoding_t stateEncoding;           /**< Encoding of the state and state delta topics */
+        payload_encoding_t telemetryEncoding;       /**< Encoding of the telemetry topic */
+    } mqtt_config_t;
+
+    /** Storable form of an event of the configuration, see config_image_data_t */
+    typedef struct config_image_event_t {
+        IrrigationEvent::event_definition_t definition;
+        uint32_t idx;                               /**< Index of the event in the configuration */
+    } config_image_event_t;
+
+    /** Storable form of the configuration. It is followed by the records of the used events. */
+    typedef struct alignas(config_image_event_t) config_image_data_t {
+        battery_config_t battery;
+        reservoir_config_t reservoir;
+        time_config_t time;
+        location_config_t location;
+        mqtt_config_t mqtt;
+        irrigation_zone_cfg_t zones[irrigationPlannerNumZones];
+        uint32_t numEvents;                         /**< Number of event records following the data */
+    } config_image_data_t;
+
+    /** Statistics of the config store writes, kept in RTC memory across deep sleep. */
+    typedef struct config_store_stats_t {
+        uint32_t requests;                          /**< Requests to store a config persistently */
+        uint32_t writes;                            /**< Files written */
+        uint32_t skippedWrites;                     /**< Writes skipped, because the file had the same content already */
+        uint32_t failedWrites;                      /**< Writes failed */
+        uint32_t bytesWritten;                      /**< Bytes written, excluding skipped writes */
+    } config_store_stats_t;
+
     typedef void(*ConfigUpdatedHookFncPtr)(void*);
 
     SettingsManager();
     ~SettingsManager();
 
     void init();
+    void start();
 
     err_t updateIrrigationConfig(const char* const jsonData, int jsonDataLen, bool noNotify);
     err_t readIrrigationConfigFile();
@@ -64,9 +116,23 @@ public:
     err_t updateHardwareConfig(const char* const jsonData, int jsonDataLen, bool noNotify);
     err_t readHardwareConfigFile();
 
-    err_t copyZonesAndEvents(irrigation_zone_cfg_t* zones, IrrigationEvent* events, bool* eventsUsed);
+    err_t mountConfigStore();
+
+    err_t loadConfigImage();
+    err_t storeConfigImage();
+    err_t loadConfigRtcCopy();
+
+    const irrigation_config_t* acquireIrrigationConfig();
+    void releaseIrrigationConfig(const irrigation_config_t* config);
     err_t copyBatteryConfig(battery_config_t* dst);
     err_t copyReservoirConfig(reservoir_config_t* dst);
+    err_t copyTimeConfig(time_config_t* dst);
+    err_t copyLocationConfig(location_config_t* dst);
+    err_t copyMqttConfig(mqtt_config_t* dst);
+    void getConfigStoreStats(config_store_stats_t* dst);
+
+    err_t updateSolarTable();
+    static void solarTableUpdateHookDispatch(void* param);
 
     err_t registerIrrigConfigUpdatedHook(ConfigUpdatedHookFncPtr hook, void* param);
     err_t registerHardwareConfigUpdatedHook(ConfigUpdatedHookFncPtr hook, void* param);
@@ -75,32 +141,70 @@ private:
     const char* logTag = "settings_mgr";
 
     const TickType_t lockAcquireTimeout = pdMS_TO_TICKS(1000);          /**< Maximum lock acquisition time in OS ticks. */
+    const TickType_t irrigConfigPollTicks = pdMS_TO_TICKS(10);         /**< Polling interval while waiting for readers of a config snapshot. */
+    const int battVoltageDeadbandMilliDefault = 100;                    /**< Battery voltage deadband if none is configured */
+    const int fillLevelDeadbandPercent10Default = 10;                   /**< Fill level deadband if none is configured */
+    static const size_t configFileReadChunkLen = 256;                   /**< Chunk size the irrigation config file is parsed in. */
+    static const size_t hardwareConfigJsonMaxLen = 2048;                /**< Maximum length of the hardware config in JSON format. */
+    static const size_t irrigationConfigZoneJsonLen = 224;              /**< Length budget of a zone in the stored irrigation config. */
+    static const size_t irrigationConfigEventJsonLen = 128;             /**< Length budget of an event in the stored irrigation config. */
+    /** Maximum length of the stored irrigation config, sized for all zones and events of the capacity policy. */
+    static const size_t irrigationConfigFileMaxLen = 256 + irrigationPlannerNumZones * irrigationConfigZoneJsonLen +
+        irrigationPlannerNumNormalEvents * irrigationConfigEventJsonLen;
+    const TickType_t persistLockTimeout = pdMS_TO_TICKS(5000);         /**< Maximum time to wait for a config file write in progress. */
+
+    static const int persistTaskStackSize = 4096;
+    static const UBaseType_t persistTaskPrio = tskIDLE_PRIORITY + 2;
+    StackType_t persistTaskStack[persistTaskStackSize];
+    StaticTask_t persistTaskBuf;
+    TaskHandle_t persistTaskHandle;
 
     SemaphoreHandle_t configMutex;
     StaticSemaphore_t configMutexBuf;
 
     SemaphoreHandle_t fileIoMutex;
     StaticSemaphore_t fileIoMutexBuf;
+    bool configStoreMounted;                                            /**< Wether or not the config store is mounted, protected by fileIoMutex */
+
+    SemaphoreHandle_t persistMutex;                                     /**< Protects the pending config files, held while they are written */
+    StaticSemaphore_t persistMutexBuf;
+    SemaphoreHandle_t persistRequestSem;                                /**< Signals pending config files to the persistence task */
+    StaticSemaphore_t persistRequestSemBuf;
 
     SemaphoreHandle_t hookMutex;
     StaticSemaphore_t hookMutexBuf;
 
-    typedef struct irrigation_config_t {
-        irrigation_zone_cfg_t zones[irrigationPlannerNumZones];         /**< Storage holding irrigation zone configurations. */
-
-        IrrigationEvent events[irrigationPlannerNumNormalEvents];       /**< Storage holding irrigation events. */
-        bool eventsUsed[irrigationPlannerNumNormalEvents];              /**< Flag weather or not the corresponding event storage is used. */
-    } irrigation_config_t;
-
-    irrigation_config_t shadowDataIrrigationConfig;
-    battery_config_t shadowDataBatteryConfig;
-    reservoir_config_t shadowDataReservoirConfig;
+    /** Irrigation config snapshots: the published one, a previous one the planner may use until its irrigations end and one to parse updates into. */
+    static const int numIrrigConfigs = 3;
+    irrigation_config_t irrigConfigs[numIrrigConfigs];                  /**< Irrigation config snapshots. */
+    std::atomic<int> irrigConfigRefCount[numIrrigConfigs];              /**< Number of acquisitions of each snapshot. */
+    std::atomic<int> irrigConfigActive;                                 /**< Index of the published snapshot, -1 if none is published yet. */
+    uint32_t irrigConfigGeneration;                                     /**< Generation of the last published snapshot. */
+    SeqLock<battery_config_t> batteryConfig;                            /**< Battery config, readable without locking */
+    SeqLock<reservoir_config_t> reservoirConfig;                        /**< Reservoir config, readable without locking */
+    time_config_t shadowDataTimeConfig;
+    location_config_t shadowDataLocationConfig;
+    mqtt_config_t shadowDataMqttConfig;
 
     typedef enum config_file_type_t {
         CONFIG_FILE_IRRIGATION = 0,
-        CONFIG_FILE_HARDWARE = 1
+        CONFIG_FILE_HARDWARE = 1,
+        CONFIG_FILE_COUNT
     } config_file_type_t;
 
+    /** Config file waiting to be written by the persistence task, protected by persistMutex */
+    typedef struct pending_config_file_t {
+        const char* filename;
+        char* data;                                                     /**< Content of the file */
+        size_t maxLen;                                                  /**< Size of the data buffer */
+        size_t len;                                                     /**< Length of the content */
+        bool pending;                                                   /**< Wether or not the content still has to be written */
+    } pending_config_file_t;
+
+    char pendingIrrigationConfig[irrigationConfigFileMaxLen];
+    char pendingHardwareConfig[hardwareConfigJsonMaxLen];
+    pending_config_file_t pendingConfigFiles[CONFIG_FILE_COUNT];
+
 
     static const int numHookTableEntries = 8;
     ConfigUpdatedHookFncPtr irrigConfigUpdatedHooks[numHookTableEntries];
@@ -110,14 +214,25 @@ private:
 
     void clearZoneData(irrigation_config_t& settings);
     void clearEventData(irrigation_config_t& settings);
-    err_t jsonParseZone(cJSON* zoneJson, irrigation_zone_cfg_t& zoneCfg);
-    err_t jsonParseEvent(cJSON* evtJson, IrrigationEvent& evt, bool& used);
+    int findFreeIrrigationConfig();
+    err_t jsonParsePayloadEncoding(cJSON* item, payload_encoding_t* encoding);
 
-    err_t readConfigFile(config_file_type_t type);
-    err_t writeConfigFile(const char* const filename, const char* const jsonData, int jsonDataLen);
+    err_t updateIrrigationConfig(const char* const jsonData, int jsonDataLen, FILE* f, bool noNotify);
+
+    void fillConfigImageData(config_image_data_t* data, const irrigation_config_t& config);
+    err_t applyConfigImage(const config_image_data_t* data, size_t len);
+    void invalidateConfigImage();
+    void updateConfigRtcCopy();
 
-    void copyBatteryConfigInt(battery_config_t* dst, battery_config_t& src);
-    void copyReservoirConfigInt(reservoir_config_t* dst, reservoir_config_t& src);
+    err_t readConfigFile(config_file_type_t type);
+    err_t requestConfigFileWrite(config_file_type_t type, const char* const data, size_t len, size_t skipOffset, size_t skipLen);
+    void writePendingConfigFiles();
+    bool configFileMatches(const char* const filename, const char* const data, size_t len);
+    err_t writeConfigFile(const char* const filename, const char* const data, size_t len);
+    void recoverConfigFile(const char* const filename);
+
+    static void persistTaskFuncDispatch(void* params);
+    void persistTaskFunc();
 
     void callIrrigConfigUpdatedHooks();
     void callHardwareConfigUpdatedHooks();
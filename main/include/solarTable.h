@@ -0,0 +1,63 @@
+#ifndef SOLAR_TABLE_H
+#define SOLAR_TABLE_H
+
+#include <stdint.h>
+#include <ctime>
+
+/** Number of days covered by the table. The layout is the one of a leap year, i.e. index 59 is February 29th. */
+constexpr int solarTableNumDays = 366;
+/** Version of the table layout and calculation. Stored tables with a different version are recalculated. */
+constexpr uint32_t solarTableVersion = 1;
+
+/**
+ * @brief The SolarTable class provides sunrise and sunset times for events
+ * anchored to the sun.
+ *
+ * The solar trigonometry is only done once when the location is configured. It results
+ * in a compact per-day-of-year table of the sunrise and sunset times in minutes after
+ * midnight UTC, which can be stored along with the settings. Resolving an event is a
+ * table lookup afterwards. Since the table is based on UTC, no timezone or DST handling
+ * is needed.
+ */
+class SolarTable
+{
+public:
+    typedef enum {
+        SUNRISE = 0,
+        SUNSET = 1,
+    } solar_event_t;
+
+    /** Marks days without a sunrise/sunset (i.e. polar night or midnight sun) */
+    static constexpr int16_t noEvent = INT16_MIN;
+
+    /** Storable form of the table */
+    typedef struct solar_table_data_t {
+        uint32_t version;                                       /**< Table version, i.e. solarTableVersion */
+        int32_t latitudeMicroDeg;                               /**< Latitude the table was calculated for (north positive) */
+        int32_t longitudeMicroDeg;                              /**< Longitude the table was calculated for (east positive) */
+        int16_t eventMinutesUtc[2][solarTableNumDays];          /**< Event times in minutes after midnight UTC, indexed by solar_event_t and day */
+    } solar_table_data_t;
+
+    SolarTable(void);
+
+    static void calculate(int32_t latitudeMicroDeg, int32_t longitudeMicroDeg, solar_table_data_t* dest);
+    static bool isValid(const solar_table_data_t& data, int32_t latitudeMicroDeg, int32_t longitudeMicroDeg);
+    static int getTableIndex(int64_t days);
+
+    void setTable(const solar_table_data_t& data);
+    void clearTable(void);
+    bool isSet(void) const;
+    bool isSetFor(int32_t latitudeMicroDeg, int32_t longitudeMicroDeg) const;
+    uint32_t getGeneration(void) const;
+
+    bool getEventTime(solar_event_t event, int64_t days, int32_t* secsUtc) const;
+
+private:
+    solar_table_data_t tables[2];                               /**< Double buffered tables, so readers never see a half written one */
+    volatile int activeTable;                                   /**< Index of the currently active table, -1 if none is set */
+    volatile uint32_t generation;                               /**< Incremented each time the active table changes */
+
+    static int16_t calcEventMinutes(float lat, float lon, float dayOfYear, solar_event_t event);
+};
+
+#endif /* SOLAR_TABLE_H */
@@ -8,6 +8,9 @@ extern "C" {
 #include <stdint.h>
 #include <time.h>
 
+/** Default timezone (POSIX TZ rule) used until the hardware config has been applied. */
+static const char TimeSystem_defaultTimezone[] = "CET-1CEST,M3.5.0,M10.5.0/3";
+
 extern const int TimeSystem_timeEventTimeSet;
 extern const int TimeSystem_timeEventTimeSetSntp;
 typedef int time_system_event_t;
@@ -15,6 +18,8 @@ typedef int time_system_event_t;
 typedef void(*TimeSystem_HookFncPtr)(void*, time_system_event_t);
 
 void TimeSystem_Init(void);
+int TimeSystem_SetTimezone(const char* posixTz);
+void TimeSystem_HardwareConfigUpdated(void* param);
 
 void TimeSystem_GetCurTimeStr(char *timeStr);
 int TimeSystem_SetTime(int16_t day, int16_t month, int16_t year, int16_t hour, int16_t minute, int16_t second);
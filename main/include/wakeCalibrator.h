@@ -0,0 +1,44 @@
+#ifndef WAKE_CALIBRATOR_H
+#define WAKE_CALIBRATOR_H
+
+#include <stdint.h>
+
+/**
+ * @brief The WakeCalibrator class learns how long before an event the deep sleep timer
+ * has to fire, so the controller is ready just in time.
+ *
+ * Before entering deep sleep, the planned wakeup time is stored in RTC memory. After a
+ * timer wakeup, the delay between the planned wakeup and the controller being ready to
+ * process events is recorded. It covers everything in-between: boot, WiFi association,
+ * peripheral power up, sensor readout and the RTC drift during deep sleep. The margin
+ * is a high percentile of the last sampleCount delays plus a guard time.
+ *
+ * The class isn't thread safe. It is meant to be used by the IrrigationController
+ * task only.
+ */
+class WakeCalibrator
+{
+public:
+    /** Number of delays the margin is learned from */
+    static const unsigned int sampleCount = 16;
+    /** Minimum number of delays needed before the learned margin is used */
+    static const unsigned int minSamples = 4;
+    /** Percentile of the delays the margin is based on */
+    static const unsigned int marginPercentile = 90;
+    /** Guard time in milliseconds added to the percentile */
+    static const uint32_t guardMillis = 1000;
+    /** Delays are clamped to this value, e.g. in case the time has been set meanwhile */
+    static const uint32_t maxDelayMillis = 120000;
+
+    void sleepPlanned(int sleepMillis);
+    void controllerReady(bool recordDelay);
+    int getMarginMillis(int fallbackMillis) const;
+    unsigned int getNumSamples(void) const;
+
+private:
+    const char* logTag = "wake_cal";
+
+    static int64_t getNowMillis(void);
+};
+
+#endif /* WAKE_CALIBRATOR_H */
@@ -0,0 +1,98 @@
+#ifndef WAKE_PROFILER_H
+#define WAKE_PROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ctime>
+
+#include "jsonWriter.h"
+
+#define WAKE_PHASE_TO_STR(phase) (\
+    (phase == WakeProfiler::PHASE_BOOT) ? "boot" : \
+    (phase == WakeProfiler::PHASE_WIFI) ? "wifi" : \
+    (phase == WakeProfiler::PHASE_PERIPHERAL) ? "peripheral" : \
+    (phase == WakeProfiler::PHASE_BATTERY) ? "battery" : \
+    (phase == WakeProfiler::PHASE_FILL_SENSOR) ? "fillSensor" : \
+    (phase == WakeProfiler::PHASE_PLANNER) ? "planner" : \
+    (phase == WakeProfiler::PHASE_MQTT_CONNECT) ? "mqttConnect" : \
+    (phase == WakeProfiler::PHASE_MQTT_PUBLISH) ? "mqttPublish" : \
+    (phase == WakeProfiler::PHASE_MQTT_FLUSH) ? "mqttFlush" : \
+    (phase == WakeProfiler::PHASE_SNTP) ? "sntp" : \
+    (phase == WakeProfiler::PHASE_SLEEP_PREP) ? "sleepPrep" : \
+    "UNKNOWN" \
+)
+
+/**
+ * @brief The WakeProfiler class measures how long the phases of a wake cycle take.
+ *
+ * The durations of the last wakeRingSize wakes are kept in a ring buffer in RTC
+ * memory, so they survive deep sleep. A phase may be entered several times per wake
+ * (e.g. MQTT publishing), its durations are accumulated. Min/avg/max aggregates are
+ * calculated over the ring contents on demand.
+ *
+ * The profiler isn't thread safe. It is meant to be used by the IrrigationController
+ * task only.
+ */
+class WakeProfiler
+{
+public:
+    typedef enum {
+        PHASE_BOOT = 0,             /**< Boot until the controller task runs */
+        PHASE_WIFI,                 /**< Waiting for the WiFi association */
+        PHASE_PERIPHERAL,           /**< Peripheral (DCDC, RS232, ext. supply) power up */
+        PHASE_BATTERY,              /**< Battery voltage ADC readout */
+        PHASE_FILL_SENSOR,          /**< Fill sensor round trip */
+        PHASE_PLANNER,              /**< Irrigation planner queries */
+        PHASE_MQTT_CONNECT,         /**< Waiting for the MQTT connection */
+        PHASE_MQTT_PUBLISH,         /**< Formatting and queueing MQTT messages */
+        PHASE_MQTT_FLUSH,           /**< Waiting for all MQTT messages being published */
+        PHASE_SNTP,                 /**< SNTP resync */
+        PHASE_SLEEP_PREP,           /**< Sleep preparation */
+        PHASE_COUNT
+    } phase_t;
+
+    /** Number of wakes kept in the ring buffer */
+    static const unsigned int wakeRingSize = 8;
+
+    /** Profile of a single wake */
+    typedef struct wake_record_t {
+        time_t wakeTime;                        /**< Time of the wake */
+        uint32_t phaseMillis[PHASE_COUNT];      /**< Accumulated durations of the phases */
+        uint32_t totalMillis;                   /**< Duration of the whole wake */
+    } wake_record_t;
+
+    /** Min/avg/max aggregate of a duration */
+    typedef struct aggregate_t {
+        uint32_t minMillis;
+        uint32_t avgMillis;
+        uint32_t maxMillis;
+    } aggregate_t;
+
+    /** Aggregates over the ring buffer contents */
+    typedef struct aggregates_t {
+        unsigned int numWakes;                  /**< Number of wakes the aggregates cover */
+        aggregate_t phases[PHASE_COUNT];        /**< Aggregates per phase */
+        aggregate_t total;                      /**< Aggregate of the whole wakes */
+    } aggregates_t;
+
+    void startWake(bool afterBoot);
+    void startPhase(phase_t phase);
+    void endPhase(phase_t phase);
+    void endWake(void);
+
+    bool isPublishDue(void) const;
+    void setPublished(void);
+    void getAggregates(aggregates_t* dst) const;
+    size_t formatAggregates(const aggregates_t& aggr, char* buf, size_t bufLen) const;
+
+private:
+    static void updateAggregate(aggregate_t* aggr, uint64_t* sum, uint32_t millis, bool first);
+    static void addAggregate(JsonWriter* writer, const char* key, const aggregate_t& aggr);
+
+    int64_t wakeStartUs = 0;
+    int64_t phaseStartUs[PHASE_COUNT] = {};
+    int64_t phaseAccuUs[PHASE_COUNT] = {};
+    bool wakeActive = false;
+};
+
+#endif /* WAKE_PROFILER_H */
@@ -0,0 +1,602 @@
+#include "irrigationConfigParser.h"
+
+#include <cstring>
+#include <strings.h>
+
+const char* const IrrigationConfigParser::zoneMemberNames[ZONE_MEMBER_COUNT] = {
+    "chEnabled",
+    "chNum",
+    "chStateStart",
+    "chStateStop",
+    "name"
+};
+
+const char* const IrrigationConfigParser::eventMemberNames[EVENT_MEMBER_COUNT] = {
+    "zoneNum",
+    "durationSecs",
+    "hour",
+    "minute",
+    "second",
+    "day",
+    "month",
+    "year",
+    "offsetMinutes",
+    "minutes",
+    "hours",
+    "weekdays",
+    "daysOfMonth",
+    "months",
+    "isSingle",
+    "isDaily",
+    "isRecurring",
+    "isSolar",
+    "solarEvent"
+};
+
+/** Allowed values of the bitset members, indexed by event_member_t - EVENT_MEMBER_MINUTES */
+const IrrigationConfigParser::bitset_range_t IrrigationConfigParser::eventBitsetRanges[eventBitsetMembers] = {
+    {0, 59},
+    {0, 23},
+    {0, 6},
+    {1, 31},
+    {1, 12}
+};
+
+/**
+ * @brief Create a parser writing into the given config. The zones and events of the
+ * config have to be cleared already.
+ *
+ * @param config Target config
+ */
+IrrigationConfigParser::IrrigationConfigParser(irrigation_config_t& config) :
+    config(config), reader(tokenHandlerDispatch, this), err(ERR_OK), section(SECTION_NONE),
+    zonesFound(false), eventsFound(false), numZones(0), numEvents(0), inItem(false),
+    member(0), memberIsArray(false), zonePresent(0), topMembersSeen(0), hasTopMembers(false), topKeyOffset(0),
+    topMemberEnd(0), storePersistent(false), storeSkipPending(false), storeSkipStart(0),
+    storeSkipEnd(0)
+{
+    memset(zoneCounts, 0, sizeof(zoneCounts));
+    memset(&eventFields, 0, sizeof(eventFields));
+}
+
+/**
+ * @brief Parse the next chunk of the configuration.
+ *
+ * @param data Input chunk. It isn't needed anymore after the call.
+ * @param len Length of the chunk
+ */
+void IrrigationConfigParser::feed(const char* data, size_t len)
+{
+    reader.feed(data, len);
+}
+
+/**
+ * @brief Finish parsing after the last chunk has been fed.
+ *
+ * @return IrrigationConfigParser::err_t ERR_OK if the whole configuration is valid.
+ * Otherwise the target config is partially written and must not be used.
+ */
+IrrigationConfigParser::err_t IrrigationConfigParser::finish(void)
+{
+    JsonReader::err_t readerErr = reader.finish();
+
+    if(JsonReader::ERR_NUMBER == readerErr) {
+        ESP_LOGE(logTag, "Only integer numbers are supported!");
+        return ERR_INVALID_JSON;
+    } else if(JsonReader::ERR_OK != readerErr) {
+        return ERR_INVALID_JSON;
+    }
+
+    if((ERR_OK == err) && (!zonesFound || !eventsFound)) {
+        err = ERR_INVALID_STRUCTURE;
+    }
+
+    return err;
+}
+
+/**
+ * @brief Check if the configuration requests to be stored persistently.
+ *
+ * @param skipStart Input offset of the storePersistent member, including its separator
+ * @param skipEnd Input offset after the storePersistent member. The input without the
+ * range [skipStart, skipEnd) is a valid configuration, which doesn't request storing.
+ * @return true if "storePersistent" is true.
+ */
+bool IrrigationConfigParser::getStorePersistent(size_t* skipStart, size_t* skipEnd) const
+{
+    *skipStart = storeSkipStart;
+    *skipEnd = storeSkipEnd;
+
+    return storePersistent;
+}
+
+void IrrigationConfigParser::tokenHandlerDispatch(void* param, const JsonReader::token_t* token)
+{
+    IrrigationConfigParser* parser = (IrrigationConfigParser*) param;
+    parser->handleToken(token);
+}
+
+void IrrigationConfigParser::handleToken(const JsonReader::token_t* token)
+{
+    if(ERR_OK != err) return;
+
+    if(0 == token->depth) {
+        // The configuration has to be an object
+        if((JsonReader::TOKEN_OBJECT_START != token->type) && (JsonReader::TOKEN_OBJECT_END != token->type)) {
+            setError(ERR_INVALID_STRUCTURE);
+        }
+    } else if(1 == token->depth) {
+        handleTopToken(token);
+    } else if(SECTION_ZONES == section) {
+        handleZoneToken(token);
+    } else if(SECTION_EVENTS == section) {
+        handleEventToken(token);
+    }
+}
+
+/**
+ * @brief Handle a key or value of the top level object.
+ */
+void IrrigationConfigParser::handleTopToken(const JsonReader::token_t* token)
+{
+    switch(token->type) {
+        case JsonReader::TOKEN_KEY:
+            if(storeSkipPending) {
+                // storePersistent was the first member: skip up to this key, including the comma
+                storeSkipEnd = token->offset;
+                storeSkipPending = false;
+            }
+            topKeyOffset = token->offset;
+
+            if(token->truncated) {
+                section = SECTION_NONE;
+            } else if(0 == strcasecmp(token->str, "zones")) {
+                section = SECTION_ZONES;
+            } else if(0 == strcasecmp(token->str, "events")) {
+                section = SECTION_EVENTS;
+            } else if(0 == strcasecmp(token->str, "storePersistent")) {
+                section = SECTION_STORE_PERSISTENT;
+            } else {
+                section = SECTION_NONE;
+            }
+
+            // Only the first of duplicate members counts
+            if(0 != (topMembersSeen & (1u << section))) {
+                section = SECTION_NONE;
+            }
+            topMembersSeen |= (1u << section);
+            return;
+
+        case JsonReader::TOKEN_OBJECT_START:
+        case JsonReader::TOKEN_ARRAY_START:
+            if(SECTION_ZONES == section) {
+                zonesFound = (JsonReader::TOKEN_ARRAY_START == token->type);
+            } else if(SECTION_EVENTS == section) {
+                eventsFound = (JsonReader::TOKEN_ARRAY_START == token->type);
+            }
+            if(((SECTION_ZONES == section) || (SECTION_EVENTS == section)) &&
+                (JsonReader::TOKEN_ARRAY_START != token->type))
+            {
+                setError(ERR_INVALID_STRUCTURE);
+            }
+            // The value ends with the corresponding end token
+            return;
+
+        case JsonReader::TOKEN_BOOL:
+            if((SECTION_STORE_PERSISTENT == section) && token->boolVal) {
+                storePersistent = true;
+                storeSkipEnd = token->endOffset;
+                if(hasTopMembers) {
+                    // Skip from the end of the previous value, including the comma
+                    storeSkipStart = topMemberEnd;
+                    storeSkipPending = false;
+                } else {
+                    storeSkipStart = topKeyOffset;
+                    storeSkipPending = true;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if((SECTION_ZONES == section) || (SECTION_EVENTS == section)) {
+        if((JsonReader::TOKEN_OBJECT_END != token->type) && (JsonReader::TOKEN_ARRAY_END != token->type)) {
+            // Scalar zones or events
+            setError(ERR_INVALID_STRUCTURE);
+        }
+    }
+
+    // End of a top level value
+    hasTopMembers = true;
+    topMemberEnd = token->endOffset;
+    section = SECTION_NONE;
+}
+
+/**
+ * @brief Handle a token inside the "zones" array.
+ */
+void IrrigationConfigParser::handleZoneToken(const JsonReader::token_t* token)
+{
+    bool isEnd = (JsonReader::TOKEN_OBJECT_END == token->type) || (JsonReader::TOKEN_ARRAY_END == token->type);
+
+    if(2 == token->depth) {
+        if(JsonReader::TOKEN_OBJECT_END == token->type) {
+            if(inItem && !finishZone()) {
+                setError(ERR_INVALID_ZONE);
+            }
+            inItem = false;
+        } else if(!isEnd) {
+            if(numZones >= irrigationPlannerNumZones) {
+                setError(ERR_INVALID_STRUCTURE);
+                return;
+            }
+
+            ESP_LOGD(logTag, "Parsing zone %u", numZones);
+            numZones++;
+            if(JsonReader::TOKEN_OBJECT_START != token->type) {
+                setError(ERR_INVALID_ZONE);
+                return;
+            }
+            inItem = true;
+            member = ZONE_MEMBER_UNKNOWN;
+            memberIsArray = false;
+            zonePresent = 0;
+            memset(zoneCounts, 0, sizeof(zoneCounts));
+        }
+        return;
+    }
+
+    if(!inItem) return;
+
+    irrigation_zone_cfg_t& zoneCfg = config.zones[numZones - 1];
+
+    if(3 == token->depth) {
+        if(JsonReader::TOKEN_KEY == token->type) {
+            member = ZONE_MEMBER_UNKNOWN;
+            for(unsigned int i = 0; (i < ZONE_MEMBER_COUNT) && !token->truncated; i++) {
+                // Only the first of duplicate members counts
+                if((0 == strcasecmp(token->str, zoneMemberNames[i])) && (0 == (zonePresent & (1u << i)))) {
+                    member = i;
+                    break;
+                }
+            }
+            memberIsArray = false;
+        } else if(isEnd) {
+            memberIsArray = false;
+        } else if(ZONE_MEMBER_NAME == member) {
+            if(JsonReader::TOKEN_STRING != token->type) {
+                setError(ERR_INVALID_ZONE);
+                return;
+            }
+            strncpy(zoneCfg.name, token->str, irrigationZoneCfgNameLen);
+            zoneCfg.name[irrigationZoneCfgNameLen] = '\0';
+            zonePresent |= (1u << ZONE_MEMBER_NAME);
+        } else if(member < zoneArrayMembers) {
+            if(JsonReader::TOKEN_ARRAY_START != token->type) {
+                setError(ERR_INVALID_ZONE);
+                return;
+            }
+            zonePresent |= (1u << member);
+            zoneCounts[member] = 0;
+            memberIsArray = true;
+        }
+        return;
+    }
+
+    if((4 != token->depth) || !memberIsArray || isEnd) return;
+
+    unsigned int idx = zoneCounts[member]++;
+    if(idx >= irrigationZoneCfgElements) {
+        setError(ERR_INVALID_ZONE);
+        return;
+    }
+
+    if(ZONE_MEMBER_CH_NUM == member) {
+        if(JsonReader::TOKEN_NUMBER != token->type) {
+            setError(ERR_INVALID_ZONE);
+            return;
+        }
+        zoneCfg.chNum[idx] = (OutputController::ch_map_t) token->intVal;
+    } else {
+        if(JsonReader::TOKEN_BOOL != token->type) {
+            setError(ERR_INVALID_ZONE);
+            return;
+        }
+        if(ZONE_MEMBER_CH_ENABLED == member) {
+            zoneCfg.chEnabled[idx] = token->boolVal;
+        } else if(ZONE_MEMBER_CH_STATE_START == member) {
+            zoneCfg.chStateStart[idx] = token->boolVal;
+        } else {
+            zoneCfg.chStateStop[idx] = token->boolVal;
+        }
+    }
+}
+
+/**
+ * @brief Handle a token inside the "events" array.
+ */
+void IrrigationConfigParser::handleEventToken(const JsonReader::token_t* token)
+{
+    bool isEnd = (JsonReader::TOKEN_OBJECT_END == token->type) || (JsonReader::TOKEN_ARRAY_END == token->type);
+
+    if(2 == token->depth) {
+        if(JsonReader::TOKEN_OBJECT_END == token->type) {
+            if(inItem) {
+                unsigned int idx = numEvents - 1;
+                bool used = false;
+                if(!finishEvent(config.events[idx], used)) {
+                    setError(ERR_INVALID_EVENT);
+                } else if(used) {
+                    config.events.claim(idx);
+                }
+            }
+            inItem = false;
+        } else if(!isEnd) {
+            if(numEvents >= irrigationPlannerNumNormalEvents) {
+                setError(ERR_INVALID_STRUCTURE);
+                return;
+            }
+
+            ESP_LOGD(logTag, "Parsing event %u", numEvents);
+            numEvents++;
+            // Events other than objects are skipped
+            inItem = (JsonReader::TOKEN_OBJECT_START == token->type);
+            member = EVENT_MEMBER_UNKNOWN;
+            memberIsArray = false;
+            memset(&eventFields, 0, sizeof(eventFields));
+        }
+        return;
+    }
+
+    if(!inItem) return;
+
+    if(3 == token->depth) {
+        if(JsonReader::TOKEN_KEY == token->type) {
+            member = EVENT_MEMBER_UNKNOWN;
+            for(unsigned int i = 0; (i < EVENT_MEMBER_COUNT) && !token->truncated; i++) {
+                // Only the first of duplicate members counts
+                if((0 == strcasecmp(token->str, eventMemberNames[i])) && !exists((event_member_t) i)) {
+                    member = i;
+                    break;
+                }
+            }
+            memberIsArray = false;
+            return;
+        } else if(isEnd) {
+            memberIsArray = false;
+            return;
+        } else if(EVENT_MEMBER_UNKNOWN == member) {
+            return;
+        }
+
+        uint32_t bit = (1u << member);
+        eventFields.exists |= bit;
+        eventFields.valid &= ~bit;
+
+        if(member < EVENT_MEMBER_MINUTES) {
+            if(JsonReader::TOKEN_NUMBER == token->type) {
+                eventFields.valid |= bit;
+                eventFields.numbers[member] = token->intVal;
+            }
+        } else if(member < EVENT_MEMBER_IS_SINGLE) {
+            if(JsonReader::TOKEN_ARRAY_START == token->type) {
+                eventFields.valid |= bit;
+                eventFields.bitsets[member - EVENT_MEMBER_MINUTES] = 0;
+                memberIsArray = true;
+            }
+        } else if(member < EVENT_MEMBER_SOLAR_EVENT) {
+            if((JsonReader::TOKEN_BOOL == token->type) && token->boolVal) {
+                eventFields.valid |= bit;
+            }
+        } else if((JsonReader::TOKEN_STRING == token->type) && !token->truncated) {
+            if(0 == strcmp(token->str, "sunrise")) {
+                eventFields.valid |= bit;
+                eventFields.solarEvent = SolarTable::SUNRISE;
+            } else if(0 == strcmp(token->str, "sunset")) {
+                eventFields.valid |= bit;
+                eventFields.solarEvent = SolarTable::SUNSET;
+            }
+        }
+        return;
+    }
+
+    if((4 != token->depth) || !memberIsArray || isEnd) return;
+
+    // Element of a bitset array
+    const bitset_range_t& range = eventBitsetRanges[member - EVENT_MEMBER_MINUTES];
+    if((JsonReader::TOKEN_NUMBER == token->type) && (token->intVal >= range.minVal) && (token->intVal <= range.maxVal)) {
+        eventFields.bitsets[member - EVENT_MEMBER_MINUTES] |= (1ull << token->intVal);
+    } else {
+        eventFields.valid &= ~(1u << member);
+    }
+}
+
+void IrrigationConfigParser::setError(err_t error)
+{
+    if(ERR_OK != err) return;
+
+    if(ERR_INVALID_ZONE == error) {
+        ESP_LOGE(logTag, "Zone %u is invalid!", numZones - 1);
+    } else if(ERR_INVALID_EVENT == error) {
+        ESP_LOGE(logTag, "Event %u is invalid!", numEvents - 1);
+    }
+    err = error;
+}
+
+/**
+ * @brief Check the zone parsed last. All members are mandatory and the arrays must
+ * have the same length.
+ */
+bool IrrigationConfigParser::finishZone(void) const
+{
+    if(((1u << ZONE_MEMBER_COUNT) - 1) != zonePresent) return false;
+
+    for(unsigned int i = 1; i < zoneArrayMembers; i++) {
+        if(zoneCounts[i] != zoneCounts[0]) return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Set up an event from the members collected.
+ *
+ * Events lacking the zone, the duration or the time are skipped, i.e. left unused.
+ * Single events need "day", "month" and "year" and daily ones "isDaily". Otherwise
+ * they have to be recurring ("isRecurring") or solar ("isSolar") events.
+ *
+ * @param evt Event to be set up.
+ * @param used Set to true if the event has been set up.
+ * @return true on success, false if the event is invalid.
+ */
+bool IrrigationConfigParser::finishEvent(IrrigationEvent& evt, bool& used)
+{
+    bool ok = true;
+    bool isRecurring = isValid(EVENT_MEMBER_IS_RECURRING);
+    bool isSolar = isValid(EVENT_MEMBER_IS_SOLAR);
+    bool hasTime = isValid(EVENT_MEMBER_HOUR) && isValid(EVENT_MEMBER_MINUTE) && isValid(EVENT_MEMBER_SECOND);
+
+    if(!isValid(EVENT_MEMBER_ZONE_NUM) || !isValid(EVENT_MEMBER_DURATION_SECS) || !(isRecurring || isSolar || hasTime)) {
+        return true;
+    }
+
+    if(isValid(EVENT_MEMBER_IS_SINGLE) && isValid(EVENT_MEMBER_DAY) && isValid(EVENT_MEMBER_MONTH) && isValid(EVENT_MEMBER_YEAR)) {
+        if(!hasTime || (IrrigationEvent::ERR_OK != evt.setSingleEvent(
+            getNumber(EVENT_MEMBER_HOUR), getNumber(EVENT_MEMBER_MINUTE), getNumber(EVENT_MEMBER_SECOND),
+            getNumber(EVENT_MEMBER_DAY), getNumber(EVENT_MEMBER_MONTH), getNumber(EVENT_MEMBER_YEAR))))
+        {
+            ok = false;
+        }
+    } else if(isValid(EVENT_MEMBER_IS_DAILY)) {
+        if(!hasTime || (IrrigationEvent::ERR_OK != evt.setDailyRepetition(
+            getNumber(EVENT_MEMBER_HOUR), getNumber(EVENT_MEMBER_MINUTE), getNumber(EVENT_MEMBER_SECOND))))
+        {
+            ok = false;
+        }
+    } else if(isRecurring) {
+        ok = setupRecurrence(evt);
+    } else if(isSolar) {
+        ok = setupSolarEvent(evt);
+    } else {
+        return false;
+    }
+
+    if(IrrigationEvent::ERR_OK != evt.setZoneIndex(getNumber(EVENT_MEMBER_ZONE_NUM))) {
+        ok = false;
+    }
+    evt.setDuration(getNumber(EVENT_MEMBER_DURATION_SECS));
+    evt.setStartFlag(true);
+    used = true;
+
+    return ok;
+}
+
+/**
+ * @brief Set up the cron-style recurrence of an event.
+ *
+ * The hours and minutes are either given as arrays ("hours", "minutes") or as single
+ * numbers ("hour", "minute"). The optional arrays "weekdays" (0 = sunday), "daysOfMonth"
+ * and "months" restrict the matching days. If omitted, every day matches. The optional
+ * "second" defaults to 0.
+ *
+ * @param evt Event to be set up.
+ * @return true on success, false otherwise.
+ */
+bool IrrigationConfigParser::setupRecurrence(IrrigationEvent& evt)
+{
+    IrrigationEvent::recurrence_t rec;
+    uint64_t mask;
+
+    if(!getBitset(EVENT_MEMBER_MINUTES, EVENT_MEMBER_MINUTE, 0, &mask)) return false;
+    rec.minutes = mask;
+    if(!getBitset(EVENT_MEMBER_HOURS, EVENT_MEMBER_HOUR, 0, &mask)) return false;
+    rec.hours = (uint32_t) mask;
+    if(!getBitset(EVENT_MEMBER_WEEKDAYS, -1, IrrigationEvent::recurrenceAllWeekdays, &mask)) return false;
+    rec.weekdays = (uint8_t) mask;
+    if(!getBitset(EVENT_MEMBER_DAYS_OF_MONTH, -1, IrrigationEvent::recurrenceAllDaysOfMonth, &mask)) return false;
+    rec.daysOfMonth = (uint32_t) mask;
+    if(!getBitset(EVENT_MEMBER_MONTHS, -1, IrrigationEvent::recurrenceAllMonths, &mask)) return false;
+    rec.months = (uint16_t) mask;
+
+    rec.second = 0;
+    if(exists(EVENT_MEMBER_SECOND)) {
+        int32_t second = getNumber(EVENT_MEMBER_SECOND);
+        if(!isValid(EVENT_MEMBER_SECOND) || (second < 0) || (second > 59)) return false;
+        rec.second = (uint8_t) second;
+    }
+
+    return (IrrigationEvent::ERR_OK == evt.setRecurrence(rec));
+}
+
+/**
+ * @brief Set up an event anchored to sunrise or sunset.
+ *
+ * The mandatory "solarEvent" is either "sunrise" or "sunset". The optional
+ * "offsetMinutes" shifts the event, e.g. -30 for 30 minutes before.
+ *
+ * @param evt Event to be set up.
+ * @return true on success, false otherwise.
+ */
+bool IrrigationConfigParser::setupSolarEvent(IrrigationEvent& evt)
+{
+    int offsetMinutes = 0;
+
+    if(!isValid(EVENT_MEMBER_SOLAR_EVENT)) return false;
+
+    if(exists(EVENT_MEMBER_OFFSET_MINUTES)) {
+        if(!isValid(EVENT_MEMBER_OFFSET_MINUTES)) return false;
+        offsetMinutes = getNumber(EVENT_MEMBER_OFFSET_MINUTES);
+        // Checked before the conversion to seconds, which could overflow otherwise
+        if((offsetMinutes < -(IrrigationEvent::solarMaxOffsetSecs / 60)) ||
+            (offsetMinutes > (IrrigationEvent::solarMaxOffsetSecs / 60))) return false;
+    }
+
+    return (IrrigationEvent::ERR_OK == evt.setSolarRepetition(eventFields.solarEvent, offsetMinutes * 60));
+}
+
+/**
+ * @brief Get a recurrence field as bitmask.
+ *
+ * @param arrayMember Member listing all values.
+ * @param singleMember Alternative number member holding a single value, -1 if there is none.
+ * @param defaultMask Mask to be used if the field is omitted. 0 makes the field mandatory.
+ * @param mask Bitmask, bit n = value n.
+ * @return true on success, false if the field is invalid, empty or missing.
+ */
+bool IrrigationConfigParser::getBitset(event_member_t arrayMember, int singleMember, uint64_t defaultMask, uint64_t* mask)
+{
+    const bitset_range_t& range = eventBitsetRanges[arrayMember - EVENT_MEMBER_MINUTES];
+
+    *mask = 0;
+
+    if(exists(arrayMember)) {
+        if(!isValid(arrayMember)) return false;
+        *mask = eventFields.bitsets[arrayMember - EVENT_MEMBER_MINUTES];
+    } else if((singleMember >= 0) && exists((event_member_t) singleMember)) {
+        int32_t val = getNumber((event_member_t) singleMember);
+        if(!isValid((event_member_t) singleMember) || (val < range.minVal) || (val > range.maxVal)) return false;
+        *mask = (1ull << val);
+    } else {
+        *mask = defaultMask;
+    }
+
+    // empty arrays and omitted mandatory fields are invalid
+    return (0 != *mask);
+}
+
+bool IrrigationConfigParser::isValid(event_member_t member) const
+{
+    return (0 != (eventFields.valid & (1u << member)));
+}
+
+bool IrrigationConfigParser::exists(event_member_t member) const
+{
+    return (0 != (eventFields.exists & (1u << member)));
+}
+
+int32_t IrrigationConfigParser::getNumber(event_member_t member) const
+{
+    return (member < eventNumberMembers) ? eventFields.numbers[member] : 0;
+}
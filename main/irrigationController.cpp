@@ -1,4 +1,9 @@
 #include "irrigationController.h"
+#include "cborWriter.h"
+#include "jsonWriter.h"
+
+#include <stdlib.h>
+#include <sys/time.h>
 
 extern "C" {
     void esp_restart_noos() __attribute__ ((noreturn));
@@ -9,6 +14,28 @@ RTC_DATA_ATTR static IrrigationController::peristent_data_t irrigCtrlPersistentD
     .lastIrrigEvent = 0,
     .reservoirState = IrrigationController::RESERVOIR_OK
 };
+RTC_DATA_ATTR static IrrigationController::event_latency_stats_t irrigCtrlLatencyStats = {};
+RTC_DATA_ATTR static IrrigationController::telemetry_batch_t irrigCtrlTelemetryBatch = {};
+RTC_DATA_ATTR static IrrigationController::published_state_t irrigCtrlPublishedState = {};
+
+/**
+ * @brief Format a time as local datetime string, i.e. 'YYYY-MM-DD HH:MM:SS'.
+ * 
+ * @param t Time to format
+ * @param buf Destination buffer, should be at least 20 characters long
+ * @param bufLen Size of the destination buffer
+ */
+static void formatLocalTime(time_t t, char* buf, size_t bufLen)
+{
+    struct tm tmData;
+
+    localtime_r(&t, &tmData);
+    strftime(buf, bufLen, "%Y-%m-%d %H:%M:%S", &tmData);
+}
+
+const uint32_t IrrigationController::latencyBucketUpperMillis[IrrigationController::latencyBucketCount - 1] = {
+    100, 250, 500, 1000, 2000, 5000, 10000, 30000, 60000, 300000
+};
 
 /**
  * @brief Default constructor, which performs basic initialization,
@@ -18,35 +45,27 @@ IrrigationController::IrrigationController(void)
 {
     size_t len = strlen(mqttTopicPre) + strlen(mqttStateTopicPost) + 12 + 1;
     mqttStateTopic = (char*) calloc(len, sizeof(char));
-
-    // Format string length + 5 digits voltage in mV + 1 digit batt state + 8 digits for battery state string +
-    // 4 digits (fillLevel * 10) + 1 digit for reservoir state,
-    // 8 digits for reservoir state string,
-    // 2 digits per active output + ', ' as seperator
-    // 6 digits per active output string + ', ' as seperator
-    // 19 digits for the next event datetime
-    // 19 digits for the last SNTP sync datetime
-    // 19 digits for the next SNTP sync datetime.
-    // Format string is a bit too long, but don't care too mich about those few bytes
-    mqttStateDataMaxLen = strlen(mqttStateDataFmt) + 5 + 1 + 8 + 4 + 1 + 8 + 
-        (4+8)*(OutputController::intChannels+OutputController::extChannels) + 
-        19 + 19 + 19 + 1;
+    len = strlen(mqttTopicPre) + strlen(mqttStateDeltaTopicPost) + 12 + 1;
+    mqttStateDeltaTopic = (char*) calloc(len, sizeof(char));
+    len = strlen(mqttTopicPre) + strlen(mqttStatsTopicPost) + 12 + 1;
+    mqttStatsTopic = (char*) calloc(len, sizeof(char));
+    len = strlen(mqttTopicPre) + strlen(mqttProfileTopicPost) + 12 + 1;
+    mqttProfileTopic = (char*) calloc(len, sizeof(char));
+    len = strlen(mqttTopicPre) + strlen(mqttTelemetryTopicPost) + 12 + 1;
+    mqttTelemetryTopic = (char*) calloc(len, sizeof(char));
+
+    mqttStateDataMaxLen = getStateDataMaxLen();
     mqttStateData = (char*) calloc(mqttStateDataMaxLen, sizeof(char));
 
-    // Reserve space for active outputs
-    state.activeOutputs.clear();
-    state.activeOutputs.reserve(OutputController::intChannels+OutputController::extChannels);
-
-    // prepare empty last state
-    memset(&lastState, 0, sizeof(state_t));
-    lastState.activeOutputs.clear();
-    lastState.activeOutputs.reserve(OutputController::intChannels+OutputController::extChannels);
+    memset(&state, 0, sizeof(state_t));
 
     // Prepare time system event hook to react properly on time changes
     // Note: hook registration will be performed by the main thread, because the
     // IrrigationPlanner instance will be created before the TimeSystem is initialized.
     extEvents = xEventGroupCreate();
 
+    vPortCPUInitializeMutex(&latencyStatsMux);
+
     if (nullptr == extEvents) {
         ESP_LOGE(logTag, "extEvents event group couldn't be created.");
     }
@@ -59,7 +78,11 @@ IrrigationController::~IrrigationController(void)
 {
     // TBD: graceful shutdown of task
     if(mqttStateTopic) free(mqttStateTopic);
+    if(mqttStateDeltaTopic) free(mqttStateDeltaTopic);
     if(mqttStateData) free(mqttStateData);
+    if(mqttStatsTopic) free(mqttStatsTopic);
+    if(mqttProfileTopic) free(mqttProfileTopic);
+    if(mqttTelemetryTopic) free(mqttTelemetryTopic);
 }
 
 /**
@@ -103,12 +126,14 @@ void IrrigationController::taskFuncDispatch(void* params)
 void IrrigationController::taskFunc()
 {
     EventBits_t events;
-    TickType_t wait, loopStartTicks, nowTicks;
+    TickType_t loopStartTicks, nowTicks;
     time_t now, nextIrrigEvent, sntpNextSync;
     IrrigationPlanner::err_t plannerErr;
     bool irrigOk;
     bool firstRun = true;
 
+    wakeProfiler.startWake(true);
+
     emergencyTimerHandle = xTimerCreateStatic("Emergency reboot timer", emergencyTimerTicks,
         pdFALSE, (void*) 0, emergencyTimerCb, &emergencyTimerBuf);
 
@@ -116,16 +141,11 @@ void IrrigationController::taskFunc()
         ESP_LOGE(logTag, "Emergency reboot timer couldn't be setup. Doing our best without it ...");
     }
 
-    // Wait for WiFi to come up. TBD: make configurable (globally), implement WiFiManager for that
-    wait = portMAX_DELAY;
-    if(wifiConnectedWaitMillis >= 0) {
-        wait = pdMS_TO_TICKS(wifiConnectedWaitMillis);
-    }
-    events = xEventGroupWaitBits(wifiEvents, wifiEventConnected, pdFALSE, pdTRUE, wait);
-    if(0 != (events & wifiEventConnected)) {
-        ESP_LOGD(logTag, "WiFi connected.");
+    // Wait for WiFi to come up, unless this is a wake without network
+    if(networkStarted) {
+        waitNetwork();
     } else {
-        ESP_LOGE(logTag, "WiFi didn't come up within timeout!");
+        ESP_LOGD(logTag, "Wake without network.");
     }
 
     // Check if we have a valid time
@@ -143,10 +163,7 @@ void IrrigationController::taskFunc()
     {
         now = time(nullptr);
         if(irrigCtrlPersistentData.lastIrrigEvent == 0) {
-            struct tm nowTm;
-            localtime_r(&now, &nowTm);
-            nowTm.tm_sec--;
-            irrigCtrlPersistentData.lastIrrigEvent = mktime(&nowTm);
+            irrigCtrlPersistentData.lastIrrigEvent = now - 1;
         }
     }
 
@@ -157,6 +174,9 @@ void IrrigationController::taskFunc()
 
     while(1) {
         loopStartTicks = xTaskGetTickCount();
+        if(!firstRun) {
+            wakeProfiler.startWake(false);
+        }
 
         // feed the emergency timer
         if(pdPASS != xTimerReset(emergencyTimerHandle, 10)) {
@@ -179,12 +199,21 @@ void IrrigationController::taskFunc()
             fillLevelCriticalThresholdPercent10 = reservoirConf.fillLevelCriticalThresholdPercent10;
             fillLevelLowThresholdPercent10 = reservoirConf.fillLevelLowThresholdPercent10;
             fillLevelHysteresisPercent10 = reservoirConf.fillLevelHysteresisPercent10;
+            fillLevelDeadbandPercent10 = reservoirConf.fillLevelDeadbandPercent10;
+            battVoltageDeadbandMilli = batConf.battVoltageDeadbandMilli;
+
+            SettingsManager::mqtt_config_t mqttConf;
+            if(SettingsManager::ERR_OK == settingsMgr.copyMqttConfig(&mqttConf)) {
+                stateEncoding = mqttConf.stateEncoding;
+                telemetryEncoding = mqttConf.telemetryEncoding;
+            }
         }
 
         // *********************
         // Power up needed peripherals, DCDC, ...
         // *********************
         // Peripheral enable will power up the DCDC as well as the RS232 driver
+        wakeProfiler.startPhase(WakeProfiler::PHASE_PERIPHERAL);
         if(!pwrMgr.getPeripheralEnable()) {
             ESP_LOGD(logTag, "Bringing up DCDC + RS232 driver.");
             pwrMgr.setPeripheralEnable(true);
@@ -199,23 +228,28 @@ void IrrigationController::taskFunc()
             // Wait for external sensors to power up properly
             vTaskDelay(pdMS_TO_TICKS(peripheralExtSupplyMillis));
         }
+        wakeProfiler.endPhase(WakeProfiler::PHASE_PERIPHERAL);
 
         // *********************
         // Fetch sensor data
         // *********************
         // Battery voltage
+        wakeProfiler.startPhase(WakeProfiler::PHASE_BATTERY);
         state.battVoltage = pwrMgr.getSupplyVoltageMilli();
         if(disableBatteryCheck) {
             state.battState = PowerManager::BATT_DISABLED;
         } else {
             state.battState = pwrMgr.getBatteryState(state.battVoltage);
         }
+        wakeProfiler.endPhase(WakeProfiler::PHASE_BATTERY);
         ESP_LOGD(logTag, "Battery voltage: %02.2f V (%s)", roundf(state.battVoltage * 0.1f) * 0.01f,
             BATT_STATE_TO_STR(state.battState));
 
         // Get fill level of the reservoir, if not disabled.
         if(!disableReservoirCheck) {
+            wakeProfiler.startPhase(WakeProfiler::PHASE_FILL_SENSOR);
             int fillLevelMm = fillSensor.getFillLevel();
+            wakeProfiler.endPhase(WakeProfiler::PHASE_FILL_SENSOR);
             int fillLevel = 0;
 
             if(fillLevel < fillLevelMinVal) fillLevel = fillLevelMinVal;
@@ -290,11 +324,49 @@ void IrrigationController::taskFunc()
             outputCtrl.disableAllOutputs();
         }
 
+        // *********************
+        // Wakes without network
+        // *********************
+        // Only record the sensor data, unless something needs to be reported or done right now
+        if(!networkStarted) {
+            bool networkNeeded = false;
+
+            if((state.battState != irrigCtrlTelemetryBatch.knownBattState) ||
+                (state.reservoirState != irrigCtrlTelemetryBatch.knownReservoirState))
+            {
+                ESP_LOGI(logTag, "Sensor state changed. Bringing up the network.");
+                networkNeeded = true;
+            }
+
+            time_t nextEvent = irrigPlanner.getNextEventTime(irrigCtrlPersistentData.lastIrrigEvent, true);
+            if((nextEvent != 0) && (difftime(nextEvent, time(nullptr)) * 1000.0 <= noDeepSleepRangeMillis)) {
+                ESP_LOGI(logTag, "Event is approaching. Bringing up the network.");
+                networkNeeded = true;
+            }
+
+            if(pwrMgr.getKeepAwake() || outputCtrl.anyOutputsActive()) {
+                networkNeeded = true;
+            }
+
+            if(networkNeeded) {
+                startNetwork();
+                waitNetwork();
+            } else {
+                recordTelemetry();
+            }
+        }
+
         // *********************
         // Irrigation
         // *********************
         int millisTillNextEvent;
         bool eventsToProcess = true;
+
+        // Everything needed to process events is up now. Only wakes with network are learned
+        // from, because event wakes always bring it up.
+        if(firstRun) {
+            wakeCalibrator.controllerReady(networkStarted);
+        }
         while(eventsToProcess) {
             now = time(nullptr);
 
@@ -304,18 +376,12 @@ void IrrigationController::taskFunc()
                 ESP_LOGI(logTag, "Time set detected. Resetting event processing.");
                 // Recalculate lastIrrigEvent to not process events that haven't really 
                 // happend in-between last time and now.
-                struct tm nowTm;
-                localtime_r(&now, &nowTm);
-                nowTm.tm_sec--;
-                irrigCtrlPersistentData.lastIrrigEvent = mktime(&nowTm);
+                irrigCtrlPersistentData.lastIrrigEvent = now - 1;
 
                 // Calculate the next SNTP sync only if this was a manual time set event, otherwise
                 // the next sync time has already been set above
                 if(0 == (events & extEventTimeSetSntp)) {
-                    struct tm sntpNextSyncTm;
-                    localtime_r(&now, &sntpNextSyncTm);
-                    sntpNextSyncTm.tm_hour += sntpResyncIntervalHours;
-                    sntpNextSync = mktime(&sntpNextSyncTm);
+                    sntpNextSync = now + (time_t) (sntpResyncIntervalHours * 3600);
                     TimeSystem_SetNextSntpSync(sntpNextSync);
                 }
 
@@ -327,7 +393,9 @@ void IrrigationController::taskFunc()
                 // Note: Special handling of extEventIrrigConfigUpdated not needed, because getNextEventTime is done unconditionally
             }
 
+            wakeProfiler.startPhase(WakeProfiler::PHASE_PLANNER);
             nextIrrigEvent = irrigPlanner.getNextEventTime(irrigCtrlPersistentData.lastIrrigEvent, true);
+            wakeProfiler.endPhase(WakeProfiler::PHASE_PLANNER);
             state.nextIrrigEvent = nextIrrigEvent;
             millisTillNextEvent = (int) round(difftime(nextIrrigEvent, now) * 1000.0);
 
@@ -361,53 +429,47 @@ void IrrigationController::taskFunc()
                     eventTm.tm_mday, eventTm.tm_mon+1, 1900+eventTm.tm_year,
                     eventTm.tm_hour, eventTm.tm_min, eventTm.tm_sec);
 
-                constexpr int maxEventHandles = 8; // TBD: config parameter
-                IrrigationPlanner::event_handle_t eventHandles[maxEventHandles];
+                const IrrigationPlanner::due_event_t* dueEvents;
+                unsigned int numDueEvents;
+                struct timeval dispatchTv;
+
+                gettimeofday(&dispatchTv, nullptr);
+                int64_t dispatchMillis = ((int64_t) dispatchTv.tv_sec * 1000) + (dispatchTv.tv_usec / 1000);
 
-                plannerErr = irrigPlanner.getEventHandles(nextIrrigEvent, eventHandles, maxEventHandles);
+                wakeProfiler.startPhase(WakeProfiler::PHASE_PLANNER);
+                plannerErr = irrigPlanner.dispatchDueEvents(nextIrrigEvent, &dueEvents, &numDueEvents);
+                wakeProfiler.endPhase(WakeProfiler::PHASE_PLANNER);
                 if(IrrigationPlanner::ERR_OK != plannerErr) {
-                    ESP_LOGW(logTag, "Error getting event handles: %d. Trying our best anyway...", plannerErr);
+                    ESP_LOGW(logTag, "Error dispatching events: %d. Trying our best anyway...", plannerErr);
                 }
-                for(int cnt=0; cnt < maxEventHandles; cnt++) {
-                    IrrigationEvent::irrigation_event_data_t eventData;
-                    if(eventHandles[cnt].idx >= 0) {
-                        plannerErr = irrigPlanner.getEventData(eventHandles[cnt], &eventData);
-                        if(IrrigationPlanner::ERR_OK != plannerErr) {
-                            ESP_LOGE(logTag, "Error getting event data: %d. No actions available!", plannerErr);
-                        } else {
-                            static irrigation_zone_cfg_t zoneCfg;
-                            plannerErr = irrigPlanner.getZoneConfig(eventData.zoneIdx, &zoneCfg);
-                            bool zoneCfgIsValid = true;
-                            if(IrrigationPlanner::ERR_OK != plannerErr) {
-                                ESP_LOGE(logTag, "Error getting zone config: %d. No actions available!", plannerErr);
-                                zoneCfgIsValid = false;
-                            }
-
-                            bool isStartEvent = eventData.isStart;
-                            unsigned int durationSecs = isStartEvent ? eventData.durationSecs : 0;
-                            if(zoneCfgIsValid) {
-                                for(int i=0; i < irrigationZoneCfgElements; i++) {
-                                    if(zoneCfg.chEnabled[i]) {
-                                        ESP_LOGI(logTag, "* Channel: %s, state: %s, duration: %d s, start: %d", 
-                                        CH_MAP_TO_STR(zoneCfg.chNum[i]),
-                                        isStartEvent ? (zoneCfg.chStateStart[i] ? "ON" : "OFF") :
-                                                        (zoneCfg.chStateStop[i] ? "ON" : "OFF"),
-                                        durationSecs, isStartEvent);
-                                    }
-                                }
-                            }
+                for(unsigned int cnt=0; cnt < numDueEvents; cnt++) {
+                    const IrrigationPlanner::due_event_t* dueEvent = &dueEvents[cnt];
 
-                            plannerErr = irrigPlanner.confirmEvent(eventHandles[cnt]);
-                            if(IrrigationPlanner::ERR_OK != plannerErr) {
-                                ESP_LOGE(logTag, "Error confirming event: %d. Not performing its actions!", plannerErr);
-                            }
+                    if(!dueEvent->zoneCfgValid) {
+                        ESP_LOGE(logTag, "Error getting zone config. No actions available!");
+                    }
 
-                            if((zoneCfgIsValid) && (IrrigationPlanner::ERR_OK == plannerErr)) {
-                                setZoneOutputs(irrigOk, &zoneCfg, isStartEvent);
+                    bool isStartEvent = dueEvent->eventData.isStart;
+                    unsigned int durationSecs = isStartEvent ? dueEvent->eventData.durationSecs : 0;
+                    if(dueEvent->zoneCfgValid) {
+                        for(int i=0; i < irrigationZoneCfgElements; i++) {
+                            if(dueEvent->zoneCfg.chEnabled[i]) {
+                                ESP_LOGI(logTag, "* Channel: %s, state: %s, duration: %d s, start: %d", 
+                                CH_MAP_TO_STR(dueEvent->zoneCfg.chNum[i]),
+                                isStartEvent ? (dueEvent->zoneCfg.chStateStart[i] ? "ON" : "OFF") :
+                                                (dueEvent->zoneCfg.chStateStop[i] ? "ON" : "OFF"),
+                                durationSecs, isStartEvent);
                             }
                         }
-                    } else {
-                        break;
+                    }
+
+                    if(IrrigationPlanner::ERR_OK != dueEvent->confirmErr) {
+                        ESP_LOGE(logTag, "Error confirming event: %d. Not performing its actions!", dueEvent->confirmErr);
+                    }
+
+                    if((dueEvent->zoneCfgValid) && (IrrigationPlanner::ERR_OK == dueEvent->confirmErr)) {
+                        setZoneOutputs(irrigOk, &dueEvent->zoneCfg, isStartEvent);
+                        recordEventLatency(isStartEvent, nextIrrigEvent, dispatchMillis);
                     }
                 }
 
@@ -420,6 +482,7 @@ void IrrigationController::taskFunc()
             state.sntpLastSync = TimeSystem_GetLastSntpSync();
             state.sntpNextSync = TimeSystem_GetNextSntpSync();
             publishStateUpdate();
+            publishStatsUpdate();
         }
 
         // *********************
@@ -452,6 +515,7 @@ void IrrigationController::taskFunc()
             }
 
             if(!skipSntpResync) {
+                wakeProfiler.startPhase(WakeProfiler::PHASE_SNTP);
                 ESP_LOGI(logTag, "Requesting an SNTP time (re)sync.");
                 TimeSystem_SntpRequest();
 
@@ -462,29 +526,33 @@ void IrrigationController::taskFunc()
                 TimeSystem_SntpStop();
 
                 // Calculate the next SNTP sync
-                struct tm sntpNextSyncTm;
                 sntpNextSync = time(nullptr);
-                localtime_r(&sntpNextSync, &sntpNextSyncTm);
                 // Check status of sync to determine the next sync time
                 if(0 != (events & extEventTimeSetSntp)) {
                     ESP_LOGI(logTag, "SNTP time (re)sync was successful.");
-                    sntpNextSyncTm.tm_hour += sntpResyncIntervalHours;
+                    sntpNextSync += (time_t) (sntpResyncIntervalHours * 3600);
                 } else {
                     ESP_LOGW(logTag, "SNTP time (re)sync wasn't successful within timeout.");
-                    sntpNextSyncTm.tm_min += sntpResyncIntervalFailMinutes;
+                    sntpNextSync += (time_t) (sntpResyncIntervalFailMinutes * 60);
                 }
-                sntpNextSync = mktime(&sntpNextSyncTm);
                 TimeSystem_SetNextSntpSync(sntpNextSync);
 
                 // Update SNTP info
                 state.sntpLastSync = TimeSystem_GetLastSntpSync();
                 state.sntpNextSync = TimeSystem_GetNextSntpSync();
+                wakeProfiler.endPhase(WakeProfiler::PHASE_SNTP);
             }
         }
 
+        // Publish the wake profile of the previous wakes and the telemetry of wakes without network, if due
+        publishProfileUpdate();
+        publishTelemetryBatch();
+
         // *********************
         // Sleep preparation
         // *********************
+        wakeProfiler.startPhase(WakeProfiler::PHASE_SLEEP_PREP);
+
         // Get current time again for sleep calculation
         now = time(nullptr);
 
@@ -494,19 +562,13 @@ void IrrigationController::taskFunc()
             // Recalculate lastIrrigEvent and nextIrrig to not process events that haven't really 
             // happend in-between last time and now.
             ESP_LOGI(logTag, "Time set detected. Resetting event processing.");
-            struct tm nowTm;
-            localtime_r(&now, &nowTm);
-            nowTm.tm_sec--;
-            irrigCtrlPersistentData.lastIrrigEvent = mktime(&nowTm);
+            irrigCtrlPersistentData.lastIrrigEvent = now - 1;
             nextIrrigEvent = irrigPlanner.getNextEventTime(irrigCtrlPersistentData.lastIrrigEvent, true);
 
             // Calculate the next SNTP sync only if this was a manual time set event, otherwise
             // the next sync time has already been set above
             if(0 == (events & extEventTimeSetSntp)) {
-                struct tm sntpNextSyncTm;
-                localtime_r(&now, &sntpNextSyncTm);
-                sntpNextSyncTm.tm_hour += sntpResyncIntervalHours;
-                sntpNextSync = mktime(&sntpNextSyncTm);
+                sntpNextSync = now + (time_t) (sntpResyncIntervalHours * 3600);
                 TimeSystem_SetNextSntpSync(sntpNextSync);
             }
 
@@ -550,12 +612,18 @@ void IrrigationController::taskFunc()
                 ESP_LOGD(logTag, "Task sleep time longer than maximum allowed. "
                     "Task is going to sleep for %d ms insted.", sleepMillis);
             }
+            wakeProfiler.endPhase(WakeProfiler::PHASE_SLEEP_PREP);
+            wakeProfiler.endWake();
             vTaskDelay(pdMS_TO_TICKS(sleepMillis));
         } else {
             // Wait to get all updates through
+            wakeProfiler.endPhase(WakeProfiler::PHASE_SLEEP_PREP);
+            wakeProfiler.startPhase(WakeProfiler::PHASE_MQTT_FLUSH);
             if(!mqttMgr.waitAllPublished(mqttAllPublishedWaitMillis)) {
                 ESP_LOGW(logTag, "Waiting for MQTT to publish all messages didn't complete within timeout.");
             }
+            wakeProfiler.endPhase(WakeProfiler::PHASE_MQTT_FLUSH);
+            wakeProfiler.startPhase(WakeProfiler::PHASE_SLEEP_PREP);
 
             // TBD: stop webserver, mqtt and other stuff
 
@@ -577,9 +645,23 @@ void IrrigationController::taskFunc()
                 ESP_LOGD(logTag, "Loop runtime %d ms.", loopRunTimeMillis);
             }
 
-            int millisTillNextEventCompensated = millisTillNextEvent - preEventMillisDeepSleep - mqttAllPublishedWaitMillis;
+            // Waiting for MQTT took some time, so get the time till the next event again
+            struct timeval tv;
+            gettimeofday(&tv, nullptr);
+            int64_t nowMillis = ((int64_t) tv.tv_sec * 1000) + (tv.tv_usec / 1000);
+            if(nextIrrigEvent != 0) {
+                millisTillNextEvent = (int) (((int64_t) nextIrrigEvent * 1000) - nowMillis);
+            }
+
+            int wakeMarginMillis = wakeCalibrator.getMarginMillis(preEventMillisDeepSleep + mqttAllPublishedWaitMillis);
+            ESP_LOGD(logTag, "Deep sleep wakeup margin %d ms (%u samples).", wakeMarginMillis, wakeCalibrator.getNumSamples());
+            int millisTillNextEventCompensated = millisTillNextEvent - wakeMarginMillis;
             int sleepMillis = wakeupIntervalMillis - loopRunTimeMillis;
-            if((nextIrrigEvent != 0) && (sleepMillis > millisTillNextEventCompensated)) sleepMillis = millisTillNextEventCompensated;
+            bool eventWake = false;
+            if((nextIrrigEvent != 0) && (sleepMillis > millisTillNextEventCompensated)) {
+                sleepMillis = millisTillNextEventCompensated;
+                eventWake = true;
+            }
             if(sleepMillis < 500) sleepMillis = 500;
 
             // Check if there is enough wakeup time
@@ -592,6 +674,8 @@ void IrrigationController::taskFunc()
                     ESP_LOGD(logTag, "Task sleep time is bigger than maximum allowed. "
                         "Task is going to sleep for %d ms insted.", sleepMillis);
                 }
+                wakeProfiler.endPhase(WakeProfiler::PHASE_SLEEP_PREP);
+                wakeProfiler.endWake();
                 vTaskDelay(pdMS_TO_TICKS(sleepMillis));
             }
             // Check if any outputs are active, deep sleep would kill them!
@@ -602,6 +686,8 @@ void IrrigationController::taskFunc()
                     ESP_LOGD(logTag, "Task sleep time is bigger than maximum allowed. "
                         "Task is going to sleep for %d ms insted.", sleepMillis);
                 }
+                wakeProfiler.endPhase(WakeProfiler::PHASE_SLEEP_PREP);
+                wakeProfiler.endWake();
                 vTaskDelay(pdMS_TO_TICKS(sleepMillis));
             }
             else {
@@ -622,9 +708,15 @@ void IrrigationController::taskFunc()
 
                 if(sleepMillis < noDeepSleepRangeMillis) {
                     ESP_LOGW(logTag, "Compensating deep sleep time got too near to next event. Rebooting.");
+                    wakeProfiler.endPhase(WakeProfiler::PHASE_SLEEP_PREP);
+                    wakeProfiler.endWake();
                     pwrMgr.reboot();
                 } else {
                     ESP_LOGD(logTag, "Preparing deep sleep for %d ms.", sleepMillis);
+                    wakeProfiler.endPhase(WakeProfiler::PHASE_SLEEP_PREP);
+                    wakeProfiler.endWake();
+                    wakeCalibrator.sleepPlanned(sleepMillis);
+                    planNextWake(eventWake, sleepMillis);
                     pwrMgr.gotoSleep(sleepMillis);
                 }
             }
@@ -637,7 +729,7 @@ void IrrigationController::taskFunc()
     //pwrMgr->reboot();
 }
 
-void IrrigationController::setZoneOutputs(bool irrigOk, irrigation_zone_cfg_t* zoneCfg, bool start)
+void IrrigationController::setZoneOutputs(bool irrigOk, const irrigation_zone_cfg_t* zoneCfg, bool start)
 {
     for(int i=0; i < irrigationZoneCfgElements; i++) {
         if(zoneCfg->chEnabled[i]) {
@@ -660,106 +752,748 @@ void IrrigationController::setZoneOutputs(bool irrigOk, irrigation_zone_cfg_t* z
  */
 void IrrigationController::updateStateActiveOutputs(uint32_t chNum, bool active)
 {
-    bool inserted = false;
-    for(std::vector<uint32_t>::iterator it = state.activeOutputs.begin(); it != state.activeOutputs.end(); it++) {
-        if(!active) {
-            if(*it == chNum) {
-                state.activeOutputs.erase(it);
-                break;
-            }
-        } else {
-            if(*it > chNum) {
-                it = state.activeOutputs.insert(it, chNum);
-                inserted = true;
-                break;
-            } else if(*it == chNum) {
-                inserted = true;
-                break;
-            }
+    unsigned int num = state.numActiveOutputs;
+    unsigned int i = 0;
+
+    // Find the position of the channel in the sorted list
+    while((i < num) && (state.activeOutputs[i] < chNum)) i++;
+
+    if(!active) {
+        if((i < num) && (state.activeOutputs[i] == chNum)) {
+            memmove(&state.activeOutputs[i], &state.activeOutputs[i+1], (num - i - 1) * sizeof(state.activeOutputs[0]));
+            state.numActiveOutputs--;
+        }
+    } else if((i >= num) || (state.activeOutputs[i] != chNum)) {
+        if(num >= maxActiveOutputs) {
+            ESP_LOGE(logTag, "Too many active outputs. Not adding %u to the state.", chNum);
+            return;
         }
+        memmove(&state.activeOutputs[i+1], &state.activeOutputs[i], (num - i) * sizeof(state.activeOutputs[0]));
+        state.activeOutputs[i] = chNum;
+        state.numActiveOutputs++;
     }
+}
+
+/**
+ * @brief Get the fields of a state which differ from the published one.
+ * 
+ * Changes of the battery voltage and the fill level within their deadbands are ignored,
+ * unless one of the fill levels is negative (i.e. invalid or disabled).
+ * 
+ * @param current Current state
+ * @param published State as published the last time
+ * @return Bit mask of the changed fields (see state_field_t)
+ */
+uint32_t IrrigationController::getStateChanges(const state_t& current, const state_t& published) const
+{
+    uint32_t changes = 0;
+
+    int32_t battDiff = (int32_t) current.battVoltage - (int32_t) published.battVoltage;
+    if((0 != battDiff) && (abs(battDiff) >= battVoltageDeadbandMilli)) changes |= STATE_FIELD_BATT_VOLTAGE;
+    if(current.battState != published.battState) changes |= STATE_FIELD_BATT_STATE;
 
-    if(active && !inserted) {
-        state.activeOutputs.push_back(chNum);
+    int32_t fillDiff = current.fillLevel - published.fillLevel;
+    bool fillValid = (current.fillLevel >= 0) && (published.fillLevel >= 0);
+    if((0 != fillDiff) && ((!fillValid) || (abs(fillDiff) >= fillLevelDeadbandPercent10))) changes |= STATE_FIELD_FILL_LEVEL;
+    if(current.reservoirState != published.reservoirState) changes |= STATE_FIELD_RESERVOIR_STATE;
+
+    if( (current.numActiveOutputs != published.numActiveOutputs) ||
+        (0 != memcmp(current.activeOutputs, published.activeOutputs, current.numActiveOutputs * sizeof(current.activeOutputs[0]))) )
+    {
+        changes |= STATE_FIELD_ACTIVE_OUTPUTS;
     }
+
+    if(current.nextIrrigEvent != published.nextIrrigEvent) changes |= STATE_FIELD_NEXT_EVENT;
+    if(current.sntpLastSync != published.sntpLastSync) changes |= STATE_FIELD_SNTP_LAST_SYNC;
+    if(current.sntpNextSync != published.sntpNextSync) changes |= STATE_FIELD_SNTP_NEXT_SYNC;
+
+    return changes;
 }
 
 /**
- * @brief Publish currently stored state via MQTT.
+ * @brief Format state data as the payload of the MQTT state topics (compact JSON), e.g.
+ * {"batteryVoltage":12554,"batteryState":1,"batteryStateStr":"OK",...}
+ *
+ * @param stateData State to be formatted.
+ * @param fields Bit mask of the fields to be formatted (see state_field_t). STATE_FIELDS_ALL
+ * for a full snapshot.
+ * @param buf Destination buffer.
+ * @param bufLen Size of the destination buffer in bytes.
+ * @return Length of the formatted string (excl. the terminating zero). If it is
+ * greater than or equal to bufLen, the output has been truncated.
  */
-void IrrigationController::publishStateUpdate()
+size_t IrrigationController::formatStateData(const state_t& stateData, uint32_t fields, char* buf, size_t bufLen) const
+{
+    JsonWriter writer(buf, bufLen);
+    char timeStr[20];
+
+    writer.startObject(nullptr);
+    if(fields & STATE_FIELD_BATT_VOLTAGE) {
+        writer.addUint("batteryVoltage", stateData.battVoltage);
+    }
+    if(fields & STATE_FIELD_BATT_STATE) {
+        writer.addUint("batteryState", stateData.battState);
+        writer.addString("batteryStateStr", BATT_STATE_TO_STR(stateData.battState));
+    }
+    if(fields & STATE_FIELD_FILL_LEVEL) {
+        writer.addInt("reservoirFillLevel", stateData.fillLevel);
+    }
+    if(fields & STATE_FIELD_RESERVOIR_STATE) {
+        writer.addUint("reservoirState", stateData.reservoirState);
+        writer.addString("reservoirStateStr", RESERVOIR_STATE_TO_STR(stateData.reservoirState));
+    }
+    if(fields & STATE_FIELD_ACTIVE_OUTPUTS) {
+        writer.startArray("activeOutputs");
+        for(unsigned int i = 0; i < stateData.numActiveOutputs; i++) {
+            writer.addUint(nullptr, stateData.activeOutputs[i]);
+        }
+        writer.endArray();
+        writer.startArray("activeOutputsStr");
+        for(unsigned int i = 0; i < stateData.numActiveOutputs; i++) {
+            writer.addString(nullptr, CH_MAP_TO_STR(stateData.activeOutputs[i]));
+        }
+        writer.endArray();
+    }
+    if(fields & STATE_FIELD_NEXT_EVENT) {
+        formatLocalTime(stateData.nextIrrigEvent, timeStr, sizeof(timeStr));
+        writer.addString("nextIrrigationEvent", timeStr);
+    }
+    if(fields & STATE_FIELD_SNTP_LAST_SYNC) {
+        formatLocalTime(stateData.sntpLastSync, timeStr, sizeof(timeStr));
+        writer.addString("sntpLastSync", timeStr);
+    }
+    if(fields & STATE_FIELD_SNTP_NEXT_SYNC) {
+        formatLocalTime(stateData.sntpNextSync, timeStr, sizeof(timeStr));
+        writer.addString("sntpNextSync", timeStr);
+    }
+    writer.endObject();
+
+    return writer.getLength();
+}
+
+/**
+ * @brief Determine the size of the state data buffer by formatting full snapshots
+ * with the longest values possible, without writing them anywhere.
+ * 
+ * @return Length of the longest full snapshot incl. the terminating zero.
+ */
+size_t IrrigationController::getStateDataMaxLen(void) const
+{
+    state_t worstCase;
+    size_t maxLen = 0;
+
+    memset(&worstCase, 0, sizeof(state_t));
+    worstCase.battVoltage = UINT32_MAX;
+    worstCase.fillLevel = INT32_MIN;
+    for(unsigned int i = 0; i < maxActiveOutputs; i++) {
+        worstCase.activeOutputs[i] = OutputController::CH_MAIN + i;
+    }
+    worstCase.numActiveOutputs = maxActiveOutputs;
+
+    // The datetimes are of fixed length, but the state strings aren't
+    for(int batt = PowerManager::BATT_FULL; batt <= PowerManager::BATT_DISABLED; batt++) {
+        for(int reservoir = RESERVOIR_OK; reservoir <= RESERVOIR_DISABLED; reservoir++) {
+            worstCase.battState = (PowerManager::batt_state_t) batt;
+            worstCase.reservoirState = (reservoir_state_t) reservoir;
+            size_t len = formatStateData(worstCase, STATE_FIELDS_ALL, nullptr, 0);
+            if(len > maxLen) maxLen = len;
+        }
+    }
+
+    return maxLen + 1;
+}
+
+/**
+ * @brief Encode state data as CBOR payload of the MQTT state topics, i.e. a map of the
+ * state keys (see state_key_t) to enum codes, integers and epoch times.
+ *
+ * @param stateData State to be encoded.
+ * @param fields Bit mask of the fields to be encoded (see state_field_t). STATE_FIELDS_ALL
+ * for a full snapshot.
+ * @param buf Destination buffer.
+ * @param bufLen Size of the destination buffer in bytes.
+ * @return Length of the encoded data. If it is greater than bufLen, the output has been truncated.
+ */
+size_t IrrigationController::encodeStateData(const state_t& stateData, uint32_t fields, uint8_t* buf, size_t bufLen) const
+{
+    CborWriter writer(buf, bufLen);
+    uint32_t numPairs = 0;
+
+    fields &= STATE_FIELDS_ALL;
+    for(uint32_t f = fields; f != 0; f &= (f - 1)) numPairs++;
+
+    writer.startMap(numPairs);
+    if(fields & STATE_FIELD_BATT_VOLTAGE) {
+        writer.addUint(STATE_KEY_BATT_VOLTAGE);
+        writer.addUint(stateData.battVoltage);
+    }
+    if(fields & STATE_FIELD_BATT_STATE) {
+        writer.addUint(STATE_KEY_BATT_STATE);
+        writer.addUint(stateData.battState);
+    }
+    if(fields & STATE_FIELD_FILL_LEVEL) {
+        writer.addUint(STATE_KEY_FILL_LEVEL);
+        writer.addInt(stateData.fillLevel);
+    }
+    if(fields & STATE_FIELD_RESERVOIR_STATE) {
+        writer.addUint(STATE_KEY_RESERVOIR_STATE);
+        writer.addUint(stateData.reservoirState);
+    }
+    if(fields & STATE_FIELD_ACTIVE_OUTPUTS) {
+        writer.addUint(STATE_KEY_ACTIVE_OUTPUTS);
+        writer.startArray(stateData.numActiveOutputs);
+        for(unsigned int i = 0; i < stateData.numActiveOutputs; i++) {
+            writer.addUint(stateData.activeOutputs[i]);
+        }
+    }
+    if(fields & STATE_FIELD_NEXT_EVENT) {
+        writer.addUint(STATE_KEY_NEXT_EVENT);
+        writer.addInt(stateData.nextIrrigEvent);
+    }
+    if(fields & STATE_FIELD_SNTP_LAST_SYNC) {
+        writer.addUint(STATE_KEY_SNTP_LAST_SYNC);
+        writer.addInt(stateData.sntpLastSync);
+    }
+    if(fields & STATE_FIELD_SNTP_NEXT_SYNC) {
+        writer.addUint(STATE_KEY_SNTP_NEXT_SYNC);
+        writer.addInt(stateData.sntpNextSync);
+    }
+
+    return writer.getLength();
+}
+
+/**
+ * @brief Build an MQTT topic of the form &lt;pre&gt;&lt;MAC address&gt;&lt;post&gt;.
+ * 
+ * @param topic Destination buffer. Must be large enough for both parts + 12 digits of the MAC address.
+ * @param pre Topic prefix
+ * @param macAddr 6 byte MAC address
+ * @param post Topic postfix
+ */
+void IrrigationController::buildMqttTopic(char* topic, const char* pre, const uint8_t* macAddr, const char* post)
+{
+    size_t preLen = strlen(pre);
+    size_t postLen = strlen(post);
+
+    memcpy(topic, pre, preLen);
+    for(int i=0; i<6; i++) {
+        sprintf(&topic[preLen+i*2], "%02x", macAddr[i]);
+    }
+    memcpy(&topic[preLen+12], post, postLen);
+    topic[preLen+12+postLen] = 0;
+}
+
+/**
+ * @brief Prepare the MQTT topics, if that hasn't been done yet.
+ * 
+ * @return Wether or not the topics are ready to be used.
+ */
+bool IrrigationController::prepareMqttTopics(void)
 {
     static uint8_t mac_addr[6];
-    static char timeStr[20];
-    static char sntpLastSyncTimeStr[20];
-    static char sntpNextSyncTimeStr[20];
-    static char activeOutputs[4*(OutputController::intChannels+OutputController::extChannels)+1];
-    static char activeOutputsStr[8*(OutputController::intChannels+OutputController::extChannels)+1];
-    size_t preLen;
-    size_t postLen;
-
-    // TBD: Compare more lax, i.e. allow little differences in batt voltage, etc.
-    int stateCmp = memcmp(&state, &lastState, sizeof(state_t));
-
-    if(0 != stateCmp) {
-        if(false == mqttMgr.waitConnected(mqttConnectedWaitMillis)) {
+
+    if(!mqttPrepared) {
+        if(ESP_OK == esp_wifi_get_mac(ESP_IF_WIFI_STA, mac_addr)) {
+            buildMqttTopic(mqttStateTopic, mqttTopicPre, mac_addr, mqttStateTopicPost);
+            buildMqttTopic(mqttStateDeltaTopic, mqttTopicPre, mac_addr, mqttStateDeltaTopicPost);
+            buildMqttTopic(mqttStatsTopic, mqttTopicPre, mac_addr, mqttStatsTopicPost);
+            buildMqttTopic(mqttProfileTopic, mqttTopicPre, mac_addr, mqttProfileTopicPost);
+            buildMqttTopic(mqttTelemetryTopic, mqttTopicPre, mac_addr, mqttTelemetryTopicPost);
+            mqttPrepared = true;
+        } else {
+            ESP_LOGE(logTag, "Getting MAC address failed!");
+        }
+    }
+
+    return mqttPrepared;
+}
+
+/**
+ * @brief Publish the currently stored state via MQTT, if it changed since the last publish.
+ * 
+ * The full state is published to the state topic and retained, so it is always current.
+ * Additionally, the changed fields are published to the state delta topic (except for the
+ * first update after power on), for subscribers only interested in changes.
+ */
+void IrrigationController::publishStateUpdate()
+{
+    // Wakes without network keep the state for the next network wake
+    if(!networkStarted) return;
+
+    published_state_t* published = &irrigCtrlPublishedState;
+    uint32_t changes = getStateChanges(state, published->state);
+
+    if(0 != changes) {
+        wakeProfiler.startPhase(WakeProfiler::PHASE_MQTT_CONNECT);
+        bool connected = mqttMgr.waitConnected(mqttConnectedWaitMillis);
+        wakeProfiler.endPhase(WakeProfiler::PHASE_MQTT_CONNECT);
+
+        if(false == connected) {
             ESP_LOGW(logTag, "MQTT manager has no connection after timeout.");
         } else {
-            if(!mqttPrepared) {
-                if(ESP_OK == esp_wifi_get_mac(ESP_IF_WIFI_STA, mac_addr)) {
-                    preLen = strlen(mqttTopicPre);
-                    postLen = strlen(mqttStateTopicPost);
-                    memcpy(mqttStateTopic, mqttTopicPre, preLen);
-                    for(int i=0; i<6; i++) {
-                        sprintf(&mqttStateTopic[preLen+i*2], "%02x", mac_addr[i]);
+            if(prepareMqttTopics()) {
+                wakeProfiler.startPhase(WakeProfiler::PHASE_MQTT_PUBLISH);
+                if(publishState(mqttStateTopic, STATE_FIELDS_ALL, true)) {
+                    if(published->valid) {
+                        publishState(mqttStateDeltaTopic, changes, false);
                     }
-                    memcpy(&mqttStateTopic[preLen+12], mqttStateTopicPost, postLen);
-                    mqttStateTopic[preLen+12+postLen] = 0;
-                    mqttPrepared = true;
-                } else {
-                    ESP_LOGE(logTag, "Getting MAC address failed!");
+                    published->state = state;
+                    published->valid = true;
                 }
+                wakeProfiler.endPhase(WakeProfiler::PHASE_MQTT_PUBLISH);
             }
+        }
+    }
+}
 
-            if(mqttPrepared) {
-                // Prepare next irrigation string
-                struct tm nextIrrigEventTm;
-                localtime_r(&state.nextIrrigEvent, &nextIrrigEventTm);
-                strftime(timeStr, 20, "%Y-%m-%d %H:%M:%S", &nextIrrigEventTm);
-
-                // Prepare next+last SNTP sync strings
-                struct tm sntpLastSyncTm;
-                localtime_r(&state.sntpLastSync, &sntpLastSyncTm);
-                strftime(sntpLastSyncTimeStr, 20, "%Y-%m-%d %H:%M:%S", &sntpLastSyncTm);
-
-                struct tm sntpNextSyncTm;
-                localtime_r(&state.sntpNextSync, &sntpNextSyncTm);
-                strftime(sntpNextSyncTimeStr, 20, "%Y-%m-%d %H:%M:%S", &sntpNextSyncTm);
-
-                // Prepare active outputs strings
-                activeOutputs[0] = '\0';
-                activeOutputsStr[0] = '\0';
-                for(std::vector<uint32_t>::iterator it = state.activeOutputs.begin(); it != state.activeOutputs.end(); it++) {
-                    snprintf(activeOutputs, sizeof(activeOutputs) / sizeof(activeOutputs[0]),
-                        "%s%s%d", activeOutputs, (it==state.activeOutputs.begin()) ? "" : ", ", *it);
-                    snprintf(activeOutputsStr, sizeof(activeOutputsStr) / sizeof(activeOutputsStr[0]),
-                        "%s%s\"%s\"", activeOutputsStr, (it==state.activeOutputs.begin()) ? "" : ", ", CH_MAP_TO_STR(*it));
-                }
+/**
+ * @brief Publish fields of the currently stored state via MQTT.
+ * 
+ * @param topic Topic to publish to.
+ * @param fields Bit mask of the fields to be published (see state_field_t).
+ * @param retain Wether or not the broker shall retain the message.
+ * @return Wether or not the state has been published.
+ */
+bool IrrigationController::publishState(const char* topic, uint32_t fields, bool retain)
+{
+    size_t actualLen;
 
-                // Build the string to be send
-                size_t actualLen = snprintf(mqttStateData, mqttStateDataMaxLen, mqttStateDataFmt,
-                    state.battVoltage, state.battState, BATT_STATE_TO_STR(state.battState), 
-                    state.fillLevel, state.reservoirState, RESERVOIR_STATE_TO_STR(state.reservoirState),
-                    activeOutputs, activeOutputsStr, timeStr, sntpLastSyncTimeStr, sntpNextSyncTimeStr);
-                mqttMgr.publish(mqttStateTopic, mqttStateData, actualLen, MqttManager::QOS_EXACTLY_ONCE, true);
+    if(PAYLOAD_CBOR == stateEncoding) {
+        // Unlike the string formatting, no terminating zero is needed
+        actualLen = encodeStateData(state, fields, (uint8_t*) mqttStateData, mqttStateDataMaxLen - 1);
+    } else {
+        actualLen = formatStateData(state, fields, mqttStateData, mqttStateDataMaxLen);
+    }
 
-                // Copy the sent state over to lastState, but only if we actually sent it and not in the other cases
-                memcpy(&lastState, &state, sizeof(state_t));
+    if(actualLen >= mqttStateDataMaxLen) {
+        ESP_LOGE(logTag, "State data doesn't fit the buffer. Not publishing it.");
+        return false;
+    }
+
+    if(MqttManager::ERR_OK != mqttMgr.publish(topic, mqttStateData, actualLen, MqttManager::QOS_EXACTLY_ONCE, retain)) {
+        ESP_LOGW(logTag, "Publishing the state failed.");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Get the upper bound of a latency histogram bucket.
+ * 
+ * @param bucket Bucket index (0 .. latencyBucketCount-1)
+ * @return Inclusive upper bound in milliseconds. UINT32_MAX for the last (open) bucket.
+ */
+uint32_t IrrigationController::getLatencyBucketUpperMillis(unsigned int bucket)
+{
+    if(bucket >= (latencyBucketCount - 1)) return UINT32_MAX;
+    return latencyBucketUpperMillis[bucket];
+}
+
+/**
+ * @brief Add a single latency to a histogram. Must be called within the stats critical section.
+ * 
+ * @param hist Histogram to update
+ * @param latencyMillis Latency in milliseconds
+ * @param plannedTime Planned time of the event
+ */
+void IrrigationController::addLatencyToHistogram(latency_histogram_t* hist, uint32_t latencyMillis, time_t plannedTime)
+{
+    unsigned int bucket = 0;
+
+    while((bucket < (latencyBucketCount - 1)) && (latencyMillis > latencyBucketUpperMillis[bucket])) {
+        bucket++;
+    }
+
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->sumMillis += latencyMillis;
+    if((1 == hist->count) || (latencyMillis > hist->maxMillis)) {
+        hist->maxMillis = latencyMillis;
+        hist->maxEventTime = plannedTime;
+    }
+}
+
+/**
+ * @brief Record the latency between the planned time of an event and the time it has
+ * actually been processed at.
+ * 
+ * @param isStart Wether the event is a start or a stop event
+ * @param plannedTime Planned time of the event
+ * @param actualMillis Time the event has been processed at in milliseconds since the epoch
+ */
+void IrrigationController::recordEventLatency(bool isStart, time_t plannedTime, int64_t actualMillis)
+{
+    int64_t latency = actualMillis - ((int64_t) plannedTime * 1000);
+
+    // Events may be processed up to a second early, see the dispatch condition of the task loop
+    if(latency < 0) latency = 0;
+    if(latency > UINT32_MAX) latency = UINT32_MAX;
+
+    portENTER_CRITICAL(&latencyStatsMux);
+    addLatencyToHistogram(isStart ? &irrigCtrlLatencyStats.start : &irrigCtrlLatencyStats.stop,
+        (uint32_t) latency, plannedTime);
+    irrigCtrlLatencyStats.publishPending = true;
+    portEXIT_CRITICAL(&latencyStatsMux);
+
+    if(latency >= latencyWarnMillis) {
+        ESP_LOGW(logTag, "%s event processed late by %u ms.", isStart ? "Start" : "Stop", (uint32_t) latency);
+    }
+}
+
+/**
+ * @brief Get a consistent copy of the event latency statistics.
+ * 
+ * @param dst Destination of the copy
+ */
+void IrrigationController::getEventLatencyStats(event_latency_stats_t* dst)
+{
+    portENTER_CRITICAL(&latencyStatsMux);
+    memcpy(dst, &irrigCtrlLatencyStats, sizeof(event_latency_stats_t));
+    portEXIT_CRITICAL(&latencyStatsMux);
+}
+
+/**
+ * @brief Clear the event latency statistics.
+ */
+void IrrigationController::resetEventLatencyStats(void)
+{
+    portENTER_CRITICAL(&latencyStatsMux);
+    memset(&irrigCtrlLatencyStats, 0, sizeof(event_latency_stats_t));
+    irrigCtrlLatencyStats.publishPending = true;
+    portEXIT_CRITICAL(&latencyStatsMux);
+}
+
+/**
+ * @brief Format the event latency statistics as compact JSON.
+ * 
+ * @param stats Statistics to format
+ * @param buf Destination buffer
+ * @param bufLen Size of the destination buffer
+ * @return Length of the formatted string (excl. the terminating zero). If it is
+ * greater than or equal to bufLen, the output has been truncated.
+ */
+size_t IrrigationController::formatEventLatencyStats(const event_latency_stats_t& stats, char* buf, size_t bufLen) const
+{
+    const latency_histogram_t* hists[2] = { &stats.start, &stats.stop };
+    const char* histNames[2] = { "startLatency", "stopLatency" };
+    JsonWriter writer(buf, bufLen);
+
+    writer.startObject(nullptr);
+    writer.startArray("histBoundsMillis");
+    for(unsigned int i = 0; i < (latencyBucketCount - 1); i++) {
+        writer.addUint(nullptr, latencyBucketUpperMillis[i]);
+    }
+    writer.endArray();
+
+    for(unsigned int h = 0; h < 2; h++) {
+        const latency_histogram_t* hist = hists[h];
+        uint32_t avg = (hist->count > 0) ? (uint32_t) (hist->sumMillis / hist->count) : 0;
+
+        writer.startObject(histNames[h]);
+        writer.addUint("count", hist->count);
+        writer.addUint("avgMillis", avg);
+        writer.addUint("maxMillis", hist->maxMillis);
+        writer.addInt("maxEvent", hist->maxEventTime);
+        writer.startArray("hist");
+        for(unsigned int i = 0; i < latencyBucketCount; i++) {
+            writer.addUint(nullptr, hist->buckets[i]);
+        }
+        writer.endArray();
+        writer.endObject();
+    }
+    writer.endObject();
+
+    return writer.getLength();
+}
+
+/**
+ * @brief Publish the event latency statistics via MQTT, if they changed since the last publish.
+ */
+void IrrigationController::publishStatsUpdate()
+{
+    static event_latency_stats_t stats;
+    static char statsData[mqttStatsDataMaxLen];
+
+    if(!networkStarted) return;
+
+    getEventLatencyStats(&stats);
+
+    if(stats.publishPending) {
+        wakeProfiler.startPhase(WakeProfiler::PHASE_MQTT_CONNECT);
+        bool connected = mqttMgr.waitConnected(mqttConnectedWaitMillis);
+        wakeProfiler.endPhase(WakeProfiler::PHASE_MQTT_CONNECT);
+
+        if(false == connected) {
+            ESP_LOGW(logTag, "MQTT manager has no connection after timeout.");
+        } else if(prepareMqttTopics()) {
+            wakeProfiler.startPhase(WakeProfiler::PHASE_MQTT_PUBLISH);
+            size_t actualLen = formatEventLatencyStats(stats, statsData, sizeof(statsData));
+            if(actualLen >= sizeof(statsData)) {
+                ESP_LOGE(logTag, "Latency stats don't fit the buffer. Not publishing them.");
+            } else {
+                mqttMgr.publish(mqttStatsTopic, statsData, actualLen, MqttManager::QOS_EXACTLY_ONCE, true);
+
+                portENTER_CRITICAL(&latencyStatsMux);
+                irrigCtrlLatencyStats.publishPending = false;
+                portEXIT_CRITICAL(&latencyStatsMux);
+            }
+            wakeProfiler.endPhase(WakeProfiler::PHASE_MQTT_PUBLISH);
+        }
+    }
+}
+
+/**
+ * @brief Publish the wake profile aggregates via MQTT, if the profiler has recorded
+ * enough new wakes since the last publish.
+ */
+void IrrigationController::publishProfileUpdate()
+{
+    static WakeProfiler::aggregates_t aggr;
+    static char profileData[mqttProfileDataMaxLen];
+
+    if(networkStarted && wakeProfiler.isPublishDue()) {
+        wakeProfiler.startPhase(WakeProfiler::PHASE_MQTT_CONNECT);
+        bool connected = mqttMgr.waitConnected(mqttConnectedWaitMillis);
+        wakeProfiler.endPhase(WakeProfiler::PHASE_MQTT_CONNECT);
+
+        if(false == connected) {
+            ESP_LOGW(logTag, "MQTT manager has no connection after timeout.");
+        } else if(prepareMqttTopics()) {
+            wakeProfiler.startPhase(WakeProfiler::PHASE_MQTT_PUBLISH);
+            wakeProfiler.getAggregates(&aggr);
+            size_t actualLen = wakeProfiler.formatAggregates(aggr, profileData, sizeof(profileData));
+            if(actualLen >= sizeof(profileData)) {
+                ESP_LOGE(logTag, "Wake profile doesn't fit the buffer. Not publishing it.");
+            } else {
+                ESP_LOGD(logTag, "Wake profile: %s", profileData);
+                mqttMgr.publish(mqttProfileTopic, profileData, actualLen, MqttManager::QOS_EXACTLY_ONCE, true);
+                wakeProfiler.setPublished();
+            }
+            wakeProfiler.endPhase(WakeProfiler::PHASE_MQTT_PUBLISH);
+        }
+    }
+}
+
+/**
+ * @brief Check if WiFi should be started on this boot.
+ * 
+ * Called before the task is started. Only timer wakeups from deep sleep may skip the
+ * network, all other boots (power on, reset, keep awake input) bring it up.
+ * 
+ * @return Wether or not WiFi should be started.
+ */
+bool IrrigationController::isNetworkWakeRequired(void) const
+{
+    if(networkWakeInterval <= 1) return true;
+    if(ESP_SLEEP_WAKEUP_TIMER != esp_sleep_get_wakeup_cause()) return true;
+    return irrigCtrlTelemetryBatch.nextWakeNetwork;
+}
+
+/**
+ * @brief Start WiFi, if it hasn't been started yet. The WiFi event handler will
+ * start the MQTT client as soon as the connection is up.
+ */
+void IrrigationController::startNetwork(void)
+{
+    if(!networkStarted) {
+        esp_err_t err = esp_wifi_start();
+        if(ESP_OK != err) {
+            ESP_LOGE(logTag, "Starting WiFi failed: %d", err);
+        } else {
+            networkStarted = true;
+        }
+    }
+}
+
+/**
+ * @brief Wait for WiFi to come up.
+ * 
+ * @return Wether or not WiFi is connected.
+ */
+bool IrrigationController::waitNetwork(void)
+{
+    EventBits_t events;
+    // TBD: make configurable (globally), implement WiFiManager for that
+    TickType_t wait = portMAX_DELAY;
+
+    if(wifiConnectedWaitMillis >= 0) {
+        wait = pdMS_TO_TICKS(wifiConnectedWaitMillis);
+    }
+
+    wakeProfiler.startPhase(WakeProfiler::PHASE_WIFI);
+    events = xEventGroupWaitBits(wifiEvents, wifiEventConnected, pdFALSE, pdTRUE, wait);
+    wakeProfiler.endPhase(WakeProfiler::PHASE_WIFI);
+
+    if(0 != (events & wifiEventConnected)) {
+        ESP_LOGD(logTag, "WiFi connected.");
+        return true;
+    }
+
+    ESP_LOGE(logTag, "WiFi didn't come up within timeout!");
+    return false;
+}
+
+/**
+ * @brief Append the current sensor data to the telemetry batch. If the batch is full,
+ * the oldest sample is dropped.
+ */
+void IrrigationController::recordTelemetry(void)
+{
+    telemetry_record_t* record = &irrigCtrlTelemetryBatch.records[irrigCtrlTelemetryBatch.head];
+
+    record->time = (uint32_t) time(nullptr);
+    record->battVoltage = (uint16_t) ((state.battVoltage > UINT16_MAX) ? UINT16_MAX : state.battVoltage);
+    record->fillLevel = (int16_t) state.fillLevel;
+    record->battState = (uint8_t) state.battState;
+    record->reservoirState = (uint8_t) state.reservoirState;
+
+    irrigCtrlTelemetryBatch.head = (irrigCtrlTelemetryBatch.head + 1) % telemetryBatchSize;
+    if(irrigCtrlTelemetryBatch.count < telemetryBatchSize) {
+        irrigCtrlTelemetryBatch.count++;
+    }
+    ESP_LOGD(logTag, "Telemetry recorded (%u samples batched).", irrigCtrlTelemetryBatch.count);
+}
+
+/**
+ * @brief Format the telemetry batch as compact JSON, oldest sample first. Each sample is
+ * an array of time, battery voltage, fill level, battery state and reservoir state, e.g.
+ * {"samples":[[1521612000,12554,-2,1,3],...]}
+ * 
+ * @param buf Destination buffer
+ * @param bufLen Size of the destination buffer
+ * @return Length of the formatted string (excl. the terminating zero). If it is
+ * greater than or equal to bufLen, the output has been truncated.
+ */
+size_t IrrigationController::formatTelemetryBatch(char* buf, size_t bufLen) const
+{
+    unsigned int count = irrigCtrlTelemetryBatch.count;
+    unsigned int idx = (irrigCtrlTelemetryBatch.head + telemetryBatchSize - count) % telemetryBatchSize;
+    JsonWriter writer(buf, bufLen);
+
+    writer.startObject(nullptr);
+    writer.startArray("samples");
+    for(unsigned int i = 0; i < count; i++) {
+        const telemetry_record_t* record = &irrigCtrlTelemetryBatch.records[idx];
+
+        writer.startArray(nullptr);
+        writer.addUint(nullptr, record->time);
+        writer.addUint(nullptr, record->battVoltage);
+        writer.addInt(nullptr, record->fillLevel);
+        writer.addUint(nullptr, record->battState);
+        writer.addUint(nullptr, record->reservoirState);
+        writer.endArray();
+        idx = (idx + 1) % telemetryBatchSize;
+    }
+    writer.endArray();
+    writer.endObject();
+
+    return writer.getLength();
+}
+
+/**
+ * @brief Encode the telemetry batch as CBOR, oldest sample first. Like the JSON format,
+ * it is an array of samples, each of them an array of time, battery voltage, fill level,
+ * battery state and reservoir state.
+ * 
+ * @param buf Destination buffer
+ * @param bufLen Size of the destination buffer
+ * @return Length of the encoded data. If it is greater than bufLen, the output has been truncated.
+ */
+size_t IrrigationController::encodeTelemetryBatch(uint8_t* buf, size_t bufLen) const
+{
+    unsigned int count = irrigCtrlTelemetryBatch.count;
+    unsigned int idx = (irrigCtrlTelemetryBatch.head + telemetryBatchSize - count) % telemetryBatchSize;
+    CborWriter writer(buf, bufLen);
+
+    writer.startArray(count);
+    for(unsigned int i = 0; i < count; i++) {
+        const telemetry_record_t* record = &irrigCtrlTelemetryBatch.records[idx];
+
+        writer.startArray(telemetrySampleItems);
+        writer.addUint(record->time);
+        writer.addUint(record->battVoltage);
+        writer.addInt(record->fillLevel);
+        writer.addUint(record->battState);
+        writer.addUint(record->reservoirState);
+        idx = (idx + 1) % telemetryBatchSize;
+    }
+
+    return writer.getLength();
+}
+
+/**
+ * @brief Publish the batched telemetry of the wakes without network via MQTT in a single
+ * message and clear the batch.
+ */
+void IrrigationController::publishTelemetryBatch(void)
+{
+    static char telemetryData[mqttTelemetryDataMaxLen];
+
+    if(networkStarted && (irrigCtrlTelemetryBatch.count > 0)) {
+        wakeProfiler.startPhase(WakeProfiler::PHASE_MQTT_CONNECT);
+        bool connected = mqttMgr.waitConnected(mqttConnectedWaitMillis);
+        wakeProfiler.endPhase(WakeProfiler::PHASE_MQTT_CONNECT);
+
+        if(false == connected) {
+            ESP_LOGW(logTag, "MQTT manager has no connection after timeout.");
+        } else if(prepareMqttTopics()) {
+            wakeProfiler.startPhase(WakeProfiler::PHASE_MQTT_PUBLISH);
+            size_t actualLen;
+            if(PAYLOAD_CBOR == telemetryEncoding) {
+                actualLen = encodeTelemetryBatch((uint8_t*) telemetryData, sizeof(telemetryData) - 1);
+            } else {
+                actualLen = formatTelemetryBatch(telemetryData, sizeof(telemetryData));
             }
+            if(actualLen >= sizeof(telemetryData)) {
+                ESP_LOGE(logTag, "Telemetry batch doesn't fit the buffer. Not publishing it.");
+            } else if(MqttManager::ERR_OK == mqttMgr.publish(mqttTelemetryTopic, telemetryData, actualLen,
+                MqttManager::QOS_EXACTLY_ONCE, false))
+            {
+                ESP_LOGD(logTag, "Published %u telemetry samples.", irrigCtrlTelemetryBatch.count);
+                irrigCtrlTelemetryBatch.count = 0;
+            }
+            wakeProfiler.endPhase(WakeProfiler::PHASE_MQTT_PUBLISH);
         }
     }
 }
 
+/**
+ * @brief Decide wether the next timer wakeup brings up the network. Must be called
+ * right before entering deep sleep.
+ * 
+ * @param eventWake Wether the wakeup has been planned for an upcoming event
+ * @param sleepMillis Deep sleep duration in milliseconds
+ */
+void IrrigationController::planNextWake(bool eventWake, int sleepMillis)
+{
+    bool network = (networkWakeInterval <= 1) || eventWake;
+
+    if(networkStarted) {
+        irrigCtrlTelemetryBatch.wakesSinceNetwork = 0;
+        irrigCtrlTelemetryBatch.knownBattState = (uint8_t) state.battState;
+        irrigCtrlTelemetryBatch.knownReservoirState = (uint8_t) state.reservoirState;
+    } else {
+        irrigCtrlTelemetryBatch.wakesSinceNetwork++;
+    }
+
+    if(irrigCtrlTelemetryBatch.wakesSinceNetwork + 1 >= networkWakeInterval) {
+        network = true;
+    }
+    if(irrigCtrlTelemetryBatch.count >= telemetryBatchSize) {
+        network = true;
+    }
+
+    // The SNTP resync needs the network
+    time_t sntpNextSync = TimeSystem_GetNextSntpSync();
+    if((sntpNextSync == 0) || (difftime(sntpNextSync, time(nullptr)) * 1000.0 <= sleepMillis)) {
+        network = true;
+    }
+
+    irrigCtrlTelemetryBatch.nextWakeNetwork = network;
+    ESP_LOGD(logTag, "Next wake %s network.", network ? "with" : "without");
+}
+
 /**
  * @brief This function handles events when a new time has been set.
  * 
@@ -1,5 +1,7 @@
 #include "irrigationEvent.h"
 
+#include "globalComponents.h"
+
 /**
  * @brief Default constructor, which performs basic initialization.
  */
@@ -9,6 +11,16 @@ IrrigationEvent::IrrigationEvent(void)
     repetitionType = NOT_SET;
     refTime = 0;
 
+    nextOccuranceCache = 0;
+    nextOccuranceCacheValid = false;
+    nextOccuranceCacheTzGen = 0;
+    nextOccuranceCacheSolarGen = 0;
+
+    memset(&eventTime, 0, sizeof(struct tm));
+    memset(&recurrence, 0, sizeof(recurrence_t));
+    solarEvent = SolarTable::SUNRISE;
+    solarOffsetSecs = 0;
+
     eventData.zoneIdx = -1;
     eventData.durationSecs = 1;
     eventData.isStart = true;
@@ -24,7 +36,7 @@ IrrigationEvent::~IrrigationEvent(void)
 
 IrrigationEvent::err_t IrrigationEvent::setZoneIndex(int idx)
 {
-    if((idx < -1) || (idx >= irrigationZoneCfgElements)) {
+    if((idx < -1) || (idx >= IrrigationCapacity::numZones)) {
         return ERR_INVALID_PARAM;
     }
 
@@ -42,7 +54,7 @@ void IrrigationEvent::setStartFlag(bool isStart)
     eventData.isStart = isStart;
 }
 
-IrrigationEvent::err_t IrrigationEvent::getEventData(irrigation_event_data_t* dest)
+IrrigationEvent::err_t IrrigationEvent::getEventData(irrigation_event_data_t* dest) const
 {
     if(nullptr == dest) return ERR_INVALID_PARAM;
 
@@ -72,6 +84,7 @@ IrrigationEvent::err_t IrrigationEvent::setSingleEvent(int hour, int minute, int
         eventTime.tm_isdst = -1;
 
         repetitionType = SINGLE;
+        nextOccuranceCacheValid = false;
     }
 
     return ret;
@@ -91,22 +104,211 @@ IrrigationEvent::err_t IrrigationEvent::setDailyRepetition(int hour, int minute,
         eventTime.tm_sec = second;
 
         repetitionType = DAILY;
+        nextOccuranceCacheValid = false;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Set up a weekly repetition of this event.
+ * 
+ * @param hour Hour of the day 0..23.
+ * @param minute Minute of the hour 0..59.
+ * @param second Second of the minute 0..59.
+ * @param weekdays Bitmask of the days of the week, bit 0 = sunday.
+ * @return IrrigationEvent::err_t ERR_OK on success, ERR_INVALID_TIME otherwise.
+ */
+IrrigationEvent::err_t IrrigationEvent::setWeeklyRepetition(int hour, int minute, int second, uint8_t weekdays)
+{
+    recurrence_t rec;
+
+    if((hour < 0) || (hour > 23)) return ERR_INVALID_TIME;
+    if((minute < 0) || (minute > 59)) return ERR_INVALID_TIME;
+    if((second < 0) || (second > 59)) return ERR_INVALID_TIME;
+
+    rec.minutes = 1ull << minute;
+    rec.hours = 1ul << hour;
+    rec.daysOfMonth = recurrenceAllDaysOfMonth;
+    rec.months = recurrenceAllMonths;
+    rec.weekdays = weekdays;
+    rec.second = second;
+
+    err_t ret = setRecurrence(rec);
+    if(ERR_OK == ret) {
+        repetitionType = WEEKLY;
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Set up a monthly repetition of this event.
+ * 
+ * Note: Months without the specified day are skipped, i.e. no clamping to the
+ * last day of the month is performed.
+ * 
+ * @param hour Hour of the day 0..23.
+ * @param minute Minute of the hour 0..59.
+ * @param second Second of the minute 0..59.
+ * @param day Day of the month 1..31.
+ * @return IrrigationEvent::err_t ERR_OK on success, ERR_INVALID_TIME otherwise.
+ */
+IrrigationEvent::err_t IrrigationEvent::setMonthlyRepetition(int hour, int minute, int second, int day)
+{
+    recurrence_t rec;
+
+    if((hour < 0) || (hour > 23)) return ERR_INVALID_TIME;
+    if((minute < 0) || (minute > 59)) return ERR_INVALID_TIME;
+    if((second < 0) || (second > 59)) return ERR_INVALID_TIME;
+    if((day < 1) || (day > 31)) return ERR_INVALID_TIME;
+
+    rec.minutes = 1ull << minute;
+    rec.hours = 1ul << hour;
+    rec.daysOfMonth = 1ul << day;
+    rec.months = recurrenceAllMonths;
+    rec.weekdays = recurrenceAllWeekdays;
+    rec.second = second;
+
+    err_t ret = setRecurrence(rec);
+    if(ERR_OK == ret) {
+        repetitionType = MONTHLY;
     }
 
     return ret;
 }
 
+/**
+ * @brief Set up a cron-style recurrence of this event.
+ * 
+ * Each field of the recurrence must contain at least one valid bit and no bits
+ * outside of its valid range.
+ * 
+ * @param rec Compiled recurrence to be used.
+ * @return IrrigationEvent::err_t ERR_OK on success, ERR_INVALID_TIME otherwise.
+ */
+IrrigationEvent::err_t IrrigationEvent::setRecurrence(const recurrence_t& rec)
+{
+    if((0 == rec.minutes) || (0 != (rec.minutes & ~recurrenceAllMinutes))) return ERR_INVALID_TIME;
+    if((0 == rec.hours) || (0 != (rec.hours & ~recurrenceAllHours))) return ERR_INVALID_TIME;
+    if((0 == rec.daysOfMonth) || (0 != (rec.daysOfMonth & ~recurrenceAllDaysOfMonth))) return ERR_INVALID_TIME;
+    if((0 == rec.months) || (0 != (rec.months & ~recurrenceAllMonths))) return ERR_INVALID_TIME;
+    if((0 == rec.weekdays) || (0 != (rec.weekdays & ~recurrenceAllWeekdays))) return ERR_INVALID_TIME;
+    if(rec.second > 59) return ERR_INVALID_TIME;
+
+    recurrence = rec;
+
+    repetitionType = RECURRENCE;
+    nextOccuranceCacheValid = false;
+
+    return ERR_OK;
+}
+
+/**
+ * @brief Set up a daily repetition relative to sunrise or sunset.
+ * 
+ * Note: Days without the solar event (i.e. polar night or midnight sun) are skipped.
+ * No event occurs as long as no location is configured.
+ * 
+ * @param event Solar event the event is anchored to.
+ * @param offsetSecs Offset relative to the solar event in seconds, e.g. -1800 for 30 minutes before.
+ * @return IrrigationEvent::err_t ERR_OK on success, ERR_INVALID_PARAM/ERR_INVALID_TIME otherwise.
+ */
+IrrigationEvent::err_t IrrigationEvent::setSolarRepetition(SolarTable::solar_event_t event, int offsetSecs)
+{
+    if((event != SolarTable::SUNRISE) && (event != SolarTable::SUNSET)) return ERR_INVALID_PARAM;
+    if((offsetSecs < -solarMaxOffsetSecs) || (offsetSecs > solarMaxOffsetSecs)) return ERR_INVALID_TIME;
+
+    solarEvent = event;
+    solarOffsetSecs = offsetSecs;
+
+    repetitionType = SOLAR;
+    nextOccuranceCacheValid = false;
+
+    return ERR_OK;
+}
+
+/**
+ * @brief Get the definition of this event, e.g. to store it in binary form.
+ * 
+ * @param dest Destination of the definition. Padding bytes are cleared, so equal
+ * definitions are bytewise equal.
+ */
+void IrrigationEvent::getDefinition(event_definition_t* dest) const
+{
+    memset(dest, 0, sizeof(event_definition_t));
+
+    dest->recurrence = recurrence;
+    dest->durationSecs = eventData.durationSecs;
+    dest->solarOffsetSecs = solarOffsetSecs;
+    dest->zoneIdx = eventData.zoneIdx;
+    dest->isStart = eventData.isStart;
+    dest->repetitionType = repetitionType;
+    dest->solarEvent = solarEvent;
+
+    // Only the time fields set by setSingleEvent() and setDailyRepetition() are used
+    if((SINGLE == repetitionType) || (DAILY == repetitionType)) {
+        dest->hour = eventTime.tm_hour;
+        dest->minute = eventTime.tm_min;
+        dest->second = eventTime.tm_sec;
+    }
+    if(SINGLE == repetitionType) {
+        dest->day = eventTime.tm_mday;
+        dest->month = eventTime.tm_mon + 1;
+        dest->year = eventTime.tm_year + 1900;
+    }
+}
+
+/**
+ * @brief Restore a definition obtained by getDefinition(). The reference time is kept.
+ * 
+ * Only the ranges needed for a safe operation are checked, i.e. the definition should
+ * originate from a validated event.
+ * 
+ * @param def Definition to be restored.
+ * @return IrrigationEvent::err_t ERR_OK on success, ERR_INVALID_PARAM otherwise.
+ */
+IrrigationEvent::err_t IrrigationEvent::setDefinition(const event_definition_t& def)
+{
+    if(def.repetitionType > SOLAR) return ERR_INVALID_PARAM;
+    if((def.solarEvent != SolarTable::SUNRISE) && (def.solarEvent != SolarTable::SUNSET)) return ERR_INVALID_PARAM;
+    if(ERR_OK != setZoneIndex(def.zoneIdx)) return ERR_INVALID_PARAM;
+
+    repetitionType = (repetition_type_t) def.repetitionType;
+    eventData.durationSecs = def.durationSecs;
+    eventData.isStart = def.isStart;
+    memset(&eventTime, 0, sizeof(struct tm));
+    eventTime.tm_hour = def.hour;
+    eventTime.tm_min = def.minute;
+    eventTime.tm_sec = def.second;
+    eventTime.tm_mday = def.day;
+    eventTime.tm_mon = def.month - 1;
+    eventTime.tm_year = def.year - 1900;
+    eventTime.tm_isdst = -1;
+    recurrence = def.recurrence;
+    solarEvent = (SolarTable::solar_event_t) def.solarEvent;
+    solarOffsetSecs = def.solarOffsetSecs;
+
+    nextOccuranceCacheValid = false;
+
+    return ERR_OK;
+}
+
 /**
  * @brief Update the reference time for this event.
  * 
  * The reference time is used for comparing repetitive events against each other
  * and to calculate the next occurance of such events.
+ * The cached next occurance is only dropped if the reference time actually changes.
  * 
  * @param ref New reference time to be set.
  */
 void IrrigationEvent::updateReferenceTime(time_t ref)
 {
-    refTime = ref;
+    if(ref != refTime) {
+        refTime = ref;
+        nextOccuranceCacheValid = false;
+    }
 }
 
 /**
@@ -125,47 +327,383 @@ time_t IrrigationEvent::getReferenceTime(void)
  * Note: If an event has exactly the same time as the reference, it will be reported
  * as the next occurance, i.e. it will not be reported for the following day/week/month.
  * 
+ * The result is cached, because the calendar conversions are expensive and the
+ * comparison operators query it multiple times. The cache gets invalidated as
+ * soon as the reference time, the event definition, the timezone or the solar
+ * table changes.
+ * 
  * @return time_t Time of next occurance.
  */
 time_t IrrigationEvent::getNextOccurance(void) const
 {
-    time_t next = 0;
+    uint32_t tzGen = civilTime.getRuleGeneration();
+    uint32_t solarGen = solarTable.getGeneration();
+
+    if(!nextOccuranceCacheValid || (nextOccuranceCacheTzGen != tzGen) || (nextOccuranceCacheSolarGen != solarGen)) {
+        nextOccuranceCache = calcNextOccurance(refTime);
+        nextOccuranceCacheValid = true;
+        nextOccuranceCacheTzGen = tzGen;
+        nextOccuranceCacheSolarGen = solarGen;
+    }
 
-    struct tm refTm;
-    struct tm nextTm;
-    struct tm eventTm = eventTime; // make a copy to keep the underlying object const
+    return nextOccuranceCache;
+}
+
+/**
+ * @brief Calculate the next occurance of this event at or after the given time.
+ * 
+ * In contrast to getNextOccurance(), neither the reference time nor the cache are
+ * touched, i.e. the event may be shared (e.g. as part of a configuration snapshot).
+ * 
+ * @param ref Reference time to calculate the next occurance for.
+ * @return time_t Time of next occurance.
+ */
+time_t IrrigationEvent::calcNextOccurance(time_t ref) const
+{
+    time_t next = 0;
 
     if(repetitionType == SINGLE) {
-        next = mktime(&eventTm);
+        next = civilTime.civilToUtc(eventTime.tm_year + 1900, eventTime.tm_mon + 1, eventTime.tm_mday,
+            eventTime.tm_hour, eventTime.tm_min, eventTime.tm_sec);
     }
     else if(repetitionType == DAILY) {
-        // Convert reference time_t for easier handling
-        localtime_r(&refTime, &refTm);
-
-        // Make a full copy of it
-        memcpy(&nextTm, &refTm, sizeof(struct tm));
-        // ... and replace h:m:s
-        nextTm.tm_hour = eventTm.tm_hour;
-        nextTm.tm_min = eventTm.tm_min;
-        nextTm.tm_sec = eventTm.tm_sec;
-
-        // Adjust day in case event has already passed today
-        // Note: mktime below will fixup month/hour/... overflows
-        uint32_t refDaySecs = refTm.tm_hour*60*60 + refTm.tm_min*60 + refTm.tm_sec;
-        uint32_t nextDaySecs = nextTm.tm_hour*60*60 + nextTm.tm_min*60 + nextTm.tm_sec;
-        if(refDaySecs > nextDaySecs) {
-            nextTm.tm_mday++;
+        // Local day of the reference time
+        int64_t refDays = CivilTime::floorDiv(civilTime.utcToLocal(ref), CivilTime::secsPerDay);
+        int32_t nextDaySecs = eventTime.tm_hour*60*60 + eventTime.tm_min*60 + eventTime.tm_sec;
+
+        // DST handling (i.e. gaps and ambiguous times) is done by the conversion
+        next = civilTime.localToUtc(refDays * CivilTime::secsPerDay + nextDaySecs);
+
+        // Adjust day in case event has already passed today. Compare in UTC, because
+        // times within the DST gap are shifted behind it, i.e. they may still be ahead
+        // although the wall clock is already beyond them.
+        if(next < ref) {
+            next = civilTime.localToUtc((refDays + 1) * CivilTime::secsPerDay + nextDaySecs);
+        }
+    }
+    else if((repetitionType == WEEKLY) || (repetitionType == MONTHLY) || (repetitionType == RECURRENCE)) {
+        next = calcNextRecurrence(ref);
+    }
+    else if(repetitionType == SOLAR) {
+        next = calcNextSolarEvent(ref);
+    }
+
+    if(next < ref) next = 0; // don't return events in the past
+    return next;
+}
+
+/**
+ * @brief Check if this event repeats, i.e. if it is anything but a SINGLE event.
+ * 
+ * @return true Event repeats, so a missing next occurance may be transient.
+ * @return false Event occurs once or isn't set.
+ */
+bool IrrigationEvent::isRepeating(void) const
+{
+    return (repetitionType != NOT_SET) && (repetitionType != SINGLE);
+}
+
+/**
+ * @brief Calculate the next match of the recurrence at or after the given time.
+ * 
+ * The search skips non-matching months and days by scanning the recurrence bitsets,
+ * so the effort is bounded by the number of months searched, not the number of days.
+ * 
+ * @param ref Reference time to start searching at.
+ * @return time_t Time of next match or 0 if there is none within the search range.
+ */
+time_t IrrigationEvent::calcNextRecurrence(time_t ref) const
+{
+    int year, month, day;
+    int hour, minute;
+    int32_t gapStartSecs, gapSecs;
+
+    // Times within the DST gap are shifted behind it, so matches up to the gap length
+    // before the local reference time may still be ahead
+    civilTime.getDstGap(&gapStartSecs, &gapSecs);
+
+    // Split the local reference time into date and time of the day
+    int64_t refLocal = civilTime.utcToLocal(ref) - gapSecs;
+    int64_t refDays = CivilTime::floorDiv(refLocal, CivilTime::secsPerDay);
+    int32_t refDaySecs = (int32_t) (refLocal - refDays * CivilTime::secsPerDay);
+    CivilTime::civilFromDays(refDays, &year, &month, &day);
+
+    int fromHour = refDaySecs / 3600;
+    int fromMinute = (refDaySecs / 60) % 60;
+    // The second is fixed, so the current minute has passed if we are beyond it
+    if((refDaySecs % 60) > recurrence.second) fromMinute++;
+
+    for(int i = 0; i < recurrenceSearchMaxMonths; i++) {
+        if(0 != (recurrence.months & (1u << month))) {
+            uint32_t dayMask = getRecurrenceDayMask(year, month);
+
+            for(int d = nextSetBit(dayMask, day); d >= 0; d = nextSetBit(dayMask, d + 1)) {
+                if(d != day) {
+                    // Following days are searched from their very beginning
+                    fromHour = 0;
+                    fromMinute = 0;
+                }
+                while(findRecurrenceTimeOfDay(fromHour, fromMinute, &hour, &minute)) {
+                    int64_t localSecs = CivilTime::daysFromCivil(year, month, d) * CivilTime::secsPerDay +
+                        hour*60*60 + minute*60 + recurrence.second;
+                    // DST handling (i.e. gaps and ambiguous times) is done by the conversion. Compare
+                    // in UTC, since the first instance of an ambiguous time may have passed already.
+                    time_t next = civilTime.localToUtc(localSecs);
+                    if(next >= ref) return next;
+
+                    // Continue with the following minute, a minute of 60 moves on to the next hour
+                    fromHour = hour;
+                    fromMinute = minute + 1;
+                }
+            }
+        }
+
+        // Continue with the beginning of the next month
+        month++;
+        if(month > 12) {
+            month = 1;
+            year++;
+        }
+        day = 1;
+        fromHour = 0;
+        fromMinute = 0;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Calculate the next solar event at or after the given time.
+ * 
+ * The solar table is based on UTC, so the days are iterated in UTC without
+ * any timezone handling.
+ * 
+ * @param ref Reference time to start searching at.
+ * @return time_t Time of next solar event or 0 if there is none (e.g. no location configured).
+ */
+time_t IrrigationEvent::calcNextSolarEvent(time_t ref) const
+{
+    int32_t eventSecs;
+
+    if(!solarTable.isSet()) return 0;
+
+    // Start one day early, because table entries may lie outside of their UTC day
+    int64_t firstDay = CivilTime::floorDiv((int64_t) ref - solarOffsetSecs, CivilTime::secsPerDay) - 1;
+
+    for(int64_t d = firstDay; d < firstDay + solarSearchMaxDays; d++) {
+        if(solarTable.getEventTime(solarEvent, d, &eventSecs)) {
+            int64_t next = d * CivilTime::secsPerDay + eventSecs + solarOffsetSecs;
+            if(next >= ref) return (time_t) next;
         }
+    }
 
-        // Set DST status to not available, because it may be different by 
-        // the modifications modifications
-        nextTm.tm_isdst = -1;
+    return 0;
+}
 
-        next = mktime(&nextTm);
+/**
+ * @brief Find the first time of the day matching the recurrence at or after the
+ * specified time.
+ * 
+ * @param fromHour Hour to start searching at.
+ * @param fromMinute Minute to start searching at. May be 60 to start at the following hour.
+ * @param hour Matching hour.
+ * @param minute Matching minute.
+ * @return true if a match was found, false otherwise.
+ */
+bool IrrigationEvent::findRecurrenceTimeOfDay(int fromHour, int fromMinute, int* hour, int* minute) const
+{
+    int h = nextSetBit(recurrence.hours, fromHour);
+    if(h < 0) return false;
+
+    int m = -1;
+    if(h == fromHour) {
+        m = nextSetBit(recurrence.minutes, fromMinute);
+        if(m < 0) {
+            // Current hour has no more matching minutes
+            h = nextSetBit(recurrence.hours, fromHour + 1);
+            if(h < 0) return false;
+        }
+    }
+    if(m < 0) {
+        m = nextSetBit(recurrence.minutes, 0);
     }
 
-    if(next < refTime) next = 0; // don't return events in the past
-    return next;
+    *hour = h;
+    *minute = m;
+    return true;
+}
+
+/**
+ * @brief Get the days of the specified month matching both the day of the month
+ * and the day of the week masks of the recurrence.
+ * 
+ * @param year Full year, e.g. 2018.
+ * @param month Month 1..12.
+ * @return uint32_t Bitmask of the matching days, bit n = day n.
+ */
+uint32_t IrrigationEvent::getRecurrenceDayMask(int year, int month) const
+{
+    int firstWeekday = CivilTime::weekdayFromDays(CivilTime::daysFromCivil(year, month, 1));
+
+    // Build the weekday pattern of the first week, starting with the first day of the month ...
+    uint32_t pattern = 0;
+    for(int i = 0; i < 7; i++) {
+        if(0 != (recurrence.weekdays & (1u << ((firstWeekday + i) % 7)))) {
+            pattern |= (1u << i);
+        }
+    }
+    // ... and repeat it for the following weeks. Bit 0 is day 1 at this point.
+    uint64_t weekdayMask = pattern | (pattern << 7) | (pattern << 14) | (pattern << 21) | ((uint64_t) pattern << 28);
+
+    uint32_t validDays = (uint32_t) (((1ull << CivilTime::daysInMonth(year, month)) - 1) << 1);
+    return (uint32_t) (weekdayMask << 1) & validDays & recurrence.daysOfMonth;
+}
+
+/**
+ * @brief Get the index of the lowest set bit at or above the specified index.
+ * 
+ * @param mask Bitmask to be scanned.
+ * @param from Bit index to start scanning at.
+ * @return int Index of the found bit or -1 if there is none.
+ */
+int IrrigationEvent::nextSetBit(uint64_t mask, int from)
+{
+    if((from < 0) || (from > 63)) return -1;
+
+    mask &= (~0ull) << from;
+    if(0 == mask) return -1;
+
+    return __builtin_ctzll(mask);
+}
+
+/**
+ * @brief Add the irrigations of this event running on a day of the week to a coverage of
+ * the day, i.e. occurances whose stop event is pending.
+ *
+ * The coverage is a difference array over the minutes of the day, i.e. the number of
+ * irrigations running in minute m is the sum of the entries 0..m. Irrigations started on
+ * previous days are included. The estimation is conservative: Repetitions are assumed to
+ * occur on each of their weekdays regardless of the days of month and months, SOLAR
+ * events, whose time of day varies, are assumed to start anytime and an irrigation ending
+ * in the minute another one starts counts as overlapping.
+ *
+ * On days with a DST gap, local time jumps forward by it. Irrigations across the gap end
+ * the gap later in local time, so they are extended by it, and ones started within it are
+ * shifted behind it. Pass a dstGapSecs of 0 for regular days.
+ *
+ * @param coverage Difference array of dayCoverageSlots + 1 entries.
+ * @param weekday Day of the week 0..6, 0 = sunday.
+ * @param dstGapStartSecs Local time of day the DST gap starts at (see CivilTime::getDstGap()).
+ * @param dstGapSecs Length of the DST gap, 0 for days without one.
+ */
+void IrrigationEvent::addDayCoverage(int32_t* coverage, int weekday, int32_t dstGapStartSecs, int32_t dstGapSecs) const
+{
+    int64_t lenSecs = eventData.durationSecs;
+
+    if(lenSecs > dayCoverageMaxLenSecs) lenSecs = dayCoverageMaxLenSecs;
+
+    switch(repetitionType) {
+        case SINGLE: {
+            int64_t days = CivilTime::daysFromCivil(eventTime.tm_year + 1900, eventTime.tm_mon + 1, eventTime.tm_mday);
+            addDayCoverageInterval(coverage, weekday, 1u << CivilTime::weekdayFromDays(days), false,
+                eventTime.tm_hour*60*60 + eventTime.tm_min*60 + eventTime.tm_sec, lenSecs, dstGapStartSecs, dstGapSecs);
+            break;
+        }
+        case DAILY:
+            addDayCoverageInterval(coverage, weekday, recurrenceAllWeekdays, true,
+                eventTime.tm_hour*60*60 + eventTime.tm_min*60 + eventTime.tm_sec, lenSecs, dstGapStartSecs, dstGapSecs);
+            break;
+        case WEEKLY:
+        case MONTHLY:
+        case RECURRENCE:
+            for(int hour = nextSetBit(recurrence.hours, 0); (hour >= 0) && (hour < 24); hour = nextSetBit(recurrence.hours, hour + 1)) {
+                for(int minute = nextSetBit(recurrence.minutes, 0); (minute >= 0) && (minute < 60); minute = nextSetBit(recurrence.minutes, minute + 1)) {
+                    addDayCoverageInterval(coverage, weekday, recurrence.weekdays, true,
+                        hour*60*60 + minute*60 + recurrence.second, lenSecs, dstGapStartSecs, dstGapSecs);
+                }
+            }
+            break;
+        case SOLAR:
+            // One irrigation per day starting in any minute, i.e. starting at midnight and lasting a day longer
+            addDayCoverageInterval(coverage, weekday, recurrenceAllWeekdays, true,
+                0, lenSecs + CivilTime::secsPerDay - 60, dstGapStartSecs, dstGapSecs);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Add the part of an irrigation running on a day of the week to a coverage of the
+ * day (see addDayCoverage()). The irrigation starts at the same time on each of its
+ * weekdays, so the ones of previous days may still be running.
+ *
+ * @param coverage Difference array of dayCoverageSlots + 1 entries.
+ * @param weekday Day of the week of the coverage 0..6, 0 = sunday.
+ * @param weekdays Bitmask of the days of the week the irrigation starts at, bit 0 = sunday.
+ * @param repeating Wether or not the irrigation repeats every week. Otherwise it starts once.
+ * @param startSecs Start of the irrigation in seconds after midnight.
+ * @param lenSecs Length of the irrigation in seconds.
+ * @param dstGapStartSecs Local time of day the DST gap starts at.
+ * @param dstGapSecs Length of the DST gap, 0 if there is none.
+ */
+void IrrigationEvent::addDayCoverageInterval(int32_t* coverage, int weekday, uint8_t weekdays, bool repeating,
+    int32_t startSecs, int64_t lenSecs, int32_t dstGapStartSecs, int32_t dstGapSecs)
+{
+    const int32_t daySecs = CivilTime::secsPerDay;
+    const int32_t lastSlot = dayCoverageSlots - 1;
+
+    if(dstGapSecs > 0) {
+        int32_t nextGapStart = (startSecs < dstGapStartSecs + dstGapSecs) ? dstGapStartSecs : (dstGapStartSecs + daySecs);
+        if((startSecs >= dstGapStartSecs) && (startSecs < dstGapStartSecs + dstGapSecs) && (startSecs + dstGapSecs < daySecs)) {
+            startSecs += dstGapSecs;
+        } else if(startSecs + lenSecs > nextGapStart) {
+            lenSecs += dstGapSecs;
+        }
+    }
+
+    // An irrigation starting once can't overlap itself, it runs the whole week at most
+    if(!repeating && (lenSecs >= 7 * daySecs)) {
+        addDayCoverageSlots(coverage, 0, lastSlot, 1);
+        return;
+    }
+
+    int64_t endSecs = startSecs + lenSecs;
+    int64_t lastDay = endSecs / daySecs;                    // Days after the start day the irrigation runs on
+
+    // Started on the day itself
+    if(0 != (weekdays & (1u << weekday))) {
+        addDayCoverageSlots(coverage, startSecs / 60, (lastDay > 0) ? lastSlot : (int32_t) (endSecs / 60), 1);
+    }
+
+    if(lastDay < 1) return;
+
+    // Started on previous days and running all day: count the matching weekdays 1..lastDay-1 days ago
+    int64_t fullDays = lastDay - 1;
+    int32_t count = (int32_t) (fullDays / 7) * __builtin_popcount(weekdays);
+    for(int i = 1; i <= (fullDays % 7); i++) {
+        if(0 != (weekdays & (1u << ((weekday - i + 7) % 7)))) count++;
+    }
+    addDayCoverageSlots(coverage, 0, lastSlot, count);
+
+    // Started lastDay days ago and ending on the day
+    if(0 != (weekdays & (1u << ((weekday - (lastDay % 7) + 7) % 7)))) {
+        addDayCoverageSlots(coverage, 0, (int32_t) ((endSecs - lastDay * daySecs) / 60), 1);
+    }
+}
+
+/**
+ * @brief Add a number of irrigations to a range of minutes of a coverage of the day.
+ *
+ * @param coverage Difference array of dayCoverageSlots + 1 entries.
+ * @param firstSlot First minute of the day.
+ * @param lastSlot Last minute of the day, inclusive.
+ * @param count Number of irrigations.
+ */
+void IrrigationEvent::addDayCoverageSlots(int32_t* coverage, int32_t firstSlot, int32_t lastSlot, int32_t count)
+{
+    coverage[firstSlot] += count;
+    coverage[lastSlot + 1] -= count;
 }
 
 /**
@@ -194,7 +732,7 @@ bool IrrigationEvent::operator<(const IrrigationEvent& rhs) const
     time_t us_time = getNextOccurance();
 
     if(us_time != 0) {
-        return (getNextOccurance() < rhs.getNextOccurance());
+        return (us_time < rhs.getNextOccurance());
     } else {
         // If we are invalid, report us as greater, because this will interfere the least with irrigation planning
         return false;
@@ -209,7 +747,7 @@ bool IrrigationEvent::operator<=(const IrrigationEvent& rhs) const
     time_t us_time = getNextOccurance();
 
     if(us_time != 0) {
-        return (getNextOccurance() <= rhs.getNextOccurance());
+        return (us_time <= rhs.getNextOccurance());
     } else {
         // If we are invalid, report us as greater, because this will interfere the least with irrigation planning
         return false;
@@ -224,7 +762,7 @@ bool IrrigationEvent::operator>(const IrrigationEvent& rhs) const
     time_t us_time = getNextOccurance();
 
     if(us_time != 0) {
-        return (getNextOccurance() > rhs.getNextOccurance());
+        return (us_time > rhs.getNextOccurance());
     } else {
         // If we are invalid, report us as greater, because this will interfere the least with irrigation planning
         return true;
@@ -239,7 +777,7 @@ bool IrrigationEvent::operator>=(const IrrigationEvent& rhs) const
     time_t us_time = getNextOccurance();
 
     if(us_time != 0) {
-        return (getNextOccurance() >= rhs.getNextOccurance());
+        return (us_time >= rhs.getNextOccurance());
     } else {
         // If we are invalid, report us as greater, because this will interfere the least with irrigation planning
         return true;
@@ -14,19 +14,19 @@
  */
 IrrigationPlanner::IrrigationPlanner()
 {
-    // Prepare event and zone storages
-    for(int i = 0; i < irrigationPlannerNumZones; i++) {
-        zones[i].name[irrigationZoneCfgNameLen] = '\0';
-        for(int j=0; j < irrigationZoneCfgElements; j++) {
-            zones[i].chEnabled[j] = false;
-        }
-    }
+    config = nullptr;
+
+    timelineLen = 0;
     for(int i = 0; i < irrigationPlannerNumEvents; i++) {
-        eventsUsed[i] = false;
+        timelinePosStart[i] = -1;
     }
     for(int i = 0; i < irrigationPlannerNumStopEvents; i++) {
-        stopEventsUsed[i] = false;
+        timelinePosStop[i] = -1;
     }
+    timelineRefTime = 0;
+    timelineValid = false;
+    timelineTzGen = 0;
+    timelineSolarGen = 0;
 
     configUpdatedHook = nullptr;
     configUpdatedHookParamPtr = nullptr;
@@ -40,18 +40,12 @@ IrrigationPlanner::IrrigationPlanner()
  */
 IrrigationPlanner::~IrrigationPlanner()
 {
-    // clean up all events and zones
-    for(int i = 0; i < irrigationPlannerNumZones; i++) {
-        zones[i].name[irrigationZoneCfgNameLen] = '\0';
-        for(int j=0; j < irrigationZoneCfgElements; j++) {
-            zones[i].chEnabled[j] = false;
-        }
-    }
-    for(int i = 0; i < irrigationPlannerNumEvents; i++) {
-        eventsUsed[i] = false;
-    }
-    for(int i = 0; i < irrigationPlannerNumStopEvents; i++) {
-        stopEventsUsed[i] = false;
+    // clean up all events and release the configuration
+    singleShotEvents.clear();
+    stopEvents.clear();
+    if(nullptr != config) {
+        settingsMgr.releaseIrrigationConfig(config);
+        config = nullptr;
     }
 
     if (accessMutex) vSemaphoreDelete(accessMutex);
@@ -61,6 +55,10 @@ IrrigationPlanner::~IrrigationPlanner()
 /**
  * @brief Get the time of the next occuring event starting at startTime.
  * 
+ * The next event is taken from the timeline. Only the events that have passed since
+ * the previous call are re-evaluated, each in O(log n). The timeline is rebuilt
+ * entirely if startTime moves backwards or the timezone/solar table changed.
+ * 
  * @param startTime Start time to consider for searching the next occurance
  * @param excludeStartTime If true, only search for events later than startTime, not equal.
  * @return time_t Time of the next occuring event.
@@ -69,88 +67,37 @@ time_t IrrigationPlanner::getNextEventTime(time_t startTime, bool excludeStartTi
 {
     time_t nextEventTime = 0;
 
-    int nextStartEventIdx;
-    int nextStopEventIdx;
-
     if(excludeStartTime) {
-        // convert startTime to time to easily increase the startTime by one sec
-        struct tm startTimeTm;
-        localtime_r(&startTime, &startTimeTm);
-        startTimeTm.tm_sec++;
-        // and convert it back to time_t, inc. wrap-arounds
-        startTime = mktime(&startTimeTm);
+        startTime++;
     }
 
     if (pdFALSE == xSemaphoreTake(accessMutex, lockAcquireTimeout)) {
         ESP_LOGE(logTag, "Couldn't acquire access lock within timeout!");
     } else {
-        // getting the index will update all of the reference times as well
-        nextStartEventIdx = getNextEventIdx(startTime, events, eventsUsed, irrigationPlannerNumEvents);
-        nextStopEventIdx = getNextEventIdx(startTime, stopEvents, stopEventsUsed, irrigationPlannerNumStopEvents);
-
-        if(nextStartEventIdx >= 0) {
-            if(nextStopEventIdx >= 0) {
-                if(events[nextStartEventIdx] < stopEvents[nextStopEventIdx]) {
-                    nextEventTime = events[nextStartEventIdx].getNextOccurance();
-                } else {
-                    nextEventTime = stopEvents[nextStopEventIdx].getNextOccurance();
-                }
-            } else {
-                nextEventTime = events[nextStartEventIdx].getNextOccurance();
-            }
+        if( !timelineValid || (startTime < timelineRefTime) ||
+            (timelineTzGen != civilTime.getRuleGeneration()) || (timelineSolarGen != solarTable.getGeneration()) )
+        {
+            rebuildTimeline(startTime);
         } else {
-            if(nextStopEventIdx >= 0) {
-                nextEventTime = stopEvents[nextStopEventIdx].getNextOccurance();
+            // Move passed events to their next occurance
+            while((timelineLen > 0) && (timeline[0].time < startTime)) {
+                timelineUpdate(timeline[0].handle, startTime);
             }
+            timelineRefTime = startTime;
         }
 
-        xSemaphoreGive(accessMutex);
-    }
+        if(timelineLen > 0) {
+            nextEventTime = timeline[0].time;
 
-    return nextEventTime;
-}
-
-/**
- * @brief Get the index of the next upcoming event in the specified list.
- * 
- * @param startTime Start time to consider for searching the next occurance
- * @param eventList Event list to search.
- * @param eventUsedList Used event list corresponding to eventList.
- * @return int Inedx the next occuring event within the list.
- */
-int IrrigationPlanner::getNextEventIdx(time_t startTime, IrrigationEvent* eventList, bool* eventUsedList, 
-    unsigned int listElements)
-{
-    int nextIdx = -1;
-    IrrigationEvent* nextEvent = nullptr;
-
-    for(int i=0; i < listElements; i++) {
-        if((nullptr != nextEvent) && eventUsedList[i]) {
-            eventList[i].updateReferenceTime(startTime);
-            if((eventList[i].getNextOccurance() != 0) && (eventList[i] < *nextEvent)) {
-                nextIdx = i;
-                nextEvent = &eventList[i];
-
-                #ifdef IRRIGATION_PLANNER_NEXT_EVENT_DEBUG
-                    printEventDetails(nextEvent);
-                    ESP_LOGD(logTag, "This is our new candidate!");
-                #endif
-            }
-        } else if(eventUsedList[i]) {
-            eventList[i].updateReferenceTime(startTime);
-            if(eventList[i].getNextOccurance() != 0) {
-                nextIdx = i;
-                nextEvent = &eventList[i];
-
-                #ifdef IRRIGATION_PLANNER_NEXT_EVENT_DEBUG
-                    printEventDetails(nextEvent);
-                    ESP_LOGD(logTag, "This is our new candidate!");
-                #endif
-            }
+            #ifdef IRRIGATION_PLANNER_NEXT_EVENT_DEBUG
+                printEventDetails(getEventPtr(timeline[0].handle));
+            #endif
         }
+
+        xSemaphoreGive(accessMutex);
     }
 
-    return nextIdx;
+    return nextEventTime;
 }
 
 /**
@@ -172,38 +119,23 @@ IrrigationPlanner::err_t IrrigationPlanner::getEventHandles(time_t eventTime,
     err_t ret = IrrigationPlanner::ERR_OK;
 
     unsigned int handleCnt = 0;
-    time_t checkEventTime = 0;
-
-    // check start event list
-    for(int i=0; i < irrigationPlannerNumEvents; i++) {
-        if(eventsUsed[i]) {
-            checkEventTime = events[i].getNextOccurance();
-            if(checkEventTime == eventTime) {
-                if(handleCnt < maxElements) {
-                    dest[handleCnt].idx = i;
-                    dest[handleCnt].isStart = true;
-                    handleCnt++;
-                } else {
-                    ret = ERR_PARTIAL_EVENT_HANDLES;
-                    break;
-                }
-            }
-        }
-    }
+    event_handle_t found[irrigationPlannerNumTimelineEntries];
+    unsigned int foundCnt = 0;
 
-    // check stop event list
-    for(int i=0; i < irrigationPlannerNumStopEvents; i++) {
-        if(stopEventsUsed[i]) {
-            checkEventTime = stopEvents[i].getNextOccurance();
-            if(checkEventTime == eventTime) {
-                if(handleCnt < maxElements) {
-                    dest[handleCnt].idx = i;
-                    dest[handleCnt].isStart = false;
-                    handleCnt++;
-                } else {
-                    ret = ERR_PARTIAL_EVENT_HANDLES;
-                    break;
-                }
+    if (pdFALSE == xSemaphoreTake(accessMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire access lock within timeout!");
+        ret = ERR_TIMEOUT;
+    } else {
+        foundCnt = collectEventHandles(eventTime, found);
+        xSemaphoreGive(accessMutex);
+
+        for(unsigned int i = 0; i < foundCnt; i++) {
+            if(handleCnt < maxElements) {
+                dest[handleCnt] = found[i];
+                handleCnt++;
+            } else {
+                ret = ERR_PARTIAL_EVENT_HANDLES;
+                break;
             }
         }
     }
@@ -214,13 +146,120 @@ IrrigationPlanner::err_t IrrigationPlanner::getEventHandles(time_t eventTime,
     }
 
     // check if we actually found something
-    if(handleCnt == 0) {
+    if((handleCnt == 0) && (ERR_OK == ret)) {
         ret = ERR_NO_HANDLES_FOUND;
     }
 
     return ret;
 }
 
+/**
+ * @brief Collect the handles of all events occuring at the specified time from the timeline.
+ * 
+ * Note: The access lock must be held by the caller.
+ * 
+ * @param eventTime Time to get the event handles for.
+ * @param dest Pointer to a memory area holding at least irrigationPlannerNumTimelineEntries handles.
+ * @return unsigned int Number of handles found.
+ */
+unsigned int IrrigationPlanner::collectEventHandles(time_t eventTime, event_handle_t* dest)
+{
+    unsigned int foundCnt = 0;
+
+    // Walk the heap, only descending into subtrees that may contain the event time
+    unsigned int stack[irrigationPlannerNumTimelineEntries];
+    unsigned int stackLen = 0;
+
+    if((timelineLen > 0) && (timeline[0].time <= eventTime)) {
+        stack[stackLen++] = 0;
+    }
+    while(stackLen > 0) {
+        unsigned int pos = stack[--stackLen];
+
+        if(timeline[pos].time == eventTime) {
+            dest[foundCnt++] = timeline[pos].handle;
+        }
+        for(unsigned int child = 2*pos + 1; (child <= 2*pos + 2) && (child < timelineLen); child++) {
+            if(timeline[child].time <= eventTime) {
+                stack[stackLen++] = child;
+            }
+        }
+    }
+
+    // Keep the processing order independent of the heap layout:
+    // start events first, each kind ordered by index.
+    for(unsigned int i = 1; i < foundCnt; i++) {
+        event_handle_t cur = dest[i];
+        unsigned int j = i;
+        while((j > 0) && ((cur.isStart && !dest[j-1].isStart) ||
+            ((cur.isStart == dest[j-1].isStart) && (cur.idx < dest[j-1].idx))))
+        {
+            dest[j] = dest[j-1];
+            j--;
+        }
+        dest[j] = cur;
+    }
+
+    return foundCnt;
+}
+
+/**
+ * @brief Dispatch all events occuring at the specified time.
+ * 
+ * The events are collected, their event data and zone configurations are copied and
+ * they are confirmed (i.e. their stop events are queued) atomically within a single
+ * lock, so concurrent configuration updates can't interfere.
+ * 
+ * Note: The returned records stay valid until the next call.
+ * 
+ * @param eventTime Time to dispatch the events for.
+ * @param events Pointer to store the address of the first dispatched event record at.
+ * @param numEvents Pointer to store the number of dispatched events at.
+ * @return IrrigationPlanner::err_t
+ * @retval ERR_OK Success.
+ * @retval ERR_INVALID_PARAM events or numEvents is invalid.
+ * @retval ERR_NO_HANDLES_FOUND No events found for the specified time.
+ * @retval ERR_TIMEOUT Access lock couldn't be acquired.
+ */
+IrrigationPlanner::err_t IrrigationPlanner::dispatchDueEvents(time_t eventTime, const due_event_t** events,
+    unsigned int* numEvents)
+{
+    event_handle_t handles[irrigationPlannerNumTimelineEntries];
+    unsigned int handleCnt;
+
+    if((nullptr == events) || (nullptr == numEvents)) return ERR_INVALID_PARAM;
+
+    *events = dueEvents;
+    *numEvents = 0;
+
+    if (pdFALSE == xSemaphoreTake(accessMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire access lock within timeout!");
+        return ERR_TIMEOUT;
+    }
+
+    handleCnt = collectEventHandles(eventTime, handles);
+
+    for(unsigned int i = 0; i < handleCnt; i++) {
+        due_event_t* dueEvent = &dueEvents[i];
+
+        getEventPtr(handles[i])->getEventData(&dueEvent->eventData);
+        dueEvent->zoneCfgValid = (ERR_OK == getZoneConfig(dueEvent->eventData.zoneIdx, &dueEvent->zoneCfg));
+
+        if(handles[i].isStart) {
+            dueEvent->confirmErr = confirmNormalEvent(handles[i].idx, eventTime) ? ERR_OK : ERR_NO_STOP_SLOT_AVAIL;
+        } else {
+            confirmStopEvent(handles[i].idx);
+            dueEvent->confirmErr = ERR_OK;
+        }
+    }
+
+    xSemaphoreGive(accessMutex);
+
+    *numEvents = handleCnt;
+
+    return (handleCnt > 0) ? ERR_OK : ERR_NO_HANDLES_FOUND;
+}
+
 /**
  * @brief Get channel configuration for the specified event.
  * 
@@ -241,23 +280,10 @@ IrrigationPlanner::err_t IrrigationPlanner::getEventData(IrrigationPlanner::even
     if(nullptr == dest) return ERR_INVALID_PARAM;
     if(handle.idx < 0) return ERR_INVALID_HANDLE;
 
-    if(handle.isStart) {
-        if(handle.idx >= irrigationPlannerNumEvents) {
-            ret = ERR_INVALID_HANDLE;
-        } else if(!eventsUsed[handle.idx]) {
-            ret = ERR_INVALID_HANDLE;
-        } else {
-            //memcpy((void*) dest, (void*) &events[handle.idx], sizeof(IrrigationEvent::irrigation_event_data_t));
-            events[handle.idx].getEventData(dest);
-        }
+    if(!isValidHandle(handle)) {
+        ret = ERR_INVALID_HANDLE;
     } else {
-        if(handle.idx >= irrigationPlannerNumStopEvents) {
-            ret = ERR_INVALID_HANDLE;
-        } else if(!stopEventsUsed[handle.idx]) {
-            ret = ERR_INVALID_HANDLE;
-        } else {
-            stopEvents[handle.idx].getEventData(dest);
-        }
+        getEventPtr(handle)->getEventData(dest);
     }
 
     return ret;
@@ -278,26 +304,24 @@ IrrigationPlanner::err_t IrrigationPlanner::confirmEvent(IrrigationPlanner::even
 
     if(handle.idx < 0) return ERR_INVALID_HANDLE;
 
-    if(handle.isStart) {
-        if(handle.idx >= irrigationPlannerNumEvents) {
-            ret = ERR_INVALID_HANDLE;
-        } else if(!eventsUsed[handle.idx]) {
-            ret = ERR_INVALID_HANDLE;
-        } else {
-            if(!confirmNormalEvent(handle.idx)) {
-                ret = ERR_NO_STOP_SLOT_AVAIL;
-            }
+    if (pdFALSE == xSemaphoreTake(accessMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire access lock within timeout!");
+        return ERR_TIMEOUT;
+    }
+
+    if(!isValidHandle(handle)) {
+        ret = ERR_INVALID_HANDLE;
+    } else if(handle.isStart) {
+        int pos = timelinePosStart[handle.idx];
+        if(!confirmNormalEvent(handle.idx, (pos >= 0) ? timeline[pos].time : 0)) {
+            ret = ERR_NO_STOP_SLOT_AVAIL;
         }
     } else {
-        if(handle.idx >= irrigationPlannerNumStopEvents) {
-            ret = ERR_INVALID_HANDLE;
-        } else if(!stopEventsUsed[handle.idx]) {
-            ret = ERR_INVALID_HANDLE;
-        } else {
-            confirmStopEvent(handle.idx);
-        }
+        confirmStopEvent(handle.idx);
     }
 
+    xSemaphoreGive(accessMutex);
+
     return ret;
 }
 
@@ -305,70 +329,59 @@ IrrigationPlanner::err_t IrrigationPlanner::confirmEvent(IrrigationPlanner::even
  * @brief Confirm a normal event to proceed it in the schedule
  * 
  * @param idx Index of the event to be confirmed.
+ * @param occurance Occurance of the event to be confirmed, i.e. its timeline entry.
  * @return bool
  * @retval true Success.
  * @retval false Enqueuing a stop event failed due to no available stop slots.
  */
-bool IrrigationPlanner::confirmNormalEvent(unsigned int idx)
+bool IrrigationPlanner::confirmNormalEvent(unsigned int idx, time_t occurance)
 {
+    const IrrigationEvent* evt = getEventPtr({(int) idx, true});
     bool ret = false;
     IrrigationEvent::irrigation_event_data_t evtData;
 
-    for(int i=0; i<irrigationPlannerNumStopEvents; i++) {
-        if(!stopEventsUsed[i]) {
-            // Mark the slot as used
-            stopEventsUsed[i] = true;
+    int i = stopEvents.alloc();
+    if(i >= 0) {
+        // get event data
+        IrrigationEvent::err_t eventErr;
+        eventErr = evt->getEventData(&evtData);
+        if(IrrigationEvent::ERR_OK != eventErr) {
+            ESP_LOGE(logTag, "Error getting event data: %d. Cannot add stop event!", eventErr);
+        } else if(0 == occurance) {
+            ESP_LOGE(logTag, "Event isn't scheduled. Cannot add stop event!");
+        } else {
+            // Calculate the actual time
+            time_t stopTime = occurance + evtData.durationSecs;
+            civil_time_t stopTimeCivil;
+            civilTime.utcToCivil(stopTime, &stopTimeCivil);
+
+            #ifdef IRRIGATION_PLANNER_STOP_EVENT_DEBUG
+                ESP_LOGD(logTag, "stopTime: %lu", stopTime);
+                ESP_LOGD(logTag, "stopTimeCivil: %d.%d.%d %d:%d:%d",
+                    stopTimeCivil.day, stopTimeCivil.month, stopTimeCivil.year,
+                    stopTimeCivil.hour, stopTimeCivil.minute, stopTimeCivil.second);
+            #endif
 
-            // get event data
-            IrrigationEvent::err_t eventErr;
-            eventErr = events[idx].getEventData(&evtData);
-            if(IrrigationEvent::ERR_OK != eventErr) {
-                ESP_LOGE(logTag, "Error getting event data: %d. Cannot add stop event!", eventErr);
-            } else {
-                // Calculate the actual time
-                time_t stopTime = events[idx].getNextOccurance();
-
-                // a) Convert reference time_t to struct tm for recalculation
-                struct tm stopTimeTm;
-                localtime_r(&stopTime, &stopTimeTm);
-                stopTimeTm.tm_sec += evtData.durationSecs;
-                //    set DST status to not available, because it may be different by
-                //    the modifications modifications
-                stopTimeTm.tm_isdst = -1;
-
-                #ifdef IRRIGATION_PLANNER_STOP_EVENT_DEBUG
-                    ESP_LOGD(logTag, "stopTime: %lu", stopTime);
-                    ESP_LOGD(logTag, "stopTimeTm: %d.%d.%d %d:%d:%d",
-                        stopTimeTm.tm_mday, stopTimeTm.tm_mon, stopTimeTm.tm_year,
-                        stopTimeTm.tm_hour, stopTimeTm.tm_min, stopTimeTm.tm_sec);
-                #endif
-
-                // b) Use mktime to fixup the time and convert time_t back to struct tm
-                stopTime = mktime(&stopTimeTm);
-                localtime_r(&stopTime, &stopTimeTm);
-                #ifdef IRRIGATION_PLANNER_STOP_EVENT_DEBUG
-                    ESP_LOGD(logTag, "after recalc: stopTime: %lu", stopTime);
-                    ESP_LOGD(logTag, "after recalc: stopTimeTm: %d.%d.%d %d:%d:%d",
-                        stopTimeTm.tm_mday, stopTimeTm.tm_mon, stopTimeTm.tm_year,
-                        stopTimeTm.tm_hour, stopTimeTm.tm_min, stopTimeTm.tm_sec);
-                #endif
-
-                // And now set properties of the stop event
-                stopEvents[i].setSingleEvent(stopTimeTm.tm_hour, stopTimeTm.tm_min, stopTimeTm.tm_sec,
-                    stopTimeTm.tm_mday, stopTimeTm.tm_mon + 1, stopTimeTm.tm_year + 1900);
-                stopEvents[i].setStartFlag(false);
-                stopEvents[i].setDuration(0);
-                stopEvents[i].setZoneIndex(evtData.zoneIdx);
-                stopEvents[i].updateReferenceTime(events[idx].getReferenceTime());
-
-                #ifdef IRRIGATION_PLANNER_STOP_EVENT_DEBUG
-                    printEventDetails(&stopEvents[i]);
-                #endif
-
-                ret = true;
-            }
+            // And now set properties of the stop event
+            stopEvents[i].setSingleEvent(stopTimeCivil.hour, stopTimeCivil.minute, stopTimeCivil.second,
+                stopTimeCivil.day, stopTimeCivil.month, stopTimeCivil.year);
+            stopEvents[i].setStartFlag(false);
+            stopEvents[i].setDuration(0);
+            stopEvents[i].setZoneIndex(evtData.zoneIdx);
+            stopEvents[i].updateReferenceTime(occurance);
+
+            #ifdef IRRIGATION_PLANNER_STOP_EVENT_DEBUG
+                printEventDetails(&stopEvents[i]);
+            #endif
+
+            timelineUpdate({i, false}, stopEvents[i].getReferenceTime());
 
-            break;
+            ret = true;
+        }
+
+        if(!ret) {
+            // Don't keep a slot without a valid stop time
+            stopEvents.release(i);
         }
     }
 
@@ -376,7 +389,13 @@ bool IrrigationPlanner::confirmNormalEvent(unsigned int idx)
     // Note: Do this independant if we managed to set a stop event above;
     // cleaning up is more important to stay operational
     if(idx >= irrigationPlannerNumNormalEvents) {
-        eventsUsed[idx] = false;
+        singleShotEvents.release(idx - irrigationPlannerNumNormalEvents);
+        timelineRemove({(int) idx, true});
+    } else {
+        // Proceed to the occurance after the confirmed one
+        if(0 != occurance) {
+            timelineUpdate({(int) idx, true}, occurance + 1);
+        }
     }
 
     return ret;
@@ -389,7 +408,208 @@ bool IrrigationPlanner::confirmNormalEvent(unsigned int idx)
  */
 void IrrigationPlanner::confirmStopEvent(unsigned int idx)
 {
-    stopEventsUsed[idx] = false;
+    stopEvents.release(idx);
+    timelineRemove({(int) idx, false});
+}
+
+/**
+ * @brief Rebuild the timeline from scratch.
+ * 
+ * @param refTime Reference time to calculate the next occurances for.
+ */
+void IrrigationPlanner::rebuildTimeline(time_t refTime)
+{
+    timelineLen = 0;
+
+    for(int i = 0; i < irrigationPlannerNumEvents; i++) {
+        timelinePosStart[i] = -1;
+    }
+    for(int i = 0; i < irrigationPlannerNumStopEvents; i++) {
+        timelinePosStop[i] = -1;
+    }
+
+    for(int i = 0; i < irrigationPlannerNumEvents; i++) {
+        if(isValidHandle({i, true})) {
+            time_t next = timelineCalcNext({i, true}, refTime);
+            if(0 != next) {
+                timeline[timelineLen].time = next;
+                timeline[timelineLen].handle = {i, true};
+                timelinePosStart[i] = timelineLen;
+                timelineLen++;
+            }
+        }
+    }
+    for(int i = stopEvents.nextUsed(0); i >= 0; i = stopEvents.nextUsed(i + 1)) {
+        time_t next = timelineCalcNext({i, false}, refTime);
+        if(0 != next) {
+            timeline[timelineLen].time = next;
+            timeline[timelineLen].handle = {i, false};
+            timelinePosStop[i] = timelineLen;
+            timelineLen++;
+        }
+    }
+
+    // heapify bottom-up
+    for(int pos = (int) timelineLen / 2 - 1; pos >= 0; pos--) {
+        timelineSiftDown(pos);
+    }
+
+    timelineRefTime = refTime;
+    timelineTzGen = civilTime.getRuleGeneration();
+    timelineSolarGen = solarTable.getGeneration();
+    timelineValid = true;
+}
+
+/**
+ * @brief Calculate the next occurance of an event for the timeline.
+ * 
+ * A repeating event may have no occurance at the reference time although it occurs
+ * later, e.g. when its time has passed within the DST overlap. So it is searched for
+ * once more from the beginning of the next local day before it is considered exhausted.
+ * 
+ * @param handle Handle of the event.
+ * @param refTime Reference time to calculate the next occurance for.
+ * @return time_t Time of the next occurance or 0 if there is none.
+ */
+time_t IrrigationPlanner::timelineCalcNext(event_handle_t handle, time_t refTime)
+{
+    const IrrigationEvent* evt = getEventPtr(handle);
+    time_t next = evt->calcNextOccurance(refTime);
+
+    if((0 == next) && evt->isRepeating()) {
+        int64_t refDays = CivilTime::floorDiv(civilTime.utcToLocal(refTime), CivilTime::secsPerDay);
+        time_t nextDay = civilTime.localToUtc((refDays + 1) * CivilTime::secsPerDay);
+        next = evt->calcNextOccurance(nextDay);
+    }
+
+    return next;
+}
+
+/**
+ * @brief Recalculate the next occurance of an event and update its timeline entry.
+ * 
+ * The event is inserted if it isn't part of the timeline yet and removed if it
+ * doesn't occur anymore, i.e. if it is a passed SINGLE event or an exhausted repetition.
+ * 
+ * @param handle Handle of the event to be updated.
+ * @param refTime Reference time to calculate the next occurance for.
+ */
+void IrrigationPlanner::timelineUpdate(event_handle_t handle, time_t refTime)
+{
+    int* posPtr = getTimelinePosPtr(handle);
+    time_t next = timelineCalcNext(handle, refTime);
+
+    if(0 == next) {
+        timelineRemove(handle);
+    } else if(*posPtr < 0) {
+        unsigned int pos = timelineLen++;
+        timeline[pos].time = next;
+        timeline[pos].handle = handle;
+        *posPtr = pos;
+        timelineSiftUp(pos);
+    } else {
+        unsigned int pos = *posPtr;
+        time_t prev = timeline[pos].time;
+        timeline[pos].time = next;
+        if(next < prev) {
+            timelineSiftUp(pos);
+        } else {
+            timelineSiftDown(pos);
+        }
+    }
+}
+
+/**
+ * @brief Remove an event from the timeline (if it is part of it).
+ * 
+ * @param handle Handle of the event to be removed.
+ */
+void IrrigationPlanner::timelineRemove(event_handle_t handle)
+{
+    int* posPtr = getTimelinePosPtr(handle);
+    if(*posPtr < 0) return;
+
+    unsigned int pos = *posPtr;
+    unsigned int last = timelineLen - 1;
+
+    if(pos != last) {
+        timelineSwap(pos, last);
+    }
+    timelineLen--;
+    *posPtr = -1;
+
+    if(pos < timelineLen) {
+        timelineSiftUp(pos);
+        timelineSiftDown(pos);
+    }
+}
+
+void IrrigationPlanner::timelineSiftUp(unsigned int pos)
+{
+    while(pos > 0) {
+        unsigned int parent = (pos - 1) / 2;
+        if(timeline[parent].time <= timeline[pos].time) break;
+        timelineSwap(pos, parent);
+        pos = parent;
+    }
+}
+
+void IrrigationPlanner::timelineSiftDown(unsigned int pos)
+{
+    while(true) {
+        unsigned int smallest = pos;
+        unsigned int left = 2*pos + 1;
+        unsigned int right = 2*pos + 2;
+
+        if((left < timelineLen) && (timeline[left].time < timeline[smallest].time)) smallest = left;
+        if((right < timelineLen) && (timeline[right].time < timeline[smallest].time)) smallest = right;
+        if(smallest == pos) break;
+
+        timelineSwap(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void IrrigationPlanner::timelineSwap(unsigned int a, unsigned int b)
+{
+    timeline_entry_t tmp = timeline[a];
+    timeline[a] = timeline[b];
+    timeline[b] = tmp;
+
+    *getTimelinePosPtr(timeline[a].handle) = a;
+    *getTimelinePosPtr(timeline[b].handle) = b;
+}
+
+int* IrrigationPlanner::getTimelinePosPtr(event_handle_t handle)
+{
+    return handle.isStart ? &timelinePosStart[handle.idx] : &timelinePosStop[handle.idx];
+}
+
+const IrrigationEvent* IrrigationPlanner::getEventPtr(event_handle_t handle)
+{
+    if(!handle.isStart) {
+        return &stopEvents[handle.idx];
+    } else if(handle.idx < irrigationPlannerNumNormalEvents) {
+        return &config->events[handle.idx];
+    } else {
+        return &singleShotEvents[handle.idx - irrigationPlannerNumNormalEvents];
+    }
+}
+
+/**
+ * @brief Check if a handle refers to an existing event.
+ */
+bool IrrigationPlanner::isValidHandle(event_handle_t handle)
+{
+    if(handle.idx < 0) {
+        return false;
+    } else if(!handle.isStart) {
+        return stopEvents.isUsed(handle.idx);
+    } else if(handle.idx < irrigationPlannerNumNormalEvents) {
+        return (nullptr != config) && config->events.isUsed(handle.idx);
+    } else {
+        return singleShotEvents.isUsed(handle.idx - irrigationPlannerNumNormalEvents);
+    }
 }
 
 /**
@@ -397,19 +617,21 @@ void IrrigationPlanner::confirmStopEvent(unsigned int idx)
  * 
  * @param evt Pointer to the event to print.
  */
-void IrrigationPlanner::printEventDetails(IrrigationEvent* evt)
+void IrrigationPlanner::printEventDetails(const IrrigationEvent* evt)
 {
     struct tm eventTm;
-    time_t eventTime = evt->getNextOccurance();
+    time_t eventTime = evt->calcNextOccurance(time(NULL));
     localtime_r(&eventTime, &eventTm);
 
     IrrigationEvent::irrigation_event_data_t curEventData;
-    irrigation_zone_cfg_t* curZoneConfig = nullptr;
+    const irrigation_zone_cfg_t* curZoneConfig = nullptr;
 
     if(IrrigationEvent::ERR_OK != evt->getEventData(&curEventData)) {
         ESP_LOGE(logTag, "Error retrieving event data.");
     } else {
-        curZoneConfig = &zones[curEventData.zoneIdx];
+        if((nullptr != config) && (curEventData.zoneIdx >= 0)) {
+            curZoneConfig = &config->zones[curEventData.zoneIdx];
+        }
 
         if(nullptr != curZoneConfig) {
             bool isStartEvent = curEventData.isStart;
@@ -437,26 +659,64 @@ void IrrigationPlanner::printAllEvents()
 {
     ESP_LOGD(logTag, "***** Planned events *****");
     for(int i = 0; i < irrigationPlannerNumEvents; i++) {
-        if(eventsUsed[i]) {
-            IrrigationEvent* evt = &events[i];
-            evt->updateReferenceTime(time(NULL));
-            time_t eventTime = evt->getNextOccurance();
-            struct tm eventTm;
-            localtime_r(&eventTime, &eventTm);
-
-            printEventDetails(evt);
+        if(isValidHandle({i, true})) {
+            printEventDetails(getEventPtr({i, true}));
         }
     }
     ESP_LOGD(logTag, "**************************");
 }
 
+/**
+ * @brief Determine the worst-case number of stop events a configuration needs at once,
+ * i.e. the maximum number of overlapping irrigations on any day of the week (see
+ * IrrigationEvent::addDayCoverage()). Days with a DST gap are checked separately, as if
+ * every day of the week could have one.
+ *
+ * Configurations exceeding irrigationPlannerNumConfigStopEvents must not be applied, since
+ * a zone would never get its stop event otherwise.
+ *
+ * Note: This function isn't reentrant. Only call it from a single context, e.g. while
+ * holding the config lock of the SettingsManager.
+ *
+ * @param events Events of the configuration.
+ * @param timezone Timezone the events are scheduled in, for its DST gap.
+ * @return unsigned int Maximum number of overlapping irrigations.
+ */
+unsigned int IrrigationPlanner::calcMaxStopEvents(const IrrigationConfigEventPool& events, const CivilTime& timezone)
+{
+    static int32_t coverage[IrrigationEvent::dayCoverageSlots + 1];
+    int32_t dstGapStartSecs;
+    int32_t dstGapSecs;
+    int32_t max = 0;
+
+    timezone.getDstGap(&dstGapStartSecs, &dstGapSecs);
+
+    // Regular days and, if there is DST, days local time jumps forward on
+    for(int32_t gapSecs = 0; gapSecs <= dstGapSecs; gapSecs += ((dstGapSecs > 0) ? dstGapSecs : 1)) {
+        for(int weekday = 0; weekday < 7; weekday++) {
+            memset(coverage, 0, sizeof(coverage));
+            for(int i = events.nextUsed(0); i >= 0; i = events.nextUsed(i + 1)) {
+                events[i].addDayCoverage(coverage, weekday, dstGapStartSecs, gapSecs);
+            }
+
+            int32_t cur = 0;
+            for(unsigned int i = 0; i < IrrigationEvent::dayCoverageSlots; i++) {
+                cur += coverage[i];
+                if(cur > max) max = cur;
+            }
+        }
+    }
+
+    return max;
+}
+
 IrrigationPlanner::err_t IrrigationPlanner::getZoneConfig(int idx, irrigation_zone_cfg_t* cfg)
 {
-    if((idx < 0) || (idx >= irrigationZoneCfgElements)) {
+    if((idx < 0) || (idx >= irrigationPlannerNumZones) || (nullptr == config)) {
         return ERR_INVALID_ZONE_IDX;
     }
 
-    *cfg = zones[idx];
+    *cfg = config->zones[idx];
 
     return ERR_OK;
 }
@@ -517,11 +777,7 @@ void IrrigationPlanner::irrigConfigUpdated()
         } else {
             ESP_LOGI(logTag, "Irrigation config update notification received.");
 
-            settingsMgr.copyZonesAndEvents(zones, events, eventsUsed);
-
-            #ifdef IRRIGATION_PLANNER_PRINT_ALL_EVENTS
-            printAllEvents();
-            #endif
+            switchConfig();
 
             if(pdFALSE == xSemaphoreTake(hookMutex, lockAcquireTimeout)) {
                 ESP_LOGE(logTag, "Couldn't acquire hook lock within timeout!");
@@ -531,9 +787,44 @@ void IrrigationPlanner::irrigConfigUpdated()
                 }
                 xSemaphoreGive(hookMutex);
             }
-
-            xSemaphoreGive(accessMutex);
         }
+
+        xSemaphoreGive(accessMutex);
+    }
+}
+
+/**
+ * @brief Switch to the latest published configuration snapshot and rebuild the timeline.
+ * 
+ * The previous snapshot is released, i.e. it may be reused by the SettingsManager afterwards.
+ * 
+ * Note: The access lock must be held by the caller.
+ */
+void IrrigationPlanner::switchConfig()
+{
+    const irrigation_config_t* newConfig = settingsMgr.acquireIrrigationConfig();
+
+    if(nullptr != config) {
+        settingsMgr.releaseIrrigationConfig(config);
+    }
+    config = newConfig;
+
+    if(nullptr == config) {
+        ESP_LOGW(logTag, "No irrigation config available!");
+    } else {
+        ESP_LOGD(logTag, "Using irrigation config generation %u.", config->generation);
+    }
+
+    #ifdef IRRIGATION_PLANNER_PRINT_ALL_EVENTS
+    printAllEvents();
+    #endif
+
+    // Rebuild the timeline for the current reference. Without one (i.e. before the first
+    // query), the rebuild is postponed to the first query.
+    if(0 != timelineRefTime) {
+        rebuildTimeline(timelineRefTime);
+    } else {
+        timelineValid = false;
     }
 }
 
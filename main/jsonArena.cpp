@@ -0,0 +1,150 @@
+#include "jsonArena.h"
+
+#include <stdlib.h>
+
+#include "cJSON.h"
+
+JsonArena* JsonArena::instance = nullptr;
+
+JsonArena::JsonArena()
+{
+    mutex = xSemaphoreCreateMutexStatic(&mutexBuf);
+    owner = nullptr;
+    used = 0;
+    exhausted = false;
+    stats = {};
+    vPortCPUInitializeMutex(&statsMux);
+
+    instance = this;
+    cJSON_Hooks hooks = {mallocHook, freeHook};
+    cJSON_InitHooks(&hooks);
+}
+
+JsonArena::~JsonArena()
+{
+    cJSON_InitHooks(nullptr);
+    instance = nullptr;
+
+    if (mutex) vSemaphoreDelete(mutex);
+}
+
+/**
+ * @brief Acquire the arena for a request of the calling task. cJSON allocations of the
+ * task are served by the arena until release() is called.
+ *
+ * @param timeout Max. time to wait for a request of another task to finish.
+ * @return JsonArena::err_t
+ */
+JsonArena::err_t JsonArena::acquire(TickType_t timeout)
+{
+    if (pdFALSE == xSemaphoreTake(mutex, timeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire arena within timeout!");
+        return ERR_TIMEOUT;
+    }
+
+    used = 0;
+    exhausted = false;
+    owner = xTaskGetCurrentTaskHandle();
+
+    return ERR_OK;
+}
+
+/**
+ * @brief Release the arena after a request. All memory allocated by cJSON during the
+ * request is reclaimed, so pointers to it (e.g. cJSON trees) must not be used anymore.
+ */
+void JsonArena::release(void)
+{
+    bool newHighWater = false;
+
+    owner = nullptr;
+
+    portENTER_CRITICAL(&statsMux);
+    stats.requests++;
+    stats.lastUsed = used;
+    if(used > stats.highWater) {
+        stats.highWater = used;
+        newHighWater = true;
+    }
+    portEXIT_CRITICAL(&statsMux);
+
+    if(newHighWater) {
+        ESP_LOGI(logTag, "New high-water mark: %u of %u bytes.", (unsigned int) used, (unsigned int) arenaSize);
+    } else {
+        ESP_LOGD(logTag, "Request used %u of %u bytes.", (unsigned int) used, (unsigned int) arenaSize);
+    }
+
+    xSemaphoreGive(mutex);
+}
+
+/**
+ * @brief Check if an allocation of the current request failed, e.g. to tell a too big
+ * request from invalid JSON. Must only be called by the task which acquired the arena.
+ */
+bool JsonArena::isExhausted(void) const
+{
+    return exhausted;
+}
+
+/**
+ * @brief Get the usage statistics of the arena.
+ *
+ * @param stats Copy of the statistics.
+ */
+void JsonArena::getStats(json_arena_stats_t* stats)
+{
+    if(nullptr == stats) return;
+
+    portENTER_CRITICAL(&statsMux);
+    *stats = this->stats;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+void* JsonArena::alloc(size_t size)
+{
+    size_t alignedSize = (size + allocAlign - 1) & ~(allocAlign - 1);
+
+    if((alignedSize < size) || (alignedSize > (arenaSize - used))) {
+        // Only the first failure of a request is logged, cJSON gives up anyway
+        if(!exhausted) {
+            ESP_LOGW(logTag, "Arena exhausted (%u bytes used, %u requested)!", (unsigned int) used, (unsigned int) size);
+        }
+        exhausted = true;
+
+        portENTER_CRITICAL(&statsMux);
+        stats.failedAllocs++;
+        portEXIT_CRITICAL(&statsMux);
+        return nullptr;
+    }
+
+    void* ptr = &buffer[used];
+    used += alignedSize;
+
+    return ptr;
+}
+
+bool JsonArena::contains(const void* ptr) const
+{
+    return (ptr >= (const void*) buffer) && (ptr < (const void*) &buffer[arenaSize]);
+}
+
+void* JsonArena::mallocHook(size_t size)
+{
+    JsonArena* arena = instance;
+
+    if((nullptr != arena) && (nullptr != arena->owner) && (xTaskGetCurrentTaskHandle() == arena->owner)) {
+        return arena->alloc(size);
+    }
+
+    return malloc(size);
+}
+
+void JsonArena::freeHook(void* ptr)
+{
+    JsonArena* arena = instance;
+
+    // Arena memory is reclaimed by release()
+    if((nullptr != arena) && arena->contains(ptr)) return;
+
+    free(ptr);
+}
@@ -0,0 +1,363 @@
+#include "jsonReader.h"
+
+/**
+ * @brief Create a reader, which expects a single top level value.
+ *
+ * @param handler Function called for each token. The token is only valid during the call.
+ * @param handlerParam Parameter passed to the handler
+ */
+JsonReader::JsonReader(TokenHandlerFncPtr handler, void* handlerParam) :
+    handler(handler), handlerParam(handlerParam), state(STATE_VALUE), err(ERR_OK), offset(0),
+    depth(0), isObject(0), tokenOffset(0), strLen(0), strTruncated(false), strIsKey(false),
+    codepoint(0), highSurrogate(0), numHexDigits(0), numMagnitude(0), numNegative(false),
+    numHasDigits(false), literal(nullptr), literalPos(0)
+{
+    str[0] = '\0';
+}
+
+/**
+ * @brief Tokenize the next chunk of the input.
+ *
+ * @param data Input chunk. It isn't needed anymore after the call.
+ * @param len Length of the chunk
+ * @return JsonReader::err_t ERR_OK or the first error, which stops the tokenization.
+ */
+JsonReader::err_t JsonReader::feed(const char* data, size_t len)
+{
+    for(size_t i = 0; (i < len) && (ERR_OK == err); i++) {
+        err = processChar(data[i]);
+        offset++;
+    }
+
+    return err;
+}
+
+/**
+ * @brief Finish the tokenization after the last chunk has been fed.
+ *
+ * @return JsonReader::err_t ERR_OK if a complete top level value has been read.
+ */
+JsonReader::err_t JsonReader::finish(void)
+{
+    // A number isn't complete until the next char
+    if((ERR_OK == err) && (STATE_NUMBER == state)) {
+        err = endNumber();
+    }
+    if((ERR_OK == err) && (STATE_DONE != state)) {
+        err = ERR_INCOMPLETE;
+    }
+
+    return err;
+}
+
+JsonReader::err_t JsonReader::processChar(char c)
+{
+    bool isWhitespace = (' ' == c) || ('\t' == c) || ('\n' == c) || ('\r' == c);
+
+    switch(state) {
+        case STATE_VALUE:
+            if(isWhitespace) return ERR_OK;
+            return startValue(c);
+
+        case STATE_VALUE_OR_END:
+            if(isWhitespace) return ERR_OK;
+            if(']' == c) {
+                depth--;
+                emit(TOKEN_ARRAY_END);
+                return endValue();
+            }
+            return startValue(c);
+
+        case STATE_KEY_OR_END:
+            if(isWhitespace) return ERR_OK;
+            if('}' == c) {
+                depth--;
+                emit(TOKEN_OBJECT_END);
+                return endValue();
+            }
+            // fall through
+        case STATE_KEY:
+            if(isWhitespace) return ERR_OK;
+            if('"' != c) return ERR_SYNTAX;
+            tokenOffset = offset;
+            strLen = 0;
+            strTruncated = false;
+            strIsKey = true;
+            state = STATE_STRING;
+            return ERR_OK;
+
+        case STATE_COLON:
+            if(isWhitespace) return ERR_OK;
+            if(':' != c) return ERR_SYNTAX;
+            state = STATE_VALUE;
+            return ERR_OK;
+
+        case STATE_SEPARATOR_OR_END:
+            if(isWhitespace) return ERR_OK;
+            if(',' == c) {
+                state = (isObject & (1u << depth)) ? STATE_KEY : STATE_VALUE;
+                return ERR_OK;
+            } else if(('}' == c) && (isObject & (1u << depth))) {
+                depth--;
+                emit(TOKEN_OBJECT_END);
+                return endValue();
+            } else if((']' == c) && !(isObject & (1u << depth))) {
+                depth--;
+                emit(TOKEN_ARRAY_END);
+                return endValue();
+            }
+            return ERR_SYNTAX;
+
+        case STATE_STRING:
+            // The low surrogate has to follow immediately
+            if((0 != highSurrogate) && ('\\' != c)) return ERR_SYNTAX;
+            if('"' == c) {
+                str[strLen] = '\0';
+                if(strIsKey) {
+                    emit(TOKEN_KEY);
+                    state = STATE_COLON;
+                    return ERR_OK;
+                }
+                emit(TOKEN_STRING);
+                return endValue();
+            } else if('\\' == c) {
+                state = STATE_STRING_ESCAPE;
+            } else if((unsigned char) c < 0x20) {
+                return ERR_SYNTAX;
+            } else {
+                appendChar(c);
+            }
+            return ERR_OK;
+
+        case STATE_STRING_ESCAPE:
+            state = STATE_STRING;
+            if((0 != highSurrogate) && ('u' != c)) return ERR_SYNTAX;
+            switch(c) {
+                case '"':
+                case '\\':
+                case '/':
+                    appendChar(c);
+                    break;
+                case 'b':
+                    appendChar('\b');
+                    break;
+                case 'f':
+                    appendChar('\f');
+                    break;
+                case 'n':
+                    appendChar('\n');
+                    break;
+                case 'r':
+                    appendChar('\r');
+                    break;
+                case 't':
+                    appendChar('\t');
+                    break;
+                case 'u':
+                    codepoint = 0;
+                    numHexDigits = 0;
+                    state = STATE_STRING_UNICODE;
+                    break;
+                default:
+                    return ERR_SYNTAX;
+            }
+            return ERR_OK;
+
+        case STATE_STRING_UNICODE:
+            if((c >= '0') && (c <= '9')) {
+                codepoint = (codepoint << 4) | (c - '0');
+            } else if((c >= 'a') && (c <= 'f')) {
+                codepoint = (codepoint << 4) | (c - 'a' + 10);
+            } else if((c >= 'A') && (c <= 'F')) {
+                codepoint = (codepoint << 4) | (c - 'A' + 10);
+            } else {
+                return ERR_SYNTAX;
+            }
+            if(++numHexDigits < 4) return ERR_OK;
+
+            state = STATE_STRING;
+            return appendCodepoint(codepoint);
+
+        case STATE_NUMBER:
+            if((c >= '0') && (c <= '9')) {
+                uint32_t digit = c - '0';
+                // JSON doesn't allow leading zeros
+                if(numHasDigits && (0 == numMagnitude)) return ERR_SYNTAX;
+                // One more than INT32_MAX is allowed for INT32_MIN, endNumber() checks the sign
+                if(numMagnitude > ((0x80000000u - digit) / 10)) return ERR_NUMBER;
+                numMagnitude = numMagnitude * 10 + digit;
+                numHasDigits = true;
+                return ERR_OK;
+            } else if(('.' == c) || ('e' == c) || ('E' == c)) {
+                return ERR_NUMBER;
+            } else {
+                err_t ret = endNumber();
+                if(ERR_OK != ret) return ret;
+                // The char terminating the number belongs to the next token
+                return processChar(c);
+            }
+
+        case STATE_LITERAL:
+            if(c != literal[literalPos]) return ERR_SYNTAX;
+            literalPos++;
+            if('\0' != literal[literalPos]) return ERR_OK;
+
+            if('n' == literal[0]) {
+                emit(TOKEN_NULL);
+            } else {
+                emit(TOKEN_BOOL);
+            }
+            return endValue();
+
+        case STATE_DONE:
+            if(isWhitespace || ('\0' == c)) return ERR_OK;
+            return ERR_SYNTAX;
+
+        default:
+            return ERR_SYNTAX;
+    }
+}
+
+/**
+ * @brief Start a value with its first char.
+ */
+JsonReader::err_t JsonReader::startValue(char c)
+{
+    tokenOffset = offset;
+
+    if(('{' == c) || ('[' == c)) {
+        if(depth >= maxDepth) return ERR_DEPTH;
+        emit(('{' == c) ? TOKEN_OBJECT_START : TOKEN_ARRAY_START);
+        depth++;
+        if('{' == c) {
+            isObject |= (1u << depth);
+            state = STATE_KEY_OR_END;
+        } else {
+            isObject &= ~(1u << depth);
+            state = STATE_VALUE_OR_END;
+        }
+    } else if('"' == c) {
+        strLen = 0;
+        strTruncated = false;
+        strIsKey = false;
+        state = STATE_STRING;
+    } else if(('-' == c) || ((c >= '0') && (c <= '9'))) {
+        numNegative = ('-' == c);
+        numHasDigits = !numNegative;
+        numMagnitude = numNegative ? 0 : (c - '0');
+        state = STATE_NUMBER;
+    } else if('t' == c) {
+        literal = "true";
+    } else if('f' == c) {
+        literal = "false";
+    } else if('n' == c) {
+        literal = "null";
+    } else {
+        return ERR_SYNTAX;
+    }
+
+    if(('t' == c) || ('f' == c) || ('n' == c)) {
+        literalPos = 1;
+        state = STATE_LITERAL;
+    }
+
+    return ERR_OK;
+}
+
+/**
+ * @brief Continue after a complete value.
+ */
+JsonReader::err_t JsonReader::endValue(void)
+{
+    state = (0 == depth) ? STATE_DONE : STATE_SEPARATOR_OR_END;
+    return ERR_OK;
+}
+
+/**
+ * @brief Emit the number read so far.
+ */
+JsonReader::err_t JsonReader::endNumber(void)
+{
+    if(!numHasDigits) return ERR_SYNTAX;
+    if(!numNegative && (numMagnitude > 0x7FFFFFFFu)) return ERR_NUMBER;
+
+    emit(TOKEN_NUMBER);
+    return endValue();
+}
+
+/**
+ * @brief Append a char to the current key or string, truncating it if necessary.
+ */
+void JsonReader::appendChar(char c)
+{
+    if(strLen < maxStringLen) {
+        str[strLen++] = c;
+    } else {
+        strTruncated = true;
+    }
+}
+
+/**
+ * @brief Append an escaped code point as UTF-8. Surrogate pairs are combined.
+ */
+JsonReader::err_t JsonReader::appendCodepoint(uint32_t codepoint)
+{
+    if((codepoint >= 0xD800) && (codepoint <= 0xDBFF)) {
+        if(0 != highSurrogate) return ERR_SYNTAX;
+        highSurrogate = codepoint;
+        return ERR_OK;
+    } else if((codepoint >= 0xDC00) && (codepoint <= 0xDFFF)) {
+        if(0 == highSurrogate) return ERR_SYNTAX;
+        codepoint = 0x10000 + ((highSurrogate - 0xD800) << 10) + (codepoint - 0xDC00);
+        highSurrogate = 0;
+    } else if(0 != highSurrogate) {
+        return ERR_SYNTAX;
+    }
+
+    if(codepoint < 0x80) {
+        appendChar((char) codepoint);
+    } else if(codepoint < 0x800) {
+        appendChar((char) (0xC0 | (codepoint >> 6)));
+        appendChar((char) (0x80 | (codepoint & 0x3F)));
+    } else if(codepoint < 0x10000) {
+        appendChar((char) (0xE0 | (codepoint >> 12)));
+        appendChar((char) (0x80 | ((codepoint >> 6) & 0x3F)));
+        appendChar((char) (0x80 | (codepoint & 0x3F)));
+    } else {
+        appendChar((char) (0xF0 | (codepoint >> 18)));
+        appendChar((char) (0x80 | ((codepoint >> 12) & 0x3F)));
+        appendChar((char) (0x80 | ((codepoint >> 6) & 0x3F)));
+        appendChar((char) (0x80 | (codepoint & 0x3F)));
+    }
+
+    return ERR_OK;
+}
+
+/**
+ * @brief Report a token to the handler.
+ */
+void JsonReader::emit(token_type_t type)
+{
+    token_t token;
+
+    token.type = type;
+    token.depth = depth;
+    token.offset = tokenOffset;
+    token.endOffset = offset + 1;
+    token.str = ((TOKEN_KEY == type) || (TOKEN_STRING == type)) ? str : nullptr;
+    token.truncated = strTruncated;
+    token.intVal = 0;
+    token.boolVal = false;
+
+    if(TOKEN_NUMBER == type) {
+        // The number ends before the char terminating it
+        token.endOffset = offset;
+        token.intVal = numNegative ? (int32_t) (0u - numMagnitude) : (int32_t) numMagnitude;
+    } else if(TOKEN_BOOL == type) {
+        token.boolVal = ('t' == literal[0]);
+    } else if((TOKEN_OBJECT_END == type) || (TOKEN_ARRAY_END == type)) {
+        token.offset = offset;
+    }
+
+    if(nullptr != handler) handler(handlerParam, &token);
+}
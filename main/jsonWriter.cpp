@@ -0,0 +1,194 @@
+#include "jsonWriter.h"
+
+/**
+ * @brief Create a writer, which starts at the beginning of the buffer.
+ * 
+ * @param buf Destination buffer. May be nullptr to just determine the length.
+ * @param bufLen Size of the destination buffer
+ */
+JsonWriter::JsonWriter(char* buf, size_t bufLen) : buf(buf), bufLen(bufLen), len(0), depth(0), hasItems(0),
+    depthExceeded(false)
+{
+    if(bufLen > 0) buf[0] = '\0';
+}
+
+/**
+ * @brief Start an object. It must be closed by endObject().
+ * 
+ * @param key Key within the enclosing object, nullptr otherwise
+ */
+void JsonWriter::startObject(const char* key)
+{
+    startContainer(key, '{');
+}
+
+/**
+ * @brief Close the current object.
+ */
+void JsonWriter::endObject(void)
+{
+    if(depth > 0) depth--;
+    putChar('}');
+}
+
+/**
+ * @brief Start an array. It must be closed by endArray().
+ * 
+ * @param key Key within the enclosing object, nullptr otherwise
+ */
+void JsonWriter::startArray(const char* key)
+{
+    startContainer(key, '[');
+}
+
+/**
+ * @brief Close the current array.
+ */
+void JsonWriter::endArray(void)
+{
+    if(depth > 0) depth--;
+    putChar(']');
+}
+
+/**
+ * @brief Add an unsigned integer.
+ * 
+ * @param key Key within the enclosing object, nullptr otherwise
+ * @param val Value
+ */
+void JsonWriter::addUint(const char* key, uint64_t val)
+{
+    startValue(key);
+    putUint(val);
+}
+
+/**
+ * @brief Add a signed integer.
+ * 
+ * @param key Key within the enclosing object, nullptr otherwise
+ * @param val Value
+ */
+void JsonWriter::addInt(const char* key, int64_t val)
+{
+    startValue(key);
+    if(val < 0) {
+        putChar('-');
+        // Negate in unsigned arithmetic, so INT64_MIN works as well
+        putUint(0 - (uint64_t) val);
+    } else {
+        putUint((uint64_t) val);
+    }
+}
+
+/**
+ * @brief Add a string. Quotes, backslashes and control characters are escaped.
+ * 
+ * @param key Key within the enclosing object, nullptr otherwise
+ * @param str Zero terminated string
+ */
+void JsonWriter::addString(const char* key, const char* str)
+{
+    startValue(key);
+    putEscaped(str);
+}
+
+/**
+ * @brief Get the length of the complete output (excl. the terminating zero). If it is
+ * greater than or equal to the buffer size, the output has been truncated. SIZE_MAX if
+ * the nesting exceeded maxDepth.
+ */
+size_t JsonWriter::getLength(void) const
+{
+    return depthExceeded ? SIZE_MAX : len;
+}
+
+/**
+ * @brief Start an object or array, unless it exceeds maxDepth.
+ */
+void JsonWriter::startContainer(const char* key, char c)
+{
+    if(depth >= maxDepth) {
+        depthExceeded = true;
+        if(bufLen > 0) buf[0] = '\0';
+        return;
+    }
+
+    startValue(key);
+    putChar(c);
+    depth++;
+    hasItems &= ~(1u << depth);
+}
+
+/**
+ * @brief Emit the separator to the previous item of the current container and the key.
+ */
+void JsonWriter::startValue(const char* key)
+{
+    if(hasItems & (1u << depth)) putChar(',');
+    hasItems |= (1u << depth);
+
+    if(nullptr != key) {
+        putEscaped(key);
+        putChar(':');
+    }
+}
+
+/**
+ * @brief Emit a single character, keeping the output zero terminated.
+ */
+void JsonWriter::putChar(char c)
+{
+    if(depthExceeded) return;
+
+    if((len + 1) < bufLen) {
+        buf[len] = c;
+        buf[len + 1] = '\0';
+    }
+    len++;
+}
+
+/**
+ * @brief Emit a quoted and escaped string.
+ */
+void JsonWriter::putEscaped(const char* str)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    putChar('"');
+    for(; *str != '\0'; str++) {
+        unsigned char c = (unsigned char) *str;
+
+        if((c == '"') || (c == '\\')) {
+            putChar('\\');
+            putChar((char) c);
+        } else if(c < 0x20) {
+            putChar('\\');
+            putChar('u');
+            putChar('0');
+            putChar('0');
+            putChar(hexDigits[c >> 4]);
+            putChar(hexDigits[c & 0x0F]);
+        } else {
+            putChar((char) c);
+        }
+    }
+    putChar('"');
+}
+
+/**
+ * @brief Emit the decimal representation of an unsigned integer.
+ */
+void JsonWriter::putUint(uint64_t val)
+{
+    char digits[20];
+    int numDigits = 0;
+
+    do {
+        digits[numDigits++] = (char) ('0' + (val % 10));
+        val /= 10;
+    } while(val != 0);
+
+    while(numDigits > 0) {
+        putChar(digits[--numDigits]);
+    }
+}
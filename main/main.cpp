@@ -12,7 +12,7 @@
 #include "esp_event_loop.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
-#include "esp_spiffs.h"
+#include "esp_sleep.h"
 
 #include "user_config.h"
 #include "version.h"
@@ -40,6 +40,9 @@ EventGroupHandle_t wifiEvents;
 const int wifiEventConnected = (1<<0);
 const int wifiEventDisconnected = (1<<1);
 
+CivilTime civilTime;
+SolarTable solarTable;
+JsonArena jsonArena;
 SettingsManager settingsMgr;
 FillSensorPacketizer fillSensorPacketizer;
 FillSensorProtoHandler<FillSensorPacketizer> fillSensor(&fillSensorPacketizer);
@@ -49,6 +52,9 @@ MqttManager mqttMgr;
 IrrigationController irrigCtrl;
 IrrigationPlanner irrigPlanner;
 
+static_assert(sizeof(SettingsManager) + sizeof(IrrigationPlanner) <= irrigationCapacityStaticRamBudget,
+    "The irrigation capacity policy doesn't fit into the static DRAM budget");
+
 // ********************************************************************
 // WiFi handling
 // ********************************************************************
@@ -206,6 +212,12 @@ static void initializeOta()
 void mqttOtaCallback(const char* topic, int topicLen, const char* data, int dataLen)
 {
     if(0 == iap_https_update_in_progress()) {
+        // The request is parsed in the JSON arena, so it doesn't fragment the heap
+        if(JsonArena::ERR_OK != jsonArena.acquire(pdMS_TO_TICKS(1000))) {
+            ESP_LOGW(LOG_TAG_OTA, "Dropping OTA request, JSON arena is busy.");
+            return;
+        }
+
         cJSON* root = cJSON_Parse(data);
         if(nullptr == root) {
             ESP_LOGW(LOG_TAG_OTA, "Error parsing JSON OTA request.");
@@ -239,6 +251,7 @@ void mqttOtaCallback(const char* topic, int topicLen, const char* data, int data
             }
             cJSON_Delete(root);
         }
+        jsonArena.release();
     } else {
         ESP_LOGI(LOG_TAG_OTA, "OTA firmware upgrade already in progress. Dropping request.");
     }
@@ -278,38 +291,8 @@ void iapHttpsEventCallback(iap_https_event_t* event)
 // ********************************************************************
 esp_err_t initializeSpiffs(void)
 {
-    esp_err_t ret = ESP_OK;
-
-    esp_vfs_spiffs_conf_t conf = {
-      .base_path = filepathConfigStore,
-      .partition_label = partlabelConfigStore,
-      .max_files = 4,
-      .format_if_mount_failed = true
-    };
-
-    ret = esp_vfs_spiffs_register(&conf);
-
-    if (ret != ESP_OK) {
-        if (ret == ESP_FAIL) {
-            ESP_LOGE(LOG_TAG_SPIFFS, "Failed to mount or format config filesystem");
-        } else if (ret == ESP_ERR_NOT_FOUND) {
-            ESP_LOGE(LOG_TAG_SPIFFS, "Failed to find config partition");
-        } else {
-            ESP_LOGE(LOG_TAG_SPIFFS, "Failed to initialize SPIFFS (%s)", esp_err_to_name(ret));
-        }
-    }
-
-    if (ESP_OK == ret) {
-        size_t total = 0, used = 0;
-        ret = esp_spiffs_info(partlabelConfigStore, &total, &used);
-        if (ret != ESP_OK) {
-            ESP_LOGE(LOG_TAG_SPIFFS, "Failed to get partition information (%s)", esp_err_to_name(ret));
-        } else {
-            ESP_LOGI(LOG_TAG_SPIFFS, "Partition size: total: %d, used: %d", total, used);
-        }
-    }
-
-    return ret;
+    // The settings manager mounts the config store, which only it uses
+    return (SettingsManager::ERR_OK == settingsMgr.mountConfigStore()) ? ESP_OK : ESP_FAIL;
 }
 
 // ********************************************************************
@@ -324,15 +307,24 @@ esp_err_t initializeSpiffs(void)
 void mqttIrrigConfigSetCallback(const char* topic, int topicLen, const char* data, int dataLen);
 void mqttHardwareConfigSetCallback(const char* topic, int topicLen, const char* data, int dataLen);
 
-esp_err_t initializeSettingsMgr(void)
+esp_err_t initializeSettingsMgr(bool configRestored)
 {
     esp_err_t ret = ESP_OK;
 
-    settingsMgr.init();
+    // Unless the config has been restored from RTC memory, use the config image of a previous
+    // boot if possible. Otherwise parse the defaults and the config files from SPIFFS and
+    // store the result as image for the next boots.
+    if(!configRestored && (SettingsManager::ERR_OK != settingsMgr.loadConfigImage())) {
+        settingsMgr.init();
 
-    // try to read config files from SPIFFS
-    settingsMgr.readIrrigationConfigFile();
-    settingsMgr.readHardwareConfigFile();
+        settingsMgr.readIrrigationConfigFile();
+        settingsMgr.readHardwareConfigFile();
+
+        settingsMgr.storeConfigImage();
+    }
+
+    // Configs received via MQTT are stored persistently by its task
+    settingsMgr.start();
 
     // subscribe to the config topics
     static char irrigTopic[MQTT_CONFIG_TOPIC_PRE_LEN + MQTT_CONFIG_IRRIG_TOPIC_POST_SET_LEN + 12 + 1];
@@ -437,11 +429,16 @@ extern "C" void app_main()
     // Initialize WiFi, but don't start yet.
     initializeWifi();
 
-    // Initialize the SPIFFS, which may contain a config file
-    ESP_ERROR_CHECK( initializeSpiffs() );
+    // Timer wakes from deep sleep restore the config from RTC memory. Otherwise initialize
+    // the SPIFFS, which may contain config files. It is mounted on demand later on.
+    bool configRestored = (ESP_SLEEP_WAKEUP_TIMER == esp_sleep_get_wakeup_cause()) &&
+        (SettingsManager::ERR_OK == settingsMgr.loadConfigRtcCopy());
+    if(!configRestored) {
+        ESP_ERROR_CHECK( initializeSpiffs() );
+    }
 
     // Initialize settings storage including setup of hooks, initial load from file, etc.
-    ESP_ERROR_CHECK( initializeSettingsMgr() );
+    ESP_ERROR_CHECK( initializeSettingsMgr(configRestored) );
 
     // Prepare global mqtt clientName (needed due to lack of named initializers in C99)
     // and init the manager.
@@ -449,8 +446,12 @@ extern "C" void app_main()
 
     initializeOta();
 
-    // Start WiFi. Events will start/stop MQTT client
-    ESP_ERROR_CHECK( esp_wifi_start() );
+    // Start WiFi, unless this is a wake without network. Events will start/stop MQTT client
+    if(irrigCtrl.isNetworkWakeRequired()) {
+        irrigCtrl.startNetwork();
+    } else {
+        ESP_LOGI("main", "Wake without network. Not starting WiFi.");
+    }
 
     TimeSystem_Init();
 
@@ -458,10 +459,14 @@ extern "C" void app_main()
 
     // Register config hooks for classes that have no init or task startup functions and therefore can't do it
     // on their own
+    settingsMgr.registerHardwareConfigUpdatedHook(TimeSystem_HardwareConfigUpdated, nullptr);
+    settingsMgr.registerHardwareConfigUpdatedHook(settingsMgr.solarTableUpdateHookDispatch, &settingsMgr);
     settingsMgr.registerHardwareConfigUpdatedHook(pwrMgr.hardwareConfigUpdatedHookDispatch, &pwrMgr);
     settingsMgr.registerIrrigConfigUpdatedHook(irrigPlanner.irrigConfigUpdatedHookDispatch, &irrigPlanner);
 
     // ... and initiate an initial settings update for them
+    TimeSystem_HardwareConfigUpdated(nullptr);
+    settingsMgr.updateSolarTable();
     pwrMgr.hardwareConfigUpdated();
     irrigPlanner.irrigConfigUpdated();
 
@@ -52,12 +52,12 @@ PowerManager::PowerManager()
     // TBD: wait for settlement of IO?
     keepAwakeAtBootState = gpio_get_level(keepAwakeGpioNum);
 
-    configMutex = xSemaphoreCreateMutexStatic(&configMutexBuf);
+    batt_thresholds_t thresholds = {1, 2, 3};
+    battThresholds.write(thresholds);
 }
 
 PowerManager::~PowerManager()
 {
-    if (configMutex) vSemaphoreDelete(configMutex);
 }
 
 uint32_t PowerManager::getSupplyVoltageMilli(void)
@@ -98,18 +98,16 @@ uint32_t PowerManager::getSupplyVoltageMilli(void)
 PowerManager::batt_state_t PowerManager::getBatteryState(uint32_t millis)
 {
     batt_state_t state = BATT_CRITICAL;
+    batt_thresholds_t thresholds;
 
-    if (pdFALSE == xSemaphoreTake(configMutex, lockAcquireTimeout)) {
-        ESP_LOGE(logTag, "Couldn't acquire config lock within timeout!");
-    } else {
-        if(millis >= battOkThresholdMilli) {
-            state = BATT_FULL;
-        } else if(millis >= battLowThresholdMilli) {
-            state = BATT_OK;
-        } else if(millis >= battCriticalThresholdMilli) {
-            state = BATT_LOW;
-        }
-        xSemaphoreGive(configMutex);
+    battThresholds.read(&thresholds);
+
+    if(millis >= thresholds.battOkThresholdMilli) {
+        state = BATT_FULL;
+    } else if(millis >= thresholds.battLowThresholdMilli) {
+        state = BATT_OK;
+    } else if(millis >= thresholds.battCriticalThresholdMilli) {
+        state = BATT_LOW;
     }
 
     return state;
@@ -252,15 +250,12 @@ void PowerManager::hardwareConfigUpdated()
 {
     ESP_LOGI(logTag, "Hardware config update notification received.");
 
-    if (pdFALSE == xSemaphoreTake(configMutex, lockAcquireTimeout)) {
-        ESP_LOGE(logTag, "Couldn't acquire config lock within timeout!");
-    } else {
-        SettingsManager::battery_config_t batConf;
-        settingsMgr.copyBatteryConfig(&batConf);
-        battCriticalThresholdMilli = batConf.battCriticalThresholdMilli;
-        battLowThresholdMilli = batConf.battLowThresholdMilli;
-        battOkThresholdMilli = batConf.battOkThresholdMilli;
+    SettingsManager::battery_config_t batConf;
+    batt_thresholds_t thresholds;
 
-        xSemaphoreGive(configMutex);
-    }
+    settingsMgr.copyBatteryConfig(&batConf);
+    thresholds.battCriticalThresholdMilli = batConf.battCriticalThresholdMilli;
+    thresholds.battLowThresholdMilli = batConf.battLowThresholdMilli;
+    thresholds.battOkThresholdMilli = batConf.battOkThresholdMilli;
+    battThresholds.write(thresholds);
 }
@@ -0,0 +1,90 @@
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+#include "freertos/FreeRTOS.h"
+
+
+/**
+ * @brief The SeqLock class holds a small, trivially copyable value, e.g. a configuration
+ * struct, which is read frequently and written rarely.
+ *
+ * Readers never block: They copy the value and retry only if a writer modified it
+ * meanwhile, which is detected by a sequence counter being odd during a write.
+ * Writers are serialized by a short critical section covering nothing but the copy,
+ * so a reader can't be starved by a preempted writer.
+ *
+ * The value is stored as atomic words, hence racing readers and writers don't
+ * constitute a data race.
+ *
+ * @tparam T Type of the value.
+ */
+template <typename T>
+class SeqLock
+{
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type");
+
+    SeqLock() : sequence(0)
+    {
+        vPortCPUInitializeMutex(&writeMux);
+        for(unsigned int i = 0; i < numWords; i++) {
+            words[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Publish a new value.
+     *
+     * @param src Value to publish.
+     */
+    void write(const T& src)
+    {
+        uint32_t buf[numWords] = {0};
+        memcpy(buf, &src, sizeof(T));
+
+        portENTER_CRITICAL(&writeMux);
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for(unsigned int i = 0; i < numWords; i++) {
+            words[i].store(buf[i], std::memory_order_relaxed);
+        }
+        sequence.store(seq + 2, std::memory_order_release);
+        portEXIT_CRITICAL(&writeMux);
+    }
+
+    /**
+     * @brief Get a consistent copy of the current value.
+     *
+     * @param dst Destination of the copy.
+     */
+    void read(T* dst) const
+    {
+        uint32_t buf[numWords];
+        uint32_t seq;
+
+        do {
+            seq = sequence.load(std::memory_order_acquire);
+            for(unsigned int i = 0; i < numWords; i++) {
+                buf[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while((0 != (seq & 1)) || (seq != sequence.load(std::memory_order_relaxed)));
+
+        memcpy(dst, buf, sizeof(T));
+    }
+
+private:
+    static constexpr unsigned int numWords = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> sequence;         /**< Incremented before and after each write, odd while writing */
+    std::atomic<uint32_t> words[numWords];  /**< Value storage */
+    portMUX_TYPE writeMux;                  /**< Serializes writers */
+};
+
+#endif /* SEQ_LOCK_H */
@@ -80,7 +80,7 @@ private:
         static uart_event_t uart_event;
         static BUFFER_T tmpBuffer;
 
-        ESP_LOGD(caller->logTag, "Handling task started. Caller: 0x%08x", (uint32_t) params);
+        ESP_LOGD(caller->logTag, "Handling task started. Caller: %p", params);
 
         while(1) {
             // TBD: add stop request signal
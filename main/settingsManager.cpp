@@ -1,29 +1,151 @@
 #include "settingsManager.h"
 
+#include <stddef.h>
 #include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cmath>
 
+#include "freertos/task.h"
+
+#include "esp_attr.h"
+#include "esp_partition.h"
+#include "esp_spiffs.h"
+#include "rom/crc.h"
+
+#include "version.h"
+#include "defaultConfig.h"
 #include "globalComponents.h"
+#include "irrigationConfigParser.h"
 #include "irrigationController.h"
 extern IrrigationController irrigCtrl;
 
-extern const uint8_t irrigationConfig_default_json_start[] asm("_binary_irrigationConfig_default_json_start");
-extern const uint8_t irrigationConfig_default_json_end[] asm("_binary_irrigationConfig_default_json_end");
-extern const uint8_t hardwareConfig_default_json_start[] asm("_binary_hardwareConfig_default_json_start");
-extern const uint8_t hardwareConfig_default_json_end[] asm("_binary_hardwareConfig_default_json_end");
+/**
+ * Binary image of the configuration, as published after parsing the defaults and config
+ * files on a boot. It is stored in its own partition and consists of the header, the data
+ * and the records of the used events.
+ */
+static const uint32_t configImageMagic = 0x47464349;                   /**< "ICFG" */
+static const uint32_t configImageFormatVersion = 2;
+
+typedef struct config_image_header_t {
+    uint32_t magic;                                                     /**< configImageMagic, written last so incomplete images are invalid */
+    uint32_t key;                                                       /**< Firmware and defaults the image belongs to, see calcConfigImageKey() */
+    uint32_t payloadLen;                                                /**< Length of the data and event records */
+    uint32_t payloadCrc;                                                /**< CRC32 of the data and event records */
+} config_image_header_t;
+
+static const size_t configImageDataOffset = sizeof(config_image_header_t);
+static const size_t configImageEventsOffset = configImageDataOffset + sizeof(SettingsManager::config_image_data_t);
+static_assert(0 == (configImageDataOffset % alignof(SettingsManager::config_image_data_t)), "Config image data must be aligned");
+static_assert(offsetof(default_config_t, events) == sizeof(SettingsManager::config_image_data_t), "Default event records must follow the data");
+
+/**
+ * Copy of the published configuration in RTC memory, which persists during deep sleep.
+ * The payload has the format of the config image. Configurations with too many events for
+ * the payload buffer aren't copied.
+ */
+static const size_t configRtcPayloadFullLen = sizeof(SettingsManager::config_image_data_t) +
+    irrigationPlannerNumNormalEvents * sizeof(SettingsManager::config_image_event_t);
+static const size_t configRtcPayloadMaxLen = (configRtcPayloadFullLen < 3072) ? configRtcPayloadFullLen : 3072;
+
+typedef struct config_rtc_data_t {
+    uint32_t generation;                                                /**< Incremented with each accepted config update */
+    uint32_t len;                                                       /**< Length of the payload, 0 if there is no copy */
+    uint32_t crc;                                                       /**< CRC32 of the generation, length and payload */
+    alignas(SettingsManager::config_image_data_t) uint8_t payload[configRtcPayloadMaxLen];
+} config_rtc_data_t;
+
+RTC_DATA_ATTR static config_rtc_data_t configRtcData = {};
+
+/** Copy of the active solar table in RTC memory, so wakes from deep sleep don't read it from the config store */
+typedef struct solar_rtc_data_t {
+    uint32_t crc;                                                       /**< CRC32 of the table */
+    SolarTable::solar_table_data_t table;                               /**< Table, also used to read or calculate a new one */
+} solar_rtc_data_t;
+
+RTC_DATA_ATTR static solar_rtc_data_t solarRtcData = {};
+
+/** Config store writes since power on, to watch the flash wear */
+RTC_DATA_ATTR static SettingsManager::config_store_stats_t configStoreStats = {};
+static portMUX_TYPE configStoreStatsMux = portMUX_INITIALIZER_UNLOCKED;
+
+/** Suffix of the temporary file a config file is written to before it replaces the file */
+static const char configFileTempSuffix[] = ".tmp";
+/** Suffix the temporary file is renamed to once it is complete */
+static const char configFileNewSuffix[] = ".new";
+static const size_t configFilenameMaxLen = 48;                         /**< Including the temporary file suffixes */
+
+/**
+ * @brief Calculate the key of config images, which identifies the firmware and the default
+ * configs. Images of other firmware versions may have another layout or have been
+ * validated differently, so they aren't used.
+ */
+static uint32_t calcConfigImageKey(void)
+{
+    static const uint32_t layout[] = {configImageFormatVersion, sizeof(SettingsManager::config_image_data_t),
+        sizeof(SettingsManager::config_image_event_t), irrigationPlannerNumZones, irrigationPlannerNumNormalEvents};
+    uint32_t key;
+
+    key = crc32_le(0, (const uint8_t*) layout, sizeof(layout));
+    key = crc32_le(key, (const uint8_t*) &defaultConfig, sizeof(default_config_t));
+    key = crc32_le(key, (const uint8_t*) OTA_VERSION_STRING, strlen(OTA_VERSION_STRING));
+
+    return key;
+}
+
+static uint32_t calcConfigRtcCrc(void)
+{
+    uint32_t crc;
+
+    crc = crc32_le(0, (const uint8_t*) &configRtcData.generation, sizeof(configRtcData.generation));
+    crc = crc32_le(crc, (const uint8_t*) &configRtcData.len, sizeof(configRtcData.len));
+    crc = crc32_le(crc, configRtcData.payload, configRtcData.len);
+
+    return crc;
+}
+
+static uint32_t calcSolarRtcCrc(void)
+{
+    return crc32_le(0, (const uint8_t*) &solarRtcData.table, sizeof(solarRtcData.table));
+}
 
 /**
  * @brief Default constructor, which performs basic initialization.
  */
 SettingsManager::SettingsManager()
 {
-    // Clear event and zone shadow storages
-    clearZoneData(shadowDataIrrigationConfig);
-    clearEventData(shadowDataIrrigationConfig);
+    // Clear event and zone snapshots
+    for(int i = 0; i < numIrrigConfigs; i++) {
+        clearZoneData(irrigConfigs[i]);
+        clearEventData(irrigConfigs[i]);
+        irrigConfigs[i].generation = 0;
+        irrigConfigRefCount[i] = 0;
+    }
+    irrigConfigActive = -1;
+    irrigConfigGeneration = 0;
+
+    strncpy(shadowDataTimeConfig.timezone, TimeSystem_defaultTimezone, civilTimeTzRuleMaxLen);
+    shadowDataTimeConfig.timezone[civilTimeTzRuleMaxLen] = '\0';
+
+    shadowDataLocationConfig.enabled = false;
+    shadowDataLocationConfig.latitudeMicroDeg = 0;
+    shadowDataLocationConfig.longitudeMicroDeg = 0;
+
+    shadowDataMqttConfig.stateEncoding = PAYLOAD_JSON;
+    shadowDataMqttConfig.telemetryEncoding = PAYLOAD_JSON;
 
     configMutex = xSemaphoreCreateMutexStatic(&configMutexBuf);
     fileIoMutex = xSemaphoreCreateMutexStatic(&fileIoMutexBuf);
+    configStoreMounted = false;
     hookMutex = xSemaphoreCreateMutexStatic(&hookMutexBuf);
 
+    persistMutex = xSemaphoreCreateMutexStatic(&persistMutexBuf);
+    persistRequestSem = xSemaphoreCreateBinaryStatic(&persistRequestSemBuf);
+    persistTaskHandle = nullptr;
+    pendingConfigFiles[CONFIG_FILE_IRRIGATION] = {filenameIrrigationConfig, pendingIrrigationConfig, sizeof(pendingIrrigationConfig), 0, false};
+    pendingConfigFiles[CONFIG_FILE_HARDWARE] = {filenameHardwareConfig, pendingHardwareConfig, sizeof(pendingHardwareConfig), 0, false};
+
     for (int i=0; i<numHookTableEntries; i++) {
         irrigConfigUpdatedHooks[i] = nullptr;
         irrigConfigUpdatedHookParamPtrs[i] = nullptr;
@@ -40,14 +162,69 @@ SettingsManager::~SettingsManager()
     if (configMutex) vSemaphoreDelete(configMutex);
     if (fileIoMutex) vSemaphoreDelete(fileIoMutex);
     if (hookMutex) vSemaphoreDelete(hookMutex);
+    if (persistMutex) vSemaphoreDelete(persistMutex);
+    if (persistRequestSem) vSemaphoreDelete(persistRequestSem);
 }
 
+/**
+ * @brief Publish the default configuration, so defaults are available as soon as possible.
+ * 
+ * The defaults have been validated at build time and are applied in storable form (see
+ * defaultConfig.h, generated from the default config files), i.e. without any parsing.
+ * The config updated hooks aren't called.
+ */
 void SettingsManager::init()
 {
-    // setup default data so defaults are available as soon as possible
     ESP_LOGD(logTag, "Loading default configuration.");
-    updateIrrigationConfig((const char*) irrigationConfig_default_json_start, irrigationConfig_default_json_end - irrigationConfig_default_json_start + 1, true);
-    updateHardwareConfig((const char*) hardwareConfig_default_json_start, hardwareConfig_default_json_end - hardwareConfig_default_json_start + 1, true);
+
+    if (pdFALSE == xSemaphoreTake(configMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire config lock within timeout!");
+        return;
+    }
+
+    if(ERR_OK == applyConfigImage(&defaultConfig.data, sizeof(config_image_data_t) + defaultConfigNumEvents * sizeof(config_image_event_t))) {
+        updateConfigRtcCopy();
+    }
+
+    xSemaphoreGive(configMutex);
+}
+
+/**
+ * @brief Start the persistence task, which writes configs to be stored persistently to
+ * the config store. Until it is started, they are written by the updating task itself
+ * (after releasing the config lock).
+ */
+void SettingsManager::start()
+{
+    if(nullptr != persistTaskHandle) return;
+
+    persistTaskHandle = xTaskCreateStatic(persistTaskFuncDispatch, "settings_persist", persistTaskStackSize, (void*) this,
+        persistTaskPrio, persistTaskStack, &persistTaskBuf);
+    if (nullptr != persistTaskHandle) {
+        ESP_LOGI(logTag, "Persistence task created.");
+    } else {
+        ESP_LOGE(logTag, "Persistence task creation failed!");
+    }
+}
+
+void SettingsManager::persistTaskFuncDispatch(void* params)
+{
+    SettingsManager* caller = (SettingsManager*) params;
+
+    caller->persistTaskFunc();
+}
+
+/**
+ * @brief Persistence task, which writes the pending config files. The config lock isn't
+ * held meanwhile, so config readers and updates aren't blocked by the flash I/O.
+ */
+void SettingsManager::persistTaskFunc()
+{
+    while(true) {
+        if(pdTRUE == xSemaphoreTake(persistRequestSem, portMAX_DELAY)) {
+            writePendingConfigFiles();
+        }
+    }
 }
 
 void SettingsManager::clearZoneData(irrigation_config_t& settings)
@@ -62,238 +239,159 @@ void SettingsManager::clearZoneData(irrigation_config_t& settings)
 
 void SettingsManager::clearEventData(irrigation_config_t& settings)
 {
-    for(int i = 0; i < irrigationPlannerNumNormalEvents; i++) {
-        settings.eventsUsed[i] = false;
-    }
+    settings.events.clear();
 }
 
-SettingsManager::err_t SettingsManager::jsonParseZone(cJSON* zoneJson, irrigation_zone_cfg_t& zoneCfg)
+/**
+ * @brief Parse an MQTT payload encoding ("json" or "cbor").
+ * 
+ * @param item JSON item of the encoding. May be nullptr, if it is omitted.
+ * @param encoding Parsed encoding. Left untouched if the item is omitted.
+ * @return SettingsManager::err_t ERR_OK on success, ERR_PARSING_ERR otherwise.
+ */
+SettingsManager::err_t SettingsManager::jsonParsePayloadEncoding(cJSON* item, payload_encoding_t* encoding)
 {
-    err_t ret = ERR_OK;
-
-    cJSON* namePtr = cJSON_GetObjectItem(zoneJson, "name");
-    cJSON* chEnPtr = cJSON_GetObjectItem(zoneJson, "chEnabled");
-    cJSON* chNumPtr = cJSON_GetObjectItem(zoneJson, "chNum");
-    cJSON* chStateStartPtr = cJSON_GetObjectItem(zoneJson, "chStateStart");
-    cJSON* chStateStopPtr = cJSON_GetObjectItem(zoneJson, "chStateStop");
-    cJSON* elem;
-    int numZones;
-
-    if( (nullptr != namePtr) && (nullptr != chEnPtr) && (nullptr != chNumPtr) &&
-        (nullptr != chStateStartPtr) && (nullptr != chStateStopPtr) )
-    {
-        if( cJSON_IsString(namePtr) && cJSON_IsArray(chEnPtr) && cJSON_IsArray(chNumPtr) &&
-            cJSON_IsArray(chStateStartPtr) && cJSON_IsArray(chStateStopPtr) &&
-            ((numZones = cJSON_GetArraySize(chEnPtr)) <= irrigationZoneCfgElements) &&
-            (numZones == cJSON_GetArraySize(chNumPtr)) && (numZones == cJSON_GetArraySize(chStateStartPtr)) &&
-            (numZones == cJSON_GetArraySize(chStateStopPtr)) )
-        {
-            strncpy(zoneCfg.name, cJSON_GetStringValue(namePtr), irrigationZoneCfgNameLen);
-            zoneCfg.name[irrigationZoneCfgNameLen] = '\0';
-
-            int i = 0;
-            cJSON_ArrayForEach(elem, chEnPtr) {
-                if(!cJSON_IsBool(elem)) {
-                    ret = ERR_PARSING_ERR;
-                    break;
-                }
-                zoneCfg.chEnabled[i] = cJSON_IsTrue(elem);
-                i++;
-            }
+    if(nullptr == item) return ERR_OK;
+    if(!cJSON_IsString(item)) return ERR_PARSING_ERR;
 
-            i = 0;
-            cJSON_ArrayForEach(elem, chNumPtr) {
-                if(!cJSON_IsNumber(elem)) {
-                    ret = ERR_PARSING_ERR;
-                    break;
-                }
-                zoneCfg.chNum[i] = (OutputController::ch_map_t) elem->valueint;
-                i++;
-            }
-
-            i = 0;
-            cJSON_ArrayForEach(elem, chStateStartPtr) {
-                if(!cJSON_IsBool(elem)) {
-                    ret = ERR_PARSING_ERR;
-                    break;
-                }
-                zoneCfg.chStateStart[i] = cJSON_IsTrue(elem);
-                i++;
-            }
-
-            i = 0;
-            cJSON_ArrayForEach(elem, chStateStopPtr) {
-                if(!cJSON_IsBool(elem)) {
-                    ret = ERR_PARSING_ERR;
-                    break;
-                }
-                zoneCfg.chStateStop[i] = cJSON_IsTrue(elem);
-                i++;
-            }
-        } else {
-            ret = ERR_PARSING_ERR;
-        }
+    if(0 == strcmp(cJSON_GetStringValue(item), PAYLOAD_ENCODING_TO_STR(PAYLOAD_JSON))) {
+        *encoding = PAYLOAD_JSON;
+    } else if(0 == strcmp(cJSON_GetStringValue(item), PAYLOAD_ENCODING_TO_STR(PAYLOAD_CBOR))) {
+        *encoding = PAYLOAD_CBOR;
     } else {
-        ret = ERR_PARSING_ERR;
+        return ERR_PARSING_ERR;
     }
 
-    return ret;
+    return ERR_OK;
 }
 
-SettingsManager::err_t SettingsManager::jsonParseEvent(cJSON* evtJson, IrrigationEvent& evt, bool& used)
+SettingsManager::err_t SettingsManager::updateIrrigationConfig(const char* const jsonData, int jsonDataLen, bool noNotify)
 {
-    err_t ret = ERR_OK;
+    if (nullptr == jsonData) return ERR_INVALID_ARG;
+    if (jsonDataLen < 2) return ERR_INVALID_ARG; // check for minimum data length ("{}")
 
-    cJSON* zoneNumPtr = cJSON_GetObjectItem(evtJson, "zoneNum");
-    cJSON* durationSecsPtr = cJSON_GetObjectItem(evtJson, "durationSecs");
-    cJSON* isSinglePtr = cJSON_GetObjectItem(evtJson, "isSingle");
-    cJSON* isDailyPtr = cJSON_GetObjectItem(evtJson, "isDaily");
-    cJSON* hourPtr = cJSON_GetObjectItem(evtJson, "hour");
-    cJSON* minutePtr = cJSON_GetObjectItem(evtJson, "minute");
-    cJSON* secondPtr = cJSON_GetObjectItem(evtJson, "second");
-    cJSON* dayPtr = cJSON_GetObjectItem(evtJson, "day");
-    cJSON* monthPtr = cJSON_GetObjectItem(evtJson, "month");
-    cJSON* yearPtr = cJSON_GetObjectItem(evtJson, "year");
-
-    if( (nullptr != zoneNumPtr) && (nullptr != durationSecsPtr) && (nullptr != hourPtr) &&
-        (nullptr != minutePtr) && (nullptr != secondPtr) &&
-        cJSON_IsNumber(zoneNumPtr) && cJSON_IsNumber(durationSecsPtr) && cJSON_IsNumber(hourPtr) &&
-        cJSON_IsNumber(minutePtr) && cJSON_IsNumber(secondPtr) )
-    {
-        if( (nullptr != isSinglePtr) && cJSON_IsBool(isSinglePtr) && cJSON_IsTrue(isSinglePtr) &&
-            (nullptr != dayPtr) && (nullptr != monthPtr) && (nullptr != yearPtr) &&
-            cJSON_IsNumber(dayPtr) && cJSON_IsNumber(monthPtr) && cJSON_IsNumber(yearPtr))
-        {
-            if(IrrigationEvent::ERR_OK != evt.setSingleEvent(
-                hourPtr->valueint, minutePtr->valueint, secondPtr->valueint,
-                dayPtr->valueint, monthPtr->valueint, yearPtr->valueint))
-            {
-                ret = ERR_PARSING_ERR;
-            }
-            if(IrrigationEvent::ERR_OK != evt.setZoneIndex(zoneNumPtr->valueint)) {
-                ret = ERR_PARSING_ERR;
-            }
-            evt.setDuration(durationSecsPtr->valueint);
-            evt.setStartFlag(true);
-            used = true;
-        } else if((nullptr != isDailyPtr) && cJSON_IsBool(isDailyPtr) && cJSON_IsTrue(isDailyPtr)) {
-            if(IrrigationEvent::ERR_OK != evt.setDailyRepetition(
-                hourPtr->valueint, minutePtr->valueint, secondPtr->valueint))
-            {
-                ret = ERR_PARSING_ERR;
-            }
-            if(IrrigationEvent::ERR_OK != evt.setZoneIndex(zoneNumPtr->valueint)) {
-                ret = ERR_PARSING_ERR;
-            }
-            evt.setDuration(durationSecsPtr->valueint);
-            evt.setStartFlag(true);
-            used = true;
-        } else {
-            ret = ERR_PARSING_ERR;
-        }
-    }
-    return ret;
+    return updateIrrigationConfig(jsonData, jsonDataLen, nullptr, noNotify);
 }
 
-SettingsManager::err_t SettingsManager::updateIrrigationConfig(const char* const jsonData, int jsonDataLen, bool noNotify)
+/**
+ * @brief Parse and publish an irrigation config, which is streamed from memory or a file.
+ * 
+ * The config is parsed directly into the snapshot that isn't published, so neither a
+ * copy of the input nor a JSON tree is needed. Storing the config persistently is only
+ * supported for configs in memory.
+ * 
+ * @param jsonData Config in memory, nullptr if it is read from the file.
+ * @param jsonDataLen Length of the config in memory.
+ * @param f File to read the config from, nullptr if it is in memory.
+ * @param noNotify Don't call the irrigation config updated hooks.
+ * @return SettingsManager::err_t
+ */
+SettingsManager::err_t SettingsManager::updateIrrigationConfig(const char* const jsonData, int jsonDataLen, FILE* f, bool noNotify)
 {
     err_t ret = ERR_OK;
-    static char jsonStr[8192]; // data is not a NULL-terminated string, therefore we need to pre-process it
-
-    if (nullptr == jsonData) return ERR_INVALID_ARG;
-    if (jsonDataLen < 2) return ERR_INVALID_ARG; // check for minimum data length ("{}")
-    if (jsonDataLen > (sizeof(jsonStr) - 1)) return ERR_INVALID_ARG; // chekc for maximum buffer space
+    static char readChunk[configFileReadChunkLen]; // only used while holding the config lock
+
+    // Parse into a snapshot that is neither published nor used by readers of previous
+    // configurations. If readers still use all of them, wait for one to be released without
+    // holding the config lock, so other config updates aren't blocked meanwhile.
+    int targetIdx = -1;
+    bool locked = false;
+    TickType_t waitStart = xTaskGetTickCount();
+    while(!locked && (pdTRUE == xSemaphoreTake(configMutex, lockAcquireTimeout))) {
+        targetIdx = findFreeIrrigationConfig();
+        if((targetIdx >= 0) || ((xTaskGetTickCount() - waitStart) >= lockAcquireTimeout)) {
+            locked = true;
+        } else {
+            xSemaphoreGive(configMutex);
+            vTaskDelay(irrigConfigPollTicks);
+        }
+    }
 
-    if (pdFALSE == xSemaphoreTake(configMutex, lockAcquireTimeout)) {
+    if (!locked) {
         ESP_LOGE(logTag, "Couldn't acquire config lock within timeout!");
         ret = ERR_TIMEOUT;
     } else {
         ESP_LOGI(logTag, "Parsing irrigation config update.");
 
-        static irrigation_config_t settingsTemp;
-
         pwrMgr.setKeepAwakeForce(true);
 
-        clearZoneData(settingsTemp);
-        clearEventData(settingsTemp);
-
-        memcpy(jsonStr, jsonData, sizeof(char) * jsonDataLen);
-        jsonStr[jsonDataLen] = 0;
-
-        cJSON* root = cJSON_ParseWithOpts(jsonStr, nullptr, true);
-        cJSON* zones;
-        cJSON* events;
-        if(nullptr != root) {
-            zones = cJSON_GetObjectItem(root, "zones");
-            events = cJSON_GetObjectItem(root, "events");
+        bool storePersistent = false;
+        size_t storeSkipStart = 0;
+        size_t storeSkipEnd = 0;
 
-            int numZones;
-            int numEvents;
+        if(targetIdx < 0) {
+            ESP_LOGE(logTag, "Previous irrigation configs are still in use!");
+            ret = ERR_TIMEOUT;
+        } else {
+            irrigation_config_t& settingsTemp = irrigConfigs[targetIdx];
 
-            bool parsingErr = false;
-            if( (nullptr != zones) && (nullptr != events) &&
-                cJSON_IsArray(zones) && ((numZones = cJSON_GetArraySize(zones)) <= irrigationPlannerNumZones) &&
-                cJSON_IsArray(events) && ((numEvents = cJSON_GetArraySize(events)) <= irrigationPlannerNumNormalEvents) )
-            {
-                int i = 0;
-                cJSON* elem;
-                cJSON_ArrayForEach(elem, zones) {
-                    ESP_LOGD(logTag, "Parsing zone %d", i);
-                    if(ERR_OK != jsonParseZone(elem, settingsTemp.zones[i])) {
-                        parsingErr = true;
-                        break;
-                    }
-                    i++;
-                }
+            clearZoneData(settingsTemp);
+            clearEventData(settingsTemp);
 
-                i = 0;
-                cJSON_ArrayForEach(elem, events) {
-                    ESP_LOGD(logTag, "Parsing event %d", i);
-                    if(ERR_OK != jsonParseEvent(elem, settingsTemp.events[i], settingsTemp.eventsUsed[i])) {
-                        parsingErr = true;
-                        break;
-                    }
-                    i++;
+            IrrigationConfigParser parser(settingsTemp);
+            if(nullptr != f) {
+                size_t bytesRead;
+                while(0 < (bytesRead = fread(readChunk, sizeof(char), sizeof(readChunk), f))) {
+                    parser.feed(readChunk, bytesRead);
                 }
             } else {
-                ESP_LOGE(logTag, "Zone or event config not found in JSON or have wrong type / length!");
-                ret = ERR_SETTINGS_INVALID;
+                parser.feed(jsonData, jsonDataLen);
+                storePersistent = parser.getStorePersistent(&storeSkipStart, &storeSkipEnd);
+            }
+
+            switch(parser.finish()) {
+                case IrrigationConfigParser::ERR_OK:
+                    break;
+                case IrrigationConfigParser::ERR_INVALID_JSON:
+                    ESP_LOGE(logTag, "Parsing JSON failed!");
+                    ret = ERR_INVALID_JSON;
+                    break;
+                case IrrigationConfigParser::ERR_INVALID_STRUCTURE:
+                    ESP_LOGE(logTag, "Zone or event config not found in JSON or have wrong type / length!");
+                    ret = ERR_SETTINGS_INVALID;
+                    break;
+                default:
+                    ESP_LOGE(logTag, "Parsing zone or event config from JSON failed!");
+                    ret = ERR_SETTINGS_INVALID;
+                    break;
             }
 
-            if(parsingErr) {
-                ESP_LOGE(logTag, "Parsing zone or event config from JSON failed!");
+            // Events are scheduled in the configured timezone, whose DST gap lengthens irrigations across it
+            static CivilTime configTimezone;
+            configTimezone.setTimezone(shadowDataTimeConfig.timezone);
+
+            // Fail before publishing, so a published config is always stored as requested
+            if((ret == ERR_OK) && storePersistent && ((jsonDataLen - (storeSkipEnd - storeSkipStart)) > irrigationConfigFileMaxLen)) {
+                ESP_LOGE(logTag, "Config too long to be stored (%u bytes, %u supported)!",
+                    (unsigned int) (jsonDataLen - (storeSkipEnd - storeSkipStart)), (unsigned int) irrigationConfigFileMaxLen);
+                ret = ERR_NO_RESOURCES;
+            }
+
+            unsigned int maxStopEvents;
+            if((ret == ERR_OK) && ((maxStopEvents = IrrigationPlanner::calcMaxStopEvents(settingsTemp.events, configTimezone)) > irrigationPlannerNumConfigStopEvents)) {
+                ESP_LOGE(logTag, "Events overlap too much: Up to %u concurrent irrigations, %u supported!",
+                    maxStopEvents, irrigationPlannerNumConfigStopEvents);
                 ret = ERR_SETTINGS_INVALID;
             }
-        } else {
-            ESP_LOGE(logTag, "Parsing JSON tree failed!");
-            ret = ERR_INVALID_JSON;
         }
 
         if(ret == ERR_OK) {
             ESP_LOGI(logTag, "Zone and event data successfully parsed.");
-            memcpy(shadowDataIrrigationConfig.zones, settingsTemp.zones, sizeof(irrigation_zone_cfg_t) * irrigationZoneCfgElements);
-            for(int i = 0; i < irrigationPlannerNumNormalEvents; i++) {
-                shadowDataIrrigationConfig.events[i] = settingsTemp.events[i];
-                shadowDataIrrigationConfig.eventsUsed[i] = settingsTemp.eventsUsed[i];
-            }
+            // Publish the new snapshot
+            irrigConfigGeneration++;
+            irrigConfigs[targetIdx].generation = irrigConfigGeneration;
+            irrigConfigActive.store(targetIdx);
+            updateConfigRtcCopy();
         }
 
-        cJSON* storePersistentPtr = cJSON_GetObjectItem(root, "storePersistent");
-        if( (nullptr != storePersistentPtr) && cJSON_IsBool(storePersistentPtr) && cJSON_IsTrue(storePersistentPtr) ) {
-            ESP_LOGI(logTag, "Persistent storage of irrigation config requested.");
-
-            cJSON_DetachItemViaPointer(root, storePersistentPtr);
-
-            char* jsonStrModified = cJSON_Print(root);
-            int jsonStrModifiedLen = strlen(jsonStrModified);
+        xSemaphoreGive(configMutex);
 
-            if (ERR_OK != writeConfigFile(filenameIrrigationConfig, jsonStrModified, jsonStrModifiedLen)) {
-                ret = ERR_FILE_IO;
-            }
+        if((ret == ERR_OK) && storePersistent) {
+            ESP_LOGI(logTag, "Persistent storage of irrigation config requested.");
+            // Store the config as received, without the storePersistent member
+            ret = requestConfigFileWrite(CONFIG_FILE_IRRIGATION, jsonData, jsonDataLen, storeSkipStart, storeSkipEnd - storeSkipStart);
         }
 
-        xSemaphoreGive(configMutex);
-
         if((ret == ERR_OK) && !noNotify) {
             callIrrigConfigUpdatedHooks();
         }
@@ -307,7 +405,7 @@ SettingsManager::err_t SettingsManager::updateIrrigationConfig(const char* const
 SettingsManager::err_t SettingsManager::updateHardwareConfig(const char* const jsonData, int jsonDataLen, bool noNotify)
 {
     err_t ret = ERR_OK;
-    static char jsonStr[2048]; // data is not a NULL-terminated string, therefore we need to pre-process it
+    static char jsonStr[hardwareConfigJsonMaxLen]; // data is not a NULL-terminated string, therefore we need to pre-process it
 
     if (nullptr == jsonData) return ERR_INVALID_ARG;
     if (jsonDataLen < 2) return ERR_INVALID_ARG; // check for minimum data length ("{}")
@@ -321,13 +419,19 @@ SettingsManager::err_t SettingsManager::updateHardwareConfig(const char* const j
 
         static battery_config_t batteryTemp;
         static reservoir_config_t reservoirTemp;
+        static time_config_t timeTemp;
+        static location_config_t locationTemp;
+        static mqtt_config_t mqttTemp;
+        static CivilTime timezoneValidator;
 
         pwrMgr.setKeepAwakeForce(true);
 
         memcpy(jsonStr, jsonData, sizeof(char) * jsonDataLen);
         jsonStr[jsonDataLen] = 0;
 
-        cJSON* root = cJSON_ParseWithOpts(jsonStr, nullptr, true);
+        // The JSON tree lives in the JSON arena, which is reset after the update
+        bool arenaAcquired = (JsonArena::ERR_OK == jsonArena.acquire(lockAcquireTimeout));
+        cJSON* root = arenaAcquired ? cJSON_ParseWithOpts(jsonStr, nullptr, true) : nullptr;
         if(nullptr != root) {
             cJSON* disableBatteryCheckItem = cJSON_GetObjectItem(root, "disableBatteryCheck");
             cJSON* battCriticalThresholdMilliItem = cJSON_GetObjectItem(root, "battCriticalThresholdMilli");
@@ -339,6 +443,13 @@ SettingsManager::err_t SettingsManager::updateHardwareConfig(const char* const j
             cJSON* fillLevelCriticalThresholdPercent10Item = cJSON_GetObjectItem(root, "fillLevelCriticalThresholdPercent10");
             cJSON* fillLevelLowThresholdPercent10Item = cJSON_GetObjectItem(root, "fillLevelLowThresholdPercent10");
             cJSON* fillLevelHysteresisPercent10Item = cJSON_GetObjectItem(root, "fillLevelHysteresisPercent10");
+            cJSON* battVoltageDeadbandMilliItem = cJSON_GetObjectItem(root, "battVoltageDeadbandMilli");
+            cJSON* fillLevelDeadbandPercent10Item = cJSON_GetObjectItem(root, "fillLevelDeadbandPercent10");
+            cJSON* stateEncodingItem = cJSON_GetObjectItem(root, "stateEncoding");
+            cJSON* telemetryEncodingItem = cJSON_GetObjectItem(root, "telemetryEncoding");
+            cJSON* timezoneItem = cJSON_GetObjectItem(root, "timezone");
+            cJSON* latitudeItem = cJSON_GetObjectItem(root, "latitude");
+            cJSON* longitudeItem = cJSON_GetObjectItem(root, "longitude");
 
             if( (nullptr != disableBatteryCheckItem) && cJSON_IsBool(disableBatteryCheckItem) &&
                 (nullptr != battCriticalThresholdMilliItem) && cJSON_IsNumber(battCriticalThresholdMilliItem) &&
@@ -366,6 +477,73 @@ SettingsManager::err_t SettingsManager::updateHardwareConfig(const char* const j
                 ESP_LOGE(logTag, "Some mandatory hardware settings not found.");
                 ret = ERR_SETTINGS_INVALID;
             }
+
+            // deadbands are optional; use the defaults if they are not specified
+            batteryTemp.battVoltageDeadbandMilli = battVoltageDeadbandMilliDefault;
+            reservoirTemp.fillLevelDeadbandPercent10 = fillLevelDeadbandPercent10Default;
+            if(nullptr != battVoltageDeadbandMilliItem) {
+                if(cJSON_IsNumber(battVoltageDeadbandMilliItem) && (battVoltageDeadbandMilliItem->valueint >= 0)) {
+                    batteryTemp.battVoltageDeadbandMilli = battVoltageDeadbandMilliItem->valueint;
+                } else {
+                    ESP_LOGE(logTag, "Invalid battery voltage deadband found.");
+                    ret = ERR_SETTINGS_INVALID;
+                }
+            }
+            if(nullptr != fillLevelDeadbandPercent10Item) {
+                if(cJSON_IsNumber(fillLevelDeadbandPercent10Item) && (fillLevelDeadbandPercent10Item->valueint >= 0)) {
+                    reservoirTemp.fillLevelDeadbandPercent10 = fillLevelDeadbandPercent10Item->valueint;
+                } else {
+                    ESP_LOGE(logTag, "Invalid fill level deadband found.");
+                    ret = ERR_SETTINGS_INVALID;
+                }
+            }
+
+            // payload encodings are optional; JSON is used if they are not specified
+            mqttTemp.stateEncoding = PAYLOAD_JSON;
+            mqttTemp.telemetryEncoding = PAYLOAD_JSON;
+            if( (ERR_OK != jsonParsePayloadEncoding(stateEncodingItem, &mqttTemp.stateEncoding)) ||
+                (ERR_OK != jsonParsePayloadEncoding(telemetryEncodingItem, &mqttTemp.telemetryEncoding)) )
+            {
+                ESP_LOGE(logTag, "Invalid payload encoding found.");
+                ret = ERR_SETTINGS_INVALID;
+            }
+
+            // timezone is optional; keep the current one if it is not specified
+            memcpy(&timeTemp, &shadowDataTimeConfig, sizeof(time_config_t));
+            if(nullptr != timezoneItem) {
+                if( cJSON_IsString(timezoneItem) &&
+                    (CivilTime::ERR_OK == timezoneValidator.setTimezone(cJSON_GetStringValue(timezoneItem))) )
+                {
+                    strncpy(timeTemp.timezone, cJSON_GetStringValue(timezoneItem), civilTimeTzRuleMaxLen);
+                    timeTemp.timezone[civilTimeTzRuleMaxLen] = '\0';
+                } else {
+                    ESP_LOGE(logTag, "Invalid timezone rule found.");
+                    ret = ERR_SETTINGS_INVALID;
+                }
+            }
+
+            // location is optional; without it, no solar events occur
+            locationTemp.enabled = false;
+            locationTemp.latitudeMicroDeg = 0;
+            locationTemp.longitudeMicroDeg = 0;
+            if((nullptr != latitudeItem) || (nullptr != longitudeItem)) {
+                if( (nullptr != latitudeItem) && cJSON_IsNumber(latitudeItem) &&
+                    (nullptr != longitudeItem) && cJSON_IsNumber(longitudeItem) &&
+                    (fabs(latitudeItem->valuedouble) <= 90.0) && (fabs(longitudeItem->valuedouble) <= 180.0) )
+                {
+                    locationTemp.enabled = true;
+                    locationTemp.latitudeMicroDeg = (int32_t) lround(latitudeItem->valuedouble * 1000000.0);
+                    locationTemp.longitudeMicroDeg = (int32_t) lround(longitudeItem->valuedouble * 1000000.0);
+                } else {
+                    ESP_LOGE(logTag, "Invalid location found.");
+                    ret = ERR_SETTINGS_INVALID;
+                }
+            }
+        } else if(!arenaAcquired) {
+            ret = ERR_TIMEOUT;
+        } else if(jsonArena.isExhausted()) {
+            ESP_LOGE(logTag, "Hardware config too big for the JSON arena!");
+            ret = ERR_NO_RESOURCES;
         } else {
             ESP_LOGE(logTag, "Parsing JSON tree failed!");
             ret = ERR_INVALID_JSON;
@@ -373,25 +551,34 @@ SettingsManager::err_t SettingsManager::updateHardwareConfig(const char* const j
 
         if(ret == ERR_OK) {
             ESP_LOGI(logTag, "Hardware config successfully parsed.");
-            copyBatteryConfigInt(&shadowDataBatteryConfig, batteryTemp);
-            copyReservoirConfigInt(&shadowDataReservoirConfig, reservoirTemp);
+            batteryConfig.write(batteryTemp);
+            reservoirConfig.write(reservoirTemp);
+            memcpy(&shadowDataTimeConfig, &timeTemp, sizeof(time_config_t));
+            memcpy(&shadowDataLocationConfig, &locationTemp, sizeof(location_config_t));
+            memcpy(&shadowDataMqttConfig, &mqttTemp, sizeof(mqtt_config_t));
+            updateConfigRtcCopy();
         }
 
+        xSemaphoreGive(configMutex);
+
         cJSON* storePersistentPtr = cJSON_GetObjectItem(root, "storePersistent");
-        if( (nullptr != storePersistentPtr) && cJSON_IsBool(storePersistentPtr) && cJSON_IsTrue(storePersistentPtr) ) {
+        if( (ret == ERR_OK) && (nullptr != storePersistentPtr) && cJSON_IsTrue(storePersistentPtr) ) {
             ESP_LOGI(logTag, "Persistent storage of hardware config requested.");
 
-            cJSON_DetachItemViaPointer(root, storePersistentPtr);
-
-            char* jsonStrModified = cJSON_Print(root);
-            int jsonStrModifiedLen = strlen(jsonStrModified);
+            // Store the config in compact form, without the storePersistent member
+            cJSON_Delete(cJSON_DetachItemViaPointer(root, storePersistentPtr));
+            char* jsonStrModified = cJSON_PrintUnformatted(root);
 
-            if (ERR_OK != writeConfigFile(filenameHardwareConfig, jsonStrModified, jsonStrModifiedLen)) {
-                ret = ERR_FILE_IO;
+            if(nullptr == jsonStrModified) {
+                ESP_LOGE(logTag, "Printing the hardware config failed!");
+                ret = ERR_NO_RESOURCES;
+            } else {
+                ret = requestConfigFileWrite(CONFIG_FILE_HARDWARE, jsonStrModified, strlen(jsonStrModified), 0, 0);
+                cJSON_free(jsonStrModified);
             }
         }
-
-        xSemaphoreGive(configMutex);
+        cJSON_Delete(root);
+        if(arenaAcquired) jsonArena.release();
 
         if((ret == ERR_OK) && !noNotify) {
             callHardwareConfigUpdatedHooks();
@@ -403,6 +590,64 @@ SettingsManager::err_t SettingsManager::updateHardwareConfig(const char* const j
     return ret;
 }
 
+/**
+ * @brief Mount the config store (SPIFFS), unless it is mounted already. It is formatted if
+ * mounting fails.
+ * 
+ * The file access functions mount it on demand, so boots which restore the configuration
+ * from RTC memory don't need to mount it at all.
+ * 
+ * @return SettingsManager::err_t
+ */
+SettingsManager::err_t SettingsManager::mountConfigStore()
+{
+    err_t ret = ERR_OK;
+
+    if (pdFALSE == xSemaphoreTake(fileIoMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire file lock within timeout!");
+        return ERR_TIMEOUT;
+    }
+
+    if(!configStoreMounted) {
+        esp_vfs_spiffs_conf_t conf = {
+            .base_path = filepathConfigStore,
+            .partition_label = partlabelConfigStore,
+            .max_files = 4,
+            .format_if_mount_failed = true
+        };
+
+        esp_err_t espErr = esp_vfs_spiffs_register(&conf);
+
+        if (espErr != ESP_OK) {
+            if (espErr == ESP_FAIL) {
+                ESP_LOGE(logTag, "Failed to mount or format config filesystem");
+            } else if (espErr == ESP_ERR_NOT_FOUND) {
+                ESP_LOGE(logTag, "Failed to find config store partition");
+            } else {
+                ESP_LOGE(logTag, "Failed to initialize SPIFFS (%s)", esp_err_to_name(espErr));
+            }
+            ret = ERR_FILE_IO;
+        } else {
+            size_t total = 0, used = 0;
+            espErr = esp_spiffs_info(partlabelConfigStore, &total, &used);
+            if (espErr != ESP_OK) {
+                ESP_LOGE(logTag, "Failed to get partition information (%s)", esp_err_to_name(espErr));
+            } else {
+                ESP_LOGI(logTag, "Config store size: total: %u, used: %u", (unsigned int) total, (unsigned int) used);
+            }
+            configStoreMounted = true;
+
+            recoverConfigFile(filenameIrrigationConfig);
+            recoverConfigFile(filenameHardwareConfig);
+            recoverConfigFile(filenameSolarTable);
+        }
+    }
+
+    xSemaphoreGive(fileIoMutex);
+
+    return ret;
+}
+
 SettingsManager::err_t SettingsManager::readIrrigationConfigFile()
 {
     return readConfigFile(CONFIG_FILE_IRRIGATION);
@@ -417,7 +662,7 @@ SettingsManager::err_t SettingsManager::readConfigFile(config_file_type_t type)
 {
     err_t ret = ERR_OK;
     const char* filename;
-    static char settingsBuffer[8192];
+    static char hardwareBuffer[hardwareConfigJsonMaxLen];
 
     switch(type) {
         case CONFIG_FILE_IRRIGATION:
@@ -433,6 +678,8 @@ SettingsManager::err_t SettingsManager::readConfigFile(config_file_type_t type)
 
     if (ret != ERR_OK) {
         ESP_LOGE(logTag, "Invalid config file type specified.");
+    } else if (ERR_OK != mountConfigStore()) {
+        ret = ERR_FILE_IO;
     } else {
         struct stat st;
         if (stat(filename, &st) == 0) {
@@ -444,29 +691,23 @@ SettingsManager::err_t SettingsManager::readConfigFile(config_file_type_t type)
                 if (f == NULL) {
                     ESP_LOGW(logTag, "Failed to open irrigation config file for reading.");
                     ret = ERR_FILE_IO;
+                } else if(CONFIG_FILE_IRRIGATION == type) {
+                    // The irrigation config is parsed while being read
+                    ESP_LOGI(logTag, "Updating irrigation config from file.");
+                    ret = updateIrrigationConfig(nullptr, 0, f, true);
+                    fclose(f);
                 } else {
                     size_t bytesRead;
 
-                    bytesRead = fread(settingsBuffer, sizeof(char), sizeof(settingsBuffer), f);
+                    bytesRead = fread(hardwareBuffer, sizeof(char), sizeof(hardwareBuffer), f);
                     fclose(f);
 
-                    if(bytesRead == sizeof(settingsBuffer)) {
+                    if(bytesRead == sizeof(hardwareBuffer)) {
                         ESP_LOGW(logTag, "Config file too big for read buffer. Not reading it in.");
                         ret = ERR_FILE_IO;
                     } else if(bytesRead > 0) {
-                        switch(type) {
-                            case CONFIG_FILE_IRRIGATION:
-                                ESP_LOGI(logTag, "Updating irrigation config from file.");
-                                ret = updateIrrigationConfig(settingsBuffer, bytesRead, true);
-                                break;
-                            case CONFIG_FILE_HARDWARE:
-                                ESP_LOGI(logTag, "Updating hardware config from file.");
-                                ret = updateHardwareConfig(settingsBuffer, bytesRead, true);
-                                break;
-                            default:
-                                ret = ERR_INVALID_ARG;
-                                break;
-                        }
+                        ESP_LOGI(logTag, "Updating hardware config from file.");
+                        ret = updateHardwareConfig(hardwareBuffer, bytesRead, true);
                     }
                 }
                 xSemaphoreGive(fileIoMutex);
@@ -480,84 +721,651 @@ SettingsManager::err_t SettingsManager::readConfigFile(config_file_type_t type)
     return ret;
 }
 
-SettingsManager::err_t SettingsManager::writeConfigFile(const char* const filename, const char* const jsonData, int jsonDataLen)
+/**
+ * @brief Fill the storable form of the configuration. The config lock must be held.
+ * 
+ * @param data Destination of the data. The event records have to be added separately.
+ * @param config Irrigation config snapshot to be stored.
+ */
+void SettingsManager::fillConfigImageData(config_image_data_t* data, const irrigation_config_t& config)
+{
+    memset(data, 0, sizeof(config_image_data_t));
+
+    batteryConfig.read(&data->battery);
+    reservoirConfig.read(&data->reservoir);
+    memcpy(&data->time, &shadowDataTimeConfig, sizeof(time_config_t));
+    memcpy(&data->location, &shadowDataLocationConfig, sizeof(location_config_t));
+    memcpy(&data->mqtt, &shadowDataMqttConfig, sizeof(mqtt_config_t));
+    memcpy(data->zones, config.zones, sizeof(data->zones));
+    data->numEvents = config.events.numUsed();
+}
+
+/**
+ * @brief Publish a configuration in storable form. The config lock must be held.
+ * 
+ * @param data Data of the configuration, followed by the event records.
+ * @param len Length of the data and event records.
+ * @return SettingsManager::err_t
+ */
+SettingsManager::err_t SettingsManager::applyConfigImage(const config_image_data_t* data, size_t len)
+{
+    const config_image_event_t* events = (const config_image_event_t*) &data[1];
+
+    if( (len < sizeof(config_image_data_t)) || (data->numEvents > irrigationPlannerNumNormalEvents) ||
+        (len != (sizeof(config_image_data_t) + data->numEvents * sizeof(config_image_event_t))) )
+    {
+        ESP_LOGE(logTag, "Stored configuration has an invalid length!");
+        return ERR_SETTINGS_INVALID;
+    }
+
+    int targetIdx = findFreeIrrigationConfig();
+    if(targetIdx < 0) {
+        ESP_LOGE(logTag, "Previous irrigation configs are still in use!");
+        return ERR_TIMEOUT;
+    }
+    irrigation_config_t& settingsTemp = irrigConfigs[targetIdx];
+
+    memcpy(settingsTemp.zones, data->zones, sizeof(settingsTemp.zones));
+    clearEventData(settingsTemp);
+    for(unsigned int i = 0; i < data->numEvents; i++) {
+        if( !settingsTemp.events.claim(events[i].idx) ||
+            (IrrigationEvent::ERR_OK != settingsTemp.events[events[i].idx].setDefinition(events[i].definition)) )
+        {
+            ESP_LOGE(logTag, "Invalid event in stored configuration!");
+            return ERR_SETTINGS_INVALID;
+        }
+    }
+
+    irrigConfigGeneration++;
+    settingsTemp.generation = irrigConfigGeneration;
+    irrigConfigActive.store(targetIdx);
+
+    batteryConfig.write(data->battery);
+    reservoirConfig.write(data->reservoir);
+    memcpy(&shadowDataTimeConfig, &data->time, sizeof(time_config_t));
+    memcpy(&shadowDataLocationConfig, &data->location, sizeof(location_config_t));
+    memcpy(&shadowDataMqttConfig, &data->mqtt, sizeof(mqtt_config_t));
+
+    return ERR_OK;
+}
+
+/**
+ * @brief Load the configuration from the config image instead of parsing the defaults
+ * and config files, i.e. without any JSON parsing.
+ * 
+ * The image is validated and applied in place via a memory mapping of the flash, so it
+ * isn't copied into a buffer first. Must be called at boot before any other config update,
+ * like init(). The config updated hooks aren't called.
+ * 
+ * @return SettingsManager::err_t
+ * @retval ERR_OK The configuration has been loaded.
+ * @retval ERR_FILE_IO No valid image of this firmware is available.
+ */
+SettingsManager::err_t SettingsManager::loadConfigImage()
 {
     err_t ret = ERR_OK;
+    const void* mapPtr;
+    spi_flash_mmap_handle_t mapHandle;
 
-    if (pdFALSE == xSemaphoreTake(fileIoMutex, lockAcquireTimeout)) {
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partlabelConfigImage);
+    if(nullptr == partition) {
+        ESP_LOGI(logTag, "No config image partition found.");
+        return ERR_FILE_IO;
+    }
+
+    if(ESP_OK != esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapPtr, &mapHandle)) {
+        ESP_LOGE(logTag, "Mapping the config image failed!");
+        return ERR_FILE_IO;
+    }
+
+    const uint8_t* image = (const uint8_t*) mapPtr;
+    const config_image_header_t* header = (const config_image_header_t*) image;
+    const config_image_data_t* data = (const config_image_data_t*) &image[configImageDataOffset];
+
+    if((configImageMagic != header->magic) || (calcConfigImageKey() != header->key)) {
+        ESP_LOGI(logTag, "No config image of this firmware found.");
+        ret = ERR_FILE_IO;
+    } else if( (header->payloadLen > (partition->size - configImageDataOffset)) ||
+        (header->payloadCrc != crc32_le(0, (const uint8_t*) data, header->payloadLen)) )
+    {
+        ESP_LOGW(logTag, "Config image is corrupted!");
+        ret = ERR_FILE_IO;
+    } else if (pdFALSE == xSemaphoreTake(configMutex, lockAcquireTimeout)) {
         ESP_LOGE(logTag, "Couldn't acquire config lock within timeout!");
         ret = ERR_TIMEOUT;
     } else {
-        FILE* f = fopen(filename, "w");
-        if (f == NULL) {
-            ESP_LOGW(logTag, "Failed to open config file for writing.");
+        ret = applyConfigImage(data, header->payloadLen);
+        if(ERR_OK == ret) {
+            ESP_LOGI(logTag, "Configuration loaded from config image.");
+            updateConfigRtcCopy();
+        }
+
+        xSemaphoreGive(configMutex);
+    }
+
+    spi_flash_munmap(mapHandle);
+
+    return ret;
+}
+
+/**
+ * @brief Store the published configuration as config image, which loadConfigImage() uses on
+ * the next boots.
+ * 
+ * The image must only reflect the defaults and config files, so call it at boot right
+ * after they have been parsed. Configuration updates stored persistently invalidate it.
+ * 
+ * @return SettingsManager::err_t
+ */
+SettingsManager::err_t SettingsManager::storeConfigImage()
+{
+    err_t ret = ERR_OK;
+    static config_image_data_t data;
+    static config_image_event_t eventRecord;
+    config_image_header_t header;
+    const irrigation_config_t* config;
+
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partlabelConfigImage);
+    if(nullptr == partition) return ERR_FILE_IO;
+
+    if (pdFALSE == xSemaphoreTake(configMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire config lock within timeout!");
+        return ERR_TIMEOUT;
+    }
+    // The snapshot stays unchanged while acquired, the flash is written without the config lock
+    config = acquireIrrigationConfig();
+    if(nullptr != config) {
+        fillConfigImageData(&data, *config);
+    }
+    xSemaphoreGive(configMutex);
+
+    if(nullptr == config) return ERR_SETTINGS_INVALID;
+
+    header.magic = 0xFFFFFFFF;
+    header.key = calcConfigImageKey();
+    header.payloadLen = sizeof(config_image_data_t) + data.numEvents * sizeof(config_image_event_t);
+    header.payloadCrc = crc32_le(0, (const uint8_t*) &data, sizeof(config_image_data_t));
+
+    size_t imageLen = configImageDataOffset + header.payloadLen;
+    if(imageLen > partition->size) {
+        ESP_LOGE(logTag, "Config image doesn't fit into its partition (%u bytes)!", (unsigned int) imageLen);
+        releaseIrrigationConfig(config);
+        return ERR_NO_RESOURCES;
+    }
+
+    if (pdFALSE == xSemaphoreTake(fileIoMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire file lock within timeout!");
+        ret = ERR_TIMEOUT;
+    } else {
+        size_t eraseLen = ((imageLen + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE) * SPI_FLASH_SEC_SIZE;
+        esp_err_t flashErr = esp_partition_erase_range(partition, 0, eraseLen);
+
+        if(ESP_OK == flashErr) {
+            flashErr = esp_partition_write(partition, configImageDataOffset, &data, sizeof(config_image_data_t));
+        }
+
+        size_t offset = configImageEventsOffset;
+        for(int i = config->events.nextUsed(0); (i >= 0) && (ESP_OK == flashErr); i = config->events.nextUsed(i + 1)) {
+            memset(&eventRecord, 0, sizeof(config_image_event_t));
+            config->events[i].getDefinition(&eventRecord.definition);
+            eventRecord.idx = i;
+
+            header.payloadCrc = crc32_le(header.payloadCrc, (const uint8_t*) &eventRecord, sizeof(config_image_event_t));
+            flashErr = esp_partition_write(partition, offset, &eventRecord, sizeof(config_image_event_t));
+            offset += sizeof(config_image_event_t);
+        }
+
+        // Validate the image by writing the magic last (the erased word can still be written)
+        if(ESP_OK == flashErr) {
+            flashErr = esp_partition_write(partition, 0, &header, sizeof(config_image_header_t));
+        }
+        if(ESP_OK == flashErr) {
+            header.magic = configImageMagic;
+            flashErr = esp_partition_write(partition, 0, &header.magic, sizeof(header.magic));
+        }
+
+        if(ESP_OK != flashErr) {
+            ESP_LOGE(logTag, "Writing the config image failed (%s)!", esp_err_to_name(flashErr));
             ret = ERR_FILE_IO;
         } else {
-            size_t bytesWritten;
+            ESP_LOGI(logTag, "Config image written (%u bytes).", (unsigned int) imageLen);
+        }
 
-            bytesWritten = fwrite(jsonData, sizeof(char), jsonDataLen, f);
-            fclose(f);
+        xSemaphoreGive(fileIoMutex);
+    }
 
-            if(bytesWritten != jsonDataLen) {
-                ESP_LOGW(logTag, "Error writing config file. Deleting it.");
-                unlink(filename);
-                ret = ERR_FILE_IO;
+    releaseIrrigationConfig(config);
+
+    return ret;
+}
+
+/**
+ * @brief Restore the configuration from its copy in RTC memory, which is kept during deep
+ * sleep. Neither the config store nor the config image are accessed.
+ * 
+ * Must be called at boot before any other config update, like init(). The config updated
+ * hooks aren't called.
+ * 
+ * @return SettingsManager::err_t
+ * @retval ERR_OK The configuration has been restored.
+ * @retval ERR_SETTINGS_INVALID There is no valid copy, e.g. after a cold boot.
+ */
+SettingsManager::err_t SettingsManager::loadConfigRtcCopy()
+{
+    err_t ret = ERR_OK;
+
+    if( (0 == configRtcData.len) || (configRtcData.len > sizeof(configRtcData.payload)) ||
+        (configRtcData.crc != calcConfigRtcCrc()) )
+    {
+        ESP_LOGI(logTag, "No valid config copy in RTC memory.");
+        ret = ERR_SETTINGS_INVALID;
+    } else if (pdFALSE == xSemaphoreTake(configMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire config lock within timeout!");
+        ret = ERR_TIMEOUT;
+    } else {
+        ret = applyConfigImage((const config_image_data_t*) configRtcData.payload, configRtcData.len);
+        if(ERR_OK == ret) {
+            ESP_LOGI(logTag, "Configuration restored from RTC memory (generation %u).", configRtcData.generation);
+        }
+
+        xSemaphoreGive(configMutex);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Update the copy of the published configuration in RTC memory after an accepted
+ * update. The config lock must be held.
+ */
+void SettingsManager::updateConfigRtcCopy()
+{
+    int idx = irrigConfigActive.load();
+    const irrigation_config_t& config = irrigConfigs[(idx < 0) ? 0 : idx];
+    config_image_data_t* data = (config_image_data_t*) configRtcData.payload;
+    config_image_event_t* events = (config_image_event_t*) &data[1];
+    size_t len = sizeof(config_image_data_t) + config.events.numUsed() * sizeof(config_image_event_t);
+
+    configRtcData.generation++;
+    configRtcData.len = 0;
+
+    if(idx < 0) {
+        // Without irrigation config, the update is incomplete
+    } else if(len > sizeof(configRtcData.payload)) {
+        ESP_LOGW(logTag, "Config doesn't fit into RTC memory. It is read from flash after deep sleep.");
+    } else {
+        fillConfigImageData(data, config);
+        for(int i = config.events.nextUsed(0); i >= 0; i = config.events.nextUsed(i + 1)) {
+            memset(events, 0, sizeof(config_image_event_t));
+            config.events[i].getDefinition(&events->definition);
+            events->idx = i;
+            events++;
+        }
+        configRtcData.len = len;
+    }
+
+    configRtcData.crc = calcConfigRtcCrc();
+}
+
+/**
+ * @brief Invalidate the config image, because the config files are about to change.
+ * It is recreated on the next boot.
+ */
+void SettingsManager::invalidateConfigImage()
+{
+    uint32_t magic;
+
+    const esp_partition_t* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partlabelConfigImage);
+    if(nullptr == partition) return;
+
+    if (pdFALSE == xSemaphoreTake(fileIoMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire file lock within timeout!");
+    } else {
+        // Only erase a valid image, so repeated updates don't wear the flash
+        if( (ESP_OK != esp_partition_read(partition, 0, &magic, sizeof(magic))) || (configImageMagic == magic) ) {
+            ESP_LOGI(logTag, "Invalidating config image.");
+            esp_partition_erase_range(partition, 0, SPI_FLASH_SEC_SIZE);
+        }
+        xSemaphoreGive(fileIoMutex);
+    }
+}
+
+/**
+ * @brief Request a config file to be written to the config store. The content is copied,
+ * so the caller's data isn't needed after the call.
+ * 
+ * The file is written by the persistence task, if it is running, otherwise right away.
+ * A newer request for the same file replaces a pending one, so only the latest content
+ * is written. Must not be called while holding the config lock.
+ * 
+ * @param type File to be written.
+ * @param data Content of the file.
+ * @param len Length of the content.
+ * @param skipOffset Offset of a range of the content to leave out.
+ * @param skipLen Length of the range to leave out, 0 to write all data.
+ * @return SettingsManager::err_t
+ */
+SettingsManager::err_t SettingsManager::requestConfigFileWrite(config_file_type_t type, const char* const data, size_t len,
+    size_t skipOffset, size_t skipLen)
+{
+    pending_config_file_t& file = pendingConfigFiles[type];
+
+    portENTER_CRITICAL(&configStoreStatsMux);
+    configStoreStats.requests++;
+    portEXIT_CRITICAL(&configStoreStatsMux);
+
+    if((len - skipLen) > file.maxLen) {
+        ESP_LOGE(logTag, "Config too long to be stored (%u bytes)!", (unsigned int) (len - skipLen));
+        return ERR_NO_RESOURCES;
+    }
+
+    // Waits for a write in progress
+    if (pdFALSE == xSemaphoreTake(persistMutex, persistLockTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire persistence lock within timeout!");
+        return ERR_TIMEOUT;
+    }
+
+    memcpy(file.data, data, skipOffset);
+    memcpy(&file.data[skipOffset], &data[skipOffset + skipLen], len - skipOffset - skipLen);
+    file.len = len - skipLen;
+    if(!file.pending) {
+        // Don't go to sleep before the file is written
+        pwrMgr.setKeepAwakeForce(true);
+        file.pending = true;
+    }
+
+    xSemaphoreGive(persistMutex);
+
+    if(nullptr != persistTaskHandle) {
+        xSemaphoreGive(persistRequestSem);
+    } else {
+        writePendingConfigFiles();
+    }
+
+    return ERR_OK;
+}
+
+/**
+ * @brief Write the pending config files. Files already having the same content aren't
+ * written again, which saves flash wear if the same config is pushed repeatedly.
+ */
+void SettingsManager::writePendingConfigFiles()
+{
+    for(int i = 0; i < CONFIG_FILE_COUNT; i++) {
+        pending_config_file_t& file = pendingConfigFiles[i];
+
+        if (pdFALSE == xSemaphoreTake(persistMutex, persistLockTimeout)) {
+            ESP_LOGE(logTag, "Couldn't acquire persistence lock within timeout!");
+            // The request semaphore may have been taken already, so retry later
+            xSemaphoreGive(persistRequestSem);
+            return;
+        }
+
+        if(file.pending) {
+            if(configFileMatches(file.filename, file.data, file.len)) {
+                ESP_LOGI(logTag, "Config file %s is up to date already. Not writing it.", file.filename);
+                portENTER_CRITICAL(&configStoreStatsMux);
+                configStoreStats.skippedWrites++;
+                portEXIT_CRITICAL(&configStoreStatsMux);
             } else {
-                ESP_LOGI(logTag, "Config file written successfully.");
+                // The config image is recreated from the changed files on the next boot
+                invalidateConfigImage();
+                writeConfigFile(file.filename, file.data, file.len);
             }
 
+            file.pending = false;
+            pwrMgr.setKeepAwakeForce(false);
         }
-        xSemaphoreGive(fileIoMutex);
+
+        xSemaphoreGive(persistMutex);
     }
+}
 
-    return ret;
+/**
+ * @brief Check if a config file has a given content, using a CRC32 of its content.
+ * 
+ * @return true if the file exists and has the same length and CRC32 as the content.
+ */
+bool SettingsManager::configFileMatches(const char* const filename, const char* const data, size_t len)
+{
+    static uint8_t readChunk[configFileReadChunkLen]; // only used while holding the file lock
+    bool matches = false;
+    struct stat st;
+
+    if (ERR_OK != mountConfigStore()) return false;
+
+    if (pdFALSE == xSemaphoreTake(fileIoMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire file lock within timeout!");
+        return false;
+    }
+
+    if((0 == stat(filename, &st)) && ((size_t) st.st_size == len)) {
+        FILE* f = fopen(filename, "r");
+        if(nullptr != f) {
+            uint32_t fileCrc = 0;
+            size_t bytesRead, totalRead = 0;
+
+            while(0 < (bytesRead = fread(readChunk, 1, sizeof(readChunk), f))) {
+                fileCrc = crc32_le(fileCrc, readChunk, bytesRead);
+                totalRead += bytesRead;
+            }
+            fclose(f);
+
+            matches = (totalRead == len) && (fileCrc == crc32_le(0, (const uint8_t*) data, len));
+        }
+    }
+
+    xSemaphoreGive(fileIoMutex);
+
+    return matches;
 }
 
-SettingsManager::err_t SettingsManager::copyZonesAndEvents(
-    irrigation_zone_cfg_t* zones, IrrigationEvent* events, bool* eventsUsed)
+/**
+ * @brief Write a config file, replacing it atomically.
+ * 
+ * The data is written to a temporary file first, which is marked as complete by renaming
+ * it after it has been closed successfully. The complete file then replaces the file.
+ * SPIFFS can't rename onto an existing file, so the file is removed right before the
+ * rename. If this is interrupted, the config store is repaired when it is mounted the next
+ * time (see recoverConfigFile()). An interrupted write therefore never leaves a truncated
+ * file.
+ * 
+ * @param filename Name of the file.
+ * @param data Data to be written.
+ * @param len Length of the data.
+ * @return SettingsManager::err_t
+ */
+SettingsManager::err_t SettingsManager::writeConfigFile(const char* const filename, const char* const data, size_t len)
 {
     err_t ret = ERR_OK;
+    char tempFilename[configFilenameMaxLen];
+    char newFilename[configFilenameMaxLen];
 
-    if((nullptr == zones) || (nullptr == events) || (nullptr == eventsUsed)) {
+    if( (sizeof(tempFilename) <= (size_t) snprintf(tempFilename, sizeof(tempFilename), "%s%s", filename, configFileTempSuffix)) ||
+        (sizeof(newFilename) <= (size_t) snprintf(newFilename, sizeof(newFilename), "%s%s", filename, configFileNewSuffix)) )
+    {
         return ERR_INVALID_ARG;
     }
 
-    if(pdFALSE == xSemaphoreTake(configMutex, lockAcquireTimeout)) {
-        ESP_LOGE(logTag, "Couldn't acquire config lock within timeout!");
+    if (ERR_OK != mountConfigStore()) {
+        ret = ERR_FILE_IO;
+    } else if (pdFALSE == xSemaphoreTake(fileIoMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire file lock within timeout!");
         ret = ERR_TIMEOUT;
     } else {
-        memcpy(zones, shadowDataIrrigationConfig.zones, sizeof(irrigation_zone_cfg_t) * irrigationZoneCfgElements);
-        // TBD: handling of single shot event; currently not implemented in IrrigationPlanner
-        for(int i = 0; i < irrigationPlannerNumNormalEvents; i++) {
-            events[i] = shadowDataIrrigationConfig.events[i];
-            eventsUsed[i] = shadowDataIrrigationConfig.eventsUsed[i];
+        FILE* f = fopen(tempFilename, "w");
+        if (f == NULL) {
+            ESP_LOGW(logTag, "Failed to open config file for writing.");
+            ret = ERR_FILE_IO;
+        } else {
+            size_t bytesWritten = fwrite(data, sizeof(char), len, f);
+
+            if((0 != fclose(f)) || (bytesWritten != len)) {
+                ESP_LOGW(logTag, "Error writing config file. Deleting it.");
+                unlink(tempFilename);
+                ret = ERR_FILE_IO;
+            } else if(0 != rename(tempFilename, newFilename)) {
+                ESP_LOGW(logTag, "Marking the written config file as complete failed. Deleting it.");
+                unlink(tempFilename);
+                ret = ERR_FILE_IO;
+            } else {
+                unlink(filename);
+                if(0 != rename(newFilename, filename)) {
+                    // Recovered on the next mount
+                    ESP_LOGW(logTag, "Renaming the written config file failed.");
+                    ret = ERR_FILE_IO;
+                }
+            }
         }
+        xSemaphoreGive(fileIoMutex);
+    }
 
-        xSemaphoreGive(configMutex);
+    portENTER_CRITICAL(&configStoreStatsMux);
+    if(ERR_OK == ret) {
+        configStoreStats.writes++;
+        configStoreStats.bytesWritten += len;
+    } else {
+        configStoreStats.failedWrites++;
+    }
+    config_store_stats_t stats = configStoreStats;
+    portEXIT_CRITICAL(&configStoreStatsMux);
+
+    if(ERR_OK == ret) {
+        ESP_LOGI(logTag, "Config file %s written (%u bytes). Config store: %u writes, %u bytes in total.",
+            filename, (unsigned int) len, stats.writes, stats.bytesWritten);
     }
 
     return ret;
 }
 
-void SettingsManager::copyBatteryConfigInt(battery_config_t* dst, battery_config_t& src)
+/**
+ * @brief Repair a config file after its write has been interrupted (see writeConfigFile()).
+ * The file lock must be held.
+ * 
+ * A temporary file is incomplete and removed. A temporary file marked as complete holds
+ * the newest content, so it replaces the file, regardless of wether or not the file has
+ * been removed already.
+ */
+void SettingsManager::recoverConfigFile(const char* const filename)
 {
-    dst->disableBatteryCheck = src.disableBatteryCheck;
-    dst->battCriticalThresholdMilli = src.battCriticalThresholdMilli;
-    dst->battLowThresholdMilli = src.battLowThresholdMilli;
-    dst->battOkThresholdMilli = src.battOkThresholdMilli;
+    char tempFilename[configFilenameMaxLen];
+    struct stat st;
+
+    snprintf(tempFilename, sizeof(tempFilename), "%s%s", filename, configFileTempSuffix);
+    if(0 == stat(tempFilename, &st)) {
+        ESP_LOGW(logTag, "Removing incomplete config file %s.", tempFilename);
+        unlink(tempFilename);
+    }
+
+    snprintf(tempFilename, sizeof(tempFilename), "%s%s", filename, configFileNewSuffix);
+    if(0 == stat(tempFilename, &st)) {
+        ESP_LOGW(logTag, "Completing interrupted write of config file %s.", filename);
+        unlink(filename);
+        rename(tempFilename, filename);
+    }
 }
 
-void SettingsManager::copyReservoirConfigInt(reservoir_config_t* dst, reservoir_config_t& src)
+/**
+ * @brief Copy the config store statistics, e.g. to watch the flash wear.
+ *
+ * @param dst Destination of the copy.
+ */
+void SettingsManager::getConfigStoreStats(config_store_stats_t* dst)
 {
-    dst->disableReservoirCheck = src.disableReservoirCheck;
-    dst->fillLevelMaxVal = src.fillLevelMaxVal;
-    dst->fillLevelMinVal = src.fillLevelMinVal;
-    dst->fillLevelCriticalThresholdPercent10 = src.fillLevelCriticalThresholdPercent10;
-    dst->fillLevelLowThresholdPercent10 = src.fillLevelLowThresholdPercent10;
-    dst->fillLevelHysteresisPercent10 = src.fillLevelHysteresisPercent10;
+    portENTER_CRITICAL(&configStoreStatsMux);
+    memcpy(dst, &configStoreStats, sizeof(config_store_stats_t));
+    portEXIT_CRITICAL(&configStoreStatsMux);
 }
 
+/**
+ * @brief Acquire the published irrigation config snapshot.
+ * 
+ * The snapshot stays unchanged until it is released again, even if a newer one is
+ * published in the meantime. Readers should switch to newer snapshots at their next
+ * safe point (see registerIrrigConfigUpdatedHook()), because updates can only be applied
+ * as long as at most one previous snapshot is acquired.
+ * 
+ * @return const irrigation_config_t* Snapshot or nullptr if none has been published yet.
+ */
+const irrigation_config_t* SettingsManager::acquireIrrigationConfig()
+{
+    while(true) {
+        int idx = irrigConfigActive.load();
+        if(idx < 0) return nullptr;
+
+        irrigConfigRefCount[idx]++;
+        // Retry if the snapshot has been replaced in the meantime; it may be rewritten already.
+        if(idx == irrigConfigActive.load()) {
+            return &irrigConfigs[idx];
+        }
+        irrigConfigRefCount[idx]--;
+    }
+}
+
+/**
+ * @brief Find a snapshot to parse an irrigation config update into, i.e. one which is
+ * neither published nor acquired by readers. The config lock must be held.
+ * 
+ * @return int Index of the snapshot, -1 if all are in use.
+ */
+int SettingsManager::findFreeIrrigationConfig()
+{
+    int activeIdx = irrigConfigActive.load();
+
+    for(int i = 0; i < numIrrigConfigs; i++) {
+        if((i != activeIdx) && (0 == irrigConfigRefCount[i].load())) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Release an irrigation config snapshot acquired via acquireIrrigationConfig().
+ * 
+ * @param config Snapshot to be released.
+ */
+void SettingsManager::releaseIrrigationConfig(const irrigation_config_t* config)
+{
+    if((config >= &irrigConfigs[0]) && (config < &irrigConfigs[numIrrigConfigs])) {
+        irrigConfigRefCount[config - irrigConfigs]--;
+    } else {
+        ESP_LOGE(logTag, "Invalid irrigation config released!");
+    }
+}
+
+/**
+ * @brief Copy the battery config. Doesn't block, even while the config is being updated.
+ *
+ * @param dst Destination of the copy.
+ * @return SettingsManager::err_t
+ */
 SettingsManager::err_t SettingsManager::copyBatteryConfig(battery_config_t* dst)
+{
+    if(nullptr == dst) return ERR_INVALID_ARG;
+
+    batteryConfig.read(dst);
+
+    return ERR_OK;
+}
+
+/**
+ * @brief Copy the reservoir config. Doesn't block, even while the config is being updated.
+ *
+ * @param dst Destination of the copy.
+ * @return SettingsManager::err_t
+ */
+SettingsManager::err_t SettingsManager::copyReservoirConfig(reservoir_config_t* dst)
+{
+    if(nullptr == dst) return ERR_INVALID_ARG;
+
+    reservoirConfig.read(dst);
+
+    return ERR_OK;
+}
+
+SettingsManager::err_t SettingsManager::copyTimeConfig(time_config_t* dst)
 {
     err_t ret = ERR_OK;
 
@@ -567,14 +1375,31 @@ SettingsManager::err_t SettingsManager::copyBatteryConfig(battery_config_t* dst)
         ESP_LOGE(logTag, "Couldn't acquire config lock within timeout!");
         ret = ERR_TIMEOUT;
     } else {
-        copyBatteryConfigInt(dst, shadowDataBatteryConfig);
+        memcpy(dst, &shadowDataTimeConfig, sizeof(time_config_t));
         xSemaphoreGive(configMutex);
     }
 
     return ret;
 }
 
-SettingsManager::err_t SettingsManager::copyReservoirConfig(reservoir_config_t* dst)
+SettingsManager::err_t SettingsManager::copyLocationConfig(location_config_t* dst)
+{
+    err_t ret = ERR_OK;
+
+    if(nullptr == dst) return ERR_INVALID_ARG;
+
+    if(pdFALSE == xSemaphoreTake(configMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire config lock within timeout!");
+        ret = ERR_TIMEOUT;
+    } else {
+        memcpy(dst, &shadowDataLocationConfig, sizeof(location_config_t));
+        xSemaphoreGive(configMutex);
+    }
+
+    return ret;
+}
+
+SettingsManager::err_t SettingsManager::copyMqttConfig(mqtt_config_t* dst)
 {
     err_t ret = ERR_OK;
 
@@ -584,13 +1409,99 @@ SettingsManager::err_t SettingsManager::copyReservoirConfig(reservoir_config_t*
         ESP_LOGE(logTag, "Couldn't acquire config lock within timeout!");
         ret = ERR_TIMEOUT;
     } else {
-        copyReservoirConfigInt(dst, shadowDataReservoirConfig);
+        memcpy(dst, &shadowDataMqttConfig, sizeof(mqtt_config_t));
         xSemaphoreGive(configMutex);
     }
 
     return ret;
 }
 
+/**
+ * @brief Bring the solar table in line with the configured location.
+ * 
+ * The table is restored from its copy in RTC memory, which persists during deep sleep.
+ * Otherwise it is read from the config store if it was stored for the configured location
+ * before, or it is calculated and stored. So the calculation is only needed once after a
+ * location change and the config store isn't accessed on a wakeup.
+ * 
+ * @return SettingsManager::err_t
+ * @retval ERR_OK The solar table is up to date.
+ * @retval ERR_TIMEOUT Config or file lock couldn't be acquired.
+ * @retval ERR_FILE_IO The table couldn't be stored. It is active nevertheless.
+ */
+SettingsManager::err_t SettingsManager::updateSolarTable()
+{
+    err_t ret;
+    location_config_t location;
+    bool tableValid = false;
+
+    ret = copyLocationConfig(&location);
+    if(ERR_OK != ret) return ret;
+
+    if(!location.enabled) {
+        solarTable.clearTable();
+        return ERR_OK;
+    }
+
+    if(solarTable.isSetFor(location.latitudeMicroDeg, location.longitudeMicroDeg)) return ERR_OK;
+
+    if( (solarRtcData.crc == calcSolarRtcCrc()) &&
+        SolarTable::isValid(solarRtcData.table, location.latitudeMicroDeg, location.longitudeMicroDeg) )
+    {
+        ESP_LOGI(logTag, "Solar table restored from RTC memory.");
+        solarTable.setTable(solarRtcData.table);
+        return ERR_OK;
+    }
+
+    if(ERR_OK != mountConfigStore()) return ERR_FILE_IO;
+
+    if (pdFALSE == xSemaphoreTake(fileIoMutex, lockAcquireTimeout)) {
+        ESP_LOGE(logTag, "Couldn't acquire file lock within timeout!");
+        return ERR_TIMEOUT;
+    }
+
+    // The copy is invalid while the table is replaced
+    solarRtcData.crc = ~calcSolarRtcCrc();
+
+    FILE* f = fopen(filenameSolarTable, "r");
+    if (f != NULL) {
+        size_t bytesRead = fread(&solarRtcData.table, 1, sizeof(solarRtcData.table), f);
+        fclose(f);
+
+        tableValid = (sizeof(solarRtcData.table) == bytesRead) &&
+            SolarTable::isValid(solarRtcData.table, location.latitudeMicroDeg, location.longitudeMicroDeg);
+    }
+
+    xSemaphoreGive(fileIoMutex);
+
+    if(tableValid) {
+        ESP_LOGI(logTag, "Using stored solar table.");
+    } else {
+        ESP_LOGI(logTag, "Calculating solar table for the configured location.");
+        SolarTable::calculate(location.latitudeMicroDeg, location.longitudeMicroDeg, &solarRtcData.table);
+
+        if (ERR_OK != writeConfigFile(filenameSolarTable, (const char*) &solarRtcData.table, sizeof(solarRtcData.table))) {
+            ret = ERR_FILE_IO;
+        }
+    }
+
+    solarTable.setTable(solarRtcData.table);
+    solarRtcData.crc = calcSolarRtcCrc();
+
+    return ret;
+}
+
+void SettingsManager::solarTableUpdateHookDispatch(void* param)
+{
+    SettingsManager* manager = (SettingsManager*) param;
+
+    if(nullptr == manager) {
+        ESP_LOGE("unkown", "No valid SettingsManager available to dispatch hardware config events to!");
+    } else {
+        manager->updateSolarTable();
+    }
+}
+
 SettingsManager::err_t SettingsManager::registerIrrigConfigUpdatedHook(ConfigUpdatedHookFncPtr hook, void* param)
 {
     err_t ret = ERR_OK;
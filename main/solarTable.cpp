@@ -0,0 +1,199 @@
+#include "solarTable.h"
+
+#include <cmath>
+
+#include "civilTime.h"
+
+/**
+ * @brief Default constructor. No table is set, i.e. no solar events occur.
+ */
+SolarTable::SolarTable(void)
+{
+    activeTable = -1;
+    generation = 0;
+}
+
+/**
+ * @brief Calculate the sunrise/sunset table for the given location.
+ *
+ * The calculation uses the NOAA general solar position approximation in single precision,
+ * because the ESP32 FPU doesn't support double precision. The result is accurate within a
+ * few minutes, which is sufficient for irrigation. The sun is considered to rise/set when
+ * its upper limb touches the horizon, including atmospheric refraction.
+ *
+ * @param latitudeMicroDeg Latitude in micro degrees (north positive).
+ * @param longitudeMicroDeg Longitude in micro degrees (east positive).
+ * @param dest Table to store the results in.
+ */
+void SolarTable::calculate(int32_t latitudeMicroDeg, int32_t longitudeMicroDeg, solar_table_data_t* dest)
+{
+    float lat = latitudeMicroDeg / 1000000.0f;
+    float lon = longitudeMicroDeg / 1000000.0f;
+    const float epochCorrectionDays = 1.25f;
+
+    dest->version = solarTableVersion;
+    dest->latitudeMicroDeg = latitudeMicroDeg;
+    dest->longitudeMicroDeg = longitudeMicroDeg;
+
+    for(int i = 0; i < solarTableNumDays; i++) {
+        // Zero-based day of year averaged over the leap year cycle, i.e. the days after
+        // February 29th are one day earlier in three of four years.
+        float dayOfYear = (i < 59) ? (float) i : ((i == 59) ? 59.0f : (i - 0.75f));
+        // The approximation's fractional year is fitted to an older epoch. Compensate the calendar
+        // drift of the seasons for the table's lifetime (checked by tools/solarTableCheck.cpp).
+        dayOfYear += epochCorrectionDays;
+
+        dest->eventMinutesUtc[SUNRISE][i] = calcEventMinutes(lat, lon, dayOfYear, SUNRISE);
+        dest->eventMinutesUtc[SUNSET][i] = calcEventMinutes(lat, lon, dayOfYear, SUNSET);
+    }
+}
+
+/**
+ * @brief Calculate a single solar event.
+ *
+ * The sun's position is first evaluated at noon and then once more at the
+ * estimated event time, because the declination changes notably within half a day.
+ *
+ * @param lat Latitude in degrees (north positive).
+ * @param lon Longitude in degrees (east positive).
+ * @param dayOfYear Zero-based day of year.
+ * @param event Event to be calculated.
+ * @return int16_t Event time in minutes after midnight UTC or noEvent.
+ */
+int16_t SolarTable::calcEventMinutes(float lat, float lon, float dayOfYear, solar_event_t event)
+{
+    const float degToRad = 0.017453292f;
+    const float radToDeg = 57.29577951f;
+
+    float cosZenith = cosf(90.833f * degToRad);
+    float latRad = lat * degToRad;
+    float minutes = 720.0f - 4.0f * lon;
+    bool valid = true;
+
+    for(int iter = 0; iter < 2; iter++) {
+        // Fractional year at the current estimate of the event time
+        float gamma = (2.0f * (float) M_PI / 365.2422f) * (dayOfYear + (minutes - 720.0f) / 1440.0f);
+
+        float eqTimeMinutes = 229.18f * (0.000075f + 0.001868f * cosf(gamma) - 0.032077f * sinf(gamma) -
+            0.014615f * cosf(2.0f * gamma) - 0.040849f * sinf(2.0f * gamma));
+        float decl = 0.006918f - 0.399912f * cosf(gamma) + 0.070257f * sinf(gamma) -
+            0.006758f * cosf(2.0f * gamma) + 0.000907f * sinf(2.0f * gamma) -
+            0.002697f * cosf(3.0f * gamma) + 0.00148f * sinf(3.0f * gamma);
+
+        float cosHourAngle = cosZenith / (cosf(latRad) * cosf(decl)) - tanf(latRad) * tanf(decl);
+
+        // polar night or midnight sun
+        valid = (cosHourAngle <= 1.0f) && (cosHourAngle >= -1.0f);
+        if(!valid) continue;
+
+        float hourAngle = acosf(cosHourAngle) * radToDeg;
+        float noonMinutes = 720.0f - 4.0f * lon - eqTimeMinutes;
+        minutes = (SUNRISE == event) ? (noonMinutes - 4.0f * hourAngle) : (noonMinutes + 4.0f * hourAngle);
+    }
+
+    return valid ? (int16_t) lroundf(minutes) : noEvent;
+}
+
+/**
+ * @brief Check if a (e.g. stored) table is usable for the given location.
+ *
+ * @param data Table to be checked.
+ * @param latitudeMicroDeg Latitude in micro degrees (north positive).
+ * @param longitudeMicroDeg Longitude in micro degrees (east positive).
+ * @return true if the table matches the current version and location, false otherwise.
+ */
+bool SolarTable::isValid(const solar_table_data_t& data, int32_t latitudeMicroDeg, int32_t longitudeMicroDeg)
+{
+    return (solarTableVersion == data.version) && (latitudeMicroDeg == data.latitudeMicroDeg) &&
+        (longitudeMicroDeg == data.longitudeMicroDeg);
+}
+
+/**
+ * @brief Get the table index of a day.
+ *
+ * @param days Days since 1970-01-01 (UTC).
+ * @return int Table index 0..365.
+ */
+int SolarTable::getTableIndex(int64_t days)
+{
+    int year, month, day;
+    CivilTime::civilFromDays(days, &year, &month, &day);
+
+    int idx = (int) (days - CivilTime::daysFromCivil(year, 1, 1));
+    // Skip February 29th of the table in non-leap years
+    if(!CivilTime::isLeapYear(year) && (idx >= 59)) idx++;
+
+    return idx;
+}
+
+/**
+ * @brief Activate a new table.
+ *
+ * @param data Table to be used.
+ */
+void SolarTable::setTable(const solar_table_data_t& data)
+{
+    int inactiveTable = (activeTable < 0) ? 0 : (activeTable ^ 1);
+
+    tables[inactiveTable] = data;
+
+    activeTable = inactiveTable;
+    generation = generation + 1;
+}
+
+/**
+ * @brief Deactivate the table, i.e. no solar events occur anymore.
+ */
+void SolarTable::clearTable(void)
+{
+    if(activeTable >= 0) {
+        activeTable = -1;
+        generation = generation + 1;
+    }
+}
+
+bool SolarTable::isSet(void) const
+{
+    return (activeTable >= 0);
+}
+
+/**
+ * @brief Check if a table for the given location is active.
+ */
+bool SolarTable::isSetFor(int32_t latitudeMicroDeg, int32_t longitudeMicroDeg) const
+{
+    int idx = activeTable;
+    return (idx >= 0) && isValid(tables[idx], latitudeMicroDeg, longitudeMicroDeg);
+}
+
+/**
+ * @brief Get the generation of the active table. It changes each time a new
+ * table is activated or the table is cleared.
+ */
+uint32_t SolarTable::getGeneration(void) const
+{
+    return generation;
+}
+
+/**
+ * @brief Get the time of a solar event on the specified day.
+ *
+ * Note: Depending on the longitude, the returned time may be before or after the
+ * specified day, i.e. negative or above one day.
+ *
+ * @param event Event to look up.
+ * @param days Days since 1970-01-01 (UTC).
+ * @param secsUtc Event time in seconds after midnight UTC of the specified day.
+ * @return true if the event occurs on that day, false otherwise (or if no table is set).
+ */
+bool SolarTable::getEventTime(solar_event_t event, int64_t days, int32_t* secsUtc) const
+{
+    int idx = activeTable;
+    if(idx < 0) return false;
+
+    int16_t minutes = tables[idx].eventMinutesUtc[event][getTableIndex(days)];
+    if(noEvent == minutes) return false;
+
+    *secsUtc = (int32_t) minutes * 60;
+    return true;
+}
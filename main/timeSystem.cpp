@@ -1,6 +1,7 @@
 #include "timeSystem.h"
 
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <sys/time.h>
 #include <vector>
@@ -13,6 +14,7 @@
 #include "esp_sntp.h"
 
 #include "wifiEvents.h"
+#include "globalComponents.h"
 
 
 // ********************************************************************
@@ -67,9 +69,8 @@ extern "C" void TimeSystem_Init(void)
     ESP_LOGI(LOG_TAG_TIME, "Checking if time is already set.");
     time(&now);
 
-    // set correct timezone
-    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
-    tzset();
+    // set default timezone; the configured one will be applied with the hardware config
+    TimeSystem_SetTimezone(TimeSystem_defaultTimezone);
     localtime_r(&now, &timeinfo);
 
     // Is time set? If not, tm_year will be (1970 - 1900).
@@ -83,6 +84,48 @@ extern "C" void TimeSystem_Init(void)
     }
 }
 
+// ********************************************************************
+// timezone handling
+// ********************************************************************
+/**
+ * @brief Set the timezone of the system.
+ *
+ * The rule is applied to the CivilTime engine used for scheduling as well as
+ * to newlib (for logging and string representations).
+ *
+ * @param posixTz POSIX TZ rule, e.g. "CET-1CEST,M3.5.0,M10.5.0/3"
+ * @return int 0 on success, -1 if the rule is invalid.
+ */
+extern "C" int TimeSystem_SetTimezone(const char* posixTz)
+{
+    if(CivilTime::ERR_OK != civilTime.setTimezone(posixTz)) {
+        ESP_LOGE(LOG_TAG_TIME, "Invalid timezone rule. Keeping %s.", civilTime.getTimezone());
+        return -1;
+    }
+
+    setenv("TZ", posixTz, 1);
+    tzset();
+
+    return 0;
+}
+
+/**
+ * @brief Hardware config updated hook, which applies the configured timezone.
+ *
+ * @param param Unused
+ */
+extern "C" void TimeSystem_HardwareConfigUpdated(void* param)
+{
+    SettingsManager::time_config_t timeConf;
+
+    if(SettingsManager::ERR_OK == settingsMgr.copyTimeConfig(&timeConf)) {
+        if(0 != strcmp(timeConf.timezone, civilTime.getTimezone())) {
+            ESP_LOGI(LOG_TAG_TIME, "Applying timezone %s.", timeConf.timezone);
+            TimeSystem_SetTimezone(timeConf.timezone);
+        }
+    }
+}
+
 // ********************************************************************
 // time getters and setters
 // ********************************************************************
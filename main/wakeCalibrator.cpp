@@ -0,0 +1,109 @@
+#include "wakeCalibrator.h"
+
+#include <cstring>
+#include <sys/time.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+
+/** Calibration data kept in RTC memory */
+typedef struct wake_calibrator_rtc_data_t {
+    int64_t plannedWakeMillis;                              /**< Planned wakeup time of the current deep sleep, 0 if none */
+    uint32_t delayMillis[WakeCalibrator::sampleCount];      /**< Delays of the last timer wakeups */
+    unsigned int head;                                      /**< Index the next delay is stored at */
+    unsigned int count;                                     /**< Number of valid delays */
+} wake_calibrator_rtc_data_t;
+
+RTC_DATA_ATTR static wake_calibrator_rtc_data_t wakeCalibratorData = {};
+
+/**
+ * @brief Get the current time in milliseconds since the epoch.
+ */
+int64_t WakeCalibrator::getNowMillis(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, nullptr);
+    return ((int64_t) tv.tv_sec * 1000) + (tv.tv_usec / 1000);
+}
+
+/**
+ * @brief Remember the planned wakeup time. Must be called right before entering deep sleep.
+ *
+ * @param sleepMillis Deep sleep duration in milliseconds
+ */
+void WakeCalibrator::sleepPlanned(int sleepMillis)
+{
+    wakeCalibratorData.plannedWakeMillis = getNowMillis() + sleepMillis;
+}
+
+/**
+ * @brief Record the delay between the planned wakeup and now. Must be called once after
+ * boot, as soon as the controller is ready to process events.
+ *
+ * Nothing is recorded if the system didn't wake up by the deep sleep timer.
+ *
+ * @param recordDelay Wether the delay of this wake should be learned from. Wakes which
+ * take a different path than the ones before events should be skipped.
+ */
+void WakeCalibrator::controllerReady(bool recordDelay)
+{
+    int64_t plannedWakeMillis = wakeCalibratorData.plannedWakeMillis;
+
+    wakeCalibratorData.plannedWakeMillis = 0;
+    if((!recordDelay) || (0 == plannedWakeMillis) || (ESP_SLEEP_WAKEUP_TIMER != esp_sleep_get_wakeup_cause())) {
+        return;
+    }
+
+    int64_t delayMillis = getNowMillis() - plannedWakeMillis;
+    if(delayMillis < 0) delayMillis = 0;
+    if(delayMillis > maxDelayMillis) delayMillis = maxDelayMillis;
+
+    wakeCalibratorData.delayMillis[wakeCalibratorData.head] = (uint32_t) delayMillis;
+    wakeCalibratorData.head = (wakeCalibratorData.head + 1) % sampleCount;
+    if(wakeCalibratorData.count < sampleCount) wakeCalibratorData.count++;
+
+    ESP_LOGD(logTag, "Ready %u ms after the planned wakeup.", (uint32_t) delayMillis);
+}
+
+/**
+ * @brief Get the time in milliseconds the deep sleep timer should fire before an event.
+ *
+ * @param fallbackMillis Margin to use as long as there aren't enough delays recorded
+ * @return The learned margin, i.e. the marginPercentile of the recorded delays plus
+ * guardMillis, or fallbackMillis.
+ */
+int WakeCalibrator::getMarginMillis(int fallbackMillis) const
+{
+    uint32_t sorted[sampleCount];
+    unsigned int count = wakeCalibratorData.count;
+
+    if(count < minSamples) return fallbackMillis;
+
+    // Insertion sort is fine for this few samples
+    memcpy(sorted, wakeCalibratorData.delayMillis, count * sizeof(sorted[0]));
+    for(unsigned int i = 1; i < count; i++) {
+        uint32_t val = sorted[i];
+        unsigned int j = i;
+        while((j > 0) && (sorted[j-1] > val)) {
+            sorted[j] = sorted[j-1];
+            j--;
+        }
+        sorted[j] = val;
+    }
+
+    // Nearest rank percentile
+    unsigned int rank = (marginPercentile * count + 99) / 100;
+    if(rank < 1) rank = 1;
+
+    return (int) (sorted[rank-1] + guardMillis);
+}
+
+/**
+ * @brief Get the number of recorded delays.
+ */
+unsigned int WakeCalibrator::getNumSamples(void) const
+{
+    return wakeCalibratorData.count;
+}
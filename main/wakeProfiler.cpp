@@ -0,0 +1,189 @@
+#include "wakeProfiler.h"
+
+#include <cstring>
+
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+/** Profiler data kept in RTC memory */
+typedef struct wake_profiler_rtc_data_t {
+    WakeProfiler::wake_record_t ring[WakeProfiler::wakeRingSize];   /**< Profiles of the last wakes */
+    unsigned int head;                                              /**< Index the next wake is stored at */
+    unsigned int count;                                             /**< Number of valid ring entries */
+    unsigned int wakesSincePublish;                                 /**< Wakes recorded since the last publish */
+} wake_profiler_rtc_data_t;
+
+RTC_DATA_ATTR static wake_profiler_rtc_data_t wakeProfilerData = {};
+
+/**
+ * @brief Start profiling a wake.
+ *
+ * @param afterBoot Wether the system just booted. The uptime is accounted as boot phase
+ * and the wake duration includes it. Otherwise (i.e. the task just woke up from a task
+ * delay), the wake starts now.
+ */
+void WakeProfiler::startWake(bool afterBoot)
+{
+    int64_t nowUs = esp_timer_get_time();
+
+    memset(phaseAccuUs, 0, sizeof(phaseAccuUs));
+    memset(phaseStartUs, 0, sizeof(phaseStartUs));
+
+    if(afterBoot) {
+        wakeStartUs = 0;
+        phaseAccuUs[PHASE_BOOT] = nowUs;
+    } else {
+        wakeStartUs = nowUs;
+    }
+    wakeActive = true;
+}
+
+/**
+ * @brief Mark the start of a phase.
+ *
+ * @param phase The phase
+ */
+void WakeProfiler::startPhase(phase_t phase)
+{
+    if(phase < PHASE_COUNT) {
+        phaseStartUs[phase] = esp_timer_get_time();
+    }
+}
+
+/**
+ * @brief Mark the end of a phase. Its duration is added to the current wake.
+ *
+ * @param phase The phase
+ */
+void WakeProfiler::endPhase(phase_t phase)
+{
+    if((phase < PHASE_COUNT) && (0 != phaseStartUs[phase])) {
+        phaseAccuUs[phase] += esp_timer_get_time() - phaseStartUs[phase];
+        phaseStartUs[phase] = 0;
+    }
+}
+
+/**
+ * @brief Finish profiling the current wake and store it in the ring buffer.
+ *
+ * This must be called right before the system goes to sleep (deep sleep or task delay).
+ */
+void WakeProfiler::endWake(void)
+{
+    if(!wakeActive) return;
+
+    wake_record_t* record = &wakeProfilerData.ring[wakeProfilerData.head];
+
+    record->wakeTime = time(nullptr);
+    for(unsigned int i = 0; i < PHASE_COUNT; i++) {
+        record->phaseMillis[i] = (uint32_t) (phaseAccuUs[i] / 1000);
+    }
+    record->totalMillis = (uint32_t) ((esp_timer_get_time() - wakeStartUs) / 1000);
+
+    wakeProfilerData.head = (wakeProfilerData.head + 1) % wakeRingSize;
+    if(wakeProfilerData.count < wakeRingSize) wakeProfilerData.count++;
+    wakeProfilerData.wakesSincePublish++;
+
+    wakeActive = false;
+}
+
+/**
+ * @brief Check if the aggregates should be published, i.e. the ring buffer
+ * has been filled with new wakes since the last publish.
+ */
+bool WakeProfiler::isPublishDue(void) const
+{
+    return (wakeProfilerData.wakesSincePublish >= wakeRingSize);
+}
+
+/**
+ * @brief Mark the current aggregates as published.
+ */
+void WakeProfiler::setPublished(void)
+{
+    wakeProfilerData.wakesSincePublish = 0;
+}
+
+/**
+ * @brief Add a single duration to an aggregate.
+ *
+ * @param aggr Aggregate to update. The average is calculated from the sum.
+ * @param sum Sum of all durations added so far. Will be updated.
+ * @param millis Duration to add
+ * @param first Wether this is the first duration of the aggregate
+ */
+void WakeProfiler::updateAggregate(aggregate_t* aggr, uint64_t* sum, uint32_t millis, bool first)
+{
+    if(first || (millis < aggr->minMillis)) aggr->minMillis = millis;
+    if(first || (millis > aggr->maxMillis)) aggr->maxMillis = millis;
+    *sum += millis;
+}
+
+/**
+ * @brief Calculate the min/avg/max aggregates over the wakes in the ring buffer.
+ *
+ * @param dst Destination of the aggregates
+ */
+void WakeProfiler::getAggregates(aggregates_t* dst) const
+{
+    uint64_t phaseSums[PHASE_COUNT] = {};
+    uint64_t totalSum = 0;
+    unsigned int count = wakeProfilerData.count;
+
+    memset(dst, 0, sizeof(aggregates_t));
+    dst->numWakes = count;
+    if(0 == count) return;
+
+    for(unsigned int w = 0; w < count; w++) {
+        const wake_record_t* record = &wakeProfilerData.ring[w];
+
+        for(unsigned int i = 0; i < PHASE_COUNT; i++) {
+            updateAggregate(&dst->phases[i], &phaseSums[i], record->phaseMillis[i], (0 == w));
+        }
+        updateAggregate(&dst->total, &totalSum, record->totalMillis, (0 == w));
+    }
+
+    for(unsigned int i = 0; i < PHASE_COUNT; i++) {
+        dst->phases[i].avgMillis = (uint32_t) (phaseSums[i] / count);
+    }
+    dst->total.avgMillis = (uint32_t) (totalSum / count);
+}
+
+/**
+ * @brief Add an aggregate as [min,avg,max] array.
+ */
+void WakeProfiler::addAggregate(JsonWriter* writer, const char* key, const aggregate_t& aggr)
+{
+    writer->startArray(key);
+    writer->addUint(nullptr, aggr.minMillis);
+    writer->addUint(nullptr, aggr.avgMillis);
+    writer->addUint(nullptr, aggr.maxMillis);
+    writer->endArray();
+}
+
+/**
+ * @brief Format aggregates as compact JSON, e.g.
+ * {"wakes":8,"totalMillis":[min,avg,max],"phasesMillis":{"boot":[min,avg,max],...}}
+ *
+ * @param aggr Aggregates to format
+ * @param buf Destination buffer
+ * @param bufLen Size of the destination buffer
+ * @return Length of the formatted string (excl. the terminating zero). If it is
+ * greater than or equal to bufLen, the output has been truncated.
+ */
+size_t WakeProfiler::formatAggregates(const aggregates_t& aggr, char* buf, size_t bufLen) const
+{
+    JsonWriter writer(buf, bufLen);
+
+    writer.startObject(nullptr);
+    writer.addUint("wakes", aggr.numWakes);
+    addAggregate(&writer, "totalMillis", aggr.total);
+    writer.startObject("phasesMillis");
+    for(unsigned int i = 0; i < PHASE_COUNT; i++) {
+        addAggregate(&writer, WAKE_PHASE_TO_STR(i), aggr.phases[i]);
+    }
+    writer.endObject();
+    writer.endObject();
+
+    return writer.getLength();
+}
@@ -0,0 +1,272 @@
+/**
+ * @brief Host tool to generate the default configuration of the firmware as constexpr data.
+ *
+ * The default config files are parsed and validated by the firmware's own SettingsManager,
+ * so they are subject to exactly the same checks as configs received at runtime. The
+ * published configuration is then written as initializers of the storable form (see
+ * SettingsManager::config_image_data_t), which SettingsManager::init() applies without
+ * any parsing.
+ *
+ * The tool is built by the host build (target default_config_gen, see host/CMakeLists.txt)
+ * and run by the firmware and host builds whenever the default config files change:
+ *   default_config_gen <irrigation config> <hardware config> <output header>
+ *
+ * The output is only rewritten if its content changed. The exit code is non-zero if a
+ * default config is invalid, which fails the build.
+ */
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "settingsManager.h"
+
+static SettingsManager settings;
+static SettingsManager::config_image_data_t data;
+static SettingsManager::config_image_event_t events[irrigationPlannerNumNormalEvents];
+
+static bool readFile(const char* path, std::string* content)
+{
+    char buf[256];
+    size_t len;
+    FILE* f = fopen(path, "rb");
+
+    if(nullptr == f) return false;
+    while((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+        content->append(buf, len);
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+
+    return ok;
+}
+
+static std::string fmt(const char* format, ...) __attribute__((format(printf, 1, 2)));
+static std::string fmt(const char* format, ...)
+{
+    char buf[256];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+
+    return buf;
+}
+
+static const char* baseName(const char* path)
+{
+    const char* sep = strrchr(path, '/');
+    return (nullptr != sep) ? (sep + 1) : path;
+}
+
+static const char* boolStr(bool val)
+{
+    return val ? "true" : "false";
+}
+
+/**
+ * @brief Format a string as C string literal. Non-printable chars are escaped in octal, so
+ * they can't merge with following digits.
+ */
+static std::string strLiteral(const char* str)
+{
+    std::string literal = "\"";
+
+    for(const char* c = str; '\0' != *c; c++) {
+        if(('"' == *c) || ('\\' == *c)) {
+            literal += '\\';
+            literal += *c;
+        } else if((*c < 0x20) || (*c > 0x7E)) {
+            literal += fmt("\\%03o", (unsigned int) (unsigned char) *c);
+        } else {
+            literal += *c;
+        }
+    }
+
+    return literal + "\"";
+}
+
+static bool zoneIsEmpty(const irrigation_zone_cfg_t& zone)
+{
+    if('\0' != zone.name[0]) return false;
+    for(unsigned int i = 0; i < irrigationZoneCfgElements; i++) {
+        if(zone.chEnabled[i]) return false;
+    }
+    return true;
+}
+
+static std::string boolArray(const bool* vals, unsigned int num)
+{
+    std::string out = "{";
+    for(unsigned int i = 0; i < num; i++) {
+        out += fmt("%s%s", (i > 0) ? ", " : "", boolStr(vals[i]));
+    }
+    return out + "}";
+}
+
+/**
+ * @brief Collect the published configuration in storable form.
+ *
+ * @return Number of zones up to the last one in use. The remaining zones are empty.
+ */
+static unsigned int collectConfig(void)
+{
+    unsigned int numZones = 0;
+    const irrigation_config_t* config = settings.acquireIrrigationConfig();
+
+    if(nullptr == config) return 0;
+
+    settings.copyBatteryConfig(&data.battery);
+    settings.copyReservoirConfig(&data.reservoir);
+    settings.copyTimeConfig(&data.time);
+    settings.copyLocationConfig(&data.location);
+    settings.copyMqttConfig(&data.mqtt);
+    memcpy(data.zones, config->zones, sizeof(data.zones));
+    for(unsigned int i = 0; i < irrigationPlannerNumZones; i++) {
+        if(!zoneIsEmpty(data.zones[i])) numZones = i + 1;
+    }
+
+    data.numEvents = 0;
+    for(int i = config->events.nextUsed(0); i >= 0; i = config->events.nextUsed(i + 1)) {
+        memset(&events[data.numEvents], 0, sizeof(SettingsManager::config_image_event_t));
+        config->events[i].getDefinition(&events[data.numEvents].definition);
+        events[data.numEvents].idx = i;
+        data.numEvents++;
+    }
+
+    settings.releaseIrrigationConfig(config);
+
+    return numZones;
+}
+
+static std::string generateHeader(const char* irrigConfigPath, const char* hardwareConfigPath, unsigned int numZones)
+{
+    unsigned int maxEventIdx = 0;
+    std::string out;
+
+    out += "/*\n";
+    out += fmt(" * Default configuration, generated by tools/defaultConfigGen.cpp from %s and %s.\n",
+        baseName(irrigConfigPath), baseName(hardwareConfigPath));
+    out += " * Do not edit, change the default config files instead.\n";
+    out += " */\n\n";
+    out += "#ifndef DEFAULT_CONFIG_H\n#define DEFAULT_CONFIG_H\n\n";
+    out += "#include \"settingsManager.h\"\n\n";
+
+    out += fmt("static constexpr unsigned int defaultConfigNumZones = %u;\n", numZones);
+    out += fmt("static constexpr unsigned int defaultConfigNumEvents = %u;\n\n", (unsigned int) data.numEvents);
+
+    out += "/** Default configuration in storable form, followed by its event records (at least one for the array size) */\n";
+    out += "typedef struct default_config_t {\n";
+    out += "    SettingsManager::config_image_data_t data;\n";
+    out += "    SettingsManager::config_image_event_t events[defaultConfigNumEvents ? defaultConfigNumEvents : 1];\n";
+    out += "} default_config_t;\n\n";
+
+    out += "static constexpr default_config_t defaultConfig = {\n";
+    out += "    {\n";
+    out += fmt("        {%s, %d, %d, %d, %d},\n", boolStr(data.battery.disableBatteryCheck),
+        data.battery.battCriticalThresholdMilli, data.battery.battLowThresholdMilli,
+        data.battery.battOkThresholdMilli, data.battery.battVoltageDeadbandMilli);
+    out += fmt("        {%s, %d, %d, %d, %d, %d, %d},\n", boolStr(data.reservoir.disableReservoirCheck),
+        data.reservoir.fillLevelMaxVal, data.reservoir.fillLevelMinVal,
+        data.reservoir.fillLevelCriticalThresholdPercent10, data.reservoir.fillLevelLowThresholdPercent10,
+        data.reservoir.fillLevelHysteresisPercent10, data.reservoir.fillLevelDeadbandPercent10);
+    out += "        {" + strLiteral(data.time.timezone) + "},\n";
+    out += fmt("        {%s, %d, %d},\n", boolStr(data.location.enabled),
+        (int) data.location.latitudeMicroDeg, (int) data.location.longitudeMicroDeg);
+    out += fmt("        {(payload_encoding_t) %d, (payload_encoding_t) %d},\n",
+        (int) data.mqtt.stateEncoding, (int) data.mqtt.telemetryEncoding);
+
+    out += "        {\n";
+    for(unsigned int i = 0; i < numZones; i++) {
+        const irrigation_zone_cfg_t& zone = data.zones[i];
+        std::string chNum = "{";
+        for(unsigned int j = 0; j < irrigationZoneCfgElements; j++) {
+            chNum += fmt("%s(OutputController::ch_map_t) %d", (j > 0) ? ", " : "", (int) zone.chNum[j]);
+        }
+        chNum += "}";
+
+        out += "            {" + strLiteral(zone.name) + ", " + boolArray(zone.chEnabled, irrigationZoneCfgElements) + ",\n";
+        out += "                " + chNum + ",\n";
+        out += "                " + boolArray(zone.chStateStart, irrigationZoneCfgElements) + ", " +
+            boolArray(zone.chStateStop, irrigationZoneCfgElements) + "}";
+        out += (i + 1 < numZones) ? ",\n" : "\n";
+    }
+    out += "        },\n";
+    out += "        defaultConfigNumEvents\n";
+    out += "    },\n";
+
+    out += "    {\n";
+    for(unsigned int i = 0; i < data.numEvents; i++) {
+        const IrrigationEvent::event_definition_t& def = events[i].definition;
+        const IrrigationEvent::recurrence_t& rec = def.recurrence;
+
+        out += fmt("        {{{0x%016llxull, 0x%08xu, 0x%08xu, 0x%04x, 0x%02x, %u},\n",
+            (unsigned long long) rec.minutes, (unsigned int) rec.hours, (unsigned int) rec.daysOfMonth,
+            (unsigned int) rec.months, (unsigned int) rec.weekdays, (unsigned int) rec.second);
+        out += fmt("            %uu, %d, %d, %d, %u, %u, %u, %u, %u, %u, %u, %s}, %u}",
+            (unsigned int) def.durationSecs, (int) def.solarOffsetSecs, (int) def.zoneIdx, (int) def.year,
+            (unsigned int) def.month, (unsigned int) def.day, (unsigned int) def.hour, (unsigned int) def.minute,
+            (unsigned int) def.second, (unsigned int) def.repetitionType, (unsigned int) def.solarEvent,
+            boolStr(def.isStart), (unsigned int) events[i].idx);
+        out += (i + 1 < data.numEvents) ? ",\n" : "\n";
+        if(events[i].idx > maxEventIdx) maxEventIdx = events[i].idx;
+    }
+    out += "    }\n";
+    out += "};\n\n";
+
+    // The firmware may be built with another capacity policy than this tool
+    out += "static_assert(defaultConfigNumZones <= irrigationPlannerNumZones, \"The default config has too many zones\");\n";
+    out += fmt("static_assert(%u < irrigationPlannerNumNormalEvents, \"The default config has too many events\");\n",
+        (0 == data.numEvents) ? 0 : maxEventIdx);
+    out += "\n#endif /* DEFAULT_CONFIG_H */\n";
+
+    return out;
+}
+
+int main(int argc, char** argv)
+{
+    std::string irrigConfig;
+    std::string hardwareConfig;
+    std::string previous;
+
+    if(4 != argc) {
+        fprintf(stderr, "Usage: %s <irrigation config> <hardware config> <output header>\n", argv[0]);
+        return 2;
+    }
+
+    if(!readFile(argv[1], &irrigConfig) || !readFile(argv[2], &hardwareConfig)) {
+        fprintf(stderr, "Error: Reading the default config files failed!\n");
+        return 1;
+    }
+
+    // The configs are validated like received ones
+    SettingsManager::err_t err = settings.updateIrrigationConfig(irrigConfig.c_str(), irrigConfig.length() + 1, true);
+    if(SettingsManager::ERR_OK != err) {
+        fprintf(stderr, "Error: %s is invalid (%d)!\n", argv[1], err);
+        return 1;
+    }
+    err = settings.updateHardwareConfig(hardwareConfig.c_str(), hardwareConfig.length() + 1, true);
+    if(SettingsManager::ERR_OK != err) {
+        fprintf(stderr, "Error: %s is invalid (%d)!\n", argv[2], err);
+        return 1;
+    }
+
+    unsigned int numZones = collectConfig();
+    std::string header = generateHeader(argv[1], argv[2], numZones);
+
+    // Keep the timestamp of an unchanged header, so dependent objects aren't rebuilt
+    if(readFile(argv[3], &previous) && (previous == header)) return 0;
+
+    FILE* f = fopen(argv[3], "wb");
+    if((nullptr == f) || (header.length() != fwrite(header.c_str(), 1, header.length(), f))) {
+        fprintf(stderr, "Error: Writing %s failed!\n", argv[3]);
+        if(nullptr != f) fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    return 0;
+}
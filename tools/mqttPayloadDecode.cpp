@@ -0,0 +1,265 @@
+/**
+ * @brief Host tool to decode CBOR encoded MQTT payloads of the controller into JSON,
+ * e.g. for logging them alongside the JSON encoded ones.
+ *
+ * The state (and state delta) maps are translated to the key names of the JSON encoding.
+ * Enums are kept as their codes and times as seconds since the epoch. The telemetry batch
+ * is wrapped into a "samples" object like in the JSON encoding.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=gnu++11 -O2 -Imain/include -o mqttPayloadDecode tools/mqttPayloadDecode.cpp
+ *   mosquitto_sub -t 'whan/irrigation/+/state' -C 1 | ./mqttPayloadDecode state
+ *   mosquitto_sub -t 'whan/irrigation/+/telemetry' -F '%x' | ./mqttPayloadDecode -x telemetry
+ *
+ * Without -x, the whole input (stdin or the given file) is a single binary payload. With -x,
+ * each input line is a hex encoded payload. Payloads starting with '{' are JSON encoded
+ * already and are passed through. The exit code is non-zero if a payload couldn't be decoded.
+ */
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mqttPayload.h"
+
+/** Names of the state keys in the JSON encoding, indexed by state_key_t */
+static const char* const stateKeyNames[STATE_KEY_COUNT] = {
+    "batteryVoltage",
+    "batteryState",
+    "reservoirFillLevel",
+    "reservoirState",
+    "activeOutputs",
+    "nextIrrigationEvent",
+    "sntpLastSync",
+    "sntpNextSync"
+};
+
+/** Maximum nesting of arrays and maps */
+static const int maxDepth = 8;
+
+/**
+ * @brief Minimal CBOR decoder, which converts a data item into JSON. Only the types
+ * the controller produces are supported.
+ */
+class CborToJson
+{
+public:
+    CborToJson(const std::vector<uint8_t>& data) : data(data), pos(0) {}
+
+    bool convert(std::string* json, bool stateKeys)
+    {
+        return convertItem(json, stateKeys, 0) && (pos == data.size());
+    }
+
+private:
+    const std::vector<uint8_t>& data;
+    size_t pos;
+
+    bool readHead(uint8_t* majorType, uint64_t* val)
+    {
+        if(pos >= data.size()) return false;
+
+        uint8_t initial = data[pos++];
+        uint8_t info = initial & 0x1F;
+        int numBytes;
+
+        *majorType = initial >> 5;
+        if(info < 24) {
+            *val = info;
+            return true;
+        } else if(info == 24) {
+            numBytes = 1;
+        } else if(info == 25) {
+            numBytes = 2;
+        } else if(info == 26) {
+            numBytes = 4;
+        } else if(info == 27) {
+            numBytes = 8;
+        } else {
+            // Indefinite lengths and reserved values aren't used by the controller
+            return false;
+        }
+
+        if((pos + numBytes) > data.size()) return false;
+        *val = 0;
+        for(int i = 0; i < numBytes; i++) {
+            *val = (*val << 8) | data[pos++];
+        }
+        return true;
+    }
+
+    bool convertItem(std::string* json, bool stateKeys, int depth)
+    {
+        uint8_t majorType;
+        uint64_t val;
+        char numStr[24];
+
+        if((depth > maxDepth) || !readHead(&majorType, &val)) return false;
+
+        switch(majorType) {
+            case 0:
+                snprintf(numStr, sizeof(numStr), "%llu", (unsigned long long) val);
+                json->append(numStr);
+                return true;
+            case 1:
+                snprintf(numStr, sizeof(numStr), "-%llu", (unsigned long long) val + 1);
+                json->append(numStr);
+                return true;
+            case 3:
+                if((pos + val) > data.size()) return false;
+                json->push_back('"');
+                for(uint64_t i = 0; i < val; i++) {
+                    char c = (char) data[pos++];
+                    if((c == '"') || (c == '\\')) json->push_back('\\');
+                    json->push_back(c);
+                }
+                json->push_back('"');
+                return true;
+            case 4:
+                json->push_back('[');
+                for(uint64_t i = 0; i < val; i++) {
+                    if(i > 0) json->push_back(',');
+                    if(!convertItem(json, false, depth + 1)) return false;
+                }
+                json->push_back(']');
+                return true;
+            case 5:
+                json->push_back('{');
+                for(uint64_t i = 0; i < val; i++) {
+                    if(i > 0) json->push_back(',');
+                    if(!convertKey(json, stateKeys)) return false;
+                    json->push_back(':');
+                    if(!convertItem(json, false, depth + 1)) return false;
+                }
+                json->push_back('}');
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool convertKey(std::string* json, bool stateKeys)
+    {
+        size_t keyPos = pos;
+        uint8_t majorType;
+        uint64_t val;
+
+        if(stateKeys && readHead(&majorType, &val) && (0 == majorType) && (val < STATE_KEY_COUNT)) {
+            json->push_back('"');
+            json->append(stateKeyNames[val]);
+            json->push_back('"');
+            return true;
+        }
+
+        // Not a known state key: JSON only allows string keys
+        pos = keyPos;
+        std::string key;
+        if(!convertItem(&key, false, maxDepth)) return false;
+        if(key[0] != '"') key = "\"" + key + "\"";
+        json->append(key);
+        return true;
+    }
+};
+
+static bool decodePayload(const std::vector<uint8_t>& payload, bool telemetry)
+{
+    std::string json;
+
+    if(!payload.empty() && (payload[0] == '{')) {
+        json.assign(payload.begin(), payload.end());
+    } else {
+        CborToJson converter(payload);
+        std::string decoded;
+
+        if(!converter.convert(&decoded, !telemetry)) {
+            fprintf(stderr, "Payload of %u bytes isn't valid CBOR.\n", (unsigned int) payload.size());
+            return false;
+        }
+        json = telemetry ? ("{\"samples\":" + decoded + "}") : decoded;
+    }
+
+    printf("%s\n", json.c_str());
+    return true;
+}
+
+static bool parseHexLine(const char* line, std::vector<uint8_t>* payload)
+{
+    payload->clear();
+    while(*line != '\0') {
+        if(isspace((unsigned char) *line)) {
+            line++;
+            continue;
+        }
+        if(!isxdigit((unsigned char) line[0]) || !isxdigit((unsigned char) line[1])) return false;
+
+        char byteStr[3] = {line[0], line[1], '\0'};
+        payload->push_back((uint8_t) strtoul(byteStr, nullptr, 16));
+        line += 2;
+    }
+    return true;
+}
+
+static void printUsage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-x] state|telemetry [file]\n", name);
+}
+
+int main(int argc, char** argv)
+{
+    bool hex = false;
+    int argIdx = 1;
+
+    if((argIdx < argc) && (0 == strcmp(argv[argIdx], "-x"))) {
+        hex = true;
+        argIdx++;
+    }
+    if(argIdx >= argc) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    bool telemetry;
+    if(0 == strcmp(argv[argIdx], "state")) {
+        telemetry = false;
+    } else if(0 == strcmp(argv[argIdx], "telemetry")) {
+        telemetry = true;
+    } else {
+        printUsage(argv[0]);
+        return 2;
+    }
+    argIdx++;
+
+    FILE* f = stdin;
+    if(argIdx < argc) {
+        f = fopen(argv[argIdx], "rb");
+        if(nullptr == f) {
+            fprintf(stderr, "Couldn't open %s.\n", argv[argIdx]);
+            return 2;
+        }
+    }
+
+    bool ok = true;
+    std::vector<uint8_t> payload;
+    if(hex) {
+        static char line[8192];
+        while(nullptr != fgets(line, sizeof(line), f)) {
+            if(!parseHexLine(line, &payload)) {
+                fprintf(stderr, "Invalid hex line.\n");
+                ok = false;
+            } else if(!payload.empty()) {
+                ok = decodePayload(payload, telemetry) && ok;
+            }
+        }
+    } else {
+        int c;
+        while(EOF != (c = fgetc(f))) payload.push_back((uint8_t) c);
+        ok = decodePayload(payload, telemetry);
+    }
+
+    if(f != stdin) fclose(f);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+/**
+ * @brief Host tool to check the precomputed solar table against a reference ephemeris.
+ *
+ * The firmware calculates its sunrise/sunset table once per location in single precision
+ * using the NOAA general solar position approximation. This tool compares each table entry
+ * over several years against the NOAA solar calculator algorithm (based on Jean Meeus'
+ * "Astronomical Algorithms"), which is evaluated in double precision for the actual date
+ * and iterated to the actual event time.
+ *
+ * Build and run from the repository root:
+ *   g++ -std=gnu++11 -O2 -Imain/include -o solarTableCheck tools/solarTableCheck.cpp main/solarTable.cpp main/civilTime.cpp
+ *   ./solarTableCheck [latitude longitude]
+ *
+ * Without arguments, a set of reference locations is checked. The exit code is non-zero if
+ * the maximum deviation exceeds the allowed error.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "civilTime.h"
+#include "solarTable.h"
+
+static const int firstYear = 2018;
+static const int lastYear = 2040;
+static const double maxAllowedErrorMinutes = 3.0;
+
+static double degToRad(double deg) { return deg * M_PI / 180.0; }
+static double radToDeg(double rad) { return rad * 180.0 / M_PI; }
+
+/**
+ * @brief Calculate a solar event using the NOAA solar calculator algorithm.
+ *
+ * @param days Days since 1970-01-01 (UTC).
+ * @param lat Latitude in degrees (north positive).
+ * @param lon Longitude in degrees (east positive).
+ * @param sunrise true for sunrise, false for sunset.
+ * @param minutesUtc Event time in minutes after midnight UTC of the specified day.
+ * @return true if the event occurs, false otherwise.
+ */
+static bool referenceEvent(int64_t days, double lat, double lon, bool sunrise, double* minutesUtc)
+{
+    double minutes = 720.0 - 4.0 * lon;
+
+    // Iterate, because the sun's position depends on the event time itself
+    for(int iter = 0; iter < 4; iter++) {
+        double jd = 2440587.5 + days + minutes / 1440.0;
+        double t = (jd - 2451545.0) / 36525.0;
+
+        double geomMeanLongSun = fmod(280.46646 + t * (36000.76983 + t * 0.0003032), 360.0);
+        double geomMeanAnomSun = 357.52911 + t * (35999.05029 - 0.0001537 * t);
+        double eccentEarthOrbit = 0.016708634 - t * (0.000042037 + 0.0000001267 * t);
+        double sunEqOfCtr = sin(degToRad(geomMeanAnomSun)) * (1.914602 - t * (0.004817 + 0.000014 * t)) +
+            sin(degToRad(2 * geomMeanAnomSun)) * (0.019993 - 0.000101 * t) +
+            sin(degToRad(3 * geomMeanAnomSun)) * 0.000289;
+        double sunTrueLong = geomMeanLongSun + sunEqOfCtr;
+        double sunAppLong = sunTrueLong - 0.00569 - 0.00478 * sin(degToRad(125.04 - 1934.136 * t));
+        double meanObliqEcliptic = 23.0 + (26.0 + ((21.448 - t * (46.815 + t * (0.00059 - t * 0.001813)))) / 60.0) / 60.0;
+        double obliqCorr = meanObliqEcliptic + 0.00256 * cos(degToRad(125.04 - 1934.136 * t));
+        double sunDeclin = radToDeg(asin(sin(degToRad(obliqCorr)) * sin(degToRad(sunAppLong))));
+        double varY = tan(degToRad(obliqCorr / 2)) * tan(degToRad(obliqCorr / 2));
+        double eqOfTime = 4 * radToDeg(varY * sin(2 * degToRad(geomMeanLongSun)) -
+            2 * eccentEarthOrbit * sin(degToRad(geomMeanAnomSun)) +
+            4 * eccentEarthOrbit * varY * sin(degToRad(geomMeanAnomSun)) * cos(2 * degToRad(geomMeanLongSun)) -
+            0.5 * varY * varY * sin(4 * degToRad(geomMeanLongSun)) -
+            1.25 * eccentEarthOrbit * eccentEarthOrbit * sin(2 * degToRad(geomMeanAnomSun)));
+
+        double cosHa = cos(degToRad(90.833)) / (cos(degToRad(lat)) * cos(degToRad(sunDeclin))) -
+            tan(degToRad(lat)) * tan(degToRad(sunDeclin));
+        if((cosHa > 1.0) || (cosHa < -1.0)) return false;
+
+        double ha = radToDeg(acos(cosHa));
+        double noon = 720.0 - 4.0 * lon - eqOfTime;
+        minutes = sunrise ? (noon - 4.0 * ha) : (noon + 4.0 * ha);
+    }
+
+    *minutesUtc = minutes;
+    return true;
+}
+
+/**
+ * @brief Check the table of a location.
+ *
+ * @return double Maximum deviation in minutes.
+ */
+static double checkLocation(double lat, double lon)
+{
+    static SolarTable::solar_table_data_t table;
+    SolarTable::calculate((int32_t) lround(lat * 1000000.0), (int32_t) lround(lon * 1000000.0), &table);
+
+    double maxError = 0.0;
+    double sumError = 0.0;
+    int numCompared = 0;
+    int numMismatchedPolar = 0;
+
+    int64_t firstDay = CivilTime::daysFromCivil(firstYear, 1, 1);
+    int64_t lastDay = CivilTime::daysFromCivil(lastYear, 12, 31);
+
+    for(int64_t d = firstDay; d <= lastDay; d++) {
+        int idx = SolarTable::getTableIndex(d);
+
+        for(int ev = SolarTable::SUNRISE; ev <= SolarTable::SUNSET; ev++) {
+            double ref;
+            bool refValid = referenceEvent(d, lat, lon, (ev == SolarTable::SUNRISE), &ref);
+            int16_t tableMinutes = table.eventMinutesUtc[ev][idx];
+
+            if(refValid != (SolarTable::noEvent != tableMinutes)) {
+                // days right at the polar circle transition are allowed to differ
+                numMismatchedPolar++;
+                continue;
+            }
+            if(!refValid) continue;
+
+            double err = fabs(tableMinutes - ref);
+            if(err > maxError) maxError = err;
+            sumError += err;
+            numCompared++;
+        }
+    }
+
+    printf("lat %8.3f lon %8.3f: max error %5.2f min, mean error %5.2f min, %d polar mismatches\n",
+        lat, lon, maxError, (numCompared > 0) ? (sumError / numCompared) : 0.0, numMismatchedPolar);
+
+    return maxError;
+}
+
+int main(int argc, char** argv)
+{
+    static const double locations[][2] = {
+        { 48.137, 11.575 },     // Munich
+        { 52.520, 13.405 },     // Berlin
+        { 59.913, 10.752 },     // Oslo
+        { 0.0, 0.0 },
+        { -33.868, 151.209 },   // Sydney
+        { -41.286, 174.776 },   // Wellington
+        { 40.713, -74.006 },    // New York
+        { 21.307, -157.858 },   // Honolulu
+    };
+    double maxError = 0.0;
+
+    if(argc == 3) {
+        maxError = checkLocation(atof(argv[1]), atof(argv[2]));
+    } else {
+        for(unsigned int i = 0; i < sizeof(locations) / sizeof(locations[0]); i++) {
+            double err = checkLocation(locations[i][0], locations[i][1]);
+            if(err > maxError) maxError = err;
+        }
+    }
+
+    if(maxError > maxAllowedErrorMinutes) {
+        printf("FAILED: maximum error exceeds %.1f minutes.\n", maxAllowedErrorMinutes);
+        return 1;
+    }
+
+    printf("OK\n");
+    return 0;
+}